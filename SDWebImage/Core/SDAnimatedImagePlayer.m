@@ -11,8 +11,9 @@
 #import "SDDisplayLink.h"
 #import "SDDeviceHelper.h"
 #import "SDInternalMacros.h"
+#import "SDMemoryPressureCoordinator.h"
 
-@interface SDAnimatedImagePlayer () {
+@interface SDAnimatedImagePlayer () <SDMemoryPressureResponder> {
     SD_LOCK_DECLARE(_lock);
     NSRunLoopMode _runLoopMode;
 }
@@ -49,7 +50,7 @@
         self.playbackRate = 1.0;
         SD_LOCK_INIT(_lock);
 #if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+        [SDMemoryPressureCoordinator.sharedCoordinator registerResponder:self priority:SDMemoryPressurePriorityAnimatedFrame];
 #endif
     }
     return self;
@@ -60,15 +61,12 @@
     return player;
 }
 
-#pragma mark - Life Cycle
+#pragma mark - SDMemoryPressureResponder
 
-- (void)dealloc {
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
-}
-
-- (void)didReceiveMemoryWarning:(NSNotification *)notification {
+- (void)memoryPressureCoordinator:(SDMemoryPressureCoordinator *)coordinator didReceiveMemoryPressure:(SDMemoryPressureLevel)level {
+    if (level == SDMemoryPressureLevelNormal) {
+        return;
+    }
     [_fetchQueue cancelAllOperations];
     [_fetchQueue addOperationWithBlock:^{
         NSNumber *currentFrameIndex = @(self.currentFrameIndex);
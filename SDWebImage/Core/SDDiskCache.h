@@ -117,6 +117,56 @@
  */
 - (NSUInteger)totalSize;
 
+@optional
+/**
+ Sets the values of many keys in the cache in one batch. This is used by the write-behind mode of `SDImageCache` (See `SDImageCacheConfig.diskCacheWriteBehindInterval`), if not implemented, `setData:forKey:` is called for each key instead.
+ The implementation can share the work for the whole batch, such as the directory creation and the file attributes. Each file is written with the same `diskCacheWritingOptions` as `setData:forKey:`.
+ This method may blocks the calling thread until file write finished.
+ 
+ @param dataBatch The data to be stored in the cache, by key.
+ */
+- (void)setDataBatch:(nonnull NSDictionary<NSString *, NSData *> *)dataBatch;
+
+/**
+ Removes the expired data from the cache incrementally, and stop when the time limit is reached. This is used by `SDImageCache` to trim the disk cache in small slices (See `SDImageCacheConfig.diskCacheTrimSliceDuration`).
+ The implementation should keep the progress, so that the next call (even after app relaunch) continue the work.
+ This method may blocks the calling thread until the time limit is reached.
+ 
+ @param timeLimit The time limit in seconds for this call.
+ @return YES if all the work is done, NO if this method should be called again.
+ */
+- (BOOL)removeExpiredDataWithTimeLimit:(NSTimeInterval)timeLimit;
+
+/**
+ Returns whether `removeExpiredDataWithTimeLimit:` has work to do, such as the cache is above the size limit or the oldest data is expired. This is checked by `SDImageCache` after each disk store, so it should be cheap and not enumerate the files.
+ If not implemented, the incremental trimming is always scheduled after disk stores.
+ 
+ @return YES if the expired data should be removed.
+ */
+- (BOOL)shouldRemoveExpiredData;
+
+/**
+ Writes the pending bookkeeping of the cache (such as the file index) to disk. This is called by `SDImageCache` when the app enters background or terminates.
+ */
+- (void)synchronize;
+
+/**
+ Returns the HTTP cache validator data associated with a given key. This is used by `SDImageCache` to revalidate the cached image with the server (See `SDImageCacheConfig.shouldStoreHTTPCacheValidators`).
+ This method may blocks the calling thread until file read finished.
+ 
+ @param key A string identifying the data.
+ @return The validator data associated with key, or nil if no value is associated with key.
+ */
+- (nullable NSData *)validatorDataForKey:(nonnull NSString *)key;
+
+/**
+ Set the HTTP cache validator data with a given key. Like the extended data, this does not override the exist disk file data.
+ 
+ @param validatorData The validator data (pass nil to remove).
+ @param key The key with which to associate the value.
+ */
+- (void)setValidatorData:(nullable NSData *)validatorData forKey:(nonnull NSString *)key;
+
 @end
 
 /**
@@ -9,14 +9,24 @@
 #import "SDDiskCache.h"
 #import "SDImageCacheConfig.h"
 #import "SDFileAttributeHelper.h"
+#import "SDDiskCacheIndex.h"
+#import "SDDownloadedFile.h"
 #import <CommonCrypto/CommonDigest.h>
+#import <sys/stat.h>
 
 static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDiskCache";
+static NSString * const SDDiskCacheValidatorAttributeName = @"com.hackemist.SDDiskCache.validator";
+static NSString * const SDDiskCacheIndexManifestName = @".com.hackemist.SDDiskCacheIndex";
+static NSString * const SDDiskCacheTrimmingMarkerName = @".com.hackemist.SDDiskCacheTrimming";
 
 @interface SDDiskCache ()
 
 @property (nonatomic, copy) NSString *diskCachePath;
 @property (nonatomic, strong, nonnull) NSFileManager *fileManager;
+@property (nonatomic, strong, nullable) SDDiskCacheIndex *index;
+@property (nonatomic, assign) BOOL trimmingLoaded;
+@property (nonatomic, assign, getter=isTrimming) BOOL trimming; // Match the trimming marker file, which keeps the progress across launches
+@property (nonatomic, assign) BOOL removedSinceSynchronize;
 
 @end
 
@@ -43,12 +53,19 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
     } else {
         self.fileManager = [NSFileManager new];
     }
+    if (self.config.shouldUseDiskCacheIndex) {
+        NSString *manifestPath = [self.diskCachePath stringByAppendingPathComponent:SDDiskCacheIndexManifestName];
+        self.index = [[SDDiskCacheIndex alloc] initWithManifestPath:manifestPath];
+    }
 }
 
 - (BOOL)containsDataForKey:(NSString *)key {
     NSParameterAssert(key);
     NSString *filePath = [self cachePathForKey:key];
     BOOL exists = [self.fileManager fileExistsAtPath:filePath];
+    if (!exists) {
+        exists = [self migrateLegacyFileForKey:key toPath:filePath];
+    }
     
     // fallback because of https://github.com/rs/SDWebImage/pull/976 that added the extension to the disk file name
     // checking the key with and without the extension
@@ -62,24 +79,40 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
 - (NSData *)dataForKey:(NSString *)key {
     NSParameterAssert(key);
     NSString *filePath = [self cachePathForKey:key];
-    NSData *data = [NSData dataWithContentsOfFile:filePath options:self.config.diskCacheReadingOptions error:nil];
+    NSData *data = [self readDataAtPath:filePath];
+    if (!data && [self migrateLegacyFileForKey:key toPath:filePath]) {
+        data = [self readDataAtPath:filePath];
+    }
     if (data) {
+        [self touchIndexForFilePath:filePath];
         return data;
     }
     
     // fallback because of https://github.com/rs/SDWebImage/pull/976 that added the extension to the disk file name
     // checking the key with and without the extension
-    data = [NSData dataWithContentsOfFile:filePath.stringByDeletingPathExtension options:self.config.diskCacheReadingOptions error:nil];
+    data = [self readDataAtPath:filePath.stringByDeletingPathExtension];
     if (data) {
+        [self touchIndexForFilePath:filePath.stringByDeletingPathExtension];
         return data;
     }
     
     return nil;
 }
 
+- (nullable NSData *)readDataAtPath:(nonnull NSString *)filePath {
+    // Choose the reading options by file size, this also avoid the error creation for missing file
+    struct stat fileStat;
+    if (stat(filePath.fileSystemRepresentation, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+        return nil;
+    }
+    NSDataReadingOptions options = [self.config diskCacheReadingOptionsForFileSize:fileStat.st_size];
+    return [NSData dataWithContentsOfFile:filePath options:options error:nil];
+}
+
 - (void)setData:(NSData *)data forKey:(NSString *)key {
     NSParameterAssert(data);
     NSParameterAssert(key);
+    [self prepareIndexIfNeeded];
     if (![self.fileManager fileExistsAtPath:self.diskCachePath]) {
         [self.fileManager createDirectoryAtPath:self.diskCachePath withIntermediateDirectories:YES attributes:nil error:NULL];
     }
@@ -89,13 +122,53 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
     // transform to NSURL
     NSURL *fileURL = [NSURL fileURLWithPath:cachePathForKey isDirectory:NO];
     
-    [data writeToURL:fileURL options:self.config.diskCacheWritingOptions error:nil];
+    BOOL success = [self writeData:data toPath:cachePathForKey];
     
     // disable iCloud backup
     if (self.config.shouldDisableiCloud) {
         // ignore iCloud backup resource value error
         [fileURL setResourceValue:@YES forKey:NSURLIsExcludedFromBackupKey error:nil];
     }
+    
+    if (success) {
+        [self updateIndexForFilePath:cachePathForKey data:data];
+    }
+}
+
+- (BOOL)writeData:(nonnull NSData *)data toPath:(nonnull NSString *)filePath {
+    // The data streamed by download operation owns a file in the cache directory, move it into place instead of writing the bytes again
+    BOOL success = SDDownloadedFileDataMoveToPath(data, filePath) || [data writeToFile:filePath options:self.config.diskCacheWritingOptions error:nil];
+    if (!success && self.fanOutLevel > 0) {
+        // The fan-out sub-directory is created lazily on the first write failure, instead of checking it for each write
+        [self.fileManager createDirectoryAtPath:filePath.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:NULL];
+        success = SDDownloadedFileDataMoveToPath(data, filePath) || [data writeToFile:filePath options:self.config.diskCacheWritingOptions error:nil];
+    }
+    return success;
+}
+
+- (void)setDataBatch:(NSDictionary<NSString *,NSData *> *)dataBatch {
+    NSParameterAssert(dataBatch);
+    if (dataBatch.count == 0) {
+        return;
+    }
+    [self prepareIndexIfNeeded];
+    if (![self.fileManager fileExistsAtPath:self.diskCachePath]) {
+        [self.fileManager createDirectoryAtPath:self.diskCachePath withIntermediateDirectories:YES attributes:nil error:NULL];
+    }
+    
+    // disable iCloud backup for the whole directory once, instead of each file
+    if (self.config.shouldDisableiCloud) {
+        NSURL *directoryURL = [NSURL fileURLWithPath:self.diskCachePath isDirectory:YES];
+        [directoryURL setResourceValue:@YES forKey:NSURLIsExcludedFromBackupKey error:nil];
+    }
+    
+    [dataBatch enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSData * _Nonnull data, BOOL * _Nonnull stop) {
+        NSString *cachePathForKey = [self cachePathForKey:key];
+        BOOL success = [self writeData:data toPath:cachePathForKey];
+        if (success) {
+            [self updateIndexForFilePath:cachePathForKey data:data];
+        }
+    }];
 }
 
 - (NSData *)extendedDataForKey:(NSString *)key {
@@ -111,22 +184,55 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
 
 - (void)setExtendedData:(NSData *)extendedData forKey:(NSString *)key {
     NSParameterAssert(key);
+    [self setExtendedAttribute:SDDiskCacheExtendedAttributeName value:extendedData forKey:key];
+}
+
+- (NSData *)validatorDataForKey:(NSString *)key {
+    NSParameterAssert(key);
+    
     // get cache Path for image key
     NSString *cachePathForKey = [self cachePathForKey:key];
     
-    if (!extendedData) {
+    NSData *validatorData = [SDFileAttributeHelper extendedAttribute:SDDiskCacheValidatorAttributeName atPath:cachePathForKey traverseLink:NO error:nil];
+    
+    return validatorData;
+}
+
+- (void)setValidatorData:(NSData *)validatorData forKey:(NSString *)key {
+    NSParameterAssert(key);
+    [self setExtendedAttribute:SDDiskCacheValidatorAttributeName value:validatorData forKey:key];
+}
+
+- (void)setExtendedAttribute:(NSString *)name value:(NSData *)value forKey:(NSString *)key {
+    // get cache Path for image key
+    NSString *cachePathForKey = [self cachePathForKey:key];
+    
+    if (!value) {
         // Remove
-        [SDFileAttributeHelper removeExtendedAttribute:SDDiskCacheExtendedAttributeName atPath:cachePathForKey traverseLink:NO error:nil];
+        [SDFileAttributeHelper removeExtendedAttribute:name atPath:cachePathForKey traverseLink:NO error:nil];
     } else {
         // Override
-        [SDFileAttributeHelper setExtendedAttribute:SDDiskCacheExtendedAttributeName value:extendedData atPath:cachePathForKey traverseLink:NO overwrite:YES error:nil];
+        [SDFileAttributeHelper setExtendedAttribute:name value:value atPath:cachePathForKey traverseLink:NO overwrite:YES error:nil];
+    }
+    
+    if (self.config.diskCacheExpireType == SDImageCacheConfigExpireTypeChangeDate) {
+        // xattr change the file status change date
+        [self prepareIndexIfNeeded];
+        [self.index touchEntryForFileName:[self indexFileNameForFilePath:cachePathForKey] date:[NSDate date].timeIntervalSince1970];
     }
 }
 
 - (void)removeDataForKey:(NSString *)key {
     NSParameterAssert(key);
     NSString *filePath = [self cachePathForKey:key];
+    [self prepareIndexIfNeeded];
     [self.fileManager removeItemAtPath:filePath error:nil];
+    [self.index removeEntryForFileName:[self indexFileNameForFilePath:filePath]];
+    // The file may be still in legacy layout or name
+    for (NSString *legacyPath in [self legacyCachePathsForKey:key filePath:filePath]) {
+        [self.fileManager removeItemAtPath:legacyPath error:nil];
+        [self.index removeEntryForFileName:[self indexFileNameForFilePath:legacyPath]];
+    }
 }
 
 - (void)removeAllData {
@@ -135,29 +241,18 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
             withIntermediateDirectories:YES
                              attributes:nil
                                   error:NULL];
+    [self.index reset];
 }
 
 - (void)removeExpiredData {
+    if (self.index) {
+        [self removeExpiredDataUsingIndex];
+        return;
+    }
     NSURL *diskCacheURL = [NSURL fileURLWithPath:self.diskCachePath isDirectory:YES];
     
     // Compute content date key to be used for tests
-    NSURLResourceKey cacheContentDateKey = NSURLContentModificationDateKey;
-    switch (self.config.diskCacheExpireType) {
-        case SDImageCacheConfigExpireTypeAccessDate:
-            cacheContentDateKey = NSURLContentAccessDateKey;
-            break;
-        case SDImageCacheConfigExpireTypeModificationDate:
-            cacheContentDateKey = NSURLContentModificationDateKey;
-            break;
-        case SDImageCacheConfigExpireTypeCreationDate:
-            cacheContentDateKey = NSURLCreationDateKey;
-            break;
-        case SDImageCacheConfigExpireTypeChangeDate:
-            cacheContentDateKey = NSURLAttributeModificationDateKey;
-            break;
-        default:
-            break;
-    }
+    NSURLResourceKey cacheContentDateKey = [self cacheContentDateKey];
     
     NSArray<NSString *> *resourceKeys = @[NSURLIsDirectoryKey, cacheContentDateKey, NSURLTotalFileAllocatedSizeKey];
     
@@ -205,9 +300,9 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
     // If our remaining disk cache exceeds a configured maximum size, perform a second
     // size-based cleanup pass.  We delete the oldest files first.
     NSUInteger maxDiskSize = self.config.maxDiskSize;
-    if (maxDiskSize > 0 && currentCacheSize > maxDiskSize) {
-        // Target half of our maximum cache size for this cleanup pass.
-        const NSUInteger desiredCacheSize = maxDiskSize / 2;
+    if (maxDiskSize > 0 && currentCacheSize > [self highWatermark]) {
+        // Target the low watermark for this cleanup pass.
+        const NSUInteger desiredCacheSize = [self lowWatermark];
         
         // Sort the remaining cache files by their last modification time or last access time (oldest first).
         NSArray<NSURL *> *sortedFiles = [cacheFiles keysSortedByValueWithOptions:NSSortConcurrent
@@ -236,28 +331,117 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
 }
 
 - (NSUInteger)totalSize {
+    if (self.index) {
+        [self prepareIndexIfNeeded];
+        return self.index.totalSize;
+    }
     NSUInteger size = 0;
     NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtPath:self.diskCachePath];
     for (NSString *fileName in fileEnumerator) {
         NSString *filePath = [self.diskCachePath stringByAppendingPathComponent:fileName];
         NSDictionary<NSString *, id> *attrs = [self.fileManager attributesOfItemAtPath:filePath error:nil];
+        // Skip the fan-out sub-directories
+        if ([attrs.fileType isEqualToString:NSFileTypeDirectory]) {
+            continue;
+        }
         size += [attrs fileSize];
     }
     return size;
 }
 
 - (NSUInteger)totalCount {
+    if (self.index) {
+        [self prepareIndexIfNeeded];
+        return self.index.totalCount;
+    }
     NSUInteger count = 0;
     NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtPath:self.diskCachePath];
-    count = fileEnumerator.allObjects.count;
+    if (self.fanOutLevel == 0) {
+        count = fileEnumerator.allObjects.count;
+        return count;
+    }
+    for (__unused NSString *fileName in fileEnumerator) {
+        // Skip the fan-out sub-directories
+        if (![fileEnumerator.fileAttributes.fileType isEqualToString:NSFileTypeDirectory]) {
+            count++;
+        }
+    }
     return count;
 }
 
 #pragma mark - Cache paths
 
 - (nullable NSString *)cachePathForKey:(nullable NSString *)key inPath:(nonnull NSString *)path {
-    NSString *filename = SDDiskCacheFileNameForKey(key);
-    return [path stringByAppendingPathComponent:filename];
+    NSString *filename;
+    if (self.config.diskCacheFileNameHash == SDImageCacheConfigFileNameHashMurmur3) {
+        filename = SDDiskCacheMurmur3FileNameForKey(key);
+    } else {
+        filename = SDDiskCacheMD5FileNameForKey(key);
+    }
+    return [self cachePathForFileName:filename inPath:path];
+}
+
+// The fan-out layout use the leading hex characters of the hashed file name as sub-directories, such as `ab/cd/abcd....png`
+- (nonnull NSString *)cachePathForFileName:(nonnull NSString *)fileName inPath:(nonnull NSString *)path {
+    NSUInteger fanOutLevel = self.fanOutLevel;
+    if (fanOutLevel == 0 || fileName.length < fanOutLevel * 2 || [fileName hasPrefix:@"."]) {
+        return [path stringByAppendingPathComponent:fileName];
+    }
+    NSMutableString *filePath = [NSMutableString stringWithString:path];
+    for (NSUInteger level = 0; level < fanOutLevel; level++) {
+        [filePath appendFormat:@"/%@", [fileName substringWithRange:NSMakeRange(level * 2, 2)]];
+    }
+    [filePath appendFormat:@"/%@", fileName];
+    return [filePath copy];
+}
+
+- (NSUInteger)fanOutLevel {
+    return MIN(self.config.diskCacheFanOutLevel, 2);
+}
+
+// The possible paths of the file created with legacy flat layout or legacy MD5 file name
+- (nullable NSArray<NSString *> *)legacyCachePathsForKey:(nonnull NSString *)key filePath:(nonnull NSString *)filePath {
+    BOOL legacyLayout = self.fanOutLevel > 0;
+    BOOL legacyName = self.config.diskCacheFileNameHash != SDImageCacheConfigFileNameHashMD5;
+    if (!legacyLayout && !legacyName) {
+        return nil;
+    }
+    NSMutableArray<NSString *> *legacyPaths = [NSMutableArray arrayWithCapacity:3];
+    if (legacyLayout) {
+        [legacyPaths addObject:[self.diskCachePath stringByAppendingPathComponent:filePath.lastPathComponent]];
+    }
+    if (legacyName) {
+        NSString *legacyFileName = SDDiskCacheMD5FileNameForKey(key);
+        [legacyPaths addObject:[self cachePathForFileName:legacyFileName inPath:self.diskCachePath]];
+        if (legacyLayout) {
+            [legacyPaths addObject:[self.diskCachePath stringByAppendingPathComponent:legacyFileName]];
+        }
+    }
+    return [legacyPaths copy];
+}
+
+// Move the file in legacy layout or name to current path when it's accessed, so the existing cache is migrated incrementally
+- (BOOL)migrateLegacyFileForKey:(nonnull NSString *)key toPath:(nonnull NSString *)filePath {
+    for (NSString *legacyPath in [self legacyCachePathsForKey:key filePath:filePath]) {
+        if ([legacyPath isEqualToString:filePath] || ![self.fileManager fileExistsAtPath:legacyPath]) {
+            continue;
+        }
+        [self.fileManager createDirectoryAtPath:filePath.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:NULL];
+        if (![self.fileManager moveItemAtPath:legacyPath toPath:filePath error:nil]) {
+            return NO;
+        }
+        if (self.index) {
+            [self prepareIndexIfNeeded];
+            NSString *legacyFileName = [self indexFileNameForFilePath:legacyPath];
+            SDDiskCacheIndexEntry *entry = [self.index entryForFileName:legacyFileName];
+            if (entry) {
+                [self.index removeEntryForFileName:legacyFileName];
+                [self.index setEntryForFileName:[self indexFileNameForFilePath:filePath] size:entry.size date:entry.date format:entry.format];
+            }
+        }
+        return YES;
+    }
+    return NO;
 }
 
 - (void)moveCacheDirectoryFromPath:(nonnull NSString *)srcPath toPath:(nonnull NSString *)dstPath {
@@ -290,11 +474,225 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
         NSDirectoryEnumerator *dirEnumerator = [self.fileManager enumeratorAtPath:srcPath];
         NSString *file;
         while ((file = [dirEnumerator nextObject])) {
-            [self.fileManager moveItemAtPath:[srcPath stringByAppendingPathComponent:file] toPath:[dstPath stringByAppendingPathComponent:file] error:nil];
+            if (self.fanOutLevel == 0) {
+                [self.fileManager moveItemAtPath:[srcPath stringByAppendingPathComponent:file] toPath:[dstPath stringByAppendingPathComponent:file] error:nil];
+                continue;
+            }
+            // Move the files (flat or fan-out) into the fan-out layout of new directory
+            if ([dirEnumerator.fileAttributes.fileType isEqualToString:NSFileTypeDirectory]) {
+                continue;
+            }
+            NSString *dstFilePath = [self cachePathForFileName:file.lastPathComponent inPath:dstPath];
+            [self.fileManager createDirectoryAtPath:dstFilePath.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:NULL];
+            [self.fileManager moveItemAtPath:[srcPath stringByAppendingPathComponent:file] toPath:dstFilePath error:nil];
         }
         // Remove the old path
         [self.fileManager removeItemAtPath:srcPath error:nil];
     }
+    if ([srcPath isEqualToString:self.diskCachePath] || [dstPath isEqualToString:self.diskCachePath]) {
+        // Files changed without the index, rebuild on next access
+        [self.index invalidate];
+    }
+}
+
+#pragma mark - Index
+
+- (NSURLResourceKey)cacheContentDateKey {
+    NSURLResourceKey cacheContentDateKey = NSURLContentModificationDateKey;
+    switch (self.config.diskCacheExpireType) {
+        case SDImageCacheConfigExpireTypeAccessDate:
+            cacheContentDateKey = NSURLContentAccessDateKey;
+            break;
+        case SDImageCacheConfigExpireTypeModificationDate:
+            cacheContentDateKey = NSURLContentModificationDateKey;
+            break;
+        case SDImageCacheConfigExpireTypeCreationDate:
+            cacheContentDateKey = NSURLCreationDateKey;
+            break;
+        case SDImageCacheConfigExpireTypeChangeDate:
+            cacheContentDateKey = NSURLAttributeModificationDateKey;
+            break;
+        default:
+            break;
+    }
+    return cacheContentDateKey;
+}
+
+// The index use the path relative to the cache directory, which contains the fan-out sub-directories
+- (nonnull NSString *)indexFileNameForFilePath:(nonnull NSString *)filePath {
+    NSString *prefix = [self.diskCachePath stringByAppendingString:@"/"];
+    if ([filePath hasPrefix:prefix]) {
+        return [filePath substringFromIndex:prefix.length];
+    }
+    return filePath.lastPathComponent;
+}
+
+- (void)updateIndexForFilePath:(nonnull NSString *)filePath data:(nonnull NSData *)data {
+    if (!self.index) {
+        return;
+    }
+    NSString *fileName = [self indexFileNameForFilePath:filePath];
+    NSTimeInterval date = [NSDate date].timeIntervalSince1970;
+    SDDiskCacheIndexEntry *entry = [self.index entryForFileName:fileName];
+    if (entry && self.config.diskCacheExpireType == SDImageCacheConfigExpireTypeCreationDate) {
+        // Overwrite does not change the creation date
+        date = entry.date;
+    }
+    [self.index setEntryForFileName:fileName size:data.length date:date format:[NSData sd_imageFormatForImageData:data]];
+}
+
+- (void)touchIndexForFilePath:(nonnull NSString *)filePath {
+    if (!self.index || self.config.diskCacheExpireType != SDImageCacheConfigExpireTypeAccessDate) {
+        return;
+    }
+    [self prepareIndexIfNeeded];
+    [self.index touchEntryForFileName:[self indexFileNameForFilePath:filePath] date:[NSDate date].timeIntervalSince1970];
+}
+
+- (void)prepareIndexIfNeeded {
+    if (!self.index || self.index.isLoaded) {
+        return;
+    }
+    if ([self.index load]) {
+        return;
+    }
+    [self rebuildIndex];
+}
+
+// The only place which need to enumerate the whole directory, when manifest is missing
+- (void)rebuildIndex {
+    [self.index reset];
+    NSURL *diskCacheURL = [NSURL fileURLWithPath:self.diskCachePath isDirectory:YES];
+    NSURLResourceKey cacheContentDateKey = [self cacheContentDateKey];
+    NSArray<NSString *> *resourceKeys = @[NSURLIsDirectoryKey, cacheContentDateKey, NSURLFileSizeKey];
+    NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtURL:diskCacheURL
+                                                   includingPropertiesForKeys:resourceKeys
+                                                                      options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                                 errorHandler:NULL];
+    NSMutableArray<NSDictionary<NSString *, id> *> *files = [NSMutableArray array];
+    for (NSURL *fileURL in fileEnumerator) {
+        NSDictionary<NSString *, id> *resourceValues = [fileURL resourceValuesForKeys:resourceKeys error:nil];
+        // Skip directories and errors.
+        if (!resourceValues || [resourceValues[NSURLIsDirectoryKey] boolValue]) {
+            continue;
+        }
+        NSMutableDictionary<NSString *, id> *file = [resourceValues mutableCopy];
+        file[NSURLPathKey] = fileURL.path;
+        [files addObject:file];
+    }
+    // Insert from the oldest to the newest
+    [files sortUsingComparator:^NSComparisonResult(NSDictionary<NSString *, id> *obj1, NSDictionary<NSString *, id> *obj2) {
+        return [obj1[cacheContentDateKey] compare:obj2[cacheContentDateKey]];
+    }];
+    for (NSDictionary<NSString *, id> *file in files) {
+        NSDate *date = file[cacheContentDateKey];
+        // Format detection need to read the file, leave it undefined for rebuilt entries
+        [self.index setEntryForFileName:[self indexFileNameForFilePath:file[NSURLPathKey]]
+                                   size:[file[NSURLFileSizeKey] unsignedIntegerValue]
+                                   date:date.timeIntervalSince1970
+                                 format:SDImageFormatUndefined];
+    }
+}
+
+- (void)removeExpiredDataUsingIndex {
+    [self removeExpiredDataWithTimeLimit:DBL_MAX];
+}
+
+- (BOOL)removeExpiredDataWithTimeLimit:(NSTimeInterval)timeLimit {
+    if (!self.index) {
+        // Can not trim incrementally without the index, fallback to one pass
+        [self removeExpiredData];
+        return YES;
+    }
+    [self prepareIndexIfNeeded];
+    CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + timeLimit;
+    NSTimeInterval expirationDate = self.config.maxDiskAge >= 0 ? [NSDate date].timeIntervalSince1970 - self.config.maxDiskAge : -DBL_MAX;
+    
+    // Start trimming above the high watermark, and keep trimming (across slices and launches) until below the low watermark
+    NSString *markerPath = [self.diskCachePath stringByAppendingPathComponent:SDDiskCacheTrimmingMarkerName];
+    BOOL trimming = NO;
+    if (self.config.maxDiskSize > 0) {
+        trimming = self.isTrimming;
+        if (!trimming && self.index.totalSize > [self highWatermark]) {
+            trimming = YES;
+            self.trimming = YES;
+            [self.fileManager createFileAtPath:markerPath contents:nil attributes:nil];
+        }
+    }
+    NSUInteger lowWatermark = [self lowWatermark];
+    
+    // Entries are ordered from the oldest, remove from the head
+    BOOL finished = YES;
+    SDDiskCacheIndexEntry *entry;
+    while ((entry = self.index.oldestEntry)) {
+        BOOL expired = entry.date <= expirationDate;
+        BOOL oversized = trimming && self.index.totalSize > lowWatermark;
+        if (!expired && !oversized) {
+            break;
+        }
+        [self removeIndexEntry:entry];
+        self.removedSinceSynchronize = YES;
+        if (CFAbsoluteTimeGetCurrent() >= deadline) {
+            finished = NO;
+            break;
+        }
+    }
+    
+    if (finished) {
+        if (trimming) {
+            self.trimming = NO;
+            [self.fileManager removeItemAtPath:markerPath error:nil];
+        }
+        // Writing the manifest is O(n), only do it when the entries are removed, the next store will remove it again anyway
+        if (self.removedSinceSynchronize) {
+            [self synchronize];
+        }
+    }
+    return finished;
+}
+
+- (BOOL)shouldRemoveExpiredData {
+    if (!self.index) {
+        return YES;
+    }
+    [self prepareIndexIfNeeded];
+    if (self.config.maxDiskSize > 0 && (self.isTrimming || self.index.totalSize > [self highWatermark])) {
+        return YES;
+    }
+    if (self.config.maxDiskAge < 0) {
+        return NO;
+    }
+    SDDiskCacheIndexEntry *oldestEntry = self.index.oldestEntry;
+    return oldestEntry && oldestEntry.date <= [NSDate date].timeIntervalSince1970 - self.config.maxDiskAge;
+}
+
+- (void)synchronize {
+    self.removedSinceSynchronize = NO;
+    [self.index synchronize];
+}
+
+- (BOOL)isTrimming {
+    if (!self.trimmingLoaded) {
+        // Check the marker once, it's kept in sync after that
+        self.trimmingLoaded = YES;
+        _trimming = [self.fileManager fileExistsAtPath:[self.diskCachePath stringByAppendingPathComponent:SDDiskCacheTrimmingMarkerName]];
+    }
+    return _trimming;
+}
+
+- (NSUInteger)highWatermark {
+    return (NSUInteger)(self.config.maxDiskSize * MAX(self.config.diskCacheHighWatermarkRatio, 0));
+}
+
+- (NSUInteger)lowWatermark {
+    return (NSUInteger)(self.config.maxDiskSize * MIN(MAX(self.config.diskCacheLowWatermarkRatio, 0), MAX(self.config.diskCacheHighWatermarkRatio, 0)));
+}
+
+- (void)removeIndexEntry:(nonnull SDDiskCacheIndexEntry *)entry {
+    NSString *filePath = [self.diskCachePath stringByAppendingPathComponent:entry.fileName];
+    [self.fileManager removeItemAtPath:filePath error:nil];
+    // Remove the entry even if file is already missing, to avoid dead loop
+    [self.index removeEntryForFileName:entry.fileName];
 }
 
 #pragma mark - Hash
@@ -303,7 +701,7 @@ static NSString * const SDDiskCacheExtendedAttributeName = @"com.hackemist.SDDis
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
-static inline NSString * _Nonnull SDDiskCacheFileNameForKey(NSString * _Nullable key) {
+static inline NSString * _Nonnull SDDiskCacheMD5FileNameForKey(NSString * _Nullable key) {
     const char *str = key.UTF8String;
     if (str == NULL) {
         str = "";
@@ -323,4 +721,109 @@ static inline NSString * _Nonnull SDDiskCacheFileNameForKey(NSString * _Nullable
 }
 #pragma clang diagnostic pop
 
+static inline uint64_t SDRotateLeft64(uint64_t x, int8_t r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t SDMurmur3Mix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+// MurmurHash3_x64_128, see https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp
+static void SDMurmur3Hash128(const uint8_t * _Nonnull data, size_t length, uint8_t result[16]) {
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    size_t blockCount = length / 16;
+    for (size_t i = 0; i < blockCount; i++) {
+        uint64_t k1, k2;
+        memcpy(&k1, data + i * 16, 8);
+        memcpy(&k2, data + i * 16 + 8, 8);
+        k1 *= c1; k1 = SDRotateLeft64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = SDRotateLeft64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = SDRotateLeft64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = SDRotateLeft64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+    // Tail bytes, read as little-endian like the reference implementation
+    size_t tailLength = length & 15;
+    uint8_t tail[16] = {0};
+    memcpy(tail, data + blockCount * 16, tailLength);
+    uint64_t k1, k2;
+    memcpy(&k1, tail, 8);
+    memcpy(&k2, tail + 8, 8);
+    if (tailLength > 8) {
+        k2 *= c2; k2 = SDRotateLeft64(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    if (tailLength > 0) {
+        k1 *= c1; k1 = SDRotateLeft64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = SDMurmur3Mix64(h1);
+    h2 = SDMurmur3Mix64(h2);
+    h1 += h2;
+    h2 += h1;
+    memcpy(result, &h1, 8);
+    memcpy(result + 8, &h2, 8);
+}
+
+// Build the file name in one buffer, without `NSURL` parsing and format string
+static inline NSString * _Nonnull SDDiskCacheMurmur3FileNameForKey(NSString * _Nullable key) {
+    static const char hexDigits[] = "0123456789abcdef";
+    const char *str = key.UTF8String;
+    if (str == NULL) {
+        str = "";
+    }
+    size_t length = strlen(str);
+    uint8_t r[16];
+    SDMurmur3Hash128((const uint8_t *)str, length, r);
+    char buffer[32 + 1 + SD_MAX_FILE_EXTENSION_LENGTH];
+    for (size_t i = 0; i < 16; i++) {
+        buffer[i * 2] = hexDigits[r[i] >> 4];
+        buffer[i * 2 + 1] = hexDigits[r[i] & 0x0F];
+    }
+    size_t bufferLength = 32;
+    
+    // The path extension of the last path component, ignore the URL query and fragment. Only alphanumeric extension is used
+    size_t end = 0;
+    while (end < length && str[end] != '?' && str[end] != '#') {
+        end++;
+    }
+    // Skip the URL scheme and host, the host name like `example.com` is not an extension
+    size_t pathStart = 0;
+    const char *scheme = strstr(str, "://");
+    if (scheme && (size_t)(scheme - str) < end) {
+        pathStart = scheme - str + 3;
+        while (pathStart < end && str[pathStart] != '/') {
+            pathStart++;
+        }
+    }
+    size_t dot = end;
+    while (dot > pathStart && str[dot - 1] != '.' && str[dot - 1] != '/') {
+        dot--;
+    }
+    if (dot > pathStart + 1 && str[dot - 1] == '.' && str[dot - 2] != '/') {
+        size_t extLength = end - dot;
+        BOOL valid = extLength > 0 && extLength <= SD_MAX_FILE_EXTENSION_LENGTH;
+        for (size_t i = dot; valid && i < end; i++) {
+            char c = str[i];
+            valid = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        }
+        if (valid) {
+            buffer[bufferLength++] = '.';
+            memcpy(buffer + bufferLength, str + dot, extLength);
+            bufferLength += extLength;
+        }
+    }
+    return [[NSString alloc] initWithBytes:buffer length:bufferLength encoding:NSASCIIStringEncoding];
+}
+
 @end
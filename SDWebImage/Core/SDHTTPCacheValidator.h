@@ -0,0 +1,54 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+/**
+ The HTTP cache validator of a cached image, which contains the `ETag`, `Last-Modified` and the `Cache-Control` max-age of the response.
+ This is stored with the image data by `SDImageCache` (See `SDImageCacheConfig.shouldStoreHTTPCacheValidators`), so `SDWebImageRefreshCached` can revalidate the cached image with conditional request, instead of storing the response again into `NSURLCache`.
+ */
+@interface SDHTTPCacheValidator : NSObject <NSCopying>
+
+/// The `ETag` header of response, used as `If-None-Match` header of conditional request.
+@property (nonatomic, copy, readonly, nullable) NSString *entityTag;
+/// The `Last-Modified` header of response, used as `If-Modified-Since` header of conditional request.
+@property (nonatomic, copy, readonly, nullable) NSString *lastModified;
+/// The date until the cached image is fresh, calculated from the `Cache-Control` max-age and `Age` of response. nil means always revalidate.
+@property (nonatomic, copy, readonly, nullable) NSDate *expirationDate;
+
+/// Whether the cached image is still fresh, the fresh image is used without network request.
+@property (nonatomic, assign, readonly, getter=isFresh) BOOL fresh;
+/// Whether the validator contains any `ETag` or `Last-Modified`, a conditional request can be sent.
+@property (nonatomic, assign, readonly) BOOL canRevalidate;
+
+/// Create the empty validator, which is not fresh and can not revalidate. The request with it downloads the full response.
+- (nonnull instancetype)init;
+
+/// Create the validator from the response headers.
+/// @param response The URL response, only the `NSHTTPURLResponse` contains the validators.
+/// @return The validator. The validator is empty if the response is not HTTP response, or contains `Cache-Control: no-store`.
++ (nonnull instancetype)validatorWithResponse:(nullable NSURLResponse *)response;
+
+/// Create the validator from the archived data.
+/// @param data The data returned by `archivedData`
+/// @return The validator, or nil if the data is invalid.
++ (nullable instancetype)validatorWithArchivedData:(nonnull NSData *)data;
+
+/// The archived data of validator, stored by disk cache.
+@property (nonatomic, copy, readonly, nonnull) NSData *archivedData;
+
+/// Create the validator with the 304 (Not Modified) response to current one. The headers of response override the current ones, and the freshness is recalculated.
+/// @param response The 304 response
+- (nonnull instancetype)validatorByUpdatingWithResponse:(nullable NSURLResponse *)response;
+
+/// Add the `If-None-Match` and `If-Modified-Since` headers into request, which does not override the request's own headers.
+/// @param request The request to send
+- (void)applyToRequest:(nonnull NSMutableURLRequest *)request;
+
+@end
@@ -0,0 +1,168 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDHTTPCacheValidator.h"
+
+static NSString * const SDHTTPCacheValidatorEntityTagKey = @"etag";
+static NSString * const SDHTTPCacheValidatorLastModifiedKey = @"lastModified";
+static NSString * const SDHTTPCacheValidatorExpirationDateKey = @"expirationDate";
+
+// The header fields are case insensitive
+static NSString * SDHTTPHeaderValue(NSDictionary *headers, NSString *field) {
+    for (NSString *key in headers) {
+        if ([key isKindOfClass:[NSString class]] && [key caseInsensitiveCompare:field] == NSOrderedSame) {
+            id value = headers[key];
+            return [value isKindOfClass:[NSString class]] ? value : nil;
+        }
+    }
+    return nil;
+}
+
+@interface SDHTTPCacheValidator ()
+
+@property (nonatomic, copy, readwrite, nullable) NSString *entityTag;
+@property (nonatomic, copy, readwrite, nullable) NSString *lastModified;
+@property (nonatomic, copy, readwrite, nullable) NSDate *expirationDate;
+
+@end
+
+@implementation SDHTTPCacheValidator
+
++ (instancetype)validatorWithResponse:(NSURLResponse *)response {
+    SDHTTPCacheValidator *validator = [[SDHTTPCacheValidator alloc] init];
+    if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return validator;
+    }
+    NSDictionary *headers = ((NSHTTPURLResponse *)response).allHeaderFields;
+    BOOL noStore = NO;
+    validator.expirationDate = [self expirationDateWithHeaders:headers noStore:&noStore];
+    if (noStore) {
+        validator.expirationDate = nil;
+        return validator;
+    }
+    validator.entityTag = SDHTTPHeaderValue(headers, @"ETag");
+    validator.lastModified = SDHTTPHeaderValue(headers, @"Last-Modified");
+    return validator;
+}
+
++ (nullable NSDate *)expirationDateWithHeaders:(NSDictionary *)headers noStore:(BOOL *)noStore {
+    NSString *cacheControl = SDHTTPHeaderValue(headers, @"Cache-Control");
+    if (!cacheControl) {
+        return nil;
+    }
+    BOOL noCache = NO;
+    NSInteger maxAge = -1;
+    for (NSString *component in [cacheControl componentsSeparatedByString:@","]) {
+        NSString *directive = [[component stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] lowercaseString];
+        if ([directive isEqualToString:@"no-store"]) {
+            *noStore = YES;
+        } else if ([directive isEqualToString:@"no-cache"]) {
+            noCache = YES;
+        } else if ([directive hasPrefix:@"max-age="]) {
+            maxAge = [directive substringFromIndex:@"max-age=".length].integerValue;
+        }
+    }
+    if (noCache || maxAge <= 0) {
+        return nil;
+    }
+    // The response may be served by a shared cache, which already used part of the lifetime
+    NSInteger age = MAX(SDHTTPHeaderValue(headers, @"Age").integerValue, 0);
+    if (age >= maxAge) {
+        return nil;
+    }
+    return [NSDate dateWithTimeIntervalSinceNow:maxAge - age];
+}
+
++ (instancetype)validatorWithArchivedData:(NSData *)data {
+    if (!data) {
+        return nil;
+    }
+    NSDictionary *dictionary = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:nil error:nil];
+    if (![dictionary isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+    SDHTTPCacheValidator *validator = [[SDHTTPCacheValidator alloc] init];
+    id entityTag = dictionary[SDHTTPCacheValidatorEntityTagKey];
+    id lastModified = dictionary[SDHTTPCacheValidatorLastModifiedKey];
+    id expirationDate = dictionary[SDHTTPCacheValidatorExpirationDateKey];
+    validator.entityTag = [entityTag isKindOfClass:[NSString class]] ? entityTag : nil;
+    validator.lastModified = [lastModified isKindOfClass:[NSString class]] ? lastModified : nil;
+    validator.expirationDate = [expirationDate isKindOfClass:[NSDate class]] ? expirationDate : nil;
+    return validator;
+}
+
+- (NSData *)archivedData {
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:3];
+    dictionary[SDHTTPCacheValidatorEntityTagKey] = self.entityTag;
+    dictionary[SDHTTPCacheValidatorLastModifiedKey] = self.lastModified;
+    dictionary[SDHTTPCacheValidatorExpirationDateKey] = self.expirationDate;
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:dictionary format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    return data ?: [NSData data];
+}
+
+- (BOOL)isFresh {
+    return self.expirationDate && self.expirationDate.timeIntervalSinceNow > 0;
+}
+
+- (BOOL)canRevalidate {
+    return self.entityTag.length > 0 || self.lastModified.length > 0;
+}
+
+- (instancetype)validatorByUpdatingWithResponse:(NSURLResponse *)response {
+    SDHTTPCacheValidator *responseValidator = [SDHTTPCacheValidator validatorWithResponse:response];
+    SDHTTPCacheValidator *validator = [self copy];
+    // The 304 response may omit the validators, keep the current ones
+    if (responseValidator.entityTag) {
+        validator.entityTag = responseValidator.entityTag;
+    }
+    if (responseValidator.lastModified) {
+        validator.lastModified = responseValidator.lastModified;
+    }
+    validator.expirationDate = responseValidator.expirationDate;
+    return validator;
+}
+
+- (void)applyToRequest:(NSMutableURLRequest *)request {
+    if (self.entityTag.length > 0 && ![request valueForHTTPHeaderField:@"If-None-Match"]) {
+        [request setValue:self.entityTag forHTTPHeaderField:@"If-None-Match"];
+    }
+    if (self.lastModified.length > 0 && ![request valueForHTTPHeaderField:@"If-Modified-Since"]) {
+        [request setValue:self.lastModified forHTTPHeaderField:@"If-Modified-Since"];
+    }
+}
+
+#pragma mark - NSCopying
+
+- (id)copyWithZone:(NSZone *)zone {
+    SDHTTPCacheValidator *validator = [[[self class] allocWithZone:zone] init];
+    validator.entityTag = self.entityTag;
+    validator.lastModified = self.lastModified;
+    validator.expirationDate = self.expirationDate;
+    return validator;
+}
+
+#pragma mark - NSObject
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    if (![object isKindOfClass:[SDHTTPCacheValidator class]]) {
+        return NO;
+    }
+    SDHTTPCacheValidator *other = object;
+    return (self.entityTag == other.entityTag || [self.entityTag isEqualToString:other.entityTag])
+    && (self.lastModified == other.lastModified || [self.lastModified isEqualToString:other.lastModified])
+    && (self.expirationDate == other.expirationDate || [self.expirationDate isEqualToDate:other.expirationDate]);
+}
+
+- (NSUInteger)hash {
+    return self.entityTag.hash ^ self.lastModified.hash ^ self.expirationDate.hash;
+}
+
+@end
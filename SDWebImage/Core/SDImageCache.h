@@ -327,6 +327,21 @@ typedef NS_OPTIONS(NSUInteger, SDImageCacheOptions) {
  */
 - (nullable SDImageCacheToken *)queryCacheOperationForKey:(nullable NSString *)key options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context cacheType:(SDImageCacheType)queryCacheType done:(nullable SDImageCacheQueryCompletionBlock)doneBlock;
 
+/**
+ * Asynchronously queries the cache for many keys with one operation and call the completion when done.
+ * The memory cache is checked in one pass, the disk data of all the missing keys is read in one IO queue dispatch, and decoded in parallel.
+ *
+ * @param keys      The unique keys used to store the wanted images. The duplicated keys are queried only once
+ * @param options   A mask to specify options to use for this cache query
+ * @param context   A context contains different options to perform specify changes or processes, see `SDWebImageContextOption`. This hold the extra objects which `options` enum can not hold.
+ * @param queryCacheType Specify where to query the cache from. Pass `.none` is invalid and callback with nil images immediately.
+ * @param progressBlock The block called for each key. The memory cache result is called synchronously, the disk cache result is called on the main queue. Pass nil to receive the coalesced result only. Will not get called if the operation is cancelled
+ * @param doneBlock The completion block, called once after all the progress blocks. If the operation is cancelled, it is called on the main queue with the results gathered so far instead
+ *
+ * @return a SDImageCacheToken instance containing the cache operation for the whole batch, or nil if all keys are completed synchronously
+ */
+- (nullable SDImageCacheToken *)queryCacheOperationForKeys:(nullable NSArray<NSString *> *)keys options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context cacheType:(SDImageCacheType)queryCacheType progress:(nullable SDImageCacheBatchQueryProgressBlock)progressBlock done:(nullable SDImageCacheBatchQueryCompletionBlock)doneBlock;
+
 /**
  * Synchronously query the memory cache.
  *
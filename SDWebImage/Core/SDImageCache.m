@@ -14,12 +14,16 @@
 #import "UIImage+MemoryCacheCost.h"
 #import "UIImage+Metadata.h"
 #import "UIImage+ExtendedCacheData.h"
+#import "SDInternalMacros.h"
+#import "SDBitmapDiskCache.h"
+#import "SDLRUMemoryCache.h"
 
 @interface SDImageCacheToken ()
 
 @property (nonatomic, strong, nullable, readwrite) NSString *key;
 @property (nonatomic, assign, getter=isCancelled) BOOL cancelled;
 @property (nonatomic, copy, nullable) SDImageCacheQueryCompletionBlock doneBlock;
+@property (nonatomic, copy, nullable) dispatch_block_t cancelBlock; // Called instead of the done block when cancelled, such as the batch query
 
 @end
 
@@ -45,22 +49,93 @@
                 self.doneBlock(nil, nil, SDImageCacheTypeNone);
                 self.doneBlock = nil;
             }
+            dispatch_block_t cancelBlock;
+            @synchronized (self) {
+                cancelBlock = self.cancelBlock;
+                self.cancelBlock = nil;
+            }
+            if (cancelBlock) {
+                cancelBlock();
+            }
         });
     }
 }
 
 @end
 
+// A disk store which is waiting in the write lane, the data can be read before it's written to disk
+@interface SDImageCachePendingStore : NSObject
+
+@property (nonatomic, strong, nullable) UIImage *image;
+@property (nonatomic, strong, nullable) NSData *imageData; // The provided data, or the encoded data of image
+@property (nonatomic, strong, nullable) NSData *extendedData;
+@property (nonatomic, copy, nullable) SDHTTPCacheValidator *validator;
+@property (nonatomic, strong, nonnull) NSMutableArray<SDWebImageNoParamsBlock> *completionBlocks;
+@property (nonatomic, assign, getter=isWriting) BOOL writing;
+@property (nonatomic, assign, getter=isCancelled) BOOL cancelled;
+
+@end
+
+@implementation SDImageCachePendingStore
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _completionBlocks = [NSMutableArray array];
+    }
+    return self;
+}
+
+@end
+
+// The encoded data kept in memory tier, with the extended data, so the query does not touch the disk
+@interface SDImageCacheMemoryData : NSObject
+
+@property (nonatomic, strong, nonnull) NSData *data;
+@property (nonatomic, strong, nullable) NSData *extendedData;
+
+@end
+
+@implementation SDImageCacheMemoryData
+@end
+
 static NSString * _defaultDiskCacheDirectory;
 
-@interface SDImageCache ()
+// Map the QoS of caller into decode operation, so that the decode for visible cells does not wait behind prefetching
+static inline NSQualityOfService SDImageCacheQualityOfServiceForCurrentQueue(void) {
+    switch (qos_class_self()) {
+        case QOS_CLASS_USER_INTERACTIVE:
+        case QOS_CLASS_USER_INITIATED:
+            return NSQualityOfServiceUserInitiated;
+        case QOS_CLASS_UTILITY:
+            return NSQualityOfServiceUtility;
+        case QOS_CLASS_BACKGROUND:
+            return NSQualityOfServiceBackground;
+        default:
+            return NSQualityOfServiceDefault;
+    }
+}
+
+@interface SDImageCache () {
+    SD_LOCK_DECLARE(_runningQueriesLock); // A lock to keep the access to `runningQueries` thread-safe
+    SD_LOCK_DECLARE(_pendingStoresLock); // A lock to keep the access to `pendingStores` thread-safe
+}
 
 #pragma mark - Properties
 @property (nonatomic, strong, readwrite, nonnull) id<SDMemoryCache> memoryCache;
 @property (nonatomic, strong, readwrite, nonnull) id<SDDiskCache> diskCache;
+@property (nonatomic, strong, nullable) SDBitmapDiskCache *bitmapCache;
+@property (nonatomic, strong, nullable) SDLRUMemoryCache<NSString *, SDImageCacheMemoryData *> *memoryDataCache;
 @property (nonatomic, copy, readwrite, nonnull) SDImageCacheConfig *config;
 @property (nonatomic, copy, readwrite, nonnull) NSString *diskCachePath;
 @property (nonatomic, strong, nullable) dispatch_queue_t ioQueue;
+@property (nonatomic, strong, nonnull) dispatch_queue_t writeQueue;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDImageCachePendingStore *> *pendingStores;
+@property (nonatomic, assign) BOOL writeBehindScheduled;
+@property (nonatomic, assign) BOOL trimScheduled; // Only accessed in IO queue
+@property (nonatomic, strong, nonnull) NSMutableArray<SDWebImageNoParamsBlock> *trimCompletionBlocks; // Only accessed in IO queue
+@property (nonatomic, strong, nonnull) NSOperationQueue *decodeQueue;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, NSMutableArray<SDImageCacheToken *> *> *runningQueries;
 
 @end
 
@@ -111,6 +186,21 @@ static NSString * _defaultDiskCacheDirectory;
         // Create IO serial queue
         _ioQueue = dispatch_queue_create("com.hackemist.SDImageCache", DISPATCH_QUEUE_SERIAL);
         
+        // Create write serial queue with lower priority, encoding and archiving for store should not block the read in IO queue
+        dispatch_queue_attr_t writeQueueAttributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+        _writeQueue = dispatch_queue_create("com.hackemist.SDImageCache.writeQueue", writeQueueAttributes);
+        _pendingStores = [NSMutableDictionary dictionary];
+        SD_LOCK_INIT(_pendingStoresLock);
+        
+        // Create decode concurrent queue, decoding should not block the IO queue
+        _decodeQueue = [NSOperationQueue new];
+        _decodeQueue.maxConcurrentOperationCount = MAX(NSProcessInfo.processInfo.activeProcessorCount, 2);
+        _decodeQueue.name = @"com.hackemist.SDImageCache.decodeQueue";
+        
+        _runningQueries = [NSMutableDictionary dictionary];
+        SD_LOCK_INIT(_runningQueriesLock);
+        _trimCompletionBlocks = [NSMutableArray array];
+        
         if (!config) {
             config = SDImageCacheConfig.defaultCacheConfig;
         }
@@ -120,6 +210,16 @@ static NSString * _defaultDiskCacheDirectory;
         NSAssert([config.memoryCacheClass conformsToProtocol:@protocol(SDMemoryCache)], @"Custom memory cache class must conform to `SDMemoryCache` protocol");
         _memoryCache = [[config.memoryCacheClass alloc] initWithConfig:_config];
         
+        // Init the encoded data memory tier, which has its own cost limit
+        if (config.shouldCacheImageDataInMemory) {
+            SDImageCacheConfig *dataConfig = [_config copy];
+            dataConfig.maxMemoryCost = config.maxMemoryDataCost;
+            dataConfig.maxMemoryCount = 0;
+            dataConfig.shouldUseWeakMemoryCache = NO;
+            _memoryDataCache = [[SDLRUMemoryCache alloc] initWithConfig:dataConfig];
+            _memoryDataCache.evictionPolicy = SDLRUMemoryCacheEvictionPolicySegmentedLRU;
+        }
+        
         // Init the disk cache
         if (!directory) {
             // Use default disk cache directory
@@ -130,8 +230,17 @@ static NSString * _defaultDiskCacheDirectory;
         NSAssert([config.diskCacheClass conformsToProtocol:@protocol(SDDiskCache)], @"Custom disk cache class must conform to `SDDiskCache` protocol");
         _diskCache = [[config.diskCacheClass alloc] initWithCachePath:_diskCachePath config:_config];
         
+        // Init the decoded bitmap cache, next to the disk cache directory to not mix with the disk cache files
+        if (config.shouldCacheDecodedImagesOnDisk) {
+            NSString *bitmapCachePath = [_diskCachePath stringByAppendingPathExtension:@"bitmap"];
+            _bitmapCache = [[SDBitmapDiskCache alloc] initWithCachePath:bitmapCachePath config:_config];
+        }
+        
         // Check and migrate disk cache directory if need
         [self migrateDiskCacheDirectory];
+        
+        // Resume the interrupted trimming from last launch
+        [self trimDiskCacheIfNeeded];
 
 #if SD_UIKIT
         // Subscribe to app events
@@ -224,6 +333,17 @@ static NSString * _defaultDiskCacheDirectory;
           toMemory:(BOOL)toMemory
             toDisk:(BOOL)toDisk
         completion:(nullable SDWebImageNoParamsBlock)completionBlock {
+    [self _storeImage:image imageData:imageData forKey:key toMemory:toMemory toDisk:toDisk lowPriority:NO validator:nil completion:completionBlock];
+}
+
+- (void)_storeImage:(nullable UIImage *)image
+          imageData:(nullable NSData *)imageData
+             forKey:(nullable NSString *)key
+           toMemory:(BOOL)toMemory
+             toDisk:(BOOL)toDisk
+        lowPriority:(BOOL)lowPriority
+          validator:(nullable SDHTTPCacheValidator *)validator
+         completion:(nullable SDWebImageNoParamsBlock)completionBlock {
     if ((!image && !imageData) || !key) {
         if (completionBlock) {
             completionBlock();
@@ -233,7 +353,11 @@ static NSString * _defaultDiskCacheDirectory;
     // if memory cache is enabled
     if (image && toMemory && self.config.shouldCacheImagesInMemory) {
         NSUInteger cost = image.sd_memoryCost;
-        [self.memoryCache setObject:image forKey:key cost:cost];
+        if (lowPriority && [self.memoryCache respondsToSelector:@selector(setObject:forKey:cost:lowPriority:)]) {
+            [self.memoryCache setObject:image forKey:key cost:cost lowPriority:YES];
+        } else {
+            [self.memoryCache setObject:image forKey:key cost:cost];
+        }
     }
     
     if (!toDisk) {
@@ -242,47 +366,213 @@ static NSString * _defaultDiskCacheDirectory;
         }
         return;
     }
-    dispatch_async(self.ioQueue, ^{
-        @autoreleasepool {
-            NSData *data = imageData;
-            if (!data && [image conformsToProtocol:@protocol(SDAnimatedImage)]) {
-                // If image is custom animated image class, prefer its original animated data
-                data = [((id<SDAnimatedImage>)image) animatedImageData];
-            }
-            if (!data && image) {
-                // Check image's associated image format, may return .undefined
-                SDImageFormat format = image.sd_imageFormat;
-                if (format == SDImageFormatUndefined) {
-                    // If image is animated, use GIF (APNG may be better, but has bugs before macOS 10.14)
-                    if (image.sd_isAnimated) {
-                        format = SDImageFormatGIF;
-                    } else {
-                        // If we do not have any data to detect image format, check whether it contains alpha channel to use PNG or JPEG format
-                        format = [SDImageCoderHelper CGImageContainsAlpha:image.CGImage] ? SDImageFormatPNG : SDImageFormatJPEG;
-                    }
+    // The data in memory tier is older than this store, the pending store is read until it's written
+    [self.memoryDataCache removeObjectForKey:key];
+    // Coalesce the repeated stores of same key which are not written yet, the last one wins
+    SDImageCachePendingStore *pendingStore;
+    BOOL shouldSchedule = NO;
+    SD_LOCK(_pendingStoresLock);
+    pendingStore = self.pendingStores[key];
+    if (!pendingStore || pendingStore.isWriting) {
+        pendingStore = [SDImageCachePendingStore new];
+        self.pendingStores[key] = pendingStore;
+        shouldSchedule = YES;
+    }
+    pendingStore.image = image;
+    pendingStore.imageData = imageData;
+    pendingStore.validator = validator;
+    if (completionBlock) {
+        [pendingStore.completionBlocks addObject:completionBlock];
+    }
+    SD_UNLOCK(_pendingStoresLock);
+    
+    if (!shouldSchedule) {
+        return;
+    }
+    NSTimeInterval writeBehindInterval = self.config.diskCacheWriteBehindInterval;
+    if (writeBehindInterval > 0) {
+        // Write-behind, collect the stores during the interval and write them in batch
+        SD_LOCK(_pendingStoresLock);
+        BOOL scheduled = self.writeBehindScheduled;
+        self.writeBehindScheduled = YES;
+        SD_UNLOCK(_pendingStoresLock);
+        if (!scheduled) {
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(writeBehindInterval * NSEC_PER_SEC)), self.writeQueue, ^{
+                [self _flushPendingStores];
+            });
+        }
+    } else {
+        dispatch_async(self.writeQueue, ^{
+            [self _writePendingStores:@{key : pendingStore}];
+        });
+    }
+}
+
+// Make sure to call from write queue by caller
+- (void)_flushPendingStores {
+    SD_LOCK(_pendingStoresLock);
+    self.writeBehindScheduled = NO;
+    NSDictionary<NSString *, SDImageCachePendingStore *> *pendingStores = [self.pendingStores copy];
+    SD_UNLOCK(_pendingStoresLock);
+    [self _writePendingStores:pendingStores];
+}
+
+// Make sure to call from write queue by caller
+- (void)_writePendingStores:(nonnull NSDictionary<NSString *, SDImageCachePendingStore *> *)pendingStores {
+    NSMutableArray<SDWebImageNoParamsBlock> *completionBlocks = [NSMutableArray array];
+    @autoreleasepool {
+        // Take the stores which are not taken by other writes, new stores for these keys are not coalesced into them anymore
+        NSMutableDictionary<NSString *, SDImageCachePendingStore *> *writingStores = [NSMutableDictionary dictionaryWithCapacity:pendingStores.count];
+        SD_LOCK(_pendingStoresLock);
+        [pendingStores enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, SDImageCachePendingStore * _Nonnull pendingStore, BOOL * _Nonnull stop) {
+            if (!pendingStore.isWriting) {
+                pendingStore.writing = YES;
+                writingStores[key] = pendingStore;
+            }
+        }];
+        SD_UNLOCK(_pendingStoresLock);
+        
+        // Encode and archive outside of IO queue
+        NSMutableDictionary<NSString *, NSData *> *datas = [NSMutableDictionary dictionaryWithCapacity:writingStores.count];
+        NSMutableDictionary<NSString *, NSData *> *extendedDatas = [NSMutableDictionary dictionary];
+        NSMutableDictionary<NSString *, NSData *> *bitmapDatas = [NSMutableDictionary dictionary];
+        NSMutableDictionary<NSString *, NSData *> *validatorDatas = [NSMutableDictionary dictionary];
+        [writingStores enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, SDImageCachePendingStore * _Nonnull pendingStore, BOOL * _Nonnull stop) {
+            @autoreleasepool {
+                SD_LOCK(self->_pendingStoresLock);
+                BOOL cancelled = pendingStore.isCancelled;
+                UIImage *image = pendingStore.image;
+                NSData *data = pendingStore.imageData;
+                SDHTTPCacheValidator *validator = pendingStore.validator;
+                SD_UNLOCK(self->_pendingStoresLock);
+                if (cancelled) {
+                    return;
+                }
+                if (!data) {
+                    data = [self _encodedDataWithImage:image];
+                }
+                NSData *extendedData = [self _archivedDataWithImage:image];
+                NSData *bitmapData = (data && image) ? [self.bitmapCache bitmapDataWithImage:image] : nil;
+                SD_LOCK(self->_pendingStoresLock);
+                pendingStore.imageData = data;
+                pendingStore.extendedData = extendedData;
+                SD_UNLOCK(self->_pendingStoresLock);
+                if (data) {
+                    datas[key] = data;
+                }
+                if (data && extendedData) {
+                    extendedDatas[key] = extendedData;
+                }
+                if (bitmapData) {
+                    bitmapDatas[key] = bitmapData;
+                }
+                if (data && validator) {
+                    validatorDatas[key] = validator.archivedData;
                 }
-                data = [[SDImageCodersManager sharedManager] encodedDataWithImage:image format:format options:nil];
             }
-            [self _storeImageDataToDisk:data forKey:key];
-            [self _archivedDataWithImage:image forKey:key];
+        }];
+        
+        // Only the disk operation is performed in IO queue
+        if (datas.count > 0) {
+            dispatch_sync(self.ioQueue, ^{
+                NSMutableDictionary<NSString *, NSData *> *dataBatch = [NSMutableDictionary dictionaryWithCapacity:datas.count];
+                SD_LOCK(self->_pendingStoresLock);
+                [datas enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSData * _Nonnull data, BOOL * _Nonnull stop) {
+                    if (!writingStores[key].isCancelled) {
+                        dataBatch[key] = data;
+                    }
+                }];
+                SD_UNLOCK(self->_pendingStoresLock);
+                if (dataBatch.count > 1 && [self.diskCache respondsToSelector:@selector(setDataBatch:)]) {
+                    [self.diskCache setDataBatch:dataBatch];
+                } else {
+                    [dataBatch enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSData * _Nonnull data, BOOL * _Nonnull stop) {
+                        [self _storeImageDataToDisk:data forKey:key];
+                    }];
+                }
+                [extendedDatas enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSData * _Nonnull extendedData, BOOL * _Nonnull stop) {
+                    if (dataBatch[key]) {
+                        [self.diskCache setExtendedData:extendedData forKey:key];
+                    }
+                }];
+                [dataBatch enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSData * _Nonnull data, BOOL * _Nonnull stop) {
+                    [self _storeImageDataToMemory:data extendedData:extendedDatas[key] forKey:key];
+                }];
+                if ([self _shouldStoreHTTPCacheValidators]) {
+                    // The validator of previous data is stale, the file may be overwritten in place
+                    [dataBatch enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSData * _Nonnull data, BOOL * _Nonnull stop) {
+                        [self.diskCache setValidatorData:validatorDatas[key] forKey:key];
+                    }];
+                }
+                if (self.bitmapCache) {
+                    // The bitmap of previous image is stale, even if the new one can not be stored as bitmap
+                    [dataBatch enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSData * _Nonnull data, BOOL * _Nonnull stop) {
+                        NSData *bitmapData = bitmapDatas[key];
+                        if (bitmapData) {
+                            [self.bitmapCache setBitmapData:bitmapData forKey:key];
+                        } else {
+                            [self.bitmapCache removeImageForKey:key];
+                        }
+                    }];
+                }
+            });
+            // Check the expiration and watermarks after the disk cache grows
+            [self trimDiskCacheIfNeeded];
         }
         
-        if (completionBlock) {
-            dispatch_async(dispatch_get_main_queue(), ^{
+        SD_LOCK(_pendingStoresLock);
+        [writingStores enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, SDImageCachePendingStore * _Nonnull pendingStore, BOOL * _Nonnull stop) {
+            if (self.pendingStores[key] == pendingStore) {
+                [self.pendingStores removeObjectForKey:key];
+            }
+            [completionBlocks addObjectsFromArray:pendingStore.completionBlocks];
+        }];
+        SD_UNLOCK(_pendingStoresLock);
+    }
+    
+    if (completionBlocks.count > 0) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            for (SDWebImageNoParamsBlock completionBlock in completionBlocks) {
                 completionBlock();
-            });
+            }
+        });
+    }
+}
+
+- (nullable NSData *)_encodedDataWithImage:(nullable UIImage *)image {
+    if (!image) {
+        return nil;
+    }
+    NSData *data;
+    if ([image conformsToProtocol:@protocol(SDAnimatedImage)]) {
+        // If image is custom animated image class, prefer its original animated data
+        data = [((id<SDAnimatedImage>)image) animatedImageData];
+    }
+    if (!data) {
+        // Check image's associated image format, may return .undefined
+        SDImageFormat format = image.sd_imageFormat;
+        if (format == SDImageFormatUndefined) {
+            // If image is animated, use GIF (APNG may be better, but has bugs before macOS 10.14)
+            if (image.sd_isAnimated) {
+                format = SDImageFormatGIF;
+            } else {
+                // If we do not have any data to detect image format, check whether it contains alpha channel to use PNG or JPEG format
+                format = [SDImageCoderHelper CGImageContainsAlpha:image.CGImage] ? SDImageFormatPNG : SDImageFormatJPEG;
+            }
         }
-    });
+        data = [[SDImageCodersManager sharedManager] encodedDataWithImage:image format:format options:nil];
+    }
+    return data;
 }
 
-- (void)_archivedDataWithImage:(UIImage *)image forKey:(NSString *)key {
-    if (!image || !key) {
-        return;
+- (nullable NSData *)_archivedDataWithImage:(nullable UIImage *)image {
+    if (!image) {
+        return nil;
     }
     // Check extended data
     id extendedObject = image.sd_extendedObject;
     if (![extendedObject conformsToProtocol:@protocol(NSCoding)]) {
-        return;
+        return nil;
     }
     NSData *extendedData;
     if (@available(iOS 11, tvOS 11, macOS 10.13, watchOS 4, *)) {
@@ -301,9 +591,7 @@ static NSString * _defaultDiskCacheDirectory;
             NSLog(@"NSKeyedArchiver archive failed with exception: %@", exception);
         }
     }
-    if (extendedData) {
-        [self.diskCache setExtendedData:extendedData forKey:key];
-    }
+    return extendedData;
 }
 
 - (void)storeImageToMemory:(UIImage *)image forKey:(NSString *)key {
@@ -320,8 +608,12 @@ static NSString * _defaultDiskCacheDirectory;
         return;
     }
     
+    // The pending stores are older than this one
+    [self cancelPendingStoresForKey:key];
     dispatch_sync(self.ioQueue, ^{
         [self _storeImageDataToDisk:imageData forKey:key];
+        [self.bitmapCache removeImageForKey:key];
+        [self _storeImageDataToMemory:imageData extendedData:nil forKey:key];
     });
 }
 
@@ -334,6 +626,84 @@ static NSString * _defaultDiskCacheDirectory;
     [self.diskCache setData:imageData forKey:key];
 }
 
+// Keep the data which is written to or read from disk in memory tier
+- (void)_storeImageDataToMemory:(nullable NSData *)imageData extendedData:(nullable NSData *)extendedData forKey:(nonnull NSString *)key {
+    if (!self.memoryDataCache || !imageData) {
+        return;
+    }
+    SDImageCacheMemoryData *memoryData = [SDImageCacheMemoryData new];
+    memoryData.data = imageData;
+    memoryData.extendedData = extendedData;
+    [self.memoryDataCache setObject:memoryData forKey:key cost:imageData.length + extendedData.length];
+}
+
+// Return the data of the pending store which is not written to disk yet, to keep read-after-write consistency
+- (nullable NSData *)_pendingImageDataForKey:(nonnull NSString *)key {
+    SD_LOCK(_pendingStoresLock);
+    SDImageCachePendingStore *pendingStore = self.pendingStores[key];
+    UIImage *image = pendingStore.image;
+    NSData *data = pendingStore.imageData;
+    SD_UNLOCK(_pendingStoresLock);
+    if (!pendingStore || data || !image) {
+        return data;
+    }
+    // Encoding is not finished in write queue, do it here (can not wait for write queue in IO queue)
+    data = [self _encodedDataWithImage:image];
+    SD_LOCK(_pendingStoresLock);
+    if (pendingStore.image == image && !pendingStore.imageData) {
+        pendingStore.imageData = data;
+    }
+    SD_UNLOCK(_pendingStoresLock);
+    return data;
+}
+
+- (nullable NSData *)_diskExtendedDataForKey:(nonnull NSString *)key {
+    SD_LOCK(_pendingStoresLock);
+    SDImageCachePendingStore *pendingStore = self.pendingStores[key];
+    NSData *extendedData = pendingStore.extendedData;
+    SD_UNLOCK(_pendingStoresLock);
+    if (pendingStore) {
+        return extendedData;
+    }
+    SDImageCacheMemoryData *memoryData = [self.memoryDataCache objectForKey:key];
+    if (memoryData) {
+        return memoryData.extendedData;
+    }
+    return [self.diskCache extendedDataForKey:key];
+}
+
+// Cancel the pending stores for key, or all pending stores if key is nil. The completion blocks are still called
+- (void)cancelPendingStoresForKey:(nullable NSString *)key {
+    NSMutableArray<SDWebImageNoParamsBlock> *completionBlocks = [NSMutableArray array];
+    SD_LOCK(_pendingStoresLock);
+    NSArray<SDImageCachePendingStore *> *pendingStores;
+    if (key) {
+        SDImageCachePendingStore *pendingStore = self.pendingStores[key];
+        pendingStores = pendingStore ? @[pendingStore] : @[];
+        [self.pendingStores removeObjectForKey:key];
+    } else {
+        pendingStores = self.pendingStores.allValues;
+        [self.pendingStores removeAllObjects];
+    }
+    for (SDImageCachePendingStore *pendingStore in pendingStores) {
+        pendingStore.cancelled = YES;
+        // The store taken by a write calls its completion blocks after that write, others are not reachable by any write anymore
+        if (!pendingStore.isWriting) {
+            pendingStore.writing = YES;
+            [completionBlocks addObjectsFromArray:pendingStore.completionBlocks];
+        }
+    }
+    SD_UNLOCK(_pendingStoresLock);
+    
+    if (completionBlocks.count > 0) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            for (SDWebImageNoParamsBlock completionBlock in completionBlocks) {
+                completionBlock();
+            }
+        });
+    }
+}
+
 #pragma mark - Query and Retrieve Ops
 
 - (void)diskImageExistsWithKey:(nullable NSString *)key completion:(nullable SDImageCacheCheckCompletionBlock)completionBlock {
@@ -365,6 +735,12 @@ static NSString * _defaultDiskCacheDirectory;
     if (!key) {
         return NO;
     }
+    SD_LOCK(_pendingStoresLock);
+    BOOL pending = self.pendingStores[key] != nil;
+    SD_UNLOCK(_pendingStoresLock);
+    if (pending) {
+        return YES;
+    }
     
     return [self.diskCache containsDataForKey:key];
 }
@@ -427,27 +803,7 @@ static NSString * _defaultDiskCacheDirectory;
 
 - (nullable UIImage *)imageFromCacheForKey:(nullable NSString *)key options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context {
     // First check the in-memory cache...
-    UIImage *image = [self imageFromMemoryCacheForKey:key];
-    if (image) {
-        if (options & SDImageCacheDecodeFirstFrameOnly) {
-            // Ensure static image
-            Class animatedImageClass = image.class;
-            if (image.sd_isAnimated || ([animatedImageClass isSubclassOfClass:[UIImage class]] && [animatedImageClass conformsToProtocol:@protocol(SDAnimatedImage)])) {
-#if SD_MAC
-                image = [[NSImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:kCGImagePropertyOrientationUp];
-#else
-                image = [[UIImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:image.imageOrientation];
-#endif
-            }
-        } else if (options & SDImageCacheMatchAnimatedImageClass) {
-            // Check image class matching
-            Class animatedImageClass = image.class;
-            Class desiredImageClass = context[SDWebImageContextAnimatedImageClass];
-            if (desiredImageClass && ![animatedImageClass isSubclassOfClass:desiredImageClass]) {
-                image = nil;
-            }
-        }
-    }
+    UIImage *image = [self _memoryImageForKey:key options:options context:context];
     
     // Since we don't need to query imageData, return image if exist
     if (image) {
@@ -464,7 +820,17 @@ static NSString * _defaultDiskCacheDirectory;
         return nil;
     }
     
-    NSData *data = [self.diskCache dataForKey:key];
+    NSData *data = [self _pendingImageDataForKey:key];
+    if (data) {
+        return data;
+    }
+    
+    SDImageCacheMemoryData *memoryData = [self.memoryDataCache objectForKey:key];
+    if (memoryData) {
+        return memoryData.data;
+    }
+    
+    data = [self.diskCache dataForKey:key];
     if (data) {
         return data;
     }
@@ -473,7 +839,9 @@ static NSString * _defaultDiskCacheDirectory;
     if (self.additionalCachePathBlock) {
         NSString *filePath = self.additionalCachePathBlock(key);
         if (filePath) {
-            data = [NSData dataWithContentsOfFile:filePath options:self.config.diskCacheReadingOptions error:nil];
+            NSDictionary<NSFileAttributeKey, id> *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:filePath error:nil];
+            NSDataReadingOptions readingOptions = [self.config diskCacheReadingOptionsForFileSize:attributes.fileSize];
+            data = [NSData dataWithContentsOfFile:filePath options:readingOptions error:nil];
         }
     }
 
@@ -498,13 +866,26 @@ static NSString * _defaultDiskCacheDirectory;
     return image;
 }
 
+- (nullable UIImage *)diskImageForKey:(nullable NSString *)key data:(nullable NSData *)data extendedData:(nullable NSData *)extendedData options:(SDImageCacheOptions)options context:(SDWebImageContext *)context {
+    if (!data) {
+        return nil;
+    }
+    UIImage *image = SDImageCacheDecodeImageData(data, key, [[self class] imageOptionsFromCacheOptions:options], context);
+    [self _unarchiveObjectWithImage:image extendedData:extendedData];
+    return image;
+}
+
 - (void)_unarchiveObjectWithImage:(UIImage *)image forKey:(NSString *)key {
     if (!image) {
         return;
     }
     // Check extended data
-    NSData *extendedData = [self.diskCache extendedDataForKey:key];
-    if (!extendedData) {
+    NSData *extendedData = [self _diskExtendedDataForKey:key];
+    [self _unarchiveObjectWithImage:image extendedData:extendedData];
+}
+
+- (void)_unarchiveObjectWithImage:(UIImage *)image extendedData:(NSData *)extendedData {
+    if (!image || !extendedData) {
         return;
     }
     id extendedObject;
@@ -529,6 +910,93 @@ static NSString * _defaultDiskCacheDirectory;
     image.sd_extendedObject = extendedObject;
 }
 
+- (nullable UIImage *)_memoryImageForKey:(nullable NSString *)key options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context {
+    UIImage *image = [self imageFromMemoryCacheForKey:key];
+    if (image) {
+        if (options & SDImageCacheDecodeFirstFrameOnly) {
+            // Ensure static image
+            Class animatedImageClass = image.class;
+            if (image.sd_isAnimated || ([animatedImageClass isSubclassOfClass:[UIImage class]] && [animatedImageClass conformsToProtocol:@protocol(SDAnimatedImage)])) {
+#if SD_MAC
+                image = [[NSImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:kCGImagePropertyOrientationUp];
+#else
+                image = [[UIImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:image.imageOrientation];
+#endif
+            }
+        } else if (options & SDImageCacheMatchAnimatedImageClass) {
+            // Check image class matching
+            Class animatedImageClass = image.class;
+            Class desiredImageClass = context[SDWebImageContextAnimatedImageClass];
+            if (desiredImageClass && ![animatedImageClass isSubclassOfClass:desiredImageClass]) {
+                image = nil;
+            }
+        }
+    }
+    return image;
+}
+
+- (nullable UIImage *)_decodedDiskImageForKey:(nonnull NSString *)key data:(nonnull NSData *)diskData extendedData:(nullable NSData *)extendedData options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context {
+    UIImage *diskImage = [self diskImageForKey:key data:diskData extendedData:extendedData options:options context:context];
+    [self _storeDiskImageToMemory:diskImage forKey:key context:context];
+    return diskImage;
+}
+
+- (void)_storeDiskImageToMemory:(nullable UIImage *)diskImage forKey:(nonnull NSString *)key context:(nullable SDWebImageContext *)context {
+    BOOL shouldCacheToMomery = YES;
+    if (context[SDWebImageContextStoreCacheType]) {
+        SDImageCacheType cacheType = [context[SDWebImageContextStoreCacheType] integerValue];
+        shouldCacheToMomery = (cacheType == SDImageCacheTypeAll || cacheType == SDImageCacheTypeMemory);
+    }
+    if (context[SDWebImageContextImageThumbnailPixelSize]) {
+        // Query full size cache key which generate a thumbnail, should not write back to full size memory cache
+        shouldCacheToMomery = NO;
+    }
+    if (shouldCacheToMomery && diskImage && self.config.shouldCacheImagesInMemory) {
+        NSUInteger cost = diskImage.sd_memoryCost;
+        [self.memoryCache setObject:diskImage forKey:key cost:cost];
+    }
+}
+
+- (BOOL)_shouldQueryBitmapWithCacheType:(SDImageCacheType)queryCacheType options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context {
+    if (!self.bitmapCache || queryCacheType != SDImageCacheTypeAll) {
+        // Only use the decoded bitmap for the common query
+        return NO;
+    }
+    // The options and context which produce a different image from the same data
+    if (options & (SDImageCacheScaleDownLargeImages | SDImageCacheAvoidDecodeImage | SDImageCacheMatchAnimatedImageClass)) {
+        return NO;
+    }
+    return !context[SDWebImageContextImageThumbnailPixelSize] && !context[SDWebImageContextAnimatedImageClass] && !context[SDWebImageContextImageScaleFactor];
+}
+
+// Make sure to call from io queue by caller. The encoded data is still read, the caller may need it (such as the refresh and revalidation), only the decode is skipped
+- (nullable UIImage *)_bitmapDiskImageForKey:(nonnull NSString *)key context:(nullable SDWebImageContext *)context diskData:(NSData * _Nullable * _Nonnull)diskData {
+    if (!self.bitmapCache) {
+        return nil;
+    }
+    // The pending store is newer than the bitmap
+    SD_LOCK(_pendingStoresLock);
+    BOOL pending = self.pendingStores[key] != nil;
+    SD_UNLOCK(_pendingStoresLock);
+    if (pending) {
+        return nil;
+    }
+    UIImage *bitmapImage = [self.bitmapCache imageForKey:key];
+    if (!bitmapImage) {
+        return nil;
+    }
+    // Keep consistent with the disk cache, the image data may be expired or removed by the disk cache itself
+    NSData *data = [self diskImageDataBySearchingAllPathsForKey:key];
+    if (!data) {
+        [self.bitmapCache removeImageForKey:key];
+        return nil;
+    }
+    [self _unarchiveObjectWithImage:bitmapImage forKey:key];
+    [self _storeDiskImageToMemory:bitmapImage forKey:key context:context];
+    *diskData = data;
+    return bitmapImage;
+}
+
 - (nullable SDImageCacheToken *)queryCacheOperationForKey:(NSString *)key done:(SDImageCacheQueryCompletionBlock)doneBlock {
     return [self queryCacheOperationForKey:key options:0 done:doneBlock];
 }
@@ -559,28 +1027,7 @@ static NSString * _defaultDiskCacheDirectory;
     // First check the in-memory cache...
     UIImage *image;
     if (queryCacheType != SDImageCacheTypeDisk) {
-        image = [self imageFromMemoryCacheForKey:key];
-    }
-    
-    if (image) {
-        if (options & SDImageCacheDecodeFirstFrameOnly) {
-            // Ensure static image
-            Class animatedImageClass = image.class;
-            if (image.sd_isAnimated || ([animatedImageClass isSubclassOfClass:[UIImage class]] && [animatedImageClass conformsToProtocol:@protocol(SDAnimatedImage)])) {
-#if SD_MAC
-                image = [[NSImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:kCGImagePropertyOrientationUp];
-#else
-                image = [[UIImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:image.imageOrientation];
-#endif
-            }
-        } else if (options & SDImageCacheMatchAnimatedImageClass) {
-            // Check image class matching
-            Class animatedImageClass = image.class;
-            Class desiredImageClass = context[SDWebImageContextAnimatedImageClass];
-            if (desiredImageClass && ![animatedImageClass isSubclassOfClass:desiredImageClass]) {
-                image = nil;
-            }
-        }
+        image = [self _memoryImageForKey:key options:options context:context];
     }
 
     BOOL shouldQueryMemoryOnly = (queryCacheType == SDImageCacheTypeMemory) || (image && !(options & SDImageCacheQueryMemoryData));
@@ -599,21 +1046,81 @@ static NSString * _defaultDiskCacheDirectory;
     // 2. in-memory cache miss & diskDataSync
     BOOL shouldQueryDiskSync = ((image && options & SDImageCacheQueryMemoryDataSync) ||
                                 (!image && options & SDImageCacheQueryDiskDataSync));
-    NSData* (^queryDiskDataBlock)(void) = ^NSData* {
+    
+    // Coalesce the asynchronous query for the same key and decode options, one disk read and decode fan out to all waiters
+    NSArray<SDImageCacheToken *> *waiters = @[operation];
+    NSString *queryKey;
+    if (!image && !shouldQueryDiskSync) {
+        queryKey = [self runningQueryKeyForKey:key options:options context:context cacheType:queryCacheType];
+        SD_LOCK(_runningQueriesLock);
+        NSMutableArray<SDImageCacheToken *> *runningWaiters = self.runningQueries[queryKey];
+        if (runningWaiters) {
+            [runningWaiters addObject:operation];
+        } else {
+            runningWaiters = [NSMutableArray arrayWithObject:operation];
+            self.runningQueries[queryKey] = runningWaiters;
+        }
+        SD_UNLOCK(_runningQueriesLock);
+        if (runningWaiters.count > 1) {
+            // Another query is running, wait for its result
+            return operation;
+        }
+        waiters = runningWaiters;
+    }
+    BOOL(^isCancelledBlock)(void) = ^BOOL {
+        if (queryKey) {
+            return [self cancelRunningQueryIfNeededForKey:queryKey waiters:waiters];
+        }
         @synchronized (operation) {
-            if (operation.isCancelled) {
-                return nil;
-            }
+            return operation.isCancelled;
+        }
+    };
+    
+    // The encoded data in memory tier does not need disk IO, only decode
+    SDImageCacheMemoryData *memoryData = [self.memoryDataCache objectForKey:key];
+    
+    BOOL shouldQueryBitmap = !image && !memoryData && [self _shouldQueryBitmapWithCacheType:queryCacheType options:options context:context];
+    UIImage* (^queryBitmapImageBlock)(NSData**) = ^UIImage*(NSData** diskData) {
+        if (!shouldQueryBitmap || isCancelledBlock()) {
+            return nil;
+        }
+        
+        return [self _bitmapDiskImageForKey:key context:context diskData:diskData];
+    };
+    
+    NSData* (^queryDiskDataBlock)(void) = ^NSData* {
+        if (isCancelledBlock()) {
+            return nil;
+        }
+        if (memoryData) {
+            return memoryData.data;
         }
         
         return [self diskImageDataBySearchingAllPathsForKey:key];
     };
     
-    UIImage* (^queryDiskImageBlock)(NSData*) = ^UIImage*(NSData* diskData) {
-        @synchronized (operation) {
-            if (operation.isCancelled) {
-                return nil;
-            }
+    // Extended data is stored along with the disk file, so it should be read on IO queue as well
+    NSData* (^queryExtendedDataBlock)(NSData*) = ^NSData*(NSData* diskData) {
+        if (image || !diskData) {
+            return nil;
+        }
+        if (isCancelledBlock()) {
+            return nil;
+        }
+        if (memoryData) {
+            return memoryData.extendedData;
+        }
+        
+        NSData *extendedData = [self _diskExtendedDataForKey:key];
+        // Keep the data read from disk in memory tier, for the next query after the decoded image is evicted
+        [self _storeImageDataToMemory:diskData extendedData:extendedData forKey:key];
+        return extendedData;
+    };
+    
+    // Decode does not touch the disk cache, so it can run outside of IO queue
+    UIImage* (^queryDiskImageBlock)(NSData*, NSData*) = ^UIImage*(NSData* diskData, NSData* extendedData) {
+        if (isCancelledBlock()) {
+            return nil;
         }
         
         UIImage *diskImage;
@@ -621,63 +1128,357 @@ static NSString * _defaultDiskCacheDirectory;
             // the image is from in-memory cache, but need image data
             diskImage = image;
         } else if (diskData) {
-            BOOL shouldCacheToMomery = YES;
-            if (context[SDWebImageContextStoreCacheType]) {
-                SDImageCacheType cacheType = [context[SDWebImageContextStoreCacheType] integerValue];
-                shouldCacheToMomery = (cacheType == SDImageCacheTypeAll || cacheType == SDImageCacheTypeMemory);
-            }
-            if (context[SDWebImageContextImageThumbnailPixelSize]) {
-                // Query full size cache key which generate a thumbnail, should not write back to full size memory cache
-                shouldCacheToMomery = NO;
-            }
             // decode image data only if in-memory cache missed
-            diskImage = [self diskImageForKey:key data:diskData options:options context:context];
-            if (shouldCacheToMomery && diskImage && self.config.shouldCacheImagesInMemory) {
-                NSUInteger cost = diskImage.sd_memoryCost;
-                [self.memoryCache setObject:diskImage forKey:key cost:cost];
-            }
+            diskImage = [self _decodedDiskImageForKey:key data:diskData extendedData:extendedData options:options context:context];
         }
         return diskImage;
     };
     
-    // Query in ioQueue to keep IO-safe
+    // Query in ioQueue to keep IO-safe, decode in decodeQueue to avoid blocking other IO
     if (shouldQueryDiskSync) {
+        __block UIImage* bitmapImage;
         __block NSData* diskData;
-        __block UIImage* diskImage;
-        dispatch_sync(self.ioQueue, ^{
+        __block NSData* extendedData;
+        dispatch_block_t queryBlock = ^{
+            NSData* bitmapDiskData;
+            bitmapImage = queryBitmapImageBlock(&bitmapDiskData);
+            if (bitmapImage) {
+                diskData = bitmapDiskData;
+                return;
+            }
             diskData = queryDiskDataBlock();
-            diskImage = queryDiskImageBlock(diskData);
-        });
+            extendedData = queryExtendedDataBlock(diskData);
+        };
+        if (memoryData) {
+            // The data is in memory, no need to wait for IO queue
+            queryBlock();
+        } else {
+            dispatch_sync(self.ioQueue, queryBlock);
+        }
+        UIImage* diskImage = bitmapImage ?: queryDiskImageBlock(diskData, extendedData);
         if (doneBlock) {
             doneBlock(diskImage, diskData, SDImageCacheTypeDisk);
         }
     } else {
-        dispatch_async(self.ioQueue, ^{
-            NSData* diskData = queryDiskDataBlock();
-            UIImage* diskImage = queryDiskImageBlock(diskData);
-            @synchronized (operation) {
-                if (operation.isCancelled) {
-                    return;
+        NSQualityOfService qualityOfService = SDImageCacheQualityOfServiceForCurrentQueue();
+        void(^completeBlock)(UIImage*, NSData*) = ^(UIImage* diskImage, NSData* diskData) {
+            NSArray<SDImageCacheToken *> *tokens = queryKey ? [self finishRunningQueryForKey:queryKey waiters:waiters] : waiters;
+            for (SDImageCacheToken *token in tokens) {
+                SDImageCacheQueryCompletionBlock tokenDoneBlock;
+                @synchronized (token) {
+                    tokenDoneBlock = token.isCancelled ? nil : token.doneBlock;
+                }
+                if (!tokenDoneBlock) {
+                    continue;
                 }
-            }
-            if (doneBlock) {
                 dispatch_async(dispatch_get_main_queue(), ^{
                     // Dispatch from IO queue to main queue need time, user may call cancel during the dispatch timing
                     // This check is here to avoid double callback (one is from `SDImageCacheToken` in sync)
-                    @synchronized (operation) {
-                        if (operation.isCancelled) {
+                    @synchronized (token) {
+                        if (token.isCancelled) {
                             return;
                         }
                     }
-                    doneBlock(diskImage, diskData, SDImageCacheTypeDisk);
+                    tokenDoneBlock(diskImage, diskData, SDImageCacheTypeDisk);
                 });
             }
+        };
+        dispatch_block_t queryBlock = ^{
+            NSData* bitmapDiskData;
+            UIImage* bitmapImage = queryBitmapImageBlock(&bitmapDiskData);
+            if (bitmapImage) {
+                // Decoded bitmap hit, no need to decode
+                completeBlock(bitmapImage, bitmapDiskData);
+                return;
+            }
+            NSData* diskData = queryDiskDataBlock();
+            NSData* extendedData = queryExtendedDataBlock(diskData);
+            if (image || !diskData) {
+                // Nothing to decode, callback directly
+                completeBlock(queryDiskImageBlock(diskData, extendedData), diskData);
+                return;
+            }
+            if (isCancelledBlock()) {
+                return;
+            }
+            NSBlockOperation *decodeOperation = [NSBlockOperation blockOperationWithBlock:^{
+                @autoreleasepool {
+                    UIImage* diskImage = queryDiskImageBlock(diskData, extendedData);
+                    completeBlock(diskImage, diskData);
+                }
+            }];
+            decodeOperation.qualityOfService = qualityOfService;
+            [self.decodeQueue addOperation:decodeOperation];
+        };
+        if (memoryData) {
+            // The data is in memory, no need to wait for IO queue
+            queryBlock();
+        } else {
+            dispatch_async(self.ioQueue, queryBlock);
+        }
+    }
+    
+    return operation;
+}
+
+- (nullable SDImageCacheToken *)queryCacheOperationForKeys:(nullable NSArray<NSString *> *)keys options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context cacheType:(SDImageCacheType)queryCacheType progress:(nullable SDImageCacheBatchQueryProgressBlock)progressBlock done:(nullable SDImageCacheBatchQueryCompletionBlock)doneBlock {
+    NSMutableDictionary<NSString *, UIImage *> *images = [NSMutableDictionary dictionary];
+    NSMutableDictionary<NSString *, NSNumber *> *cacheTypes = [NSMutableDictionary dictionary];
+    // Invalid cache type
+    if (queryCacheType == SDImageCacheTypeNone) {
+        for (NSString *key in [NSOrderedSet orderedSetWithArray:keys]) {
+            cacheTypes[key] = @(SDImageCacheTypeNone);
+            if (progressBlock) {
+                progressBlock(key, nil, nil, SDImageCacheTypeNone);
+            }
+        }
+        if (doneBlock) {
+            doneBlock([images copy], [cacheTypes copy]);
+        }
+        return nil;
+    }
+    
+    // First check the in-memory cache in one pass...
+    NSMutableArray<NSString *> *diskKeys = [NSMutableArray array];
+    NSMutableDictionary<NSString *, UIImage *> *memoryImages = [NSMutableDictionary dictionary];
+    BOOL shouldQueryDiskSync = YES;
+    for (NSString *key in [NSOrderedSet orderedSetWithArray:keys]) {
+        UIImage *image;
+        if (queryCacheType != SDImageCacheTypeDisk) {
+            image = [self _memoryImageForKey:key options:options context:context];
+        }
+        BOOL shouldQueryMemoryOnly = (queryCacheType == SDImageCacheTypeMemory) || (image && !(options & SDImageCacheQueryMemoryData));
+        if (shouldQueryMemoryOnly) {
+            SDImageCacheType cacheType = image ? SDImageCacheTypeMemory : SDImageCacheTypeNone;
+            if (image) {
+                images[key] = image;
+            }
+            cacheTypes[key] = @(cacheType);
+            if (progressBlock) {
+                progressBlock(key, image, nil, cacheType);
+            }
+            continue;
+        }
+        if (image) {
+            memoryImages[key] = image;
+        }
+        [diskKeys addObject:key];
+        // Same as single query, but all the keys should match
+        shouldQueryDiskSync = shouldQueryDiskSync && ((image && options & SDImageCacheQueryMemoryDataSync) ||
+                                                      (!image && options & SDImageCacheQueryDiskDataSync));
+    }
+    if (diskKeys.count == 0) {
+        if (doneBlock) {
+            doneBlock([images copy], [cacheTypes copy]);
+        }
+        return nil;
+    }
+    
+    // Second check the disk cache...
+    // The batch token does not have single query done block, it calls the batch done block with the results so far when cancelled
+    SDImageCacheToken *operation = [[SDImageCacheToken alloc] initWithDoneBlock:nil];
+    if (doneBlock) {
+        operation.cancelBlock = ^{
+            NSDictionary<NSString *, UIImage *> *resultImages;
+            NSDictionary<NSString *, NSNumber *> *resultCacheTypes;
+            @synchronized (images) {
+                resultImages = [images copy];
+                resultCacheTypes = [cacheTypes copy];
+            }
+            doneBlock(resultImages, resultCacheTypes);
+        };
+    }
+    BOOL(^isCancelledBlock)(void) = ^BOOL {
+        @synchronized (operation) {
+            return operation.isCancelled;
+        }
+    };
+    
+    // Read the disk data of all keys, should be called on IO queue
+    NSMutableDictionary<NSString *, NSData *> *diskDatas = [NSMutableDictionary dictionary];
+    NSMutableDictionary<NSString *, NSData *> *extendedDatas = [NSMutableDictionary dictionary];
+    NSMutableDictionary<NSString *, UIImage *> *bitmapImages = [NSMutableDictionary dictionary];
+    BOOL shouldQueryBitmap = [self _shouldQueryBitmapWithCacheType:queryCacheType options:options context:context];
+    BOOL(^queryDiskDataBlock)(void) = ^BOOL {
+        for (NSString *key in diskKeys) {
+            if (isCancelledBlock()) {
+                return NO;
+            }
+            NSData *bitmapDiskData;
+            UIImage *bitmapImage = (shouldQueryBitmap && !memoryImages[key]) ? [self _bitmapDiskImageForKey:key context:context diskData:&bitmapDiskData] : nil;
+            if (bitmapImage) {
+                // Decoded bitmap hit, no need to decode the data
+                bitmapImages[key] = bitmapImage;
+                diskDatas[key] = bitmapDiskData;
+                continue;
+            }
+            NSData *diskData = [self diskImageDataBySearchingAllPathsForKey:key];
+            if (!diskData) {
+                continue;
+            }
+            diskDatas[key] = diskData;
+            if (memoryImages[key]) {
+                continue;
+            }
+            NSData *extendedData = [self _diskExtendedDataForKey:key];
+            if (extendedData) {
+                extendedDatas[key] = extendedData;
+            }
+            [self _storeImageDataToMemory:diskData extendedData:extendedData forKey:key];
+        }
+        return YES;
+    };
+    
+    // Decode does not touch the disk cache, so it can run outside of IO queue, in parallel
+    UIImage* (^queryDiskImageBlock)(NSString*) = ^UIImage*(NSString *key) {
+        if (isCancelledBlock()) {
+            return nil;
+        }
+        UIImage *diskImage = memoryImages[key] ?: bitmapImages[key];
+        NSData *diskData = diskDatas[key];
+        if (!diskImage && diskData) {
+            diskImage = [self _decodedDiskImageForKey:key data:diskData extendedData:extendedDatas[key] options:options context:context];
+        }
+        @synchronized (images) {
+            if (diskImage) {
+                images[key] = diskImage;
+            }
+            cacheTypes[key] = diskImage ? @(SDImageCacheTypeDisk) : @(SDImageCacheTypeNone);
+        }
+        return diskImage;
+    };
+    
+    if (shouldQueryDiskSync) {
+        dispatch_sync(self.ioQueue, ^{
+            queryDiskDataBlock();
         });
+        dispatch_apply(diskKeys.count, dispatch_get_global_queue(qos_class_self(), 0), ^(size_t index) {
+            @autoreleasepool {
+                queryDiskImageBlock(diskKeys[index]);
+            }
+        });
+        if (progressBlock) {
+            for (NSString *key in diskKeys) {
+                progressBlock(key, images[key], diskDatas[key], cacheTypes[key].integerValue);
+            }
+        }
+        if (doneBlock) {
+            doneBlock([images copy], [cacheTypes copy]);
+        }
+        return operation;
     }
     
+    NSQualityOfService qualityOfService = SDImageCacheQualityOfServiceForCurrentQueue();
+    void(^progressKeyBlock)(NSString*, UIImage*) = ^(NSString *key, UIImage *diskImage) {
+        if (!progressBlock || isCancelledBlock()) {
+            return;
+        }
+        NSData *diskData = diskDatas[key];
+        SDImageCacheType cacheType = diskImage ? SDImageCacheTypeDisk : SDImageCacheTypeNone;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (isCancelledBlock()) {
+                return;
+            }
+            progressBlock(key, diskImage, diskData, cacheType);
+        });
+    };
+    dispatch_async(self.ioQueue, ^{
+        // Group the disk reads of all keys into one IO queue dispatch
+        if (!queryDiskDataBlock()) {
+            return;
+        }
+        // The completion operation depends on all decode operations, so it's called after all the progress blocks are dispatched
+        NSBlockOperation *completeOperation = [NSBlockOperation blockOperationWithBlock:^{
+            if (!doneBlock || isCancelledBlock()) {
+                return;
+            }
+            NSDictionary<NSString *, UIImage *> *resultImages;
+            NSDictionary<NSString *, NSNumber *> *resultCacheTypes;
+            @synchronized (images) {
+                resultImages = [images copy];
+                resultCacheTypes = [cacheTypes copy];
+            }
+            dispatch_async(dispatch_get_main_queue(), ^{
+                // The cancel calls the done block instead, only one of them wins
+                @synchronized (operation) {
+                    if (operation.isCancelled) {
+                        return;
+                    }
+                    operation.cancelBlock = nil;
+                }
+                doneBlock(resultImages, resultCacheTypes);
+            });
+        }];
+        completeOperation.qualityOfService = qualityOfService;
+        for (NSString *key in diskKeys) {
+            if (memoryImages[key] || !diskDatas[key]) {
+                // Nothing to decode, callback directly
+                progressKeyBlock(key, queryDiskImageBlock(key));
+                continue;
+            }
+            NSBlockOperation *decodeOperation = [NSBlockOperation blockOperationWithBlock:^{
+                @autoreleasepool {
+                    UIImage *diskImage = queryDiskImageBlock(key);
+                    progressKeyBlock(key, diskImage);
+                }
+            }];
+            decodeOperation.qualityOfService = qualityOfService;
+            [completeOperation addDependency:decodeOperation];
+            [self.decodeQueue addOperation:decodeOperation];
+        }
+        [self.decodeQueue addOperation:completeOperation];
+    });
+    
     return operation;
 }
 
+- (nonnull NSString *)runningQueryKeyForKey:(nonnull NSString *)key options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context cacheType:(SDImageCacheType)queryCacheType {
+    // Only the options, context and cache type which affect the result (and the memory cache write back) are taken into account
+    SDImageCacheOptions queryOptions = options & (SDImageCacheScaleDownLargeImages | SDImageCacheAvoidDecodeImage | SDImageCacheDecodeFirstFrameOnly | SDImageCachePreloadAllFrames | SDImageCacheMatchAnimatedImageClass | SDImageCacheQueryMemoryData | SDImageCacheQueryDiskDataSync);
+    return [NSString stringWithFormat:@"%@|%lu|%ld|%@|%@|%@|%@|%p|%@",
+            key,
+            (unsigned long)queryOptions,
+            (long)queryCacheType,
+            context[SDWebImageContextImageScaleFactor],
+            context[SDWebImageContextImagePreserveAspectRatio],
+            context[SDWebImageContextImageThumbnailPixelSize],
+            NSStringFromClass(context[SDWebImageContextAnimatedImageClass]),
+            context[SDWebImageContextImageCoder],
+            context[SDWebImageContextStoreCacheType]];
+}
+
+// Return YES and stop the running query when all the waiters are cancelled, or it's already finished
+- (BOOL)cancelRunningQueryIfNeededForKey:(nonnull NSString *)queryKey waiters:(nonnull NSArray<SDImageCacheToken *> *)waiters {
+    BOOL cancelled = YES;
+    SD_LOCK(_runningQueriesLock);
+    if (self.runningQueries[queryKey] == waiters) {
+        for (SDImageCacheToken *token in waiters) {
+            @synchronized (token) {
+                cancelled = token.isCancelled;
+            }
+            if (!cancelled) {
+                break;
+            }
+        }
+        if (cancelled) {
+            [self.runningQueries removeObjectForKey:queryKey];
+        }
+    }
+    SD_UNLOCK(_runningQueriesLock);
+    return cancelled;
+}
+
+// Stop accepting new waiters, and return all the waiters to callback
+- (nonnull NSArray<SDImageCacheToken *> *)finishRunningQueryForKey:(nonnull NSString *)queryKey waiters:(nonnull NSArray<SDImageCacheToken *> *)waiters {
+    SD_LOCK(_runningQueriesLock);
+    if (self.runningQueries[queryKey] == waiters) {
+        [self.runningQueries removeObjectForKey:queryKey];
+    }
+    NSArray<SDImageCacheToken *> *tokens = [waiters copy];
+    SD_UNLOCK(_runningQueriesLock);
+    return tokens;
+}
+
 #pragma mark - Remove Ops
 
 - (void)removeImageForKey:(nullable NSString *)key withCompletion:(nullable SDWebImageNoParamsBlock)completion {
@@ -698,8 +1499,9 @@ static NSString * _defaultDiskCacheDirectory;
     }
 
     if (fromDisk) {
+        [self cancelPendingStoresForKey:key];
         dispatch_async(self.ioQueue, ^{
-            [self.diskCache removeDataForKey:key];
+            [self _removeImageFromDiskForKey:key];
             
             if (completion) {
                 dispatch_async(dispatch_get_main_queue(), ^{
@@ -724,6 +1526,7 @@ static NSString * _defaultDiskCacheDirectory;
     if (!key) {
         return;
     }
+    [self cancelPendingStoresForKey:key];
     dispatch_sync(self.ioQueue, ^{
         [self _removeImageFromDiskForKey:key];
     });
@@ -736,17 +1539,23 @@ static NSString * _defaultDiskCacheDirectory;
     }
     
     [self.diskCache removeDataForKey:key];
+    [self.bitmapCache removeImageForKey:key];
+    [self.memoryDataCache removeObjectForKey:key];
 }
 
 #pragma mark - Cache clean Ops
 
 - (void)clearMemory {
     [self.memoryCache removeAllObjects];
+    [self.memoryDataCache removeAllObjects];
 }
 
 - (void)clearDiskOnCompletion:(nullable SDWebImageNoParamsBlock)completion {
+    [self cancelPendingStoresForKey:nil];
     dispatch_async(self.ioQueue, ^{
         [self.diskCache removeAllData];
+        [self.bitmapCache removeAllImages];
+        [self.memoryDataCache removeAllObjects];
         if (completion) {
             dispatch_async(dispatch_get_main_queue(), ^{
                 completion();
@@ -766,25 +1575,99 @@ static NSString * _defaultDiskCacheDirectory;
     });
 }
 
+- (BOOL)shouldTrimDiskCacheIncrementally {
+    // Without the index, each slice need to enumerate the whole directory
+    return self.config.diskCacheTrimSliceDuration > 0 && self.config.shouldUseDiskCacheIndex && [self.diskCache respondsToSelector:@selector(removeExpiredDataWithTimeLimit:)];
+}
+
+// Schedule the trimming only when the disk cache is above the high watermark or the oldest data is expired, the check does not touch the disk
+- (void)trimDiskCacheIfNeeded {
+    if (![self shouldTrimDiskCacheIncrementally]) {
+        return;
+    }
+    dispatch_async(self.ioQueue, ^{
+        if (self.trimScheduled) {
+            return;
+        }
+        if ([self.diskCache respondsToSelector:@selector(shouldRemoveExpiredData)] && ![self.diskCache shouldRemoveExpiredData]) {
+            return;
+        }
+        self.trimScheduled = YES;
+        [self _trimDiskCacheSlice];
+    });
+}
+
+// Trim the disk cache in small slices on IO queue, the disk queries can be processed between slices
+- (void)trimDiskCacheWithCompletion:(nullable SDWebImageNoParamsBlock)completionBlock {
+    dispatch_async(self.ioQueue, ^{
+        if (completionBlock) {
+            [self.trimCompletionBlocks addObject:completionBlock];
+        }
+        if (self.trimScheduled) {
+            return;
+        }
+        self.trimScheduled = YES;
+        [self _trimDiskCacheSlice];
+    });
+}
+
+// Make sure to call from io queue by caller
+- (void)_trimDiskCacheSlice {
+    NSTimeInterval sliceDuration = self.config.diskCacheTrimSliceDuration;
+    BOOL finished = [self.diskCache removeExpiredDataWithTimeLimit:sliceDuration > 0 ? sliceDuration : DBL_MAX];
+    if (!finished) {
+        // Yield the IO queue to other operations before next slice
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(sliceDuration * NSEC_PER_SEC)), self.ioQueue, ^{
+            [self _trimDiskCacheSlice];
+        });
+        return;
+    }
+    self.trimScheduled = NO;
+    NSArray<SDWebImageNoParamsBlock> *completionBlocks = [self.trimCompletionBlocks copy];
+    [self.trimCompletionBlocks removeAllObjects];
+    if (completionBlocks.count > 0) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            for (SDWebImageNoParamsBlock completionBlock in completionBlocks) {
+                completionBlock();
+            }
+        });
+    }
+}
+
 #pragma mark - UIApplicationWillTerminateNotification
 
 #if SD_UIKIT || SD_MAC
 - (void)applicationWillTerminate:(NSNotification *)notification {
     // On iOS/macOS, the async opeartion to remove exipred data will be terminated quickly
     // Try using the sync operation to ensure we reomve the exipred data
-    if (!self.config.shouldRemoveExpiredDataWhenTerminate) {
-        return;
-    }
+    // Flush the pending stores in write queue, including the write-behind ones
+    dispatch_sync(self.writeQueue, ^{
+        [self _flushPendingStores];
+    });
     dispatch_sync(self.ioQueue, ^{
-        [self.diskCache removeExpiredData];
+        if (self.config.shouldRemoveExpiredDataWhenTerminate) {
+            [self.diskCache removeExpiredData];
+        }
+        [self _synchronizeDiskCache];
     });
 }
+
+// Make sure to call from io queue by caller
+- (void)_synchronizeDiskCache {
+    if ([self.diskCache respondsToSelector:@selector(synchronize)]) {
+        [self.diskCache synchronize];
+    }
+}
 #endif
 
 #pragma mark - UIApplicationDidEnterBackgroundNotification
 
 #if SD_UIKIT
 - (void)applicationDidEnterBackground:(NSNotification *)notification {
+    // The stores since last trimming are not written to the index manifest yet
+    dispatch_async(self.ioQueue, ^{
+        [self _synchronizeDiskCache];
+    });
     if (!self.config.shouldRemoveExpiredDataWhenEnterBackground) {
         return;
     }
@@ -801,10 +1684,16 @@ static NSString * _defaultDiskCacheDirectory;
     }];
 
     // Start the long-running task and return immediately.
-    [self deleteOldFilesWithCompletionBlock:^{
+    SDWebImageNoParamsBlock completionBlock = ^{
         [application endBackgroundTask:bgTask];
         bgTask = UIBackgroundTaskInvalid;
-    }];
+    };
+    if ([self shouldTrimDiskCacheIncrementally]) {
+        // Continue the incremental trimming, instead of a whole cleanup pass
+        [self trimDiskCacheWithCompletion:completionBlock];
+    } else {
+        [self deleteOldFilesWithCompletionBlock:completionBlock];
+    }
 }
 #endif
 
@@ -850,6 +1739,24 @@ static NSString * _defaultDiskCacheDirectory;
     return options;
 }
 
++ (SDImageCacheOptions)cacheOptionsFromImageOptions:(SDWebImageOptions)options {
+    SDImageCacheOptions cacheOptions = 0;
+    if (options & SDWebImageQueryMemoryData) cacheOptions |= SDImageCacheQueryMemoryData;
+    if (options & SDWebImageQueryMemoryDataSync) cacheOptions |= SDImageCacheQueryMemoryDataSync;
+    if (options & SDWebImageQueryDiskDataSync) cacheOptions |= SDImageCacheQueryDiskDataSync;
+    if (options & SDWebImageScaleDownLargeImages) cacheOptions |= SDImageCacheScaleDownLargeImages;
+    if (options & SDWebImageAvoidDecodeImage) cacheOptions |= SDImageCacheAvoidDecodeImage;
+    if (options & SDWebImageDecodeFirstFrameOnly) cacheOptions |= SDImageCacheDecodeFirstFrameOnly;
+    if (options & SDWebImagePreloadAllFrames) cacheOptions |= SDImageCachePreloadAllFrames;
+    if (options & SDWebImageMatchAnimatedImageClass) cacheOptions |= SDImageCacheMatchAnimatedImageClass;
+    
+    return cacheOptions;
+}
+
+- (BOOL)_shouldStoreHTTPCacheValidators {
+    return self.config.shouldStoreHTTPCacheValidators && [self.diskCache respondsToSelector:@selector(validatorDataForKey:)] && [self.diskCache respondsToSelector:@selector(setValidatorData:forKey:)];
+}
+
 @end
 
 @implementation SDImageCache (SDImageCache)
@@ -861,35 +1768,44 @@ static NSString * _defaultDiskCacheDirectory;
 }
 
 - (id<SDWebImageOperation>)queryImageForKey:(NSString *)key options:(SDWebImageOptions)options context:(nullable SDWebImageContext *)context cacheType:(SDImageCacheType)cacheType completion:(nullable SDImageCacheQueryCompletionBlock)completionBlock {
-    SDImageCacheOptions cacheOptions = 0;
-    if (options & SDWebImageQueryMemoryData) cacheOptions |= SDImageCacheQueryMemoryData;
-    if (options & SDWebImageQueryMemoryDataSync) cacheOptions |= SDImageCacheQueryMemoryDataSync;
-    if (options & SDWebImageQueryDiskDataSync) cacheOptions |= SDImageCacheQueryDiskDataSync;
-    if (options & SDWebImageScaleDownLargeImages) cacheOptions |= SDImageCacheScaleDownLargeImages;
-    if (options & SDWebImageAvoidDecodeImage) cacheOptions |= SDImageCacheAvoidDecodeImage;
-    if (options & SDWebImageDecodeFirstFrameOnly) cacheOptions |= SDImageCacheDecodeFirstFrameOnly;
-    if (options & SDWebImagePreloadAllFrames) cacheOptions |= SDImageCachePreloadAllFrames;
-    if (options & SDWebImageMatchAnimatedImageClass) cacheOptions |= SDImageCacheMatchAnimatedImageClass;
-    
+    SDImageCacheOptions cacheOptions = [[self class] cacheOptionsFromImageOptions:options];
     return [self queryCacheOperationForKey:key options:cacheOptions context:context cacheType:cacheType done:completionBlock];
 }
 
+- (id<SDWebImageOperation>)queryImagesForKeys:(NSArray<NSString *> *)keys options:(SDWebImageOptions)options context:(nullable SDWebImageContext *)context completion:(nullable SDImageCacheBatchQueryCompletionBlock)completionBlock {
+    return [self queryImagesForKeys:keys options:options context:context progress:nil completion:completionBlock];
+}
+
+- (id<SDWebImageOperation>)queryImagesForKeys:(NSArray<NSString *> *)keys options:(SDWebImageOptions)options context:(nullable SDWebImageContext *)context progress:(nullable SDImageCacheBatchQueryProgressBlock)progressBlock completion:(nullable SDImageCacheBatchQueryCompletionBlock)completionBlock {
+    SDImageCacheOptions cacheOptions = [[self class] cacheOptionsFromImageOptions:options];
+    return [self queryCacheOperationForKeys:keys options:cacheOptions context:context cacheType:SDImageCacheTypeAll progress:progressBlock done:completionBlock];
+}
+
 - (void)storeImage:(UIImage *)image imageData:(NSData *)imageData forKey:(nullable NSString *)key cacheType:(SDImageCacheType)cacheType completion:(nullable SDWebImageNoParamsBlock)completionBlock {
+    [self storeImage:image imageData:imageData forKey:key options:0 context:nil cacheType:cacheType completion:completionBlock];
+}
+
+- (void)storeImage:(UIImage *)image imageData:(NSData *)imageData forKey:(nullable NSString *)key options:(SDWebImageOptions)options context:(nullable SDWebImageContext *)context cacheType:(SDImageCacheType)cacheType completion:(nullable SDWebImageNoParamsBlock)completionBlock {
+    BOOL lowPriority = [context[SDWebImageContextMemoryCacheLowPriority] boolValue];
+    SDHTTPCacheValidator *validator = context[SDWebImageContextHTTPCacheValidator];
+    if (![validator isKindOfClass:[SDHTTPCacheValidator class]]) {
+        validator = nil;
+    }
     switch (cacheType) {
         case SDImageCacheTypeNone: {
-            [self storeImage:image imageData:imageData forKey:key toMemory:NO toDisk:NO completion:completionBlock];
+            [self _storeImage:image imageData:imageData forKey:key toMemory:NO toDisk:NO lowPriority:lowPriority validator:validator completion:completionBlock];
         }
             break;
         case SDImageCacheTypeMemory: {
-            [self storeImage:image imageData:imageData forKey:key toMemory:YES toDisk:NO completion:completionBlock];
+            [self _storeImage:image imageData:imageData forKey:key toMemory:YES toDisk:NO lowPriority:lowPriority validator:validator completion:completionBlock];
         }
             break;
         case SDImageCacheTypeDisk: {
-            [self storeImage:image imageData:imageData forKey:key toMemory:NO toDisk:YES completion:completionBlock];
+            [self _storeImage:image imageData:imageData forKey:key toMemory:NO toDisk:YES lowPriority:lowPriority validator:validator completion:completionBlock];
         }
             break;
         case SDImageCacheTypeAll: {
-            [self storeImage:image imageData:imageData forKey:key toMemory:YES toDisk:YES completion:completionBlock];
+            [self _storeImage:image imageData:imageData forKey:key toMemory:YES toDisk:YES lowPriority:lowPriority validator:validator completion:completionBlock];
         }
             break;
         default: {
@@ -1007,5 +1923,70 @@ static NSString * _defaultDiskCacheDirectory;
     }
 }
 
-@end
+- (void)queryHTTPCacheValidatorForKey:(NSString *)key completion:(SDImageCacheHTTPCacheValidatorQueryCompletionBlock)completionBlock {
+    if (!completionBlock) {
+        return;
+    }
+    if (!key || ![self _shouldStoreHTTPCacheValidators]) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completionBlock(nil);
+        });
+        return;
+    }
+    // The pending store is not written yet, its validator is the latest one
+    SD_LOCK(_pendingStoresLock);
+    SDImageCachePendingStore *pendingStore = self.pendingStores[key];
+    BOOL pending = pendingStore && !pendingStore.isCancelled;
+    SDHTTPCacheValidator *pendingValidator = pendingStore.validator;
+    SD_UNLOCK(_pendingStoresLock);
+    if (pending) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completionBlock(pendingValidator);
+        });
+        return;
+    }
+    dispatch_async(self.ioQueue, ^{
+        NSData *validatorData = [self.diskCache validatorDataForKey:key];
+        // Nil if the data is stored without validator, or before the validators are enabled, then manager fallback to `NSURLCache`
+        SDHTTPCacheValidator *validator = validatorData ? [SDHTTPCacheValidator validatorWithArchivedData:validatorData] : nil;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completionBlock(validator);
+        });
+    });
+}
+
+- (void)storeHTTPCacheValidator:(SDHTTPCacheValidator *)validator forKey:(NSString *)key completion:(SDWebImageNoParamsBlock)completionBlock {
+    if (!key || ![self _shouldStoreHTTPCacheValidators]) {
+        if (completionBlock) {
+            completionBlock();
+        }
+        return;
+    }
+    // Attach to the pending store, so the validator is written with its data
+    BOOL attached = NO;
+    SD_LOCK(_pendingStoresLock);
+    SDImageCachePendingStore *pendingStore = self.pendingStores[key];
+    if (pendingStore && !pendingStore.isWriting) {
+        pendingStore.validator = validator;
+        if (completionBlock) {
+            [pendingStore.completionBlocks addObject:completionBlock];
+        }
+        attached = YES;
+    }
+    SD_UNLOCK(_pendingStoresLock);
+    if (attached) {
+        return;
+    }
+    // Use the write queue, so the validator is written after the data which is writing
+    NSData *validatorData = validator.archivedData;
+    dispatch_async(self.writeQueue, ^{
+        dispatch_sync(self.ioQueue, ^{
+            [self.diskCache setValidatorData:validatorData forKey:key];
+        });
+        if (completionBlock) {
+            dispatch_async(dispatch_get_main_queue(), completionBlock);
+        }
+    });
+}
 
+@end
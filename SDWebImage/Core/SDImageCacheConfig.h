@@ -29,6 +29,19 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
     SDImageCacheConfigExpireTypeChangeDate,
 };
 
+/// The hash function to generate the disk cache file name from the cache key
+typedef NS_ENUM(NSUInteger, SDImageCacheConfigFileNameHash) {
+    /**
+     * Use the MD5 hash of the key and the path extension parsed by `NSURL` (Default)
+     */
+    SDImageCacheConfigFileNameHashMD5,
+    /**
+     * Use the 128-bit MurmurHash3 of the key and the plain alphanumeric path extension. This is much faster than MD5, but it's not a cryptographic hash.
+     * The existing MD5 named files are still readable, they're renamed when accessed.
+     */
+    SDImageCacheConfigFileNameHashMurmur3,
+};
+
 /**
  The class contains all the config for image cache
  @note This class conform to NSCopying, make sure to add the property in `copyWithZone:` as well.
@@ -77,15 +90,39 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
 /**
  * The reading options while reading cache from disk.
  * Defaults to 0. You can set this to `NSDataReadingMappedIfSafe` to improve performance.
+ * @note The size-based policy (See `diskCacheMappedReadingThreshold` and `diskCacheUncachedReadingThreshold`) is applied on top of this value.
  */
 @property (assign, nonatomic) NSDataReadingOptions diskCacheReadingOptions;
 
+/**
+ * The minimum file size (in bytes) to read the disk cache with memory mapping (`NSDataReadingMappedIfSafe`). Smaller files use a plain read, because mapping a small file cost more than copying it.
+ * The mapping is kept alive by the returned data (and the image decoder which retains it), so the file content is paged in on demand without a heap copy.
+ * Defaults to 64 KB. Setting this to 0 means only `diskCacheReadingOptions` is used.
+ * @note Mapping by size is only used when `diskCacheWritingOptions` contains `NSDataWritingAtomic`, because a mapped file which is overwritten in place may crash the process.
+ */
+@property (assign, nonatomic) NSUInteger diskCacheMappedReadingThreshold;
+
+/**
+ * The minimum file size (in bytes) to read the disk cache with `NSDataReadingUncached`, which does not keep the file content in the system page cache. This is useful when the large files are read only once, such as the full size image used to generate thumbnail.
+ * This takes precedence over `diskCacheMappedReadingThreshold`.
+ * Defaults to 0. Which means never use uncached reading by size.
+ */
+@property (assign, nonatomic) NSUInteger diskCacheUncachedReadingThreshold;
+
 /**
  * The writing options while writing cache to disk.
  * Defaults to `NSDataWritingAtomic`. You can set this to `NSDataWritingWithoutOverwriting` to prevent overwriting an existing file.
  */
 @property (assign, nonatomic) NSDataWritingOptions diskCacheWritingOptions;
 
+/**
+ * The interval (in seconds) to collect the disk stores of `SDImageCache` and write them in batch (write-behind). The pending stores are still visible to the disk query before they're written.
+ * Batching shares the directory creation and the file attributes update between stores, which reduce the syscalls when prefetching many images. See `-[SDDiskCache setDataBatch:]`.
+ * Defaults to 0. Which means each store is written as soon as possible.
+ * @note The pending stores are lost if the app is killed before they're written, they are flushed when the app is terminated normally.
+ */
+@property (assign, nonatomic) NSTimeInterval diskCacheWriteBehindInterval;
+
 /**
  * The maximum length of time to keep an image in the disk cache, in seconds.
  * Setting this to a negative value means no expiring.
@@ -94,12 +131,75 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
  */
 @property (assign, nonatomic) NSTimeInterval maxDiskAge;
 
+/**
+ * The hash function to generate the file name of the built-in `SDDiskCache`.
+ * When using other than MD5, the files named by MD5 (created by previous version) are renamed when they're accessed, and removed as usual when expired. So you can switch the hash function without losing the existing cache.
+ * Defaults to `SDImageCacheConfigFileNameHashMD5`.
+ * @note This value does not support dynamic changes. Which means further modification on this value after cache initialized has no effect.
+ */
+@property (assign, nonatomic) SDImageCacheConfigFileNameHash diskCacheFileNameHash;
+
+/**
+ * The number of hashed sub-directory levels of the built-in `SDDiskCache`. Each level use 2 hex characters of the hashed file name (256 sub-directories), such as `ab/cd/abcd....png` for level 2. The maximum value is 2.
+ * Large flat directory degrades the file lookup, create and enumeration on file system, enable this if the disk cache holds a large amount of files.
+ * The existing files in flat layout are moved into the fan-out layout when they're accessed, or when the cache directory is moved (See `-[SDDiskCache moveCacheDirectoryFromPath:toPath:]`).
+ * Defaults to 0. Which means the flat layout.
+ * @note This value does not support dynamic changes. Which means further modification on this value after cache initialized has no effect.
+ */
+@property (assign, nonatomic) NSUInteger diskCacheFanOutLevel;
+
+/**
+ * Whether or not to keep an index of the disk cache files, with a manifest file in the disk cache directory.
+ * When enabled, the `totalSize`, `totalCount` and `removeExpiredData` of the built-in `SDDiskCache` use the index and do not need to enumerate the whole cache directory. The index is rebuilt from the directory if the manifest is missing (such as first launch, or the app was killed before the manifest is written).
+ * Defaults to NO.
+ * @note This value does not support dynamic changes. Which means further modification on this value after cache initialized has no effect.
+ */
+@property (assign, nonatomic) BOOL shouldUseDiskCacheIndex;
+
 /**
  * The maximum size of the disk cache, in bytes.
  * Defaults to 0. Which means there is no cache size limit.
  */
 @property (assign, nonatomic) NSUInteger maxDiskSize;
 
+/**
+ * The ratio of `maxDiskSize` to start the size-based trimming of disk cache.
+ * Defaults to 1.0. Which means start trimming when the disk cache exceeds `maxDiskSize`.
+ */
+@property (assign, nonatomic) double diskCacheHighWatermarkRatio;
+
+/**
+ * The ratio of `maxDiskSize` to stop the size-based trimming of disk cache. The oldest files are removed until the disk cache is not larger than this size, no more.
+ * Defaults to 0.8. (Before this option, the disk cache was always trimmed to half of `maxDiskSize`)
+ */
+@property (assign, nonatomic) double diskCacheLowWatermarkRatio;
+
+/**
+ * The time limit (in seconds) of each slice of the incremental trimming. When the disk cache index is used (See `shouldUseDiskCacheIndex`), `SDImageCache` checks the expiration and watermarks after writing, and trims the disk cache in small slices on the IO queue, so the disk query is not blocked by a long cleanup pass. The progress is kept in disk cache, an interrupted trimming is resumed after relaunch.
+ * Defaults to 0.005 (5ms). Setting this to 0 disables the incremental trimming, the disk cache is only trimmed by `deleteOldFilesWithCompletionBlock:`, or when app enters background / terminates.
+ */
+@property (assign, nonatomic) NSTimeInterval diskCacheTrimSliceDuration;
+
+/**
+ * Whether or not to keep a decoded bitmap copy of the small static images on disk, so a disk cache hit does not need to decode the image data again. The bitmaps are appended into fixed-size chunk files next to the disk cache directory, and a hit maps the pixels into the image without decoding or copying.
+ * The bitmap is only used for the query of `SDImageCacheTypeAll` when the image data still exists in disk cache, the image data is still read and provided in the query completion. The query with `SDImageCacheScaleDownLargeImages`, `SDImageCacheAvoidDecodeImage` or `SDImageCacheMatchAnimatedImageClass` decodes the image data instead. The animated images are not stored.
+ * Defaults to NO.
+ * @note This value does not support dynamic changes. Which means further modification on this value after cache initialized has no effect.
+ */
+@property (assign, nonatomic) BOOL shouldCacheDecodedImagesOnDisk;
+
+/**
+ * The maximum pixel count (width * height) of the image to keep the decoded bitmap on disk. The decoding cost matters more than the size for small and medium images, such as avatars and thumbnails.
+ * Defaults to 512 * 512.
+ */
+@property (assign, nonatomic) NSUInteger maxDecodedDiskCachePixelCount;
+
+/**
+ * The maximum size of the decoded bitmaps on disk, in bytes. This is not counted in `maxDiskSize`. The oldest chunk file is removed when exceeds.
+ * Defaults to 50MB. 0 means there is no size limit.
+ */
+@property (assign, nonatomic) NSUInteger maxDecodedDiskCacheSize;
+
 /**
  * The maximum "total cost" of the in-memory image cache. The cost function is the bytes size held in memory.
  * @note The memory cost is bytes size in memory, but not simple pixels count. For common ARGB8888 image, one pixel is 4 bytes (32 bits).
@@ -113,6 +213,30 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
  */
 @property (assign, nonatomic) NSUInteger maxMemoryCount;
 
+/**
+ * Whether or not to keep the encoded image data (the original bytes, which is much smaller than the decoded image) in a memory tier between the memory cache and the disk cache.
+ * When the decoded image is evicted from the memory cache, the next query is served from the data in memory with a decode, but without disk IO. The query with `SDImageCacheQueryMemoryData` also read the data from this tier.
+ * The data is kept by an `SDLRUMemoryCache` with `maxMemoryDataCost` limit, after it's read from or written to disk.
+ * Defaults to NO.
+ * @note This value does not support dynamic changes. Which means further modification on this value after cache initialized has no effect.
+ */
+@property (assign, nonatomic) BOOL shouldCacheImageDataInMemory;
+
+/**
+ * The maximum bytes of the encoded image data kept in memory. See `shouldCacheImageDataInMemory`.
+ * Defaults to 20MB. 0 means there is no cost limit.
+ * @note This value does not support dynamic changes. Which means further modification on this value after cache initialized has no effect.
+ */
+@property (assign, nonatomic) NSUInteger maxMemoryDataCost;
+
+/**
+ * Whether or not to store the HTTP cache validators (`ETag`, `Last-Modified` and `Cache-Control` max-age) of the downloaded image with the image data in disk cache.
+ * When enabled, `SDWebImageRefreshCached` does not use `NSURLCache`, which stores every image data a second time. The fresh image is used without network request, the stale image is revalidated with `If-None-Match` / `If-Modified-Since` request, and the 304 response is treated as cache hit.
+ * The disk cache should implement `validatorDataForKey:` and `setValidatorData:forKey:`, the built-in `SDDiskCache` stores the validator in the extended file attributes.
+ * Defaults to NO.
+ */
+@property (assign, nonatomic) BOOL shouldStoreHTTPCacheValidators;
+
 /*
  * The attribute which the clear cache will be checked against when clearing the disk cache
  * Default is Modified Date
@@ -141,4 +265,13 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
  */
 @property (assign ,nonatomic, nonnull) Class diskCacheClass;
 
+/**
+ * The reading options for a disk cache file with the given size, calculated from `diskCacheReadingOptions`, `diskCacheMappedReadingThreshold` and `diskCacheUncachedReadingThreshold`.
+ * The custom disk cache class can use this to keep the same reading policy as the built-in `SDDiskCache`.
+ *
+ * @param fileSize The file size in bytes
+ * @return The reading options to read the file
+ */
+- (NSDataReadingOptions)diskCacheReadingOptionsForFileSize:(unsigned long long)fileSize;
+
 @end
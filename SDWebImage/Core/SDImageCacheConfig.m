@@ -12,6 +12,7 @@
 
 static SDImageCacheConfig *_defaultCacheConfig;
 static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
+static const NSUInteger kDefaultDiskCacheMappedReadingThreshold = 64 * 1024; // 64 KB
 
 @implementation SDImageCacheConfig
 
@@ -32,8 +33,23 @@ static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
         _shouldRemoveExpiredDataWhenTerminate = YES;
         _diskCacheReadingOptions = 0;
         _diskCacheWritingOptions = NSDataWritingAtomic;
+        _diskCacheMappedReadingThreshold = kDefaultDiskCacheMappedReadingThreshold;
+        _diskCacheUncachedReadingThreshold = 0;
+        _diskCacheWriteBehindInterval = 0;
         _maxDiskAge = kDefaultCacheMaxDiskAge;
         _maxDiskSize = 0;
+        _diskCacheHighWatermarkRatio = 1.0;
+        _diskCacheLowWatermarkRatio = 0.8;
+        _diskCacheTrimSliceDuration = 0.005;
+        _shouldUseDiskCacheIndex = NO;
+        _diskCacheFanOutLevel = 0;
+        _diskCacheFileNameHash = SDImageCacheConfigFileNameHashMD5;
+        _shouldCacheDecodedImagesOnDisk = NO;
+        _maxDecodedDiskCachePixelCount = 512 * 512;
+        _maxDecodedDiskCacheSize = 50 * 1024 * 1024;
+        _shouldCacheImageDataInMemory = NO;
+        _maxMemoryDataCost = 20 * 1024 * 1024;
+        _shouldStoreHTTPCacheValidators = NO;
         _diskCacheExpireType = SDImageCacheConfigExpireTypeModificationDate;
         _memoryCacheClass = [SDMemoryCache class];
         _diskCacheClass = [SDDiskCache class];
@@ -50,10 +66,25 @@ static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
     config.shouldRemoveExpiredDataWhenTerminate = self.shouldRemoveExpiredDataWhenTerminate;
     config.diskCacheReadingOptions = self.diskCacheReadingOptions;
     config.diskCacheWritingOptions = self.diskCacheWritingOptions;
+    config.diskCacheMappedReadingThreshold = self.diskCacheMappedReadingThreshold;
+    config.diskCacheUncachedReadingThreshold = self.diskCacheUncachedReadingThreshold;
+    config.diskCacheWriteBehindInterval = self.diskCacheWriteBehindInterval;
     config.maxDiskAge = self.maxDiskAge;
     config.maxDiskSize = self.maxDiskSize;
+    config.diskCacheHighWatermarkRatio = self.diskCacheHighWatermarkRatio;
+    config.diskCacheLowWatermarkRatio = self.diskCacheLowWatermarkRatio;
+    config.diskCacheTrimSliceDuration = self.diskCacheTrimSliceDuration;
+    config.shouldUseDiskCacheIndex = self.shouldUseDiskCacheIndex;
+    config.diskCacheFanOutLevel = self.diskCacheFanOutLevel;
+    config.diskCacheFileNameHash = self.diskCacheFileNameHash;
+    config.shouldCacheDecodedImagesOnDisk = self.shouldCacheDecodedImagesOnDisk;
+    config.maxDecodedDiskCachePixelCount = self.maxDecodedDiskCachePixelCount;
+    config.maxDecodedDiskCacheSize = self.maxDecodedDiskCacheSize;
     config.maxMemoryCost = self.maxMemoryCost;
     config.maxMemoryCount = self.maxMemoryCount;
+    config.shouldCacheImageDataInMemory = self.shouldCacheImageDataInMemory;
+    config.maxMemoryDataCost = self.maxMemoryDataCost;
+    config.shouldStoreHTTPCacheValidators = self.shouldStoreHTTPCacheValidators;
     config.diskCacheExpireType = self.diskCacheExpireType;
     config.fileManager = self.fileManager; // NSFileManager does not conform to NSCopying, just pass the reference
     config.memoryCacheClass = self.memoryCacheClass;
@@ -62,4 +93,17 @@ static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
     return config;
 }
 
+- (NSDataReadingOptions)diskCacheReadingOptionsForFileSize:(unsigned long long)fileSize {
+    NSDataReadingOptions options = self.diskCacheReadingOptions;
+    if (self.diskCacheUncachedReadingThreshold > 0 && fileSize >= self.diskCacheUncachedReadingThreshold) {
+        // Uncached reading copy the data into memory, which does not work with mapping
+        options &= ~(NSDataReadingMappedIfSafe | NSDataReadingMappedAlways);
+        return options | NSDataReadingUncached;
+    }
+    if (self.diskCacheMappedReadingThreshold > 0 && fileSize >= self.diskCacheMappedReadingThreshold && (self.diskCacheWritingOptions & NSDataWritingAtomic)) {
+        options |= NSDataReadingMappedIfSafe;
+    }
+    return options;
+}
+
 @end
@@ -11,6 +11,7 @@
 #import "SDWebImageOperation.h"
 #import "SDWebImageDefine.h"
 #import "SDImageCoder.h"
+#import "SDHTTPCacheValidator.h"
 
 /// Image Cache Type
 typedef NS_ENUM(NSInteger, SDImageCacheType) {
@@ -42,6 +43,9 @@ typedef void(^SDImageCacheCalculateSizeBlock)(NSUInteger fileCount, NSUInteger t
 typedef NSString * _Nullable (^SDImageCacheAdditionalCachePathBlock)(NSString * _Nonnull key);
 typedef void(^SDImageCacheQueryCompletionBlock)(UIImage * _Nullable image, NSData * _Nullable data, SDImageCacheType cacheType);
 typedef void(^SDImageCacheContainsCompletionBlock)(SDImageCacheType containsCacheType);
+typedef void(^SDImageCacheBatchQueryProgressBlock)(NSString * _Nonnull key, UIImage * _Nullable image, NSData * _Nullable data, SDImageCacheType cacheType);
+typedef void(^SDImageCacheBatchQueryCompletionBlock)(NSDictionary<NSString *, UIImage *> * _Nonnull images, NSDictionary<NSString *, NSNumber *> * _Nonnull cacheTypes);
+typedef void(^SDImageCacheHTTPCacheValidatorQueryCompletionBlock)(SDHTTPCacheValidator * _Nullable validator);
 
 /**
  This is the built-in decoding process for image query from cache.
@@ -147,4 +151,80 @@ FOUNDATION_EXPORT SDImageCoderOptions * _Nonnull SDGetDecodeOptionsFromContext(S
 - (void)clearWithCacheType:(SDImageCacheType)cacheType
                 completion:(nullable SDWebImageNoParamsBlock)completionBlock;
 
+@optional
+/**
+ Query the cached images from image cache for given keys in one batch, with one operation to cancel the whole batch.
+ This is useful when a list view query many keys at once, the memory cache is checked in one pass, and the disk query and decoding are grouped.
+ If all images are cached in memory, completion is called synchronously, else asynchronously on the main queue.
+
+ @param keys The image cache keys. The duplicated keys are queried only once
+ @param options A mask to specify options to use for this query
+ @param context A context contains different options to perform specify changes or processes, see `SDWebImageContextOption`. This hold the extra objects which `options` enum can not hold.
+ @param completionBlock The completion block, called once when all keys are queried. The `images` contains the found images, the `cacheTypes` contains the `SDImageCacheType` for each key (`.none` for missing ones). Will not get called if the operation is cancelled
+ @return The operation for this batch query
+ */
+- (nullable id<SDWebImageOperation>)queryImagesForKeys:(nonnull NSArray<NSString *> *)keys
+                                               options:(SDWebImageOptions)options
+                                               context:(nullable SDWebImageContext *)context
+                                            completion:(nullable SDImageCacheBatchQueryCompletionBlock)completionBlock;
+
+/**
+ Query the cached images from image cache for given keys in one batch, with one operation to cancel the whole batch.
+ Compared to `queryImagesForKeys:options:context:completion:`, the result of each key is also delivered through the progress block as soon as it's available, so the visible cells can be updated without waiting for the whole batch.
+
+ @param keys The image cache keys. The duplicated keys are queried only once
+ @param options A mask to specify options to use for this query
+ @param context A context contains different options to perform specify changes or processes, see `SDWebImageContextOption`. This hold the extra objects which `options` enum can not hold.
+ @param progressBlock The block called for each key. The memory cache result is called synchronously, the disk cache result is called on the main queue. Will not get called if the operation is cancelled
+ @param completionBlock The completion block, called once after all the progress blocks. Will not get called if the operation is cancelled
+ @return The operation for this batch query
+ */
+- (nullable id<SDWebImageOperation>)queryImagesForKeys:(nonnull NSArray<NSString *> *)keys
+                                               options:(SDWebImageOptions)options
+                                               context:(nullable SDWebImageContext *)context
+                                              progress:(nullable SDImageCacheBatchQueryProgressBlock)progressBlock
+                                            completion:(nullable SDImageCacheBatchQueryCompletionBlock)completionBlock;
+
+/**
+ Store the image into image cache for the given key, with options and context. If cache type is memory only, completion is called synchronously, else asynchronously.
+ Compared to `storeImage:imageData:forKey:cacheType:completion:`, the context can control the store, such as `SDWebImageContextMemoryCacheLowPriority`.
+
+ @param image The image to store
+ @param imageData The image data to be used for disk storage
+ @param key The image cache key
+ @param options A mask to specify options to use for this store
+ @param context A context contains different options to perform specify changes or processes, see `SDWebImageContextOption`. This hold the extra objects which `options` enum can not hold.
+ @param cacheType The image store op cache type
+ @param completionBlock A block executed after the operation is finished
+ */
+- (void)storeImage:(nullable UIImage *)image
+         imageData:(nullable NSData *)imageData
+            forKey:(nullable NSString *)key
+           options:(SDWebImageOptions)options
+           context:(nullable SDWebImageContext *)context
+         cacheType:(SDImageCacheType)cacheType
+        completion:(nullable SDWebImageNoParamsBlock)completionBlock;
+
+/**
+ Query the HTTP cache validator stored with the image data for the given key. This is used by manager for `SDWebImageRefreshCached`, the fresh image is used without network request, and the stale image is revalidated with conditional request.
+ The completion is called asynchronously on the main queue.
+
+ @param key The image cache key
+ @param completionBlock The completion block. The validator is nil if the image cache does not store the validators, or no validator is stored for the key, then manager fallback to `NSURLCache`
+ */
+- (void)queryHTTPCacheValidatorForKey:(nullable NSString *)key
+                           completion:(nonnull SDImageCacheHTTPCacheValidatorQueryCompletionBlock)completionBlock;
+
+/**
+ Store the HTTP cache validator for the given key, without touching the image data. This is used by manager to update the freshness after the 304 (Not Modified) response.
+ The validator of downloaded image is stored with the image data, through the `SDWebImageContextHTTPCacheValidator` of store context.
+
+ @param validator The validator (pass nil to remove)
+ @param key The image cache key
+ @param completionBlock A block executed after the operation is finished
+ */
+- (void)storeHTTPCacheValidator:(nullable SDHTTPCacheValidator *)validator
+                         forKey:(nullable NSString *)key
+                     completion:(nullable SDWebImageNoParamsBlock)completionBlock;
+
 @end
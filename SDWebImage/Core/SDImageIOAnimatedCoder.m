@@ -13,6 +13,7 @@
 #import "SDImageCoderHelper.h"
 #import "SDAnimatedImageRep.h"
 #import "UIImage+ForceDecode.h"
+#import "SDMemoryPressureCoordinator.h"
 
 // Specify DPI for vector format in CGImageSource, like PDF
 static NSString * kSDCGImageSourceRasterizationDPI = @"kCGImageSourceRasterizationDPI";
@@ -29,6 +30,10 @@ static NSString * kSDCGImageDestinationRequestedFileSize = @"kCGImageDestination
 @implementation SDImageIOCoderFrame
 @end
 
+@interface SDImageIOAnimatedCoder () <SDMemoryPressureResponder>
+
+@end
+
 @implementation SDImageIOAnimatedCoder {
     size_t _width, _height;
     CGImageSourceRef _imageSource;
@@ -48,13 +53,13 @@ static NSString * kSDCGImageDestinationRequestedFileSize = @"kCGImageDestination
         CFRelease(_imageSource);
         _imageSource = NULL;
     }
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
 }
 
-- (void)didReceiveMemoryWarning:(NSNotification *)notification
+- (void)memoryPressureCoordinator:(SDMemoryPressureCoordinator *)coordinator didReceiveMemoryPressure:(SDMemoryPressureLevel)level
 {
+    if (level == SDMemoryPressureLevelNormal) {
+        return;
+    }
     if (_imageSource) {
         for (size_t i = 0; i < _frameCount; i++) {
             CGImageSourceRemoveCacheAtIndex(_imageSource, i);
@@ -369,7 +374,7 @@ static NSString * kSDCGImageDestinationRequestedFileSize = @"kCGImageDestination
         }
         _preserveAspectRatio = preserveAspectRatio;
 #if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+        [SDMemoryPressureCoordinator.sharedCoordinator registerResponder:self priority:SDMemoryPressurePriorityCoder];
 #endif
     }
     return self;
@@ -576,7 +581,7 @@ static NSString * kSDCGImageDestinationRequestedFileSize = @"kCGImageDestination
         _imageSource = imageSource;
         _imageData = data;
 #if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+        [SDMemoryPressureCoordinator.sharedCoordinator registerResponder:self priority:SDMemoryPressurePriorityCoder];
 #endif
     }
     return self;
@@ -12,12 +12,17 @@
 #import <ImageIO/ImageIO.h>
 #import "UIImage+Metadata.h"
 #import "SDImageIOAnimatedCoderInternal.h"
+#import "SDMemoryPressureCoordinator.h"
 
 // Specify DPI for vector format in CGImageSource, like PDF
 static NSString * kSDCGImageSourceRasterizationDPI = @"kCGImageSourceRasterizationDPI";
 // Specify File Size for lossy format encoding, like JPEG
 static NSString * kSDCGImageDestinationRequestedFileSize = @"kCGImageDestinationRequestedFileSize";
 
+@interface SDImageIOCoder () <SDMemoryPressureResponder>
+
+@end
+
 @implementation SDImageIOCoder {
     size_t _width, _height;
     CGImagePropertyOrientation _orientation;
@@ -33,13 +38,13 @@ static NSString * kSDCGImageDestinationRequestedFileSize = @"kCGImageDestination
         CFRelease(_imageSource);
         _imageSource = NULL;
     }
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
 }
 
-- (void)didReceiveMemoryWarning:(NSNotification *)notification
+- (void)memoryPressureCoordinator:(SDMemoryPressureCoordinator *)coordinator didReceiveMemoryPressure:(SDMemoryPressureLevel)level
 {
+    if (level == SDMemoryPressureLevelNormal) {
+        return;
+    }
     if (_imageSource) {
         CGImageSourceRemoveCacheAtIndex(_imageSource, 0);
     }
@@ -184,7 +189,7 @@ static NSString * kSDCGImageDestinationRequestedFileSize = @"kCGImageDestination
         }
         _preserveAspectRatio = preserveAspectRatio;
 #if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+        [SDMemoryPressureCoordinator.sharedCoordinator registerResponder:self priority:SDMemoryPressurePriorityCoder];
 #endif
     }
     return self;
@@ -0,0 +1,90 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+#import "SDMemoryCache.h"
+
+/// The eviction policy of `SDLRUMemoryCache`
+typedef NS_ENUM(NSUInteger, SDLRUMemoryCacheEvictionPolicy) {
+    /**
+     * Evict the least recently used object first.
+     */
+    SDLRUMemoryCacheEvictionPolicyLRU = 0,
+    /**
+     * Segmented LRU. New objects are inserted into the probationary segment, and promoted into the protected segment when accessed again. Evict the probationary segment first, so one-time accessed objects do not flush the frequently accessed ones.
+     */
+    SDLRUMemoryCacheEvictionPolicySegmentedLRU,
+    /**
+     * W-TinyLFU. New objects are inserted into a small LRU window (1% of the limits), and then admitted into the segmented LRU only when they're accessed more frequently than the object to be evicted. The access frequency is estimated by a Count-Min sketch. So a burst of one-time accessed objects (like prefetching) can not flush the working set.
+     */
+    SDLRUMemoryCacheEvictionPolicyTinyLFU
+};
+
+/**
+ A memory cache which use a strict LRU (or SLRU) eviction by cost and count, instead of the undocumented eviction of `NSCache`.
+ The objects are distributed into several shards by the key hash, each shard has its own lock and linked list, so the concurrent access from different threads does not contend on one lock. The `maxMemoryCost` and `maxMemoryCount` limits are divided equally into each shard.
+ It also support weak cache and auto purge the cache on memory warning, like `SDMemoryCache`.
+
+ To use this class, set `SDImageCacheConfig.memoryCacheClass` to `SDLRUMemoryCache.class`.
+ */
+@interface SDLRUMemoryCache <KeyType, ObjectType> : NSObject <SDMemoryCache>
+
+@property (nonatomic, strong, nonnull, readonly) SDImageCacheConfig *config;
+
+/**
+ The number of lock shards. Always be power of 2.
+ Defaults to the active processor count (round up to power of 2, at least 2).
+ */
+@property (nonatomic, assign, readonly) NSUInteger shardCount;
+
+/**
+ The eviction policy. This value does not support dynamic changes, set it before storing any object.
+ Defaults to `SDLRUMemoryCacheEvictionPolicyLRU`.
+ */
+@property (nonatomic, assign) SDLRUMemoryCacheEvictionPolicy evictionPolicy;
+
+/**
+ The total cost of objects in the cache.
+ */
+@property (nonatomic, assign, readonly) NSUInteger totalCost;
+
+/**
+ The total count of objects in the cache.
+ */
+@property (nonatomic, assign, readonly) NSUInteger totalCount;
+
+/**
+ The number of `objectForKey:` calls which find an object, including the one from weak cache.
+ */
+@property (nonatomic, assign, readonly) NSUInteger hitCount;
+
+/**
+ The number of `objectForKey:` calls which does not find any object.
+ */
+@property (nonatomic, assign, readonly) NSUInteger missCount;
+
+/**
+ The number of objects evicted because of the cost or count limit.
+ */
+@property (nonatomic, assign, readonly) NSUInteger evictionCount;
+
+/**
+ Create a new memory cache instance with the specify cache config and shard count.
+
+ @param config The cache config to be used to create the cache.
+ @param shardCount The number of lock shards, round up to power of 2. Pass 0 to use the default value.
+ @return The new memory cache instance.
+ */
+- (nonnull instancetype)initWithConfig:(nonnull SDImageCacheConfig *)config shardCount:(NSUInteger)shardCount NS_DESIGNATED_INITIALIZER;
+
+/**
+ Reset the hit, miss and eviction counters to 0.
+ */
+- (void)resetStatistics;
+
+@end
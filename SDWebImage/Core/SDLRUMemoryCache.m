@@ -0,0 +1,695 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDLRUMemoryCache.h"
+#import "SDImageCacheConfig.h"
+#import "UIImage+MemoryCacheCost.h"
+#import "SDInternalMacros.h"
+#import "SDMemoryPressureCoordinator.h"
+
+static void * SDLRUMemoryCacheContext = &SDLRUMemoryCacheContext;
+
+// The ratio of protected segment in SLRU, same as the common choice (80% protected, 20% probationary)
+static const double SDLRUMemoryCacheProtectedRatio = 0.8;
+
+// The ratio of admission window in W-TinyLFU, same as the common choice (1% window, 99% main segments)
+static const double SDLRUMemoryCacheWindowRatio = 0.01;
+
+// The frequency counters of sketch are saturated at this value, like the 4-bit counters of TinyLFU
+static const uint8_t SDLRUMemoryCacheSketchMaxFrequency = 15;
+static const NSUInteger SDLRUMemoryCacheSketchDepth = 4;
+
+@interface SDLRUMemoryCacheNode : NSObject {
+    @package
+    __unsafe_unretained SDLRUMemoryCacheNode *_prev;
+    __unsafe_unretained SDLRUMemoryCacheNode *_next;
+    id _key;
+    id _value;
+    NSUInteger _cost;
+    NSUInteger _hash;
+    BOOL _isProtected;
+    BOOL _isWindow;
+}
+@end
+
+@implementation SDLRUMemoryCacheNode
+@end
+
+// A doubly linked list, head is the most recently used and tail is the least recently used. Not thread-safe.
+@interface SDLRUMemoryCacheList : NSObject {
+    @package
+    __unsafe_unretained SDLRUMemoryCacheNode *_head; // retained by the shard map, not here
+    __unsafe_unretained SDLRUMemoryCacheNode *_tail;
+    NSUInteger _totalCost;
+    NSUInteger _totalCount;
+}
+@end
+
+@implementation SDLRUMemoryCacheList
+
+- (void)insertNodeAtHead:(SDLRUMemoryCacheNode *)node {
+    _totalCost += node->_cost;
+    _totalCount++;
+    if (_head) {
+        node->_next = _head;
+        _head->_prev = node;
+        _head = node;
+    } else {
+        _head = _tail = node;
+    }
+}
+
+- (void)insertNodeAtTail:(SDLRUMemoryCacheNode *)node {
+    _totalCost += node->_cost;
+    _totalCount++;
+    if (_tail) {
+        node->_prev = _tail;
+        _tail->_next = node;
+        _tail = node;
+    } else {
+        _head = _tail = node;
+    }
+}
+
+- (void)bringNodeToHead:(SDLRUMemoryCacheNode *)node {
+    if (_head == node) {
+        return;
+    }
+    if (_tail == node) {
+        _tail = node->_prev;
+        _tail->_next = nil;
+    } else {
+        node->_next->_prev = node->_prev;
+        node->_prev->_next = node->_next;
+    }
+    node->_next = _head;
+    node->_prev = nil;
+    _head->_prev = node;
+    _head = node;
+}
+
+- (void)removeNode:(SDLRUMemoryCacheNode *)node {
+    _totalCost -= node->_cost;
+    _totalCount--;
+    if (node->_next) node->_next->_prev = node->_prev;
+    if (node->_prev) node->_prev->_next = node->_next;
+    if (_head == node) _head = node->_next;
+    if (_tail == node) _tail = node->_prev;
+    node->_prev = nil;
+    node->_next = nil;
+}
+
+- (void)removeAll {
+    _totalCost = 0;
+    _totalCount = 0;
+    _head = nil;
+    _tail = nil;
+}
+
+@end
+
+// One lock shard. For LRU only the probation list is used, the window list and sketch are only used for TinyLFU.
+@interface SDLRUMemoryCacheShard : NSObject {
+    @package
+    SD_LOCK_DECLARE(_lock);
+    CFMutableDictionaryRef _map;
+    SDLRUMemoryCacheList *_window;
+    SDLRUMemoryCacheList *_probation;
+    SDLRUMemoryCacheList *_protected;
+    uint8_t *_sketch; // SDLRUMemoryCacheSketchDepth rows of counters
+    NSUInteger _sketchMask;
+    NSUInteger _sketchAdditions;
+    NSUInteger _costLimit;
+    NSUInteger _countLimit;
+    NSUInteger _hitCount;
+    NSUInteger _missCount;
+    NSUInteger _evictionCount;
+#if SD_UIKIT
+    NSMapTable *_weakCache; // strong-weak cache
+#endif
+}
+@end
+
+@implementation SDLRUMemoryCacheShard
+
+- (void)dealloc {
+    CFRelease(_map);
+    free(_sketch);
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        SD_LOCK_INIT(_lock);
+        // Does not copy the key, like NSCache
+        _map = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        _window = [SDLRUMemoryCacheList new];
+        _probation = [SDLRUMemoryCacheList new];
+        _protected = [SDLRUMemoryCacheList new];
+#if SD_UIKIT
+        _weakCache = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory valueOptions:NSPointerFunctionsWeakMemory capacity:0];
+#endif
+    }
+    return self;
+}
+
+@end
+
+static inline SDLRUMemoryCacheList * SDLRUMemoryCacheListOfNode(SDLRUMemoryCacheShard *shard, SDLRUMemoryCacheNode *node) {
+    if (node->_isWindow) {
+        return shard->_window;
+    }
+    return node->_isProtected ? shard->_protected : shard->_probation;
+}
+
+@interface SDLRUMemoryCache () <SDMemoryPressureResponder> {
+    NSUInteger _shardMask;
+    NSArray<SDLRUMemoryCacheShard *> *_shards;
+}
+
+@property (nonatomic, strong, nonnull) SDImageCacheConfig *config;
+
+@end
+
+@implementation SDLRUMemoryCache
+
+- (void)dealloc {
+    [_config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCost)) context:SDLRUMemoryCacheContext];
+    [_config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCount)) context:SDLRUMemoryCacheContext];
+}
+
+- (instancetype)init {
+    return [self initWithConfig:[[SDImageCacheConfig alloc] init] shardCount:0];
+}
+
+- (instancetype)initWithConfig:(SDImageCacheConfig *)config {
+    return [self initWithConfig:config shardCount:0];
+}
+
+- (instancetype)initWithConfig:(SDImageCacheConfig *)config shardCount:(NSUInteger)shardCount {
+    self = [super init];
+    if (self) {
+        _config = config;
+        if (shardCount == 0) {
+            shardCount = MAX(NSProcessInfo.processInfo.activeProcessorCount, 2);
+        }
+        // Round up to power of 2, so the shard index can be calculated by mask
+        NSUInteger count = 1;
+        while (count < shardCount) {
+            count <<= 1;
+        }
+        _shardCount = count;
+        _shardMask = count - 1;
+        NSMutableArray<SDLRUMemoryCacheShard *> *shards = [NSMutableArray arrayWithCapacity:count];
+        for (NSUInteger i = 0; i < count; i++) {
+            [shards addObject:[SDLRUMemoryCacheShard new]];
+        }
+        _shards = [shards copy];
+        [self commonInit];
+    }
+    return self;
+}
+
+- (void)commonInit {
+    SDImageCacheConfig *config = self.config;
+    [self updateCostLimit:config.maxMemoryCost];
+    [self updateCountLimit:config.maxMemoryCount];
+
+    [config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCost)) options:0 context:SDLRUMemoryCacheContext];
+    [config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCount)) options:0 context:SDLRUMemoryCacheContext];
+
+#if SD_UIKIT
+    [SDMemoryPressureCoordinator.sharedCoordinator registerResponder:self priority:SDMemoryPressurePriorityMemoryCache];
+#endif
+}
+
+#pragma mark - Shard
+
+- (SDLRUMemoryCacheShard *)shardForHash:(NSUInteger)hash {
+    // Mix the high bits, the NSString hash is not well distributed in low bits
+    hash ^= (hash >> 16);
+    hash *= 0x45d9f3b;
+    hash ^= (hash >> 16);
+    return _shards[hash & _shardMask];
+}
+
+- (void)updateCostLimit:(NSUInteger)costLimit {
+    // 0 means no limit, keep it 0 for each shard
+    NSUInteger shardCostLimit = costLimit > 0 ? MAX((costLimit + _shardCount - 1) / _shardCount, 1) : 0;
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        SD_LOCK(shard->_lock);
+        shard->_costLimit = shardCostLimit;
+        NSArray *evictedNodes = [self trimShard:shard];
+        SD_UNLOCK(shard->_lock);
+        evictedNodes = nil;
+    }
+}
+
+- (void)updateCountLimit:(NSUInteger)countLimit {
+    NSUInteger shardCountLimit = countLimit > 0 ? MAX((countLimit + _shardCount - 1) / _shardCount, 1) : 0;
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        SD_LOCK(shard->_lock);
+        shard->_countLimit = shardCountLimit;
+        NSArray *evictedNodes = [self trimShard:shard];
+        SD_UNLOCK(shard->_lock);
+        evictedNodes = nil;
+    }
+}
+
+// Call with shard lock held. Return the evicted nodes, release them outside the lock, because dealloc of large image may be slow.
+- (nullable NSArray<SDLRUMemoryCacheNode *> *)trimShard:(SDLRUMemoryCacheShard *)shard {
+    NSMutableArray<SDLRUMemoryCacheNode *> *evictedNodes;
+    if (self.evictionPolicy == SDLRUMemoryCacheEvictionPolicyTinyLFU) {
+        evictedNodes = [self admitWindowOfShard:shard];
+    }
+    NSUInteger costLimit = shard->_costLimit;
+    NSUInteger countLimit = shard->_countLimit;
+    SDLRUMemoryCacheList *windowList = shard->_window;
+    SDLRUMemoryCacheList *probationList = shard->_probation;
+    SDLRUMemoryCacheList *protectedList = shard->_protected;
+    while ((costLimit > 0 && windowList->_totalCost + probationList->_totalCost + protectedList->_totalCost > costLimit) ||
+           (countLimit > 0 && windowList->_totalCount + probationList->_totalCount + protectedList->_totalCount > countLimit)) {
+        // Evict the probationary segment first, then protected and window
+        SDLRUMemoryCacheList *list = probationList->_tail ? probationList : (protectedList->_tail ? protectedList : windowList);
+        SDLRUMemoryCacheNode *node = list->_tail;
+        if (!node) {
+            break;
+        }
+        if (!evictedNodes) {
+            evictedNodes = [NSMutableArray array];
+        }
+        [evictedNodes addObject:node];
+        [list removeNode:node];
+        CFDictionaryRemoveValue(shard->_map, (__bridge const void *)node->_key);
+        shard->_evictionCount++;
+    }
+    return evictedNodes;
+}
+
+// Call with shard lock held. Move the window overflow into the main segments, the candidate is admitted only when it's used more frequently than the victim of main segments, so one-time accessed objects can not flush the frequently accessed ones.
+- (nullable NSMutableArray<SDLRUMemoryCacheNode *> *)admitWindowOfShard:(SDLRUMemoryCacheShard *)shard {
+    NSMutableArray<SDLRUMemoryCacheNode *> *evictedNodes;
+    NSUInteger costLimit = shard->_costLimit;
+    NSUInteger countLimit = shard->_countLimit;
+    NSUInteger windowCostLimit = costLimit * SDLRUMemoryCacheWindowRatio;
+    NSUInteger windowCountLimit = countLimit * SDLRUMemoryCacheWindowRatio;
+    SDLRUMemoryCacheList *windowList = shard->_window;
+    SDLRUMemoryCacheList *probationList = shard->_probation;
+    SDLRUMemoryCacheList *protectedList = shard->_protected;
+    // Always keep the newest object in window, so the just stored object is available
+    while (windowList->_totalCount > 1 &&
+           ((costLimit > 0 && windowList->_totalCost > windowCostLimit) ||
+            (countLimit > 0 && windowList->_totalCount > windowCountLimit))) {
+        SDLRUMemoryCacheNode *candidate = windowList->_tail;
+        [windowList removeNode:candidate];
+        candidate->_isWindow = NO;
+        BOOL isFull = (costLimit > 0 && windowList->_totalCost + probationList->_totalCost + protectedList->_totalCost + candidate->_cost > costLimit) ||
+                      (countLimit > 0 && windowList->_totalCount + probationList->_totalCount + protectedList->_totalCount + 1 > countLimit);
+        SDLRUMemoryCacheList *victimList = probationList->_tail ? probationList : protectedList;
+        SDLRUMemoryCacheNode *victim = victimList->_tail;
+        if (isFull && victim) {
+            if (!evictedNodes) {
+                evictedNodes = [NSMutableArray array];
+            }
+            if ([self frequencyForHash:candidate->_hash inShard:shard] > [self frequencyForHash:victim->_hash inShard:shard]) {
+                [evictedNodes addObject:victim];
+                [victimList removeNode:victim];
+                CFDictionaryRemoveValue(shard->_map, (__bridge const void *)victim->_key);
+                [probationList insertNodeAtHead:candidate];
+            } else {
+                // Reject the candidate
+                [evictedNodes addObject:candidate];
+                CFDictionaryRemoveValue(shard->_map, (__bridge const void *)candidate->_key);
+            }
+            shard->_evictionCount++;
+        } else {
+            [probationList insertNodeAtHead:candidate];
+        }
+    }
+    return evictedNodes;
+}
+
+// Call with shard lock held. Count-Min sketch of the access frequency, the counters are halved periodically, so the old popularity fades out.
+- (void)recordAccessForHash:(NSUInteger)hash inShard:(SDLRUMemoryCacheShard *)shard {
+    if (!shard->_sketch) {
+        // Size the sketch by the count limit, or a fixed size when only cost limit is used
+        NSUInteger capacity = shard->_countLimit > 0 ? shard->_countLimit * 4 : 1024;
+        NSUInteger width = 256;
+        while (width < capacity && width < 65536) {
+            width <<= 1;
+        }
+        shard->_sketch = calloc(width * SDLRUMemoryCacheSketchDepth, sizeof(uint8_t));
+        if (!shard->_sketch) {
+            return;
+        }
+        shard->_sketchMask = width - 1;
+    }
+    for (NSUInteger row = 0; row < SDLRUMemoryCacheSketchDepth; row++) {
+        uint8_t *counter = &shard->_sketch[SDLRUMemoryCacheSketchIndex(hash, row, shard->_sketchMask)];
+        if (*counter < SDLRUMemoryCacheSketchMaxFrequency) {
+            (*counter)++;
+        }
+    }
+    shard->_sketchAdditions++;
+    NSUInteger width = shard->_sketchMask + 1;
+    if (shard->_sketchAdditions >= width * 10) {
+        for (NSUInteger i = 0; i < width * SDLRUMemoryCacheSketchDepth; i++) {
+            shard->_sketch[i] >>= 1;
+        }
+        shard->_sketchAdditions /= 2;
+    }
+}
+
+// Call with shard lock held.
+- (NSUInteger)frequencyForHash:(NSUInteger)hash inShard:(SDLRUMemoryCacheShard *)shard {
+    if (!shard->_sketch) {
+        return 0;
+    }
+    uint8_t frequency = SDLRUMemoryCacheSketchMaxFrequency;
+    for (NSUInteger row = 0; row < SDLRUMemoryCacheSketchDepth; row++) {
+        frequency = MIN(frequency, shard->_sketch[SDLRUMemoryCacheSketchIndex(hash, row, shard->_sketchMask)]);
+    }
+    return frequency;
+}
+
+static inline NSUInteger SDLRUMemoryCacheSketchIndex(NSUInteger hash, NSUInteger row, NSUInteger mask) {
+    uint64_t h = (uint64_t)hash + (row + 1) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ULL;
+    h ^= h >> 32;
+    return row * (mask + 1) + (NSUInteger)(h & mask);
+}
+
+// Call with shard lock held. Demote the protected overflow into the probationary segment.
+- (void)balanceShard:(SDLRUMemoryCacheShard *)shard {
+    SDLRUMemoryCacheList *protectedList = shard->_protected;
+    NSUInteger protectedCostLimit = shard->_costLimit * SDLRUMemoryCacheProtectedRatio;
+    NSUInteger protectedCountLimit = shard->_countLimit * SDLRUMemoryCacheProtectedRatio;
+    while (protectedList->_totalCount > 1 &&
+           ((protectedCostLimit > 0 && protectedList->_totalCost > protectedCostLimit) ||
+            (protectedCountLimit > 0 && protectedList->_totalCount > protectedCountLimit))) {
+        SDLRUMemoryCacheNode *node = protectedList->_tail;
+        [protectedList removeNode:node];
+        node->_isProtected = NO;
+        [shard->_probation insertNodeAtHead:node];
+    }
+}
+
+#pragma mark - SDMemoryCache
+
+- (id)objectForKey:(id)key {
+    if (!key) {
+        return nil;
+    }
+    NSUInteger hash = [key hash];
+    SDLRUMemoryCacheShard *shard = [self shardForHash:hash];
+    SDLRUMemoryCacheEvictionPolicy evictionPolicy = self.evictionPolicy;
+    id object;
+    SD_LOCK(shard->_lock);
+    if (evictionPolicy == SDLRUMemoryCacheEvictionPolicyTinyLFU) {
+        // Record both hit and miss, the frequency of the missed object is used when it's stored
+        [self recordAccessForHash:hash inShard:shard];
+    }
+    SDLRUMemoryCacheNode *node = CFDictionaryGetValue(shard->_map, (__bridge const void *)key);
+    if (node) {
+        object = node->_value;
+        if (node->_isWindow) {
+            [shard->_window bringNodeToHead:node];
+        } else if (evictionPolicy != SDLRUMemoryCacheEvictionPolicyLRU && !node->_isProtected) {
+            // Promote into protected segment when accessed again
+            [shard->_probation removeNode:node];
+            node->_isProtected = YES;
+            [shard->_protected insertNodeAtHead:node];
+            [self balanceShard:shard];
+        } else if (node->_isProtected) {
+            [shard->_protected bringNodeToHead:node];
+        } else {
+            [shard->_probation bringNodeToHead:node];
+        }
+        shard->_hitCount++;
+    }
+    SD_UNLOCK(shard->_lock);
+    if (object) {
+        return object;
+    }
+#if SD_UIKIT
+    if (self.config.shouldUseWeakMemoryCache) {
+        // Check weak cache
+        SD_LOCK(shard->_lock);
+        object = [shard->_weakCache objectForKey:key];
+        SD_UNLOCK(shard->_lock);
+        if (object) {
+            // Sync cache
+            NSUInteger cost = 0;
+            if ([object isKindOfClass:[UIImage class]]) {
+                cost = [(UIImage *)object sd_memoryCost];
+            }
+            [self setObject:object forKey:key cost:cost];
+            SD_LOCK(shard->_lock);
+            shard->_hitCount++;
+            SD_UNLOCK(shard->_lock);
+            return object;
+        }
+    }
+#endif
+    SD_LOCK(shard->_lock);
+    shard->_missCount++;
+    SD_UNLOCK(shard->_lock);
+    return nil;
+}
+
+- (void)setObject:(id)object forKey:(id)key {
+    [self setObject:object forKey:key cost:0];
+}
+
+- (void)setObject:(id)object forKey:(id)key cost:(NSUInteger)cost {
+    [self setObject:object forKey:key cost:cost lowPriority:NO];
+}
+
+- (void)setObject:(id)object forKey:(id)key cost:(NSUInteger)cost lowPriority:(BOOL)lowPriority {
+    if (!key) {
+        return;
+    }
+    if (!object) {
+        [self removeObjectForKey:key];
+        return;
+    }
+    NSUInteger hash = [key hash];
+    SDLRUMemoryCacheShard *shard = [self shardForHash:hash];
+    SDLRUMemoryCacheEvictionPolicy evictionPolicy = self.evictionPolicy;
+    id oldValue;
+    NSArray *evictedNodes;
+    SD_LOCK(shard->_lock);
+    if (evictionPolicy == SDLRUMemoryCacheEvictionPolicyTinyLFU && !lowPriority) {
+        [self recordAccessForHash:hash inShard:shard];
+    }
+    SDLRUMemoryCacheNode *node = CFDictionaryGetValue(shard->_map, (__bridge const void *)key);
+    if (node) {
+        SDLRUMemoryCacheList *list = SDLRUMemoryCacheListOfNode(shard, node);
+        list->_totalCost = list->_totalCost - node->_cost + cost;
+        oldValue = node->_value;
+        node->_value = object;
+        node->_cost = cost;
+        if (!lowPriority) {
+            [list bringNodeToHead:node];
+        }
+    } else {
+        node = [SDLRUMemoryCacheNode new];
+        node->_key = key;
+        node->_value = object;
+        node->_cost = cost;
+        node->_hash = hash;
+        CFDictionarySetValue(shard->_map, (__bridge const void *)key, (__bridge const void *)node);
+        if (lowPriority) {
+            // Low priority object is evicted first, it only use the free space, until it's accessed again
+            [shard->_probation insertNodeAtTail:node];
+        } else if (evictionPolicy == SDLRUMemoryCacheEvictionPolicyTinyLFU) {
+            node->_isWindow = YES;
+            [shard->_window insertNodeAtHead:node];
+        } else {
+            [shard->_probation insertNodeAtHead:node];
+        }
+    }
+    evictedNodes = [self trimShard:shard];
+#if SD_UIKIT
+    if (self.config.shouldUseWeakMemoryCache) {
+        // Store weak cache
+        [shard->_weakCache setObject:object forKey:key];
+    }
+#endif
+    SD_UNLOCK(shard->_lock);
+    // Release the old value and evicted nodes outside the lock
+    oldValue = nil;
+    evictedNodes = nil;
+}
+
+- (void)removeObjectForKey:(id)key {
+    if (!key) {
+        return;
+    }
+    SDLRUMemoryCacheShard *shard = [self shardForHash:[key hash]];
+    SD_LOCK(shard->_lock);
+    SDLRUMemoryCacheNode *node = CFDictionaryGetValue(shard->_map, (__bridge const void *)key);
+    if (node) {
+        [SDLRUMemoryCacheListOfNode(shard, node) removeNode:node];
+        // Keep node alive until unlock
+        CFRetain((__bridge CFTypeRef)node);
+        CFDictionaryRemoveValue(shard->_map, (__bridge const void *)key);
+    }
+#if SD_UIKIT
+    if (self.config.shouldUseWeakMemoryCache) {
+        // Remove weak cache
+        [shard->_weakCache removeObjectForKey:key];
+    }
+#endif
+    SD_UNLOCK(shard->_lock);
+    if (node) {
+        CFRelease((__bridge CFTypeRef)node);
+    }
+}
+
+- (void)removeAllObjects {
+    [self removeAllObjectsIncludingWeakCache:YES];
+}
+
+- (void)removeAllObjectsIncludingWeakCache:(BOOL)includingWeakCache {
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        SD_LOCK(shard->_lock);
+        CFMutableDictionaryRef map = shard->_map;
+        shard->_map = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        [shard->_window removeAll];
+        [shard->_probation removeAll];
+        [shard->_protected removeAll];
+#if SD_UIKIT
+        if (includingWeakCache && self.config.shouldUseWeakMemoryCache) {
+            // Manually remove should also remove weak cache
+            [shard->_weakCache removeAllObjects];
+        }
+#endif
+        SD_UNLOCK(shard->_lock);
+        CFRelease(map);
+    }
+}
+
+#pragma mark - Memory Pressure
+
+- (void)memoryPressureCoordinator:(SDMemoryPressureCoordinator *)coordinator didReceiveMemoryPressure:(SDMemoryPressureLevel)level {
+    if (level == SDMemoryPressureLevelCritical) {
+        // Only remove cache, but keep weak cache
+        [self removeAllObjectsIncludingWeakCache:NO];
+    } else if (level == SDMemoryPressureLevelModerate) {
+        [self trimToRatio:coordinator.moderateTargetRatio];
+    }
+}
+
+// Evict the least recently used objects of each shard, until the cost and count are reduced to the ratio
+- (void)trimToRatio:(double)ratio {
+    ratio = MIN(MAX(ratio, 0), 1);
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        NSMutableArray<SDLRUMemoryCacheNode *> *evictedNodes = [NSMutableArray array];
+        SD_LOCK(shard->_lock);
+        SDLRUMemoryCacheList *windowList = shard->_window;
+        SDLRUMemoryCacheList *probationList = shard->_probation;
+        SDLRUMemoryCacheList *protectedList = shard->_protected;
+        NSUInteger targetCost = (windowList->_totalCost + probationList->_totalCost + protectedList->_totalCost) * ratio;
+        NSUInteger targetCount = (windowList->_totalCount + probationList->_totalCount + protectedList->_totalCount) * ratio;
+        while (windowList->_totalCost + probationList->_totalCost + protectedList->_totalCost > targetCost ||
+               windowList->_totalCount + probationList->_totalCount + protectedList->_totalCount > targetCount) {
+            // Same order as the limit eviction
+            SDLRUMemoryCacheList *list = probationList->_tail ? probationList : (protectedList->_tail ? protectedList : windowList);
+            SDLRUMemoryCacheNode *node = list->_tail;
+            if (!node) {
+                break;
+            }
+            [evictedNodes addObject:node];
+            [list removeNode:node];
+            CFDictionaryRemoveValue(shard->_map, (__bridge const void *)node->_key);
+        }
+        SD_UNLOCK(shard->_lock);
+        // Release the evicted nodes outside the lock
+        evictedNodes = nil;
+    }
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)totalCost {
+    NSUInteger totalCost = 0;
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        SD_LOCK(shard->_lock);
+        totalCost += shard->_window->_totalCost + shard->_probation->_totalCost + shard->_protected->_totalCost;
+        SD_UNLOCK(shard->_lock);
+    }
+    return totalCost;
+}
+
+- (NSUInteger)totalCount {
+    NSUInteger totalCount = 0;
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        SD_LOCK(shard->_lock);
+        totalCount += shard->_window->_totalCount + shard->_probation->_totalCount + shard->_protected->_totalCount;
+        SD_UNLOCK(shard->_lock);
+    }
+    return totalCount;
+}
+
+- (NSUInteger)hitCount {
+    NSUInteger hitCount = 0;
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        SD_LOCK(shard->_lock);
+        hitCount += shard->_hitCount;
+        SD_UNLOCK(shard->_lock);
+    }
+    return hitCount;
+}
+
+- (NSUInteger)missCount {
+    NSUInteger missCount = 0;
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        SD_LOCK(shard->_lock);
+        missCount += shard->_missCount;
+        SD_UNLOCK(shard->_lock);
+    }
+    return missCount;
+}
+
+- (NSUInteger)evictionCount {
+    NSUInteger evictionCount = 0;
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        SD_LOCK(shard->_lock);
+        evictionCount += shard->_evictionCount;
+        SD_UNLOCK(shard->_lock);
+    }
+    return evictionCount;
+}
+
+- (void)resetStatistics {
+    for (SDLRUMemoryCacheShard *shard in _shards) {
+        SD_LOCK(shard->_lock);
+        shard->_hitCount = 0;
+        shard->_missCount = 0;
+        shard->_evictionCount = 0;
+        SD_UNLOCK(shard->_lock);
+    }
+}
+
+#pragma mark - KVO
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
+    if (context == SDLRUMemoryCacheContext) {
+        if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxMemoryCost))]) {
+            [self updateCostLimit:self.config.maxMemoryCost];
+        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxMemoryCount))]) {
+            [self updateCountLimit:self.config.maxMemoryCount];
+        }
+    } else {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+    }
+}
+
+@end
@@ -66,6 +66,19 @@
  */
 - (void)removeAllObjects;
 
+@optional
+
+/**
+ Sets the value of the specified key in the cache, with the admission priority hint.
+ Low priority object (such as prefetched image) should not evict the frequently used objects. If not implemented, `setObject:forKey:cost:` is used instead.
+
+ @param object The object to store in the cache. If nil, it calls `removeObjectForKey`.
+ @param key    The key with which to associate the value. If nil, this method has no effect.
+ @param cost   The cost with which to associate the key-value pair.
+ @param lowPriority Whether the object is stored with low admission priority.
+ */
+- (void)setObject:(nullable id)object forKey:(nonnull id)key cost:(NSUInteger)cost lowPriority:(BOOL)lowPriority;
+
 @end
 
 /**
@@ -10,10 +10,11 @@
 #import "SDImageCacheConfig.h"
 #import "UIImage+MemoryCacheCost.h"
 #import "SDInternalMacros.h"
+#import "SDMemoryPressureCoordinator.h"
 
 static void * SDMemoryCacheContext = &SDMemoryCacheContext;
 
-@interface SDMemoryCache <KeyType, ObjectType> () {
+@interface SDMemoryCache <KeyType, ObjectType> () <SDMemoryPressureResponder> {
 #if SD_UIKIT
     SD_LOCK_DECLARE(_weakCacheLock); // a lock to keep the access to `weakCache` thread-safe
 #endif
@@ -30,9 +31,6 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
 - (void)dealloc {
     [_config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCost)) context:SDMemoryCacheContext];
     [_config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCount)) context:SDMemoryCacheContext];
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
     self.delegate = nil;
 }
 
@@ -66,17 +64,17 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
     self.weakCache = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory valueOptions:NSPointerFunctionsWeakMemory capacity:0];
     SD_LOCK_INIT(_weakCacheLock);
 
-    [[NSNotificationCenter defaultCenter] addObserver:self
-                                             selector:@selector(didReceiveMemoryWarning:)
-                                                 name:UIApplicationDidReceiveMemoryWarningNotification
-                                               object:nil];
+    [SDMemoryPressureCoordinator.sharedCoordinator registerResponder:self priority:SDMemoryPressurePriorityMemoryCache];
 #endif
 }
 
 // Current this seems no use on macOS (macOS use virtual memory and do not clear cache when memory warning). So we only override on iOS/tvOS platform.
 #if SD_UIKIT
-- (void)didReceiveMemoryWarning:(NSNotification *)notification {
-    // Only remove cache, but keep weak cache
+- (void)memoryPressureCoordinator:(SDMemoryPressureCoordinator *)coordinator didReceiveMemoryPressure:(SDMemoryPressureLevel)level {
+    if (level == SDMemoryPressureLevelNormal) {
+        return;
+    }
+    // `NSCache` can not evict by recency, remove all on both levels. Only remove cache, but keep weak cache, so the images on screen are still available
     [super removeAllObjects];
 }
 
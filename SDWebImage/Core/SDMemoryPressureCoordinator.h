@@ -0,0 +1,97 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+
+/// The memory pressure level
+typedef NS_ENUM(NSUInteger, SDMemoryPressureLevel) {
+    /**
+     * The memory pressure returns to normal.
+     */
+    SDMemoryPressureLevelNormal = 0,
+    /**
+     * The system is low on memory, such as the memory warning on iOS. Responders should release the part which is not used recently.
+     */
+    SDMemoryPressureLevelModerate,
+    /**
+     * The system is critically low on memory. Responders should release everything which can be recreated.
+     */
+    SDMemoryPressureLevelCritical
+};
+
+/// The priority of memory pressure responder, the lower one responds first.
+typedef NSInteger SDMemoryPressurePriority;
+
+/// The priority for the coder caches (such as `CGImageSource` caches), which are cheap to recreate. Responds first.
+FOUNDATION_EXPORT const SDMemoryPressurePriority SDMemoryPressurePriorityCoder;
+/// The priority for the animated image frame buffers.
+FOUNDATION_EXPORT const SDMemoryPressurePriority SDMemoryPressurePriorityAnimatedFrame;
+/// The priority for the memory caches of static images. Responds last, to avoid the re-decoding.
+FOUNDATION_EXPORT const SDMemoryPressurePriority SDMemoryPressurePriorityMemoryCache;
+
+@class SDMemoryPressureCoordinator;
+
+/**
+ The protocol for the object which release memory under memory pressure.
+ */
+@protocol SDMemoryPressureResponder <NSObject>
+
+/**
+ Release the memory in proportion to the pressure level. This is called on the thread which dispatch the pressure (main queue for system events).
+
+ @param coordinator The coordinator which dispatch the pressure.
+ @param level The current pressure level.
+ */
+- (void)memoryPressureCoordinator:(nonnull SDMemoryPressureCoordinator *)coordinator didReceiveMemoryPressure:(SDMemoryPressureLevel)level;
+
+@end
+
+/**
+ A central coordinator for memory pressure. It listens to the system memory warning and memory pressure events (the warning of both for the same signal is dispatched once), and dispatches them to the registered responders in priority order, so the animated frames and coder caches are dropped before the static images, and the memory cache is trimmed instead of cleared on moderate pressure.
+ */
+@interface SDMemoryPressureCoordinator : NSObject
+
+/**
+ Returns the global shared coordinator instance, which listens to the system events.
+ */
+@property (nonatomic, class, readonly, nonnull) SDMemoryPressureCoordinator *sharedCoordinator;
+
+/**
+ The last dispatched pressure level.
+ */
+@property (nonatomic, assign, readonly) SDMemoryPressureLevel currentLevel;
+
+/**
+ The fraction of memory cache to keep on moderate pressure, the least recently used objects are evicted first. On critical pressure the memory cache is cleared.
+ Defaults to 0.5.
+ */
+@property (nonatomic, assign) double moderateTargetRatio;
+
+/**
+ Register a responder with priority. The responder is weakly referenced, so it does not need to unregister before dealloc.
+
+ @param responder The responder
+ @param priority The priority, the lower one responds first
+ */
+- (void)registerResponder:(nonnull id<SDMemoryPressureResponder>)responder priority:(SDMemoryPressurePriority)priority;
+
+/**
+ Unregister a responder.
+
+ @param responder The responder
+ */
+- (void)unregisterResponder:(nonnull id<SDMemoryPressureResponder>)responder;
+
+/**
+ Dispatch the pressure level to all the responders synchronously, in priority order. The system events call this automatically, you can also call this to simulate the pressure.
+
+ @param level The pressure level
+ */
+- (void)dispatchMemoryPressure:(SDMemoryPressureLevel)level;
+
+@end
@@ -0,0 +1,175 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDMemoryPressureCoordinator.h"
+#import "SDInternalMacros.h"
+
+const SDMemoryPressurePriority SDMemoryPressurePriorityCoder = 100;
+const SDMemoryPressurePriority SDMemoryPressurePriorityAnimatedFrame = 200;
+const SDMemoryPressurePriority SDMemoryPressurePriorityMemoryCache = 300;
+
+// The memory warning and the memory pressure event for the same system signal arrive close to each other, in any order
+static const CFTimeInterval SDMemoryPressureCoalesceInterval = 1;
+
+@interface SDMemoryPressureResponderEntry : NSObject
+
+@property (nonatomic, weak, nullable) id<SDMemoryPressureResponder> responder;
+@property (nonatomic, assign) SDMemoryPressurePriority priority;
+
+@end
+
+@implementation SDMemoryPressureResponderEntry
+@end
+
+@interface SDMemoryPressureCoordinator () {
+    SD_LOCK_DECLARE(_entriesLock);
+}
+
+@property (nonatomic, strong, nonnull) NSMutableArray<SDMemoryPressureResponderEntry *> *entries;
+@property (nonatomic, assign, readwrite) SDMemoryPressureLevel currentLevel;
+@property (nonatomic, strong, nullable) dispatch_source_t memoryPressureSource;
+@property (nonatomic, assign) CFAbsoluteTime lastEventWarningTime; // Only accessed on main queue
+@property (nonatomic, assign) CFAbsoluteTime lastNotificationWarningTime; // Only accessed on main queue
+
+@end
+
+@implementation SDMemoryPressureCoordinator
+
++ (SDMemoryPressureCoordinator *)sharedCoordinator {
+    static dispatch_once_t onceToken;
+    static SDMemoryPressureCoordinator *coordinator;
+    dispatch_once(&onceToken, ^{
+        coordinator = [[SDMemoryPressureCoordinator alloc] init];
+        [coordinator startMonitoring];
+    });
+    return coordinator;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [NSMutableArray array];
+        _moderateTargetRatio = 0.5;
+        SD_LOCK_INIT(_entriesLock);
+    }
+    return self;
+}
+
+- (void)dealloc {
+#if SD_UIKIT
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+#endif
+    if (_memoryPressureSource) {
+        dispatch_source_cancel(_memoryPressureSource);
+    }
+}
+
+- (void)startMonitoring {
+#if SD_UIKIT
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+#endif
+    dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0, DISPATCH_MEMORYPRESSURE_NORMAL | DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL, dispatch_get_main_queue());
+    if (!source) {
+        return;
+    }
+    @weakify(self);
+    dispatch_source_set_event_handler(source, ^{
+        @strongify(self);
+        if (!self) {
+            return;
+        }
+        unsigned long flags = dispatch_source_get_data(self.memoryPressureSource);
+        if (flags & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+            [self dispatchMemoryPressure:SDMemoryPressureLevelCritical];
+        } else if (flags & DISPATCH_MEMORYPRESSURE_WARN) {
+            [self dispatchWarningFromEvent:YES];
+        } else {
+            [self dispatchMemoryPressure:SDMemoryPressureLevelNormal];
+        }
+    });
+    dispatch_resume(source);
+    self.memoryPressureSource = source;
+}
+
+#if SD_UIKIT
+- (void)didReceiveMemoryWarning:(NSNotification *)notification {
+    [self dispatchWarningFromEvent:NO];
+}
+#endif
+
+// Dispatch the moderate pressure once for the memory warning and the memory pressure event of same signal, so the cache is not trimmed twice. The repeated ones from the same source are still dispatched
+- (void)dispatchWarningFromEvent:(BOOL)fromEvent {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    CFAbsoluteTime otherSourceTime;
+    if (fromEvent) {
+        self.lastEventWarningTime = now;
+        otherSourceTime = self.lastNotificationWarningTime;
+    } else {
+        self.lastNotificationWarningTime = now;
+        otherSourceTime = self.lastEventWarningTime;
+    }
+    if (otherSourceTime > 0 && now - otherSourceTime < SDMemoryPressureCoalesceInterval) {
+        return;
+    }
+    [self dispatchMemoryPressure:SDMemoryPressureLevelModerate];
+}
+
+#pragma mark - Responders
+
+- (void)registerResponder:(id<SDMemoryPressureResponder>)responder priority:(SDMemoryPressurePriority)priority {
+    if (!responder) {
+        return;
+    }
+    SDMemoryPressureResponderEntry *entry = [SDMemoryPressureResponderEntry new];
+    entry.responder = responder;
+    entry.priority = priority;
+    SD_LOCK(_entriesLock);
+    // Drop the deallocated responders, and keep the entries sorted by priority (stable for the same priority)
+    NSMutableArray<SDMemoryPressureResponderEntry *> *entries = self.entries;
+    NSUInteger index = 0;
+    for (NSUInteger i = 0; i < entries.count; i++) {
+        SDMemoryPressureResponderEntry *existing = entries[i];
+        if (!existing.responder || existing.responder == responder) {
+            continue;
+        }
+        entries[index++] = existing;
+    }
+    [entries removeObjectsInRange:NSMakeRange(index, entries.count - index)];
+    NSUInteger insertIndex = entries.count;
+    while (insertIndex > 0 && entries[insertIndex - 1].priority > priority) {
+        insertIndex--;
+    }
+    [entries insertObject:entry atIndex:insertIndex];
+    SD_UNLOCK(_entriesLock);
+}
+
+- (void)unregisterResponder:(id<SDMemoryPressureResponder>)responder {
+    if (!responder) {
+        return;
+    }
+    SD_LOCK(_entriesLock);
+    NSIndexSet *indexes = [self.entries indexesOfObjectsPassingTest:^BOOL(SDMemoryPressureResponderEntry * _Nonnull entry, NSUInteger idx, BOOL * _Nonnull stop) {
+        return !entry.responder || entry.responder == responder;
+    }];
+    [self.entries removeObjectsAtIndexes:indexes];
+    SD_UNLOCK(_entriesLock);
+}
+
+- (void)dispatchMemoryPressure:(SDMemoryPressureLevel)level {
+    self.currentLevel = level;
+    SD_LOCK(_entriesLock);
+    NSArray<SDMemoryPressureResponderEntry *> *entries = [self.entries copy];
+    SD_UNLOCK(_entriesLock);
+    // Call outside the lock, the responder may register or unregister
+    for (SDMemoryPressureResponderEntry *entry in entries) {
+        id<SDMemoryPressureResponder> responder = entry.responder;
+        [responder memoryPressureCoordinator:self didReceiveMemoryPressure:level];
+    }
+}
+
+@end
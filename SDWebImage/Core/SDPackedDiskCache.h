@@ -0,0 +1,55 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+#import "SDDiskCache.h"
+
+/**
+ A disk cache which appends small data into large segment files, instead of creating one file for each entry like `SDDiskCache`.
+ This reduce the file system overhead (block size round-up, inode, path hash, open/close) for small images like avatars and thumbnails. Reading use a memory-mapped view of the segment file without copying.
+ The removed or overwritten data is compacted in the background, when the live data ratio of a segment file is lower than `compactionRatio`.
+ Data larger than `maxPackedDataSize` is stored in the `files` sub-directory using the built-in `SDDiskCache`.
+
+ To use this class, set `SDImageCacheConfig.diskCacheClass` to `SDPackedDiskCache.class`.
+ @note The expiration date of packed data is always the date it's written, `diskCacheExpireType` only works for the data stored in the `files` sub-directory.
+ @note The `cachePathForKey:` return nil for packed data, because it does not have a standalone file.
+ */
+@interface SDPackedDiskCache : NSObject <SDDiskCache>
+
+/**
+ Cache Config object - storing all kind of settings.
+ */
+@property (nonatomic, strong, readonly, nonnull) SDImageCacheConfig *config;
+
+/**
+ The maximum data length (in bytes) to be packed into the segment files. Larger data is stored as standalone file.
+ Defaults to 32 KB.
+ */
+@property (nonatomic, assign) NSUInteger maxPackedDataSize;
+
+/**
+ The maximum size (in bytes) of one segment file. When the current segment file is full, a new one is created.
+ Defaults to 4 MB.
+ */
+@property (nonatomic, assign) NSUInteger maxSegmentSize;
+
+/**
+ When the live data ratio of a full segment file is lower than this value, the segment file will be compacted in the background.
+ Defaults to 0.5.
+ */
+@property (nonatomic, assign) double compactionRatio;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+/**
+ Synchronously compact all the full segment files whose live data ratio is lower than `compactionRatio`.
+ This is called automatically during `removeExpiredData`, you don't need to call this in most cases.
+ */
+- (void)compact;
+
+@end
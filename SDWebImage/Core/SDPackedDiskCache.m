@@ -0,0 +1,697 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDPackedDiskCache.h"
+#import "SDImageCacheConfig.h"
+#import "SDInternalMacros.h"
+#import <fcntl.h>
+#import <unistd.h>
+#import <sys/uio.h>
+
+static NSString * const SDPackedDiskCacheSegmentsDirectoryName = @"segments";
+static NSString * const SDPackedDiskCacheFilesDirectoryName = @"files";
+static NSString * const SDPackedDiskCacheSegmentExtension = @"segment";
+static NSString * const SDPackedDiskCacheCompactionExtension = @"compact";
+
+static const uint32_t SDPackedRecordMagic = 0x4B504453; // 'SDPK'
+
+typedef NS_ENUM(uint8_t, SDPackedRecordType) {
+    SDPackedRecordTypeData = 0,
+    SDPackedRecordTypeExtendedData = 1,
+    SDPackedRecordTypeTombstone = 2,
+};
+
+// Each record is the header, followed by the UTF-8 key bytes and the payload bytes
+typedef struct SDPackedRecordHeader {
+    uint32_t magic;
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t keyLength;
+    uint32_t dataLength;
+    double timestamp;
+} SDPackedRecordHeader;
+
+typedef struct SDPackedRecordLocation {
+    NSUInteger segment;
+    NSUInteger offset; // offset of record header
+    NSUInteger length; // length of whole record
+    NSUInteger dataLength; // length of payload, the payload is at the end of record
+} SDPackedRecordLocation;
+
+static inline NSUInteger SDPackedRecordDataOffset(SDPackedRecordLocation location) {
+    return location.offset + location.length - location.dataLength;
+}
+
+@interface SDPackedDiskCacheEntry : NSObject
+
+@property (nonatomic, assign) SDPackedRecordLocation dataLocation;
+@property (nonatomic, assign) SDPackedRecordLocation extendedDataLocation; // length 0 means no extended data
+@property (nonatomic, assign) NSTimeInterval timestamp;
+
+@end
+
+@implementation SDPackedDiskCacheEntry
+@end
+
+@interface SDPackedDiskCacheSegment : NSObject
+
+@property (nonatomic, assign) NSUInteger identifier;
+@property (nonatomic, copy, nonnull) NSString *path;
+@property (nonatomic, assign) NSUInteger fileLength;
+@property (nonatomic, assign) NSUInteger liveLength;
+@property (nonatomic, strong, nullable) NSData *mappedData;
+@property (nonatomic, assign, getter=isCompacting) BOOL compacting;
+
+@end
+
+@implementation SDPackedDiskCacheSegment
+@end
+
+@interface SDPackedDiskCache () {
+    SD_LOCK_DECLARE(_lock);
+    int _activeFileDescriptor;
+}
+
+@property (nonatomic, copy) NSString *diskCachePath;
+@property (nonatomic, copy) NSString *segmentsPath;
+@property (nonatomic, strong, nonnull) NSFileManager *fileManager;
+@property (nonatomic, strong, nonnull) SDDiskCache *fileCache;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDPackedDiskCacheEntry *> *entries;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSNumber *, SDPackedDiskCacheSegment *> *segments;
+@property (nonatomic, strong, nullable) SDPackedDiskCacheSegment *activeSegment;
+@property (nonatomic, strong, nonnull) dispatch_queue_t compactionQueue;
+@property (nonatomic, assign, getter=isLoaded) BOOL loaded;
+@property (nonatomic, assign, getter=isCompactionScheduled) BOOL compactionScheduled;
+
+@end
+
+@implementation SDPackedDiskCache
+
+- (instancetype)init {
+    NSAssert(NO, @"Use `initWithCachePath:` with the disk cache path");
+    return nil;
+}
+
+- (void)dealloc {
+    if (_activeFileDescriptor >= 0) {
+        close(_activeFileDescriptor);
+    }
+}
+
+#pragma mark - SDDiskCache Protocol
+- (instancetype)initWithCachePath:(NSString *)cachePath config:(SDImageCacheConfig *)config {
+    if (self = [super init]) {
+        _diskCachePath = [cachePath copy];
+        _config = config;
+        _maxPackedDataSize = 32 * 1024;
+        _maxSegmentSize = 4 * 1024 * 1024;
+        _compactionRatio = 0.5;
+        [self commonInit];
+    }
+    return self;
+}
+
+- (void)commonInit {
+    if (self.config.fileManager) {
+        self.fileManager = self.config.fileManager;
+    } else {
+        self.fileManager = [NSFileManager new];
+    }
+    SD_LOCK_INIT(_lock);
+    _activeFileDescriptor = -1;
+    self.segmentsPath = [self.diskCachePath stringByAppendingPathComponent:SDPackedDiskCacheSegmentsDirectoryName];
+    self.fileCache = [[SDDiskCache alloc] initWithCachePath:[self.diskCachePath stringByAppendingPathComponent:SDPackedDiskCacheFilesDirectoryName] config:self.config];
+    self.entries = [NSMutableDictionary dictionary];
+    self.segments = [NSMutableDictionary dictionary];
+    self.compactionQueue = dispatch_queue_create("com.hackemist.SDPackedDiskCache.compaction", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_BACKGROUND, 0));
+}
+
+- (BOOL)containsDataForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    BOOL exists = self.entries[key] != nil;
+    SD_UNLOCK(_lock);
+    if (exists) {
+        return YES;
+    }
+    return [self.fileCache containsDataForKey:key];
+}
+
+- (NSData *)dataForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    SDPackedDiskCacheEntry *entry = self.entries[key];
+    NSData *data;
+    if (entry) {
+        data = [self dataAtLocation:entry.dataLocation];
+    }
+    SD_UNLOCK(_lock);
+    if (data) {
+        return data;
+    }
+    return [self.fileCache dataForKey:key];
+}
+
+- (void)setData:(NSData *)data forKey:(NSString *)key {
+    NSParameterAssert(data);
+    NSParameterAssert(key);
+    if (data.length > self.maxPackedDataSize) {
+        [self.fileCache setData:data forKey:key];
+        // The large data override the packed one
+        SD_LOCK(_lock);
+        [self loadIfNeeded];
+        if (self.entries[key]) {
+            [self appendRecordWithType:SDPackedRecordTypeTombstone key:key data:nil timestamp:[NSDate date].timeIntervalSince1970];
+        }
+        SD_UNLOCK(_lock);
+        return;
+    }
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    [self appendRecordWithType:SDPackedRecordTypeData key:key data:data timestamp:[NSDate date].timeIntervalSince1970];
+    SD_UNLOCK(_lock);
+}
+
+- (NSData *)extendedDataForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    SDPackedDiskCacheEntry *entry = self.entries[key];
+    NSData *extendedData;
+    if (entry && entry.extendedDataLocation.length > 0) {
+        extendedData = [self dataAtLocation:entry.extendedDataLocation];
+    }
+    SD_UNLOCK(_lock);
+    if (entry) {
+        return extendedData;
+    }
+    return [self.fileCache extendedDataForKey:key];
+}
+
+- (void)setExtendedData:(NSData *)extendedData forKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    SDPackedDiskCacheEntry *entry = self.entries[key];
+    if (entry) {
+        // Empty extended data record means remove
+        [self appendRecordWithType:SDPackedRecordTypeExtendedData key:key data:extendedData timestamp:entry.timestamp];
+    }
+    SD_UNLOCK(_lock);
+    if (!entry) {
+        [self.fileCache setExtendedData:extendedData forKey:key];
+    }
+}
+
+- (void)removeDataForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    if (self.entries[key]) {
+        [self appendRecordWithType:SDPackedRecordTypeTombstone key:key data:nil timestamp:[NSDate date].timeIntervalSince1970];
+    }
+    SD_UNLOCK(_lock);
+    [self.fileCache removeDataForKey:key];
+}
+
+- (void)removeAllData {
+    SD_LOCK(_lock);
+    [self closeActiveSegment];
+    [self.entries removeAllObjects];
+    [self.segments removeAllObjects];
+    self.loaded = NO;
+    [self.fileManager removeItemAtPath:self.diskCachePath error:nil];
+    [self.fileManager createDirectoryAtPath:self.diskCachePath
+                withIntermediateDirectories:YES
+                                 attributes:nil
+                                      error:NULL];
+    SD_UNLOCK(_lock);
+}
+
+- (void)removeExpiredData {
+    [self.fileCache removeExpiredData];
+
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    NSTimeInterval now = [NSDate date].timeIntervalSince1970;
+
+    // Remove packed data that are older than the expiration date
+    if (self.config.maxDiskAge >= 0) {
+        NSTimeInterval expirationDate = now - self.config.maxDiskAge;
+        NSArray<NSString *> *keys = [self.entries keysOfEntriesPassingTest:^BOOL(NSString *key, SDPackedDiskCacheEntry *entry, BOOL *stop) {
+            return entry.timestamp <= expirationDate;
+        }].allObjects;
+        for (NSString *key in keys) {
+            [self appendRecordWithType:SDPackedRecordTypeTombstone key:key data:nil timestamp:now];
+        }
+    }
+
+    // If our remaining disk cache exceeds a configured maximum size, delete the oldest packed data first.
+    NSUInteger maxDiskSize = self.config.maxDiskSize;
+    if (maxDiskSize > 0) {
+        NSUInteger currentCacheSize = [self.fileCache totalSize];
+        for (SDPackedDiskCacheEntry *entry in self.entries.allValues) {
+            currentCacheSize += entry.dataLocation.dataLength;
+        }
+        if (currentCacheSize > maxDiskSize) {
+            // Target half of our maximum cache size for this cleanup pass.
+            const NSUInteger desiredCacheSize = maxDiskSize / 2;
+            NSArray<NSString *> *sortedKeys = [self.entries keysSortedByValueUsingComparator:^NSComparisonResult(SDPackedDiskCacheEntry *obj1, SDPackedDiskCacheEntry *obj2) {
+                return [@(obj1.timestamp) compare:@(obj2.timestamp)];
+            }];
+            for (NSString *key in sortedKeys) {
+                currentCacheSize -= self.entries[key].dataLocation.dataLength;
+                [self appendRecordWithType:SDPackedRecordTypeTombstone key:key data:nil timestamp:now];
+                if (currentCacheSize < desiredCacheSize) {
+                    break;
+                }
+            }
+        }
+    }
+
+    SD_UNLOCK(_lock);
+    [self compactSegments];
+}
+
+- (nullable NSString *)cachePathForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    BOOL packed = self.entries[key] != nil;
+    SD_UNLOCK(_lock);
+    if (packed) {
+        return nil;
+    }
+    return [self.fileCache cachePathForKey:key];
+}
+
+- (NSUInteger)totalCount {
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    NSUInteger count = self.entries.count;
+    SD_UNLOCK(_lock);
+    return count + [self.fileCache totalCount];
+}
+
+- (NSUInteger)totalSize {
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    NSUInteger size = 0;
+    for (SDPackedDiskCacheSegment *segment in self.segments.allValues) {
+        size += segment.fileLength;
+    }
+    SD_UNLOCK(_lock);
+    return size + [self.fileCache totalSize];
+}
+
+#pragma mark - Compaction
+
+- (void)compact {
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    SD_UNLOCK(_lock);
+    [self compactSegments];
+}
+
+- (void)scheduleCompactionIfNeeded:(nonnull SDPackedDiskCacheSegment *)segment {
+    if (self.isCompactionScheduled || segment == self.activeSegment || ![self shouldCompactSegment:segment]) {
+        return;
+    }
+    self.compactionScheduled = YES;
+    dispatch_async(self.compactionQueue, ^{
+        SD_LOCK(self->_lock);
+        self.compactionScheduled = NO;
+        BOOL loaded = self.isLoaded;
+        SD_UNLOCK(self->_lock);
+        if (loaded) {
+            [self compactSegments];
+        }
+    });
+}
+
+- (BOOL)shouldCompactSegment:(nonnull SDPackedDiskCacheSegment *)segment {
+    if (segment.fileLength == 0) {
+        return YES;
+    }
+    return (double)segment.liveLength / (double)segment.fileLength < self.compactionRatio;
+}
+
+// Call without lock
+- (void)compactSegments {
+    SD_LOCK(_lock);
+    NSArray<NSNumber *> *identifiers = [self.segments.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    SD_UNLOCK(_lock);
+    for (NSNumber *identifier in identifiers) {
+        if (![self compactSegmentWithIdentifier:identifier.unsignedIntegerValue]) {
+            // Stop when write failed, such as disk full
+            break;
+        }
+    }
+}
+
+// Call without lock. Rewrite the segment file in place with only the live records, so the replay order is kept.
+// The sealed segment is never appended, so the live records are copied without lock, the lock is only held to collect them and to swap the file and entry locations, which does not block reading for the copying.
+- (BOOL)compactSegmentWithIdentifier:(NSUInteger)identifier {
+    SD_LOCK(_lock);
+    SDPackedDiskCacheSegment *segment = self.segments[@(identifier)];
+    if (!segment || segment == self.activeSegment || segment.isCompacting || ![self shouldCompactSegment:segment]) {
+        SD_UNLOCK(_lock);
+        return YES;
+    }
+    NSData *mappedData = [self mappedDataForSegment:segment length:segment.fileLength];
+    if (!mappedData && segment.fileLength > 0) {
+        SD_UNLOCK(_lock);
+        return NO;
+    }
+    BOOL isOldest = [@(identifier) isEqualToNumber:[self.segments.allKeys valueForKeyPath:@"@min.self"]];
+    NSMutableArray<NSString *> *liveKeys = [NSMutableArray array];
+    NSMutableData *liveLocations = [NSMutableData data];
+    [self enumerateRecordsInData:mappedData segment:identifier usingBlock:^(SDPackedRecordHeader header, NSString *key, SDPackedRecordLocation location, BOOL *stop) {
+        SDPackedDiskCacheEntry *entry = self.entries[key];
+        BOOL isLive = NO;
+        switch (header.type) {
+            case SDPackedRecordTypeData:
+                isLive = entry && entry.dataLocation.segment == identifier && entry.dataLocation.offset == location.offset;
+                break;
+            case SDPackedRecordTypeExtendedData:
+                isLive = entry && entry.extendedDataLocation.length > 0 && entry.extendedDataLocation.segment == identifier && entry.extendedDataLocation.offset == location.offset;
+                break;
+            case SDPackedRecordTypeTombstone:
+                // Keep the tombstone until there is no older segment which may contains the removed data
+                isLive = !entry && !isOldest;
+                break;
+            default:
+                break;
+        }
+        if (isLive) {
+            [liveKeys addObject:key];
+            [liveLocations appendBytes:&location length:sizeof(location)];
+        }
+    }];
+    segment.compacting = YES;
+    SD_UNLOCK(_lock);
+    
+    // Copy the live records into the compaction file without lock. The records killed meanwhile are copied as well, they are dropped by next compaction
+    const SDPackedRecordLocation *locations = liveLocations.bytes;
+    NSUInteger count = liveKeys.count;
+    NSString *compactionPath = [segment.path stringByAppendingPathExtension:SDPackedDiskCacheCompactionExtension];
+    BOOL success = YES;
+    if (count > 0) {
+        int fd = open(compactionPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        success = fd >= 0;
+        for (NSUInteger i = 0; success && i < count; i++) {
+            success = write(fd, (const uint8_t *)mappedData.bytes + locations[i].offset, locations[i].length) == (ssize_t)locations[i].length;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    
+    BOOL replaced = NO;
+    SD_LOCK(_lock);
+    segment.compacting = NO;
+    if (self.segments[@(identifier)] != segment) {
+        // Removed by `removeAllData` during copying
+        success = YES;
+    } else if (success && count == 0) {
+        [self.segments removeObjectForKey:@(identifier)];
+        [self.fileManager removeItemAtPath:segment.path error:nil];
+    } else if (success && rename(compactionPath.fileSystemRepresentation, segment.path.fileSystemRepresentation) == 0) {
+        replaced = YES;
+        // Move the entries which still point to the copied records
+        NSUInteger offset = 0;
+        NSUInteger liveLength = 0;
+        for (NSUInteger i = 0; i < count; i++) {
+            SDPackedRecordLocation location = locations[i];
+            SDPackedRecordLocation newLocation = {identifier, offset, location.length, location.dataLength};
+            SDPackedDiskCacheEntry *entry = self.entries[liveKeys[i]];
+            if (entry.dataLocation.segment == identifier && entry.dataLocation.offset == location.offset) {
+                entry.dataLocation = newLocation;
+                liveLength += location.length;
+            } else if (entry.extendedDataLocation.length > 0 && entry.extendedDataLocation.segment == identifier && entry.extendedDataLocation.offset == location.offset) {
+                entry.extendedDataLocation = newLocation;
+                liveLength += location.length;
+            }
+            offset += location.length;
+        }
+        segment.fileLength = offset;
+        segment.liveLength = liveLength;
+        // The returned data still retain the old mapping, which is valid after the file replaced
+        segment.mappedData = nil;
+    } else {
+        success = NO;
+    }
+    SD_UNLOCK(_lock);
+    if (!replaced && count > 0) {
+        [self.fileManager removeItemAtPath:compactionPath error:nil];
+    }
+    return success;
+}
+
+#pragma mark - Segments
+
+// Call with lock held
+- (void)loadIfNeeded {
+    if (self.isLoaded) {
+        return;
+    }
+    self.loaded = YES;
+    if (![self.fileManager fileExistsAtPath:self.segmentsPath]) {
+        [self.fileManager createDirectoryAtPath:self.segmentsPath withIntermediateDirectories:YES attributes:nil error:NULL];
+        // disable iCloud backup for all segments
+        if (self.config.shouldDisableiCloud) {
+            [[NSURL fileURLWithPath:self.segmentsPath isDirectory:YES] setResourceValue:@YES forKey:NSURLIsExcludedFromBackupKey error:nil];
+        }
+    }
+    NSMutableArray<NSNumber *> *identifiers = [NSMutableArray array];
+    for (NSString *fileName in [self.fileManager contentsOfDirectoryAtPath:self.segmentsPath error:nil]) {
+        if ([fileName.pathExtension isEqualToString:SDPackedDiskCacheCompactionExtension]) {
+            // The compaction is interrupted by unexpected termination, the segment file is untouched
+            [self.fileManager removeItemAtPath:[self.segmentsPath stringByAppendingPathComponent:fileName] error:nil];
+            continue;
+        }
+        if (![fileName.pathExtension isEqualToString:SDPackedDiskCacheSegmentExtension]) {
+            continue;
+        }
+        NSInteger identifier = fileName.stringByDeletingPathExtension.integerValue;
+        if (identifier > 0) {
+            [identifiers addObject:@(identifier)];
+        }
+    }
+    [identifiers sortUsingSelector:@selector(compare:)];
+
+    // Replay all records from the oldest segment, the later record override the former one
+    for (NSNumber *identifier in identifiers) {
+        SDPackedDiskCacheSegment *segment = [self segmentWithIdentifier:identifier.unsignedIntegerValue];
+        NSData *mappedData = [NSData dataWithContentsOfFile:segment.path options:NSDataReadingMappedAlways error:nil];
+        NSUInteger validLength = [self enumerateRecordsInData:mappedData segment:segment.identifier usingBlock:^(SDPackedRecordHeader header, NSString *key, SDPackedRecordLocation location, BOOL *stop) {
+            [self applyRecordWithType:header.type key:key location:location timestamp:header.timestamp];
+        }];
+        segment.fileLength = validLength;
+        if (validLength < mappedData.length) {
+            // Partial record caused by unexpected termination
+            truncate(segment.path.fileSystemRepresentation, validLength);
+        } else {
+            segment.mappedData = mappedData;
+        }
+    }
+
+    NSUInteger activeIdentifier = identifiers.count > 0 ? identifiers.lastObject.unsignedIntegerValue : 1;
+    [self openActiveSegmentWithIdentifier:activeIdentifier];
+}
+
+- (nonnull SDPackedDiskCacheSegment *)segmentWithIdentifier:(NSUInteger)identifier {
+    SDPackedDiskCacheSegment *segment = self.segments[@(identifier)];
+    if (!segment) {
+        segment = [SDPackedDiskCacheSegment new];
+        segment.identifier = identifier;
+        NSString *fileName = [NSString stringWithFormat:@"%08lu.%@", (unsigned long)identifier, SDPackedDiskCacheSegmentExtension];
+        segment.path = [self.segmentsPath stringByAppendingPathComponent:fileName];
+        self.segments[@(identifier)] = segment;
+    }
+    return segment;
+}
+
+- (BOOL)openActiveSegmentWithIdentifier:(NSUInteger)identifier {
+    [self closeActiveSegment];
+    SDPackedDiskCacheSegment *segment = [self segmentWithIdentifier:identifier];
+    int fd = open(segment.path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        return NO;
+    }
+    _activeFileDescriptor = fd;
+    self.activeSegment = segment;
+    return YES;
+}
+
+- (void)closeActiveSegment {
+    if (_activeFileDescriptor >= 0) {
+        close(_activeFileDescriptor);
+        _activeFileDescriptor = -1;
+    }
+    self.activeSegment = nil;
+}
+
+- (nullable NSData *)mappedDataForSegment:(nonnull SDPackedDiskCacheSegment *)segment length:(NSUInteger)length {
+    NSData *mappedData = segment.mappedData;
+    if (!mappedData || mappedData.length < length) {
+        // The active segment grows after mapped, map again
+        mappedData = [NSData dataWithContentsOfFile:segment.path options:NSDataReadingMappedAlways error:nil];
+        segment.mappedData = mappedData;
+    }
+    if (mappedData.length < length) {
+        return nil;
+    }
+    return mappedData;
+}
+
+- (nullable NSData *)dataAtLocation:(SDPackedRecordLocation)location {
+    SDPackedDiskCacheSegment *segment = self.segments[@(location.segment)];
+    if (!segment) {
+        return nil;
+    }
+    NSData *mappedData = [self mappedDataForSegment:segment length:location.offset + location.length];
+    if (!mappedData) {
+        return nil;
+    }
+    // Return the view of mapped segment without copy, the mapping is alive until the data released
+    void *bytes = (void *)((const uint8_t *)mappedData.bytes + SDPackedRecordDataOffset(location));
+    return [[NSData alloc] initWithBytesNoCopy:bytes length:location.dataLength deallocator:^(void * _Nonnull bytes, NSUInteger length) {
+        [mappedData self];
+    }];
+}
+
+#pragma mark - Records
+
+// Return the length of valid records
+- (NSUInteger)enumerateRecordsInData:(nullable NSData *)data segment:(NSUInteger)identifier usingBlock:(void(^)(SDPackedRecordHeader header, NSString *key, SDPackedRecordLocation location, BOOL *stop))block {
+    const uint8_t *bytes = data.bytes;
+    NSUInteger length = data.length;
+    NSUInteger offset = 0;
+    BOOL stop = NO;
+    while (!stop && offset + sizeof(SDPackedRecordHeader) <= length) {
+        SDPackedRecordHeader header;
+        memcpy(&header, bytes + offset, sizeof(SDPackedRecordHeader));
+        if (header.magic != SDPackedRecordMagic) {
+            break;
+        }
+        NSUInteger recordLength = sizeof(SDPackedRecordHeader) + header.keyLength + header.dataLength;
+        if (offset + recordLength > length) {
+            break;
+        }
+        NSString *key = [[NSString alloc] initWithBytes:bytes + offset + sizeof(SDPackedRecordHeader) length:header.keyLength encoding:NSUTF8StringEncoding];
+        if (key) {
+            SDPackedRecordLocation location = {identifier, offset, recordLength, header.dataLength};
+            block(header, key, location, &stop);
+        }
+        offset += recordLength;
+    }
+    return offset;
+}
+
+// Call with lock held
+- (BOOL)appendRecordWithType:(SDPackedRecordType)type key:(nonnull NSString *)key data:(nullable NSData *)data timestamp:(NSTimeInterval)timestamp {
+    if (!self.activeSegment) {
+        return NO;
+    }
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    SDPackedRecordHeader header = {0};
+    header.magic = SDPackedRecordMagic;
+    header.type = type;
+    header.keyLength = (uint32_t)keyData.length;
+    header.dataLength = (uint32_t)data.length;
+    header.timestamp = timestamp;
+    NSUInteger recordLength = sizeof(SDPackedRecordHeader) + keyData.length + data.length;
+
+    SDPackedDiskCacheSegment *segment = self.activeSegment;
+    if (segment.fileLength > 0 && segment.fileLength + recordLength > self.maxSegmentSize) {
+        // Current segment is full, seal it and create a new one
+        if (![self openActiveSegmentWithIdentifier:segment.identifier + 1]) {
+            return NO;
+        }
+        [self scheduleCompactionIfNeeded:segment];
+        segment = self.activeSegment;
+    }
+
+    struct iovec iov[3] = {
+        {&header, sizeof(SDPackedRecordHeader)},
+        {(void *)keyData.bytes, keyData.length},
+        {(void *)data.bytes, data.length},
+    };
+    ssize_t written = writev(_activeFileDescriptor, iov, 3);
+    if (written != (ssize_t)recordLength) {
+        // Rollback the partial record
+        ftruncate(_activeFileDescriptor, segment.fileLength);
+        return NO;
+    }
+    SDPackedRecordLocation location = {segment.identifier, segment.fileLength, recordLength, data.length};
+    segment.fileLength += recordLength;
+    [self applyRecordWithType:type key:key location:location timestamp:timestamp];
+    return YES;
+}
+
+// Call with lock held
+- (void)applyRecordWithType:(SDPackedRecordType)type key:(nonnull NSString *)key location:(SDPackedRecordLocation)location timestamp:(NSTimeInterval)timestamp {
+    SDPackedDiskCacheEntry *entry = self.entries[key];
+    switch (type) {
+        case SDPackedRecordTypeData: {
+            [self killRecordsOfEntry:entry includingData:YES];
+            entry = [SDPackedDiskCacheEntry new];
+            entry.dataLocation = location;
+            entry.timestamp = timestamp;
+            self.entries[key] = entry;
+            self.segments[@(location.segment)].liveLength += location.length;
+        }
+            break;
+        case SDPackedRecordTypeExtendedData: {
+            if (!entry) {
+                break;
+            }
+            [self killRecordsOfEntry:entry includingData:NO];
+            if (location.dataLength > 0) {
+                entry.extendedDataLocation = location;
+                self.segments[@(location.segment)].liveLength += location.length;
+            } else {
+                entry.extendedDataLocation = (SDPackedRecordLocation){0};
+            }
+        }
+            break;
+        case SDPackedRecordTypeTombstone: {
+            [self killRecordsOfEntry:entry includingData:YES];
+            [self.entries removeObjectForKey:key];
+        }
+            break;
+        default:
+            break;
+    }
+}
+
+- (void)killRecordsOfEntry:(nullable SDPackedDiskCacheEntry *)entry includingData:(BOOL)includingData {
+    if (!entry) {
+        return;
+    }
+    if (includingData) {
+        [self killRecordAtLocation:entry.dataLocation];
+    }
+    if (entry.extendedDataLocation.length > 0) {
+        [self killRecordAtLocation:entry.extendedDataLocation];
+    }
+}
+
+- (void)killRecordAtLocation:(SDPackedRecordLocation)location {
+    SDPackedDiskCacheSegment *segment = self.segments[@(location.segment)];
+    if (!segment) {
+        return;
+    }
+    segment.liveLength -= MIN(segment.liveLength, location.length);
+    [self scheduleCompactionIfNeeded:segment];
+}
+
+@end
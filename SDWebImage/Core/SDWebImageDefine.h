@@ -203,7 +203,14 @@ typedef NS_OPTIONS(NSUInteger, SDWebImageOptions) {
      * We usually don't apply transform on vector images, because vector images supports dynamically changing to any size, rasterize to a fixed size will loss details. To modify vector images, you can process the vector data at runtime (such as modifying PDF tag / SVG element).
      * Use this flag to transform them anyway.
      */
-    SDWebImageTransformVectorImage = 1 << 23
+    SDWebImageTransformVectorImage = 1 << 23,
+    
+    /**
+     * By default, the downloaded data is buffered in memory, and written to the disk cache after the image is decoded.
+     * Use this flag to let the download operation write the received data into a temporary file in the disk cache directory during downloading. The image is decoded from the memory-mapped file, which reduce one full in-memory copy for large image, and the disk cache store moves the file into place instead of writing the bytes again.
+     * @note This only works for `SDImageCache` with a disk cache which provide file path (`cachePathForKey:`), and has no effect when using the cache serializer or the download decryptor, or when the disk cache is not in `storeCacheType` and `originalStoreCacheType`.
+     */
+    SDWebImageStreamToDiskCache = 1 << 24
 };
 
 
@@ -289,6 +296,12 @@ FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextOrigin
  */
 FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextOriginalStoreCacheType;
 
+/**
+ A BOOL value which mark the image stored into memory cache with low admission priority. Low priority image use the free space of memory cache only, and does not evict the frequently used images until it's accessed again. This is useful for the images which may not be displayed soon, for example, set it in `SDWebImagePrefetcher.context` to avoid prefetching flush the images on screen.
+ It takes effect when the memory cache implements `setObject:forKey:cost:lowPriority:`, such as `SDLRUMemoryCache`. Defaults to NO. (NSNumber)
+ */
+FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextMemoryCacheLowPriority;
+
 /**
  A id<SDImageCache> instance which conforms to `SDImageCache` protocol. It's used to control the cache for original image when using the transformer. If you provide one, the original image (full size image) will query and write from that cache instance instead, the transformed image will query and write from the default `SDWebImageContextImageCache` instead. (id<SDImageCache>)
  */
@@ -315,6 +328,16 @@ FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextDownlo
  */
 FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextDownloadDecryptor;
 
+/**
+ A file path to let the download operation write the received data into a temporary file in the same directory, instead of buffering in memory. The completed image data is memory-mapped from the temporary file and owns it: `SDImageCache` atomically moves the file into place when storing the data to disk, after the image is decoded, and the file is removed when the data is released without being stored, or when the decoding failed. It's set by manager when using `SDWebImageStreamToDiskCache`. (NSString *)
+ */
+FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextDownloadDestinationPath;
+
+/**
+ A SDHTTPCacheValidator instance of the cached image. It's set by manager when using `SDWebImageRefreshCached` and the image cache stores the validators (See `SDImageCacheConfig.shouldStoreHTTPCacheValidators`). The downloader sends the conditional request with it instead of using `NSURLCache`, and the 304 response is reported as `SDWebImageErrorCacheNotModified`. When storing the downloaded image, manager replace it with the validator of response, the image cache stores it with the image data. (SDHTTPCacheValidator)
+ */
+FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextHTTPCacheValidator;
+
 /**
  A id<SDWebImageCacheKeyFilter> instance to convert an URL into a cache key. It's used when manager need cache key to use image cache. If you provide one, it will ignore the `cacheKeyFilter` in manager and use provided one instead. (id<SDWebImageCacheKeyFilter>)
  */
@@ -14,6 +14,7 @@
 #import "SDWebImageDownloaderRequestModifier.h"
 #import "SDWebImageDownloaderResponseModifier.h"
 #import "SDWebImageDownloaderDecryptor.h"
+#import "SDWebImageDownloaderMetrics.h"
 #import "SDImageLoader.h"
 
 /// Downloader options
@@ -133,9 +134,30 @@ typedef SDImageLoaderCompletedBlock SDWebImageDownloaderCompletedBlock;
  */
 @property (nonatomic, strong, nullable, readonly) NSURLSessionTaskMetrics *metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
 
+/**
+ The download's priority, in the same range as `NSURLSessionTask.priority` (0.0 to 1.0). Defaults to `NSURLSessionTaskPriorityHigh`, `NSURLSessionTaskPriorityLow` or `NSURLSessionTaskPriorityDefault` according to the download options.
+ This can be changed after the download is enqueued, such as when a cell scrolls into view. The pending download with higher priority starts first, and the priority of the running download is forwarded to its URL session task.
+@note The download operation is shared by the downloads of the same URL, it takes the highest priority of the downloads which are not cancelled. So lowering the priority of one download does not slow down the others, and the getter returns the priority of the shared operation.
+ */
+@property (nonatomic, assign) float priority;
+
 @end
 
 
+@class SDWebImageDownloader;
+
+/**
+ The delegate to receive the aggregated download metrics periodically. See `SDWebImageDownloaderConfig.metricsReportInterval`.
+ */
+@protocol SDWebImageDownloaderMetricsDelegate <NSObject>
+
+/// Called on the main queue with the metrics since last report.
+/// @param downloader The downloader
+/// @param snapshot The aggregated metrics
+- (void)imageDownloader:(nonnull SDWebImageDownloader *)downloader didReportMetrics:(nonnull SDWebImageDownloaderMetricsSnapshot *)snapshot;
+
+@end
+
 /**
  * Asynchronous downloader dedicated and optimized for image loading.
  */
@@ -172,6 +194,18 @@ typedef SDImageLoaderCompletedBlock SDWebImageDownloaderCompletedBlock;
  */
 @property (nonatomic, strong, nullable) id<SDWebImageDownloaderDecryptor> decryptor;
 
+/**
+ * The collector of aggregated download metrics, by host and content type. Use `metricsCollector.snapshot` to query the current metrics.
+ * The metrics is collected only when `SDWebImageDownloaderConfig.shouldCollectMetrics` is YES.
+ */
+@property (nonatomic, strong, readonly, nonnull) SDWebImageDownloaderMetricsCollector *metricsCollector;
+
+/**
+ * The delegate to receive the aggregated metrics every `SDWebImageDownloaderConfig.metricsReportInterval`, each report resets the `metricsCollector`.
+ * Defaults to nil, which means no periodic report.
+ */
+@property (nonatomic, weak, nullable) id<SDWebImageDownloaderMetricsDelegate> metricsDelegate;
+
 /**
  * The configuration in use by the internal NSURLSession. If you want to provide a custom sessionConfiguration, use `SDWebImageDownloaderConfig.sessionConfiguration` and create a new downloader instance.
  @note This is immutable according to NSURLSession's documentation. Mutating this object directly has no effect.
@@ -9,7 +9,10 @@
 #import "SDWebImageDownloader.h"
 #import "SDWebImageDownloaderConfig.h"
 #import "SDWebImageDownloaderOperation.h"
+#import "SDWebImageDownloaderOperationInternal.h"
 #import "SDWebImageError.h"
+#import "SDHTTPCacheValidator.h"
+#import "SDWebImageDownloaderScheduler.h"
 #import "SDInternalMacros.h"
 
 NSNotificationName const SDWebImageDownloadStartNotification = @"SDWebImageDownloadStartNotification";
@@ -19,6 +22,16 @@ NSNotificationName const SDWebImageDownloadFinishNotification = @"SDWebImageDown
 
 static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 
+static inline float SDDownloaderPriorityFromOptions(SDWebImageDownloaderOptions options) {
+    if (options & SDWebImageDownloaderHighPriority) {
+        return NSURLSessionTaskPriorityHigh;
+    } else if (options & SDWebImageDownloaderLowPriority) {
+        return NSURLSessionTaskPriorityLow;
+    } else {
+        return NSURLSessionTaskPriorityDefault;
+    }
+}
+
 @interface SDWebImageDownloadToken ()
 
 @property (nonatomic, strong, nullable, readwrite) NSURL *url;
@@ -27,6 +40,7 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 @property (nonatomic, strong, nullable, readwrite) NSURLSessionTaskMetrics *metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
 @property (nonatomic, weak, nullable, readwrite) id downloadOperationCancelToken;
 @property (nonatomic, weak, nullable) NSOperation<SDWebImageDownloaderOperation> *downloadOperation;
+@property (nonatomic, weak, nullable) SDWebImageDownloaderScheduler *scheduler;
 @property (nonatomic, assign, getter=isCancelled) BOOL cancelled;
 
 - (nonnull instancetype)init NS_UNAVAILABLE;
@@ -37,9 +51,12 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 
 @interface SDWebImageDownloader () <NSURLSessionTaskDelegate, NSURLSessionDataDelegate>
 
-@property (strong, nonatomic, nonnull) NSOperationQueue *downloadQueue;
+@property (strong, nonatomic, nonnull) SDWebImageDownloaderScheduler *scheduler;
 @property (strong, nonatomic, nonnull) NSMutableDictionary<NSURL *, NSOperation<SDWebImageDownloaderOperation> *> *URLOperations;
+@property (strong, nonatomic, nonnull) NSMutableDictionary<NSNumber *, NSOperation<SDWebImageDownloaderOperation> *> *taskOperations; // task identifier -> operation, for URLSession delegate callbacks
 @property (strong, nonatomic, nullable) NSMutableDictionary<NSString *, NSString *> *HTTPHeaders;
+@property (strong, nonatomic, nullable) dispatch_source_t metricsReportTimer;
+@property (strong, nonatomic, nullable) SDWebImageDownloaderResumeDataStore *resumeDataStore;
 
 // The session in which data tasks will run
 @property (strong, nonatomic) NSURLSession *session;
@@ -49,6 +66,7 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 @implementation SDWebImageDownloader {
     SD_LOCK_DECLARE(_HTTPHeadersLock); // A lock to keep the access to `HTTPHeaders` thread-safe
     SD_LOCK_DECLARE(_operationsLock); // A lock to keep the access to `URLOperations` thread-safe
+    SD_LOCK_DECLARE(_taskOperationsLock); // A lock to keep the access to `taskOperations` thread-safe
 }
 
 + (void)initialize {
@@ -95,10 +113,24 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
         }
         _config = [config copy];
         [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloads)) options:0 context:SDWebImageDownloaderContext];
-        _downloadQueue = [NSOperationQueue new];
-        _downloadQueue.maxConcurrentOperationCount = _config.maxConcurrentDownloads;
-        _downloadQueue.name = @"com.hackemist.SDWebImageDownloader";
+        [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(executionOrder)) options:0 context:SDWebImageDownloaderContext];
+        [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloadsPerHost)) options:0 context:SDWebImageDownloaderContext];
+        [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloadsForHosts)) options:0 context:SDWebImageDownloaderContext];
+        [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxPendingDownloadsPerHost)) options:0 context:SDWebImageDownloaderContext];
+        _scheduler = [[SDWebImageDownloaderScheduler alloc] initWithExecutionOrder:_config.executionOrder];
+        _scheduler.maxConcurrentOperationCount = _config.maxConcurrentDownloads;
+        _scheduler.maxConcurrentOperationCountPerHost = _config.maxConcurrentDownloadsPerHost;
+        _scheduler.maxConcurrentOperationCountForHosts = _config.maxConcurrentDownloadsForHosts;
+        _scheduler.maxPendingOperationCountPerHost = _config.maxPendingDownloadsPerHost;
         _URLOperations = [NSMutableDictionary new];
+        _taskOperations = [NSMutableDictionary new];
+        _metricsCollector = [SDWebImageDownloaderMetricsCollector new];
+        if (_config.maxResumableDataMemorySize > 0 || _config.maxResumableDataDiskSize > 0) {
+            NSString *cachesPath = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+            NSString *diskPath = [cachesPath stringByAppendingPathComponent:@"com.hackemist.SDWebImageDownloader/Partial"];
+            _resumeDataStore = [[SDWebImageDownloaderResumeDataStore alloc] initWithMemoryLimit:_config.maxResumableDataMemorySize diskLimit:_config.maxResumableDataDiskSize diskPath:diskPath];
+            _resumeDataStore.minimumDataSize = _config.minimumResumableDataSize;
+        }
         NSMutableDictionary<NSString *, NSString *> *headerDictionary = [NSMutableDictionary dictionary];
         NSString *userAgent = nil;
 #if SD_UIKIT
@@ -123,6 +155,7 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
         _HTTPHeaders = headerDictionary;
         SD_LOCK_INIT(_HTTPHeadersLock);
         SD_LOCK_INIT(_operationsLock);
+        SD_LOCK_INIT(_taskOperationsLock);
         NSURLSessionConfiguration *sessionConfiguration = _config.sessionConfiguration;
         if (!sessionConfiguration) {
             sessionConfiguration = [NSURLSessionConfiguration defaultSessionConfiguration];
@@ -140,14 +173,49 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 }
 
 - (void)dealloc {
-    [self.downloadQueue cancelAllOperations];
+    if (_metricsReportTimer) {
+        dispatch_source_cancel(_metricsReportTimer);
+    }
+    [self.scheduler cancelAllOperations];
     [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloads)) context:SDWebImageDownloaderContext];
+    [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(executionOrder)) context:SDWebImageDownloaderContext];
+    [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloadsPerHost)) context:SDWebImageDownloaderContext];
+    [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloadsForHosts)) context:SDWebImageDownloaderContext];
+    [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxPendingDownloadsPerHost)) context:SDWebImageDownloaderContext];
     
     // Invalide the URLSession after all operations been cancelled
     [self.session invalidateAndCancel];
     self.session = nil;
 }
 
+- (void)setMetricsDelegate:(id<SDWebImageDownloaderMetricsDelegate>)metricsDelegate {
+    _metricsDelegate = metricsDelegate;
+    if (!metricsDelegate) {
+        if (self.metricsReportTimer) {
+            dispatch_source_cancel(self.metricsReportTimer);
+            self.metricsReportTimer = nil;
+        }
+        return;
+    }
+    NSTimeInterval interval = self.config.metricsReportInterval;
+    if (self.metricsReportTimer || interval <= 0) {
+        return;
+    }
+    dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+    dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), (uint64_t)(interval * NSEC_PER_SEC), (uint64_t)(interval * 0.1 * NSEC_PER_SEC));
+    @weakify(self);
+    dispatch_source_set_event_handler(timer, ^{
+        @strongify(self);
+        id<SDWebImageDownloaderMetricsDelegate> delegate = self.metricsDelegate;
+        if (!delegate) {
+            return;
+        }
+        [delegate imageDownloader:self didReportMetrics:[self.metricsCollector snapshotByResetting]];
+    });
+    dispatch_resume(timer);
+    self.metricsReportTimer = timer;
+}
+
 - (void)invalidateSessionAndCancel:(BOOL)cancelPendingOperations {
     if (self == [SDWebImageDownloader sharedDownloader]) {
         return;
@@ -219,36 +287,32 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
             return nil;
         }
         @weakify(self);
+        @weakify(operation);
         operation.completionBlock = ^{
             @strongify(self);
+            @strongify(operation);
             if (!self) {
                 return;
             }
             SD_LOCK(self->_operationsLock);
             [self.URLOperations removeObjectForKey:url];
             SD_UNLOCK(self->_operationsLock);
+            if (operation) {
+                [self.scheduler operationDidFinish:operation];
+            }
         };
         self.URLOperations[url] = operation;
         // Add the handlers before submitting to operation queue, avoid the race condition that operation finished before setting handlers.
         downloadOperationCancelToken = [operation addHandlersForProgress:progressBlock completed:completedBlock];
-        // Add operation to operation queue only after all configuration done according to Apple's doc.
-        // `addOperation:` does not synchronously execute the `operation.completionBlock` so this will not cause deadlock.
-        [self.downloadQueue addOperation:operation];
+        // Add operation to scheduler only after all configuration done.
+        // `addOperation:priority:` starts the operation asynchronously, so the `operation.completionBlock` does not cause deadlock.
+        [self.scheduler addOperation:operation priority:SDDownloaderPriorityFromOptions(options)];
     } else {
         // When we reuse the download operation to attach more callbacks, there may be thread safe issue because the getter of callbacks may in another queue (decoding queue or delegate queue)
         // So we lock the operation here, and in `SDWebImageDownloaderOperation`, we use `@synchonzied (self)`, to ensure the thread safe between these two classes.
         @synchronized (operation) {
             downloadOperationCancelToken = [operation addHandlersForProgress:progressBlock completed:completedBlock];
         }
-        if (!operation.isExecuting) {
-            if (options & SDWebImageDownloaderHighPriority) {
-                operation.queuePriority = NSOperationQueuePriorityHigh;
-            } else if (options & SDWebImageDownloaderLowPriority) {
-                operation.queuePriority = NSOperationQueuePriorityLow;
-            } else {
-                operation.queuePriority = NSOperationQueuePriorityNormal;
-            }
-        }
     }
     SD_UNLOCK(_operationsLock);
     
@@ -256,6 +320,9 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
     token.url = url;
     token.request = operation.request;
     token.downloadOperationCancelToken = downloadOperationCancelToken;
+    token.scheduler = self.scheduler;
+    // The operation is shared by all the tokens, the most urgent live one wins
+    [self.scheduler setPriority:SDDownloaderPriorityFromOptions(options) forOperation:operation requester:token];
     
     return token;
 }
@@ -276,6 +343,11 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
     SD_LOCK(_HTTPHeadersLock);
     mutableRequest.allHTTPHeaderFields = self.HTTPHeaders;
     SD_UNLOCK(_HTTPHeadersLock);
+    // Revalidate the cached image with conditional request, the 304 response is reported as `SDWebImageErrorCacheNotModified`
+    SDHTTPCacheValidator *validator = context[SDWebImageContextHTTPCacheValidator];
+    if ([validator isKindOfClass:[SDHTTPCacheValidator class]]) {
+        [validator applyToRequest:mutableRequest];
+    }
     
     // Context Option
     SDWebImageMutableContext *mutableContext;
@@ -357,52 +429,79 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
         operation.acceptableContentTypes = self.config.acceptableContentTypes;
     }
     
-    if (options & SDWebImageDownloaderHighPriority) {
-        operation.queuePriority = NSOperationQueuePriorityHigh;
-    } else if (options & SDWebImageDownloaderLowPriority) {
-        operation.queuePriority = NSOperationQueuePriorityLow;
-    }
-    
-    if (self.config.executionOrder == SDWebImageDownloaderLIFOExecutionOrder) {
-        // Emulate LIFO execution order by systematically, each previous adding operation can dependency the new operation
-        // This can gurantee the new operation to be execulated firstly, even if when some operations finished, meanwhile you appending new operations
-        // Just make last added operation dependents new operation can not solve this problem. See test case #test15DownloaderLIFOExecutionOrder
-        for (NSOperation *pendingOperation in self.downloadQueue.operations) {
-            [pendingOperation addDependency:operation];
-        }
+    if (self.resumeDataStore && [operation isKindOfClass:[SDWebImageDownloaderOperation class]]) {
+        ((SDWebImageDownloaderOperation *)operation).resumeDataStore = self.resumeDataStore;
     }
     
     return operation;
 }
 
 - (void)cancelAllDownloads {
-    [self.downloadQueue cancelAllOperations];
+    [self.scheduler cancelAllOperations];
 }
 
 #pragma mark - Properties
 
 - (BOOL)isSuspended {
-    return self.downloadQueue.isSuspended;
+    return self.scheduler.isSuspended;
 }
 
 - (void)setSuspended:(BOOL)suspended {
-    self.downloadQueue.suspended = suspended;
+    self.scheduler.suspended = suspended;
 }
 
 - (NSUInteger)currentDownloadCount {
-    return self.downloadQueue.operationCount;
+    return self.scheduler.operationCount;
 }
 
 - (NSURLSessionConfiguration *)sessionConfiguration {
     return self.session.configuration;
 }
 
+// Aggregate the metrics, and ask the concurrency controller before the next pending operation start. Call from the session delegate, the operation does not keep its task after finished
+- (void)processMetricsWithTask:(nonnull NSURLSessionTask *)task operation:(nullable NSOperation<SDWebImageDownloaderOperation> *)operation {
+    BOOL shouldCollectMetrics = self.config.shouldCollectMetrics;
+    id<SDWebImageDownloaderConcurrencyController> concurrencyController = self.config.concurrencyController;
+    if ((!shouldCollectMetrics && !concurrencyController) || ![operation respondsToSelector:@selector(metrics)]) {
+        return;
+    }
+    if (@available(iOS 10.0, tvOS 10.0, macOS 10.12, watchOS 3.0, *)) {
+        NSURLSessionTaskMetrics *metrics = operation.metrics;
+        if (!metrics) {
+            return;
+        }
+        if (shouldCollectMetrics) {
+            [self.metricsCollector recordTask:task metrics:metrics];
+        }
+        if (!concurrencyController) {
+            return;
+        }
+        SDWebImageDownloaderConcurrencySample *sample = [SDWebImageDownloaderConcurrencySample sampleWithTask:task metrics:metrics];
+        if (!sample) {
+            return;
+        }
+        NSInteger currentCount = self.scheduler.maxConcurrentOperationCount;
+        NSInteger count = [concurrencyController concurrentDownloadCountWithSample:sample currentCount:currentCount];
+        if (count > 0 && count != currentCount) {
+            self.scheduler.maxConcurrentOperationCount = count;
+        }
+    }
+}
+
 #pragma mark - KVO
 
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
     if (context == SDWebImageDownloaderContext) {
         if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxConcurrentDownloads))]) {
-            self.downloadQueue.maxConcurrentOperationCount = self.config.maxConcurrentDownloads;
+            self.scheduler.maxConcurrentOperationCount = self.config.maxConcurrentDownloads;
+        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(executionOrder))]) {
+            self.scheduler.executionOrder = self.config.executionOrder;
+        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxConcurrentDownloadsPerHost))]) {
+            self.scheduler.maxConcurrentOperationCountPerHost = self.config.maxConcurrentDownloadsPerHost;
+        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxConcurrentDownloadsForHosts))]) {
+            self.scheduler.maxConcurrentOperationCountForHosts = self.config.maxConcurrentDownloadsForHosts;
+        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxPendingDownloadsPerHost))]) {
+            self.scheduler.maxPendingOperationCountPerHost = self.config.maxPendingDownloadsPerHost;
         }
     } else {
         [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
@@ -412,23 +511,47 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 #pragma mark Helper methods
 
 - (NSOperation<SDWebImageDownloaderOperation> *)operationWithTask:(NSURLSessionTask *)task {
-    NSOperation<SDWebImageDownloaderOperation> *returnOperation = nil;
-    for (NSOperation<SDWebImageDownloaderOperation> *operation in self.downloadQueue.operations) {
+    // The task identifier is unique in our session, so the map can be used for all delegate callbacks (each data chunk) without walking the queue
+    NSNumber *taskIdentifier = @(task.taskIdentifier);
+    SD_LOCK(_taskOperationsLock);
+    NSOperation<SDWebImageDownloaderOperation> *returnOperation = self.taskOperations[taskIdentifier];
+    SD_UNLOCK(_taskOperationsLock);
+    if (returnOperation) {
+        // The cancelled or finished operation has already released its task, keep the same behavior as walking the queue
+        if (returnOperation.isCancelled || returnOperation.isFinished) {
+            return nil;
+        }
+        return returnOperation;
+    }
+    
+    // The first callback of a task. The task is created during the operation start, so walk the running operations once and register all the started tasks
+    NSMutableDictionary<NSNumber *, NSOperation<SDWebImageDownloaderOperation> *> *startedOperations = [NSMutableDictionary dictionary];
+    for (NSOperation<SDWebImageDownloaderOperation> *operation in self.scheduler.runningOperations) {
         if ([operation respondsToSelector:@selector(dataTask)]) {
             // So we lock the operation here, and in `SDWebImageDownloaderOperation`, we use `@synchonzied (self)`, to ensure the thread safe between these two classes.
             NSURLSessionTask *operationTask;
             @synchronized (operation) {
                 operationTask = operation.dataTask;
             }
-            if (operationTask.taskIdentifier == task.taskIdentifier) {
-                returnOperation = operation;
-                break;
+            // Other completed task does not receive any callback, skip to avoid leaking in map
+            if (operationTask && (operationTask.taskIdentifier == task.taskIdentifier || operationTask.state != NSURLSessionTaskStateCompleted)) {
+                startedOperations[@(operationTask.taskIdentifier)] = operation;
             }
         }
     }
+    returnOperation = startedOperations[taskIdentifier];
+    SD_LOCK(_taskOperationsLock);
+    [self.taskOperations addEntriesFromDictionary:startedOperations];
+    SD_UNLOCK(_taskOperationsLock);
     return returnOperation;
 }
 
+- (void)removeOperationWithTask:(NSURLSessionTask *)task {
+    SD_LOCK(_taskOperationsLock);
+    [self.taskOperations removeObjectForKey:@(task.taskIdentifier)];
+    SD_UNLOCK(_taskOperationsLock);
+}
+
 #pragma mark NSURLSessionDataDelegate
 
 - (void)URLSession:(NSURLSession *)session
@@ -481,6 +604,10 @@ didReceiveResponse:(NSURLResponse *)response
     if ([dataOperation respondsToSelector:@selector(URLSession:task:didCompleteWithError:)]) {
         [dataOperation URLSession:session task:task didCompleteWithError:error];
     }
+    // The metrics is collected before completion
+    [self processMetricsWithTask:task operation:dataOperation];
+    // This is the last delegate callback of a task (including cancelled one), remove it from the map
+    [self removeOperationWithTask:task];
 }
 
 - (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task willPerformHTTPRedirection:(NSHTTPURLResponse *)response newRequest:(NSURLRequest *)request completionHandler:(void (^)(NSURLRequest * _Nullable))completionHandler {
@@ -555,13 +682,36 @@ didReceiveResponse:(NSURLResponse *)response
     }
 }
 
+- (float)priority {
+    NSOperation<SDWebImageDownloaderOperation> *downloadOperation = self.downloadOperation;
+    if (!downloadOperation) {
+        return NSURLSessionTaskPriorityDefault;
+    }
+    return [self.scheduler priorityForOperation:downloadOperation];
+}
+
+- (void)setPriority:(float)priority {
+    NSOperation<SDWebImageDownloaderOperation> *downloadOperation = self.downloadOperation;
+    if (!downloadOperation) {
+        return;
+    }
+    [self.scheduler setPriority:MIN(MAX(priority, 0), 1) forOperation:downloadOperation requester:self];
+}
+
 - (void)cancel {
     @synchronized (self) {
         if (self.isCancelled) {
             return;
         }
         self.cancelled = YES;
-        [self.downloadOperation cancel:self.downloadOperationCancelToken];
+        NSOperation<SDWebImageDownloaderOperation> *downloadOperation = self.downloadOperation;
+        if ([downloadOperation cancel:self.downloadOperationCancelToken] && downloadOperation) {
+            // The cancelled operation should not wait for its turn
+            [self.scheduler operationDidCancel:downloadOperation];
+        } else if (downloadOperation) {
+            // The priority of this token does not count for the other tokens anymore
+            [self.scheduler removeRequester:self forOperation:downloadOperation];
+        }
         self.downloadOperationCancelToken = nil;
     }
 }
@@ -584,11 +734,13 @@ didReceiveResponse:(NSURLResponse *)response
 
 - (id<SDWebImageOperation>)requestImageWithURL:(NSURL *)url options:(SDWebImageOptions)options context:(SDWebImageContext *)context progress:(SDImageLoaderProgressBlock)progressBlock completed:(SDImageLoaderCompletedBlock)completedBlock {
     UIImage *cachedImage = context[SDWebImageContextLoaderCachedImage];
+    // The image cache stores the HTTP cache validators, which replace `NSURLCache`
+    BOOL hasValidator = [context[SDWebImageContextHTTPCacheValidator] isKindOfClass:[SDHTTPCacheValidator class]];
     
     SDWebImageDownloaderOptions downloaderOptions = 0;
     if (options & SDWebImageLowPriority) downloaderOptions |= SDWebImageDownloaderLowPriority;
     if (options & SDWebImageProgressiveLoad) downloaderOptions |= SDWebImageDownloaderProgressiveLoad;
-    if (options & SDWebImageRefreshCached) downloaderOptions |= SDWebImageDownloaderUseNSURLCache;
+    if (options & SDWebImageRefreshCached && !hasValidator) downloaderOptions |= SDWebImageDownloaderUseNSURLCache;
     if (options & SDWebImageContinueInBackground) downloaderOptions |= SDWebImageDownloaderContinueInBackground;
     if (options & SDWebImageHandleCookies) downloaderOptions |= SDWebImageDownloaderHandleCookies;
     if (options & SDWebImageAllowInvalidSSLCertificates) downloaderOptions |= SDWebImageDownloaderAllowInvalidSSLCertificates;
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+/**
+ The measurement of one finished download, which is collected from `NSURLSessionTaskMetrics`.
+ */
+@interface SDWebImageDownloaderConcurrencySample : NSObject
+
+/// The time from the request start to the response end, in seconds.
+@property (nonatomic, assign, readonly) NSTimeInterval duration;
+/// The time to first byte (from the request start to the response start), in seconds.
+@property (nonatomic, assign, readonly) NSTimeInterval timeToFirstByte;
+/// The number of received bytes.
+@property (nonatomic, assign, readonly) int64_t receivedBytes;
+/// The number of retried transactions, excluding the redirections.
+@property (nonatomic, assign, readonly) NSUInteger retryCount;
+/// Whether the download is failed by network error (such as timeout), or the server is overloaded (HTTP 429 and 5xx).
+@property (nonatomic, assign, readonly, getter=isFailed) BOOL failed;
+/// The received bytes per second of the response body, or 0 if unknown.
+@property (nonatomic, assign, readonly) double transferRate;
+
+/// Create the sample with values. This can be used to simulate the network.
+- (nonnull instancetype)initWithDuration:(NSTimeInterval)duration timeToFirstByte:(NSTimeInterval)timeToFirstByte receivedBytes:(int64_t)receivedBytes retryCount:(NSUInteger)retryCount failed:(BOOL)failed;
+
+/// Create the sample from the finished task and its metrics. Return nil if the task is cancelled or the metrics does not contain timing.
++ (nullable instancetype)sampleWithTask:(nonnull NSURLSessionTask *)task metrics:(nonnull NSURLSessionTaskMetrics *)metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
+
+@end
+
+/**
+ This is the protocol for downloader concurrency controller, which adjusts the maximum number of concurrent downloads at runtime by the measured downloads.
+ */
+@protocol SDWebImageDownloaderConcurrencyController <NSObject>
+
+/// Return the maximum number of concurrent downloads after a download finished. This is called on arbitrary queue after each finished download which has metrics.
+/// @param sample The measurement of the finished download
+/// @param currentCount The current maximum number of concurrent downloads
+- (NSInteger)concurrentDownloadCountWithSample:(nonnull SDWebImageDownloaderConcurrencySample *)sample currentCount:(NSInteger)currentCount;
+
+@end
+
+/**
+ A concurrency controller with the additive-increase/multiplicative-decrease (AIMD) policy.
+ The samples are measured in rounds of `sampleCount` downloads. The cost of a round is the median download duration divided by the concurrency, which is the median completion time of images when the downloads are pipelined. The concurrency increases additively while the cost is not worse than last round, and decreases multiplicatively when the cost gets worse, or the network is congested (failure, retry, or the time to first byte is much larger than the best one). So the concurrency keeps around the value which minimizes the median completion time on current network.
+ All the methods are thread-safe.
+ */
+@interface SDWebImageDownloaderAIMDConcurrencyController : NSObject <SDWebImageDownloaderConcurrencyController>
+
+/// The minimum concurrency. Defaults to 1.
+@property (nonatomic, assign) NSInteger minimumConcurrentDownloads;
+/// The maximum concurrency. Defaults to 16.
+@property (nonatomic, assign) NSInteger maximumConcurrentDownloads;
+/// The number of samples in one round. Defaults to 8.
+@property (nonatomic, assign) NSUInteger sampleCount;
+/// The concurrency added when the round is better. Defaults to 1.
+@property (nonatomic, assign) NSInteger additiveIncrease;
+/// The factor multiplied to the concurrency when the round is worse or congested, should be 0.0-1.0. Defaults to 0.5.
+@property (nonatomic, assign) double multiplicativeDecrease;
+/// The relative cost difference treated as noise. Defaults to 0.1, which means the round is worse only when the cost grows more than 10%.
+@property (nonatomic, assign) double tolerance;
+/// The congestion threshold of time to first byte, relative to the best one ever measured. Defaults to 4.
+@property (nonatomic, assign) double timeToFirstByteCongestionRatio;
+
+/// The last returned concurrency, or 0 before any sample.
+@property (nonatomic, assign, readonly) NSInteger concurrentDownloadCount;
+
+/// Reset the measured rounds.
+- (void)reset;
+
+@end
@@ -0,0 +1,164 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageDownloaderConcurrencyController.h"
+#import "SDInternalMacros.h"
+
+@implementation SDWebImageDownloaderConcurrencySample
+
+- (instancetype)initWithDuration:(NSTimeInterval)duration timeToFirstByte:(NSTimeInterval)timeToFirstByte receivedBytes:(int64_t)receivedBytes retryCount:(NSUInteger)retryCount failed:(BOOL)failed {
+    self = [super init];
+    if (self) {
+        _duration = MAX(duration, 0);
+        _timeToFirstByte = MAX(timeToFirstByte, 0);
+        _receivedBytes = MAX(receivedBytes, 0);
+        _retryCount = retryCount;
+        _failed = failed;
+    }
+    return self;
+}
+
++ (instancetype)sampleWithTask:(NSURLSessionTask *)task metrics:(NSURLSessionTaskMetrics *)metrics {
+    NSError *error = task.error;
+    if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled) {
+        return nil;
+    }
+    NSURLSessionTaskTransactionMetrics *transactionMetrics = metrics.transactionMetrics.lastObject;
+    NSDate *requestStartDate = transactionMetrics.requestStartDate ?: metrics.taskInterval.startDate;
+    NSDate *responseStartDate = transactionMetrics.responseStartDate;
+    NSDate *responseEndDate = transactionMetrics.responseEndDate ?: metrics.taskInterval.endDate;
+    if (!requestStartDate || !responseEndDate) {
+        return nil;
+    }
+    NSTimeInterval duration = [responseEndDate timeIntervalSinceDate:requestStartDate];
+    NSTimeInterval timeToFirstByte = responseStartDate ? [responseStartDate timeIntervalSinceDate:requestStartDate] : duration;
+    // Each redirection takes one transaction as well
+    NSUInteger transactionCount = MAX(metrics.transactionMetrics.count, 1);
+    NSUInteger retryCount = transactionCount - 1 > metrics.redirectCount ? transactionCount - 1 - metrics.redirectCount : 0;
+    BOOL failed = error != nil;
+    if ([task.response isKindOfClass:[NSHTTPURLResponse class]]) {
+        NSInteger statusCode = ((NSHTTPURLResponse *)task.response).statusCode;
+        if (statusCode == 429 || statusCode >= 500) {
+            failed = YES;
+        }
+    }
+    return [[self alloc] initWithDuration:duration timeToFirstByte:timeToFirstByte receivedBytes:task.countOfBytesReceived retryCount:retryCount failed:failed];
+}
+
+- (double)transferRate {
+    NSTimeInterval transferTime = self.duration - self.timeToFirstByte;
+    if (transferTime <= 0) {
+        return 0;
+    }
+    return self.receivedBytes / transferTime;
+}
+
+@end
+
+@interface SDWebImageDownloaderAIMDConcurrencyController () {
+    SD_LOCK_DECLARE(_lock); // A lock to keep the access to samples thread-safe
+}
+
+@property (nonatomic, strong, nonnull) NSMutableArray<SDWebImageDownloaderConcurrencySample *> *samples; // samples of current round
+@property (nonatomic, assign) NSTimeInterval lastCost; // cost of last round, 0 means no round
+@property (nonatomic, assign) NSTimeInterval bestTimeToFirstByte; // 0 means no sample
+@property (nonatomic, assign, readwrite) NSInteger concurrentDownloadCount;
+
+@end
+
+@implementation SDWebImageDownloaderAIMDConcurrencyController
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _minimumConcurrentDownloads = 1;
+        _maximumConcurrentDownloads = 16;
+        _sampleCount = 8;
+        _additiveIncrease = 1;
+        _multiplicativeDecrease = 0.5;
+        _tolerance = 0.1;
+        _timeToFirstByteCongestionRatio = 4;
+        _samples = [NSMutableArray array];
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+- (NSInteger)concurrentDownloadCount {
+    SD_LOCK(_lock);
+    NSInteger concurrentDownloadCount = _concurrentDownloadCount;
+    SD_UNLOCK(_lock);
+    return concurrentDownloadCount;
+}
+
+- (void)reset {
+    SD_LOCK(_lock);
+    [self.samples removeAllObjects];
+    self.lastCost = 0;
+    self.bestTimeToFirstByte = 0;
+    SD_UNLOCK(_lock);
+}
+
+- (NSInteger)concurrentDownloadCountWithSample:(SDWebImageDownloaderConcurrencySample *)sample currentCount:(NSInteger)currentCount {
+    SD_LOCK(_lock);
+    NSInteger minimumCount = MAX(self.minimumConcurrentDownloads, 1);
+    NSInteger maximumCount = MAX(self.maximumConcurrentDownloads, minimumCount);
+    NSInteger count = MIN(MAX(currentCount, minimumCount), maximumCount);
+    BOOL congested = sample.isFailed || sample.retryCount > 0;
+    if (sample.timeToFirstByte > 0) {
+        if (self.bestTimeToFirstByte == 0 || sample.timeToFirstByte < self.bestTimeToFirstByte) {
+            self.bestTimeToFirstByte = sample.timeToFirstByte;
+        } else if (sample.timeToFirstByte > self.bestTimeToFirstByte * self.timeToFirstByteCongestionRatio) {
+            congested = YES;
+        }
+    }
+    if (congested) {
+        // Back off immediately, the samples of current round are measured under congestion
+        count = [self decreasedCount:count minimumCount:minimumCount];
+        [self.samples removeAllObjects];
+        self.lastCost = 0;
+    } else {
+        [self.samples addObject:sample];
+        if (self.samples.count >= MAX(self.sampleCount, 1)) {
+            NSTimeInterval cost = [self medianDuration] / count;
+            if (self.lastCost == 0 || cost <= self.lastCost * (1 + self.tolerance)) {
+                count = MIN(count + MAX(self.additiveIncrease, 1), maximumCount);
+            } else {
+                count = [self decreasedCount:count minimumCount:minimumCount];
+            }
+            self.lastCost = cost;
+            [self.samples removeAllObjects];
+        }
+    }
+    _concurrentDownloadCount = count;
+    SD_UNLOCK(_lock);
+    return count;
+}
+
+#pragma mark - Helper
+
+// Call with lock held
+- (NSInteger)decreasedCount:(NSInteger)count minimumCount:(NSInteger)minimumCount {
+    double factor = MIN(MAX(self.multiplicativeDecrease, 0), 1);
+    return MAX((NSInteger)floor(count * factor), minimumCount);
+}
+
+// Call with lock held
+- (NSTimeInterval)medianDuration {
+    NSArray<NSNumber *> *durations = [[self.samples valueForKey:NSStringFromSelector(@selector(duration))] sortedArrayUsingSelector:@selector(compare:)];
+    NSUInteger count = durations.count;
+    if (count == 0) {
+        return 0;
+    }
+    if (count % 2 == 1) {
+        return durations[count / 2].doubleValue;
+    }
+    return (durations[count / 2 - 1].doubleValue + durations[count / 2].doubleValue) / 2;
+}
+
+@end
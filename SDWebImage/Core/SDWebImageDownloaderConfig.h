@@ -8,6 +8,7 @@
 
 #import <Foundation/Foundation.h>
 #import "SDWebImageCompat.h"
+#import "SDWebImageDownloaderConcurrencyController.h"
 
 /// Operation execution order
 typedef NS_ENUM(NSInteger, SDWebImageDownloaderExecutionOrder) {
@@ -40,6 +41,65 @@ typedef NS_ENUM(NSInteger, SDWebImageDownloaderExecutionOrder) {
  */
 @property (nonatomic, assign) NSInteger maxConcurrentDownloads;
 
+/**
+ * The maximum number of concurrent downloads for each host, under the `maxConcurrentDownloads`. The hosts with pending downloads are served in round-robin, so a slow host can not take all the download slots.
+ * Defaults to 0, which means no limit.
+ */
+@property (nonatomic, assign) NSInteger maxConcurrentDownloadsPerHost;
+
+/**
+ * The maximum number of concurrent downloads for the specify hosts, which overrides the `maxConcurrentDownloadsPerHost`. The key is the host name (such as `images.example.com`), or the host suffix pattern (such as `*.example.com`, which matches `example.com` as well). The exact host name wins, then the longest pattern.
+ * Defaults to nil.
+ */
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSNumber *> *maxConcurrentDownloadsForHosts;
+
+/**
+ * The maximum number of pending downloads for each host. When exceeded, the pending download which would start last (lowest priority, or by `executionOrder`) is cancelled, the completion block receive the error code `SDWebImageErrorCancelled`.
+ * Defaults to 0, which means no limit.
+ */
+@property (nonatomic, assign) NSInteger maxPendingDownloadsPerHost;
+
+/**
+ * The controller to adjust the maximum number of concurrent downloads at runtime, by the metrics of finished downloads. The `maxConcurrentDownloads` is used as the initial value, and setting it again resets the current value.
+ * You can use `SDWebImageDownloaderAIMDConcurrencyController`, or provide your own.
+ * Defaults to nil, which means the `maxConcurrentDownloads` is always used.
+ * @note The controller is shared (not copied) in `copyWithZone:`, and the adjusted value does not write back to `maxConcurrentDownloads`.
+ */
+@property (nonatomic, strong, nullable) id<SDWebImageDownloaderConcurrencyController> concurrencyController;
+
+/**
+ * Whether to aggregate the metrics of finished downloads into `SDWebImageDownloader.metricsCollector`, by host and content type.
+ * Defaults to NO.
+ */
+@property (nonatomic, assign) BOOL shouldCollectMetrics;
+
+/**
+ * The interval (in seconds) to report the aggregated metrics to `SDWebImageDownloader.metricsDelegate`. Each report starts a new window of metrics.
+ * Defaults to 60.0. 0 or negative value means no periodic report.
+ * @note This property does not support dynamic changes after the delegate is set.
+ */
+@property (nonatomic, assign) NSTimeInterval metricsReportInterval;
+
+/**
+ * The maximum total bytes of partial bodies kept in memory, to resume the cancelled or failed downloads. The next download of the same URL requests the remaining bytes with `Range` and `If-Range` header, if the response has a strong `ETag` or `Last-Modified` header.
+ * Defaults to 0, which means no partial body is kept in memory.
+ * @note This property does not support dynamic changes, means it's immutable after the downloader instance initialized.
+ */
+@property (nonatomic, assign) NSUInteger maxResumableDataMemorySize;
+
+/**
+ * The maximum total bytes of partial bodies kept on disk, in the `com.hackemist.SDWebImageDownloader/Partial` directory under the user caches directory. The least recently written ones are removed first.
+ * Defaults to 0, which means no partial body is kept on disk.
+ * @note This property does not support dynamic changes, means it's immutable after the downloader instance initialized.
+ */
+@property (nonatomic, assign) NSUInteger maxResumableDataDiskSize;
+
+/**
+ * The minimum bytes of partial body to keep, the smaller one is cheaper to download again.
+ * Defaults to 256KB.
+ */
+@property (nonatomic, assign) NSUInteger minimumResumableDataSize;
+
 /**
  * The timeout value (in seconds) for each download operation.
  * Defaults to 15.0.
@@ -72,7 +132,7 @@ typedef NS_ENUM(NSInteger, SDWebImageDownloaderExecutionOrder) {
 @property (nonatomic, assign, nullable) Class operationClass;
 
 /**
- * Changes download operations execution order.
+ * Changes download operations execution order, for the operations with the same priority (See `SDWebImageDownloadToken.priority`) of the same host. The different hosts are served in round-robin.
  * Defaults to `SDWebImageDownloaderFIFOExecutionOrder`.
  */
 @property (nonatomic, assign) SDWebImageDownloaderExecutionOrder executionOrder;
@@ -26,6 +26,8 @@ static SDWebImageDownloaderConfig * _defaultDownloaderConfig;
         _maxConcurrentDownloads = 6;
         _downloadTimeout = 15.0;
         _executionOrder = SDWebImageDownloaderFIFOExecutionOrder;
+        _metricsReportInterval = 60.0;
+        _minimumResumableDataSize = 256 * 1024;
         _acceptableStatusCodes = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(200, 100)];
     }
     return self;
@@ -34,6 +36,15 @@ static SDWebImageDownloaderConfig * _defaultDownloaderConfig;
 - (id)copyWithZone:(NSZone *)zone {
     SDWebImageDownloaderConfig *config = [[[self class] allocWithZone:zone] init];
     config.maxConcurrentDownloads = self.maxConcurrentDownloads;
+    config.maxConcurrentDownloadsPerHost = self.maxConcurrentDownloadsPerHost;
+    config.maxConcurrentDownloadsForHosts = self.maxConcurrentDownloadsForHosts;
+    config.maxPendingDownloadsPerHost = self.maxPendingDownloadsPerHost;
+    config.concurrencyController = self.concurrencyController;
+    config.shouldCollectMetrics = self.shouldCollectMetrics;
+    config.metricsReportInterval = self.metricsReportInterval;
+    config.maxResumableDataMemorySize = self.maxResumableDataMemorySize;
+    config.maxResumableDataDiskSize = self.maxResumableDataDiskSize;
+    config.minimumResumableDataSize = self.minimumResumableDataSize;
     config.downloadTimeout = self.downloadTimeout;
     config.minimumProgressInterval = self.minimumProgressInterval;
     config.sessionConfiguration = [self.sessionConfiguration copyWithZone:zone];
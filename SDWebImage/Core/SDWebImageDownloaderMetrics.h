@@ -0,0 +1,111 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+/**
+ A histogram of durations with fixed exponential buckets. The upper bounds of buckets are 1ms, 2ms, 4ms ... 16384ms, and the last bucket is unbounded. Recording a duration is O(1) without allocation.
+ */
+@interface SDWebImageLatencyHistogram : NSObject <NSCopying>
+
+/// The upper bounds of buckets in seconds, the last one is `DBL_MAX`.
+@property (nonatomic, class, readonly, nonnull) NSArray<NSNumber *> *bucketUpperBounds;
+/// The number of durations in each bucket, the same count as `bucketUpperBounds`.
+@property (nonatomic, copy, readonly, nonnull) NSArray<NSNumber *> *bucketCounts;
+/// The number of durations.
+@property (nonatomic, assign, readonly) NSUInteger count;
+/// The sum of durations, in seconds.
+@property (nonatomic, assign, readonly) NSTimeInterval totalDuration;
+/// The mean of durations, in seconds, or 0 if empty.
+@property (nonatomic, assign, readonly) NSTimeInterval meanDuration;
+
+/// Return the upper bound of the bucket which contains the percentile, such as 0.5 for median and 0.95 for p95. Return 0 if empty, or the largest duration for the unbounded bucket.
+/// @param percentile The percentile, should be 0.0-1.0
+- (NSTimeInterval)durationAtPercentile:(double)percentile;
+
+@end
+
+/**
+ The aggregated metrics of downloads, such as the downloads of one host or one content type.
+ */
+@interface SDWebImageDownloaderMetricsGroup : NSObject <NSCopying>
+
+/// The number of finished (not cancelled) downloads.
+@property (nonatomic, assign, readonly) NSUInteger requestCount;
+/// The number of downloads failed by network error, or HTTP status code beyond [200, 400).
+@property (nonatomic, assign, readonly) NSUInteger errorCount;
+/// The number of downloads served by `NSURLCache`, or revalidated by HTTP 304.
+@property (nonatomic, assign, readonly) NSUInteger cacheHitCount;
+/// The number of received bytes.
+@property (nonatomic, assign, readonly) int64_t receivedBytes;
+/// `errorCount / requestCount`, or 0 if empty.
+@property (nonatomic, assign, readonly) double errorRate;
+/// `cacheHitCount / requestCount`, or 0 if empty.
+@property (nonatomic, assign, readonly) double cacheHitRatio;
+/// The received bytes per second of the response bodies, or 0 if unknown.
+@property (nonatomic, assign, readonly) double bytesPerSecond;
+
+/// The DNS lookup durations. The reused connections are not counted.
+@property (nonatomic, copy, readonly, nonnull) SDWebImageLatencyHistogram *domainLookupHistogram;
+/// The connection durations, including TLS. The reused connections are not counted.
+@property (nonatomic, copy, readonly, nonnull) SDWebImageLatencyHistogram *connectHistogram;
+/// The TLS handshake durations. The reused connections and plain HTTP are not counted.
+@property (nonatomic, copy, readonly, nonnull) SDWebImageLatencyHistogram *secureConnectionHistogram;
+/// The time to first byte, from the request start to the response start.
+@property (nonatomic, copy, readonly, nonnull) SDWebImageLatencyHistogram *timeToFirstByteHistogram;
+/// The transfer durations, from the response start to the response end.
+@property (nonatomic, copy, readonly, nonnull) SDWebImageLatencyHistogram *transferHistogram;
+
+@end
+
+/**
+ The immutable snapshot of aggregated metrics in a time window.
+ */
+@interface SDWebImageDownloaderMetricsSnapshot : NSObject
+
+/// The start date of the window.
+@property (nonatomic, strong, readonly, nonnull) NSDate *startDate;
+/// The end date of the window, which is the date the snapshot is taken.
+@property (nonatomic, strong, readonly, nonnull) NSDate *endDate;
+/// The metrics of all the downloads.
+@property (nonatomic, copy, readonly, nonnull) SDWebImageDownloaderMetricsGroup *totalMetrics;
+/// The metrics for each lowercase URL host.
+@property (nonatomic, copy, readonly, nonnull) NSDictionary<NSString *, SDWebImageDownloaderMetricsGroup *> *hostMetrics;
+/// The metrics for each lowercase response MIME type, such as `image/webp`.
+@property (nonatomic, copy, readonly, nonnull) NSDictionary<NSString *, SDWebImageDownloaderMetricsGroup *> *contentTypeMetrics;
+
+@end
+
+/// The group key for the hosts or content types beyond `maxGroupCount`.
+FOUNDATION_EXPORT NSString * _Nonnull const SDWebImageDownloaderMetricsOtherGroupKey;
+
+/**
+ The collector to aggregate the `NSURLSessionTaskMetrics` of downloads by host and content type. It keeps only the counters and histograms, not the metrics objects, so it's cheap to keep on in production.
+ All the methods are thread-safe.
+ */
+@interface SDWebImageDownloaderMetricsCollector : NSObject
+
+/// The maximum number of hosts (and content types), the others are aggregated into `SDWebImageDownloaderMetricsOtherGroupKey`. Defaults to 64.
+@property (nonatomic, assign) NSUInteger maxGroupCount;
+
+/// Record the finished task with its metrics. The cancelled task is ignored.
+/// @param task The finished task
+/// @param metrics The task metrics
+- (void)recordTask:(nonnull NSURLSessionTask *)task metrics:(nonnull NSURLSessionTaskMetrics *)metrics API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
+
+/// Return the snapshot of current window.
+- (nonnull SDWebImageDownloaderMetricsSnapshot *)snapshot;
+
+/// Return the snapshot of current window, and start a new window.
+- (nonnull SDWebImageDownloaderMetricsSnapshot *)snapshotByResetting;
+
+/// Remove all the aggregated metrics, and start a new window.
+- (void)reset;
+
+@end
@@ -0,0 +1,337 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageDownloaderMetrics.h"
+#import "SDInternalMacros.h"
+
+NSString * const SDWebImageDownloaderMetricsOtherGroupKey = @"*";
+
+#define SD_LATENCY_HISTOGRAM_BUCKET_COUNT 16
+
+static inline NSTimeInterval SDTimeIntervalBetweenDates(NSDate *startDate, NSDate *endDate) {
+    if (!startDate || !endDate) {
+        return -1;
+    }
+    return [endDate timeIntervalSinceDate:startDate];
+}
+
+@interface SDWebImageLatencyHistogram () {
+    NSUInteger _buckets[SD_LATENCY_HISTOGRAM_BUCKET_COUNT];
+}
+
+@property (nonatomic, assign, readwrite) NSUInteger count;
+@property (nonatomic, assign, readwrite) NSTimeInterval totalDuration;
+@property (nonatomic, assign) NSTimeInterval maxDuration;
+
+- (void)addDuration:(NSTimeInterval)duration;
+
+@end
+
+@implementation SDWebImageLatencyHistogram
+
++ (NSArray<NSNumber *> *)bucketUpperBounds {
+    static NSArray<NSNumber *> *bucketUpperBounds;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray<NSNumber *> *bounds = [NSMutableArray arrayWithCapacity:SD_LATENCY_HISTOGRAM_BUCKET_COUNT];
+        for (NSUInteger i = 0; i < SD_LATENCY_HISTOGRAM_BUCKET_COUNT - 1; i++) {
+            [bounds addObject:@(ldexp(0.001, (int)i))];
+        }
+        [bounds addObject:@(DBL_MAX)];
+        bucketUpperBounds = [bounds copy];
+    });
+    return bucketUpperBounds;
+}
+
+- (NSArray<NSNumber *> *)bucketCounts {
+    NSMutableArray<NSNumber *> *bucketCounts = [NSMutableArray arrayWithCapacity:SD_LATENCY_HISTOGRAM_BUCKET_COUNT];
+    for (NSUInteger i = 0; i < SD_LATENCY_HISTOGRAM_BUCKET_COUNT; i++) {
+        [bucketCounts addObject:@(_buckets[i])];
+    }
+    return [bucketCounts copy];
+}
+
+- (NSTimeInterval)meanDuration {
+    if (self.count == 0) {
+        return 0;
+    }
+    return self.totalDuration / self.count;
+}
+
+- (NSTimeInterval)durationAtPercentile:(double)percentile {
+    if (self.count == 0) {
+        return 0;
+    }
+    percentile = MIN(MAX(percentile, 0), 1);
+    NSUInteger rank = MAX((NSUInteger)ceil(percentile * self.count), 1);
+    NSUInteger accumulated = 0;
+    for (NSUInteger i = 0; i < SD_LATENCY_HISTOGRAM_BUCKET_COUNT - 1; i++) {
+        accumulated += _buckets[i];
+        if (accumulated >= rank) {
+            return MIN(ldexp(0.001, (int)i), self.maxDuration);
+        }
+    }
+    return self.maxDuration;
+}
+
+- (void)addDuration:(NSTimeInterval)duration {
+    if (duration < 0) {
+        return;
+    }
+    // The bucket index is the exponent of milliseconds, rounded up
+    NSUInteger index = 0;
+    double milliseconds = duration * 1000;
+    if (milliseconds > 1) {
+        index = MIN((NSUInteger)ceil(log2(milliseconds)), SD_LATENCY_HISTOGRAM_BUCKET_COUNT - 1);
+    }
+    _buckets[index]++;
+    self.count++;
+    self.totalDuration += duration;
+    self.maxDuration = MAX(self.maxDuration, duration);
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    SDWebImageLatencyHistogram *histogram = [[[self class] allocWithZone:zone] init];
+    memcpy(histogram->_buckets, _buckets, sizeof(_buckets));
+    histogram.count = self.count;
+    histogram.totalDuration = self.totalDuration;
+    histogram.maxDuration = self.maxDuration;
+    return histogram;
+}
+
+@end
+
+@interface SDWebImageDownloaderMetricsGroup ()
+
+@property (nonatomic, assign, readwrite) NSUInteger requestCount;
+@property (nonatomic, assign, readwrite) NSUInteger errorCount;
+@property (nonatomic, assign, readwrite) NSUInteger cacheHitCount;
+@property (nonatomic, assign, readwrite) int64_t receivedBytes;
+@property (nonatomic, assign) NSTimeInterval transferDuration; // sum of the transfers which have received bytes
+@property (nonatomic, copy, readwrite, nonnull) SDWebImageLatencyHistogram *domainLookupHistogram;
+@property (nonatomic, copy, readwrite, nonnull) SDWebImageLatencyHistogram *connectHistogram;
+@property (nonatomic, copy, readwrite, nonnull) SDWebImageLatencyHistogram *secureConnectionHistogram;
+@property (nonatomic, copy, readwrite, nonnull) SDWebImageLatencyHistogram *timeToFirstByteHistogram;
+@property (nonatomic, copy, readwrite, nonnull) SDWebImageLatencyHistogram *transferHistogram;
+
+- (void)recordTransactionMetrics:(nullable NSURLSessionTaskTransactionMetrics *)transactionMetrics receivedBytes:(int64_t)receivedBytes failed:(BOOL)failed cacheHit:(BOOL)cacheHit API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0));
+
+@end
+
+@implementation SDWebImageDownloaderMetricsGroup
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _domainLookupHistogram = [SDWebImageLatencyHistogram new];
+        _connectHistogram = [SDWebImageLatencyHistogram new];
+        _secureConnectionHistogram = [SDWebImageLatencyHistogram new];
+        _timeToFirstByteHistogram = [SDWebImageLatencyHistogram new];
+        _transferHistogram = [SDWebImageLatencyHistogram new];
+    }
+    return self;
+}
+
+- (double)errorRate {
+    if (self.requestCount == 0) {
+        return 0;
+    }
+    return (double)self.errorCount / self.requestCount;
+}
+
+- (double)cacheHitRatio {
+    if (self.requestCount == 0) {
+        return 0;
+    }
+    return (double)self.cacheHitCount / self.requestCount;
+}
+
+- (double)bytesPerSecond {
+    if (self.transferDuration <= 0) {
+        return 0;
+    }
+    return self.receivedBytes / self.transferDuration;
+}
+
+- (void)recordTransactionMetrics:(nullable NSURLSessionTaskTransactionMetrics *)transactionMetrics receivedBytes:(int64_t)receivedBytes failed:(BOOL)failed cacheHit:(BOOL)cacheHit API_AVAILABLE(macosx(10.12), ios(10.0), watchos(3.0), tvos(10.0)) {
+    self.requestCount++;
+    if (failed) {
+        self.errorCount++;
+    }
+    if (cacheHit) {
+        self.cacheHitCount++;
+    }
+    self.receivedBytes += receivedBytes;
+    if (!transactionMetrics) {
+        return;
+    }
+    // The mutable histograms are only held by group, and copied for snapshot
+    [_domainLookupHistogram addDuration:SDTimeIntervalBetweenDates(transactionMetrics.domainLookupStartDate, transactionMetrics.domainLookupEndDate)];
+    [_connectHistogram addDuration:SDTimeIntervalBetweenDates(transactionMetrics.connectStartDate, transactionMetrics.connectEndDate)];
+    [_secureConnectionHistogram addDuration:SDTimeIntervalBetweenDates(transactionMetrics.secureConnectionStartDate, transactionMetrics.secureConnectionEndDate)];
+    [_timeToFirstByteHistogram addDuration:SDTimeIntervalBetweenDates(transactionMetrics.requestStartDate, transactionMetrics.responseStartDate)];
+    NSTimeInterval transferDuration = SDTimeIntervalBetweenDates(transactionMetrics.responseStartDate, transactionMetrics.responseEndDate);
+    [_transferHistogram addDuration:transferDuration];
+    if (transferDuration > 0 && receivedBytes > 0) {
+        self.transferDuration += transferDuration;
+    }
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    SDWebImageDownloaderMetricsGroup *group = [[[self class] allocWithZone:zone] init];
+    group.requestCount = self.requestCount;
+    group.errorCount = self.errorCount;
+    group.cacheHitCount = self.cacheHitCount;
+    group.receivedBytes = self.receivedBytes;
+    group.transferDuration = self.transferDuration;
+    group.domainLookupHistogram = self.domainLookupHistogram;
+    group.connectHistogram = self.connectHistogram;
+    group.secureConnectionHistogram = self.secureConnectionHistogram;
+    group.timeToFirstByteHistogram = self.timeToFirstByteHistogram;
+    group.transferHistogram = self.transferHistogram;
+    return group;
+}
+
+@end
+
+@interface SDWebImageDownloaderMetricsSnapshot ()
+
+@property (nonatomic, strong, readwrite, nonnull) NSDate *startDate;
+@property (nonatomic, strong, readwrite, nonnull) NSDate *endDate;
+@property (nonatomic, copy, readwrite, nonnull) SDWebImageDownloaderMetricsGroup *totalMetrics;
+@property (nonatomic, copy, readwrite, nonnull) NSDictionary<NSString *, SDWebImageDownloaderMetricsGroup *> *hostMetrics;
+@property (nonatomic, copy, readwrite, nonnull) NSDictionary<NSString *, SDWebImageDownloaderMetricsGroup *> *contentTypeMetrics;
+
+@end
+
+@implementation SDWebImageDownloaderMetricsSnapshot
+@end
+
+@interface SDWebImageDownloaderMetricsCollector () {
+    SD_LOCK_DECLARE(_lock); // A lock to keep the access to groups thread-safe
+}
+
+@property (nonatomic, strong, nonnull) NSDate *startDate;
+@property (nonatomic, strong, nonnull) SDWebImageDownloaderMetricsGroup *totalMetrics;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDWebImageDownloaderMetricsGroup *> *hostMetrics;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDWebImageDownloaderMetricsGroup *> *contentTypeMetrics;
+
+@end
+
+@implementation SDWebImageDownloaderMetricsCollector
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _maxGroupCount = 64;
+        _startDate = [NSDate date];
+        _totalMetrics = [SDWebImageDownloaderMetricsGroup new];
+        _hostMetrics = [NSMutableDictionary dictionary];
+        _contentTypeMetrics = [NSMutableDictionary dictionary];
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+- (void)recordTask:(NSURLSessionTask *)task metrics:(NSURLSessionTaskMetrics *)metrics {
+    NSError *error = task.error;
+    if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled) {
+        return;
+    }
+    NSURLSessionTaskTransactionMetrics *transactionMetrics = metrics.transactionMetrics.lastObject;
+    NSURLResponse *response = task.response;
+    BOOL failed = error != nil;
+    BOOL cacheHit = transactionMetrics.resourceFetchType == NSURLSessionTaskMetricsResourceFetchTypeLocalCache;
+    if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+        NSInteger statusCode = ((NSHTTPURLResponse *)response).statusCode;
+        if (statusCode == 304) {
+            cacheHit = YES;
+        } else if (statusCode < 200 || statusCode >= 400) {
+            failed = YES;
+        }
+    }
+    int64_t receivedBytes = task.countOfBytesReceived;
+    NSString *host = (task.originalRequest.URL.host ?: task.currentRequest.URL.host).lowercaseString ?: @"";
+    NSString *contentType = response.MIMEType.lowercaseString ?: @"";
+    
+    SD_LOCK(_lock);
+    [self.totalMetrics recordTransactionMetrics:transactionMetrics receivedBytes:receivedBytes failed:failed cacheHit:cacheHit];
+    [[self groupForKey:host inGroups:self.hostMetrics] recordTransactionMetrics:transactionMetrics receivedBytes:receivedBytes failed:failed cacheHit:cacheHit];
+    [[self groupForKey:contentType inGroups:self.contentTypeMetrics] recordTransactionMetrics:transactionMetrics receivedBytes:receivedBytes failed:failed cacheHit:cacheHit];
+    SD_UNLOCK(_lock);
+}
+
+- (SDWebImageDownloaderMetricsSnapshot *)snapshot {
+    SD_LOCK(_lock);
+    SDWebImageDownloaderMetricsSnapshot *snapshot = [self currentSnapshot];
+    SD_UNLOCK(_lock);
+    return snapshot;
+}
+
+- (SDWebImageDownloaderMetricsSnapshot *)snapshotByResetting {
+    SD_LOCK(_lock);
+    SDWebImageDownloaderMetricsSnapshot *snapshot = [self currentSnapshot];
+    [self resetGroupsWithDate:snapshot.endDate];
+    SD_UNLOCK(_lock);
+    return snapshot;
+}
+
+- (void)reset {
+    SD_LOCK(_lock);
+    [self resetGroupsWithDate:[NSDate date]];
+    SD_UNLOCK(_lock);
+}
+
+#pragma mark - Helper
+
+// Call with lock held
+- (SDWebImageDownloaderMetricsGroup *)groupForKey:(NSString *)key inGroups:(NSMutableDictionary<NSString *, SDWebImageDownloaderMetricsGroup *> *)groups {
+    SDWebImageDownloaderMetricsGroup *group = groups[key];
+    if (!group) {
+        // Keep the memory bounded with the random hosts
+        if (groups.count >= MAX(self.maxGroupCount, 1)) {
+            key = SDWebImageDownloaderMetricsOtherGroupKey;
+            group = groups[key];
+        }
+        if (!group) {
+            group = [SDWebImageDownloaderMetricsGroup new];
+            groups[key] = group;
+        }
+    }
+    return group;
+}
+
+// Call with lock held
+- (SDWebImageDownloaderMetricsSnapshot *)currentSnapshot {
+    SDWebImageDownloaderMetricsSnapshot *snapshot = [SDWebImageDownloaderMetricsSnapshot new];
+    snapshot.startDate = self.startDate;
+    snapshot.endDate = [NSDate date];
+    snapshot.totalMetrics = self.totalMetrics;
+    // Deep copy, the groups are mutated after snapshot
+    NSMutableDictionary<NSString *, SDWebImageDownloaderMetricsGroup *> *hostMetrics = [NSMutableDictionary dictionaryWithCapacity:self.hostMetrics.count];
+    [self.hostMetrics enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, SDWebImageDownloaderMetricsGroup * _Nonnull group, BOOL * _Nonnull stop) {
+        hostMetrics[key] = [group copy];
+    }];
+    snapshot.hostMetrics = hostMetrics;
+    NSMutableDictionary<NSString *, SDWebImageDownloaderMetricsGroup *> *contentTypeMetrics = [NSMutableDictionary dictionaryWithCapacity:self.contentTypeMetrics.count];
+    [self.contentTypeMetrics enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, SDWebImageDownloaderMetricsGroup * _Nonnull group, BOOL * _Nonnull stop) {
+        contentTypeMetrics[key] = [group copy];
+    }];
+    snapshot.contentTypeMetrics = contentTypeMetrics;
+    return snapshot;
+}
+
+// Call with lock held
+- (void)resetGroupsWithDate:(NSDate *)date {
+    self.startDate = date;
+    self.totalMetrics = [SDWebImageDownloaderMetricsGroup new];
+    [self.hostMetrics removeAllObjects];
+    [self.contentTypeMetrics removeAllObjects];
+}
+
+@end
@@ -7,10 +7,15 @@
  */
 
 #import "SDWebImageDownloaderOperation.h"
+#import "SDWebImageDownloaderOperationInternal.h"
 #import "SDWebImageError.h"
 #import "SDInternalMacros.h"
 #import "SDWebImageDownloaderResponseModifier.h"
 #import "SDWebImageDownloaderDecryptor.h"
+#import "SDWebImageDownloaderDataBuffer.h"
+#import "SDDownloadedFile.h"
+#import <fcntl.h>
+#import <unistd.h>
 
 static NSString *const kProgressCallbackKey = @"progress";
 static NSString *const kCompletedCallbackKey = @"completed";
@@ -26,7 +31,7 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
 
 @property (assign, nonatomic, getter = isExecuting) BOOL executing;
 @property (assign, nonatomic, getter = isFinished) BOOL finished;
-@property (strong, nonatomic, nullable) NSMutableData *imageData;
+@property (strong, nonatomic, nullable) SDWebImageDownloaderDataBuffer *imageData;
 @property (copy, nonatomic, nullable) NSData *cachedData; // for `SDWebImageDownloaderIgnoreCachedResponse`
 @property (assign, nonatomic) NSUInteger expectedSize; // may be 0
 @property (assign, nonatomic) NSUInteger receivedSize;
@@ -37,6 +42,11 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
 @property (strong, nonatomic, nullable) id<SDWebImageDownloaderResponseModifier> responseModifier; // modify original URLResponse
 @property (strong, nonatomic, nullable) id<SDWebImageDownloaderDecryptor> decryptor; // decrypt image data
 
+@property (copy, nonatomic, nullable) NSString *destinationPath; // stream the received data into a temporary file in the directory of this path
+@property (copy, nonatomic, nullable) NSString *temporaryPath; // the temporary file during streaming
+@property (assign, nonatomic) int temporaryFileDescriptor;
+@property (strong, nonatomic, nullable) SDWebImageDownloaderResumeData *resumeData; // the partial body requested to resume
+
 // This is weak because it is injected by whoever manages this session. If this gets nil-ed out, we won't be able to run
 // the task associated with this operation
 @property (weak, nonatomic, nullable) NSURLSession *unownedSession;
@@ -78,6 +88,11 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
         _callbackBlocks = [NSMutableArray new];
         _responseModifier = context[SDWebImageContextDownloadResponseModifier];
         _decryptor = context[SDWebImageContextDownloadDecryptor];
+        // Streaming write the raw data, which can not be decrypted
+        if (!_decryptor && [context[SDWebImageContextDownloadDestinationPath] isKindOfClass:[NSString class]]) {
+            _destinationPath = [context[SDWebImageContextDownloadDestinationPath] copy];
+        }
+        _temporaryFileDescriptor = -1;
         _executing = NO;
         _finished = NO;
         _expectedSize = 0;
@@ -142,6 +157,8 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
 }
 
 - (void)start {
+    // The resume data lookup may touch the disk, do it before taking the lock
+    SDWebImageDownloaderResumeData *resumeData = [self resumeDataForRequest];
     @synchronized (self) {
         if (self.isCancelled) {
             if (!self.isFinished) self.finished = YES;
@@ -202,7 +219,7 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
             return;
         }
         
-        self.dataTask = [session dataTaskWithRequest:self.request];
+        self.dataTask = [session dataTaskWithRequest:[self requestByResumingWithResumeData:resumeData]];
         self.executing = YES;
     }
 
@@ -252,6 +269,8 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
         [self.dataTask cancel];
         self.dataTask = nil;
     }
+    // Keep the received data, the next download of same URL can resume from it
+    [self storeResumeData];
     
     // NSOperation disallow setFinished=YES **before** operation's start method been called
     // We check for the initialized status, which is isExecuting == NO && isFinished = NO
@@ -277,6 +296,8 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
     @synchronized (self) {
         [self.callbackBlocks removeAllObjects];
         self.dataTask = nil;
+        // Remove the temporary file when cancelled or failed
+        [self closeTemporaryFileAndRemove:YES];
         
         if (self.ownedSession) {
             [self.ownedSession invalidateAndCancel];
@@ -332,14 +353,33 @@ didReceiveResponse:(NSURLResponse *)response
     
     NSInteger expected = (NSInteger)response.expectedContentLength;
     expected = expected > 0 ? expected : 0;
-    self.expectedSize = expected;
     self.response = response;
     
     // Check status code valid (defaults [200,400))
     NSInteger statusCode = [response isKindOfClass:NSHTTPURLResponse.class] ? ((NSHTTPURLResponse *)response).statusCode : 0;
+    // Check the resumed range, the server responds the full body with 200 if the `If-Range` does not match
+    NSData *resumedData;
+    if (valid && self.resumeData) {
+        int64_t rangeStart = [SDWebImageDownloaderResumeData rangeStartWithResponse:response];
+        if (rangeStart >= 0 && rangeStart == (int64_t)self.resumeData.data.length) {
+            resumedData = self.resumeData.data;
+            expected = expected > 0 ? expected + resumedData.length : 0;
+        } else if (rangeStart >= 0) {
+            valid = NO;
+            self.responseError = [NSError errorWithDomain:SDWebImageErrorDomain
+                                                     code:SDWebImageErrorInvalidDownloadStatusCode
+                                                 userInfo:@{NSLocalizedDescriptionKey : @"Download marked as failed because the partial response does not match the resumed data",
+                                                            SDWebImageErrorDownloadStatusCodeKey : @(statusCode),
+                                                            SDWebImageErrorDownloadResponseKey : response}];
+        }
+        // The partial data is held by operation now, and stored again if cancelled
+        [self.resumeDataStore removeResumeDataForURL:self.request.URL];
+        self.resumeData = nil;
+    }
+    self.expectedSize = expected;
     BOOL statusCodeValid = YES;
     if (valid && statusCode > 0 && self.acceptableStatusCodes) {
-        statusCodeValid = [self.acceptableStatusCodes containsIndex:statusCode];
+        statusCodeValid = [self.acceptableStatusCodes containsIndex:statusCode] || (resumedData && statusCode == 206);
     }
     if (!statusCodeValid) {
         valid = NO;
@@ -374,8 +414,17 @@ didReceiveResponse:(NSURLResponse *)response
     }
     
     if (valid) {
+        if (self.destinationPath) {
+            @synchronized (self) {
+                [self openTemporaryFile];
+            }
+        }
+        if (resumedData) {
+            [self appendReceivedData:resumedData];
+            self.receivedSize = resumedData.length;
+        }
         for (SDWebImageDownloaderProgressBlock progressBlock in [self callbacksForKey:kProgressCallbackKey]) {
-            progressBlock(0, expected, self.request.URL);
+            progressBlock(self.receivedSize, expected, self.request.URL);
         }
     } else {
         // Status code invalid and marked as cancelled. Do not call `[self.dataTask cancel]` which may mass up URLSession life cycle
@@ -392,12 +441,9 @@ didReceiveResponse:(NSURLResponse *)response
 }
 
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
-    if (!self.imageData) {
-        self.imageData = [[NSMutableData alloc] initWithCapacity:self.expectedSize];
-    }
-    [self.imageData appendData:data];
+    [self appendReceivedData:data];
     
-    self.receivedSize = self.imageData.length;
+    self.receivedSize += data.length;
     if (self.expectedSize == 0) {
         // Unknown expectedSize, immediately call progressBlock and return
         for (SDWebImageDownloaderProgressBlock progressBlock in [self callbacksForKey:kProgressCallbackKey]) {
@@ -422,11 +468,15 @@ didReceiveResponse:(NSURLResponse *)response
     BOOL supportProgressive = (self.options & SDWebImageDownloaderProgressiveLoad) && !self.decryptor;
     // Progressive decoding Only decode partial image, full image in `URLSession:task:didCompleteWithError:`
     if (supportProgressive && !finished) {
-        // Get the image data
-        NSData *imageData = self.imageData;
-        
         // keep maximum one progressive decode process during download
         if (self.coderQueue.operationCount == 0) {
+            // Get the image data, only flatten the received chunks when we really decode
+            NSData *imageData;
+            if (self.temporaryPath) {
+                imageData = [NSData dataWithContentsOfFile:self.temporaryPath options:NSDataReadingMappedIfSafe error:nil];
+            } else {
+                imageData = [self.imageData data];
+            }
             // NSOperation have autoreleasepool, don't need to create extra one
             @weakify(self);
             [self.coderQueue addOperationWithBlock:^{
@@ -487,12 +537,24 @@ didReceiveResponse:(NSURLResponse *)response
         // custom error instead of URLSession error
         if (self.responseError) {
             error = self.responseError;
+        } else {
+            // Network error such as connection lost, keep the received data to resume
+            @synchronized (self) {
+                [self storeResumeData];
+            }
         }
         [self callCompletionBlocksWithError:error];
         [self done];
     } else {
         if ([self callbacksForKey:kCompletedCallbackKey].count > 0) {
-            NSData *imageData = self.imageData;
+            NSData *imageData;
+            if (self.temporaryPath) {
+                @synchronized (self) {
+                    imageData = [self finishTemporaryFile];
+                }
+            } else {
+                imageData = [self.imageData data];
+            }
             self.imageData = nil;
             // data decryptor
             if (imageData && self.decryptor) {
@@ -508,6 +570,7 @@ didReceiveResponse:(NSURLResponse *)response
                                                          userInfo:@{NSLocalizedDescriptionKey : @"Downloaded image is not modified and ignored",
                                                                     SDWebImageErrorDownloadResponseKey : self.response}];
                     // call completion block with not modified error
+                    SDDownloadedFileDataRemove(imageData);
                     [self callCompletionBlocksWithError:self.responseError];
                     [self done];
                 } else {
@@ -530,6 +593,8 @@ didReceiveResponse:(NSURLResponse *)response
                         CGSize imageSize = image.size;
                         if (imageSize.width == 0 || imageSize.height == 0) {
                             NSString *description = image == nil ? @"Downloaded image decode failed" : @"Downloaded image has 0 pixels";
+                            // Do not leave the invalid data in the cache directory
+                            SDDownloadedFileDataRemove(imageData);
                             [self callCompletionBlocksWithError:[NSError errorWithDomain:SDWebImageErrorDomain code:SDWebImageErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : description}]];
                         } else {
                             [self callCompletionBlocksWithImage:image imageData:imageData error:nil finished:YES];
@@ -583,6 +648,167 @@ didReceiveResponse:(NSURLResponse *)response
     self.metrics = metrics;
 }
 
+#pragma mark Resuming
+
+// Call without lock held, this may read the disk. Return the partial data for URL if the request can be resumed
+- (nullable SDWebImageDownloaderResumeData *)resumeDataForRequest {
+    NSURLRequest *request = self.request;
+    SDWebImageDownloaderResumeDataStore *resumeDataStore = self.resumeDataStore;
+    if (!resumeDataStore || !request.URL) {
+        return nil;
+    }
+    // Do not mess up the custom range request
+    NSString *method = request.HTTPMethod ?: @"GET";
+    if (![method isEqualToString:@"GET"] || [request valueForHTTPHeaderField:@"Range"]) {
+        return nil;
+    }
+    SDWebImageDownloaderResumeData *resumeData = [resumeDataStore resumeDataForURL:request.URL];
+    if (!resumeData.ifRangeValue) {
+        return nil;
+    }
+    return resumeData;
+}
+
+// Call with lock held. Return the request with `Range` and `If-Range` if there is partial data for URL
+- (nonnull NSURLRequest *)requestByResumingWithResumeData:(nullable SDWebImageDownloaderResumeData *)resumeData {
+    NSURLRequest *request = self.request;
+    if (!resumeData) {
+        return request;
+    }
+    self.resumeData = resumeData;
+    NSMutableURLRequest *mutableRequest = [request mutableCopy];
+    [resumeData applyToRequest:mutableRequest];
+    return [mutableRequest copy];
+}
+
+// Call with lock held. Store the received data, if the response allows resuming
+// The buffer is detached from operation, then flattened and persisted by the store in background, since the cancel usually happens on main queue or under the downloader lock
+- (void)storeResumeData {
+    SDWebImageDownloaderResumeDataStore *resumeDataStore = self.resumeDataStore;
+    NSURLResponse *response = self.response;
+    NSURL *url = self.request.URL;
+    if (!resumeDataStore || !response || !url || self.receivedSize == 0 || self.responseError) {
+        return;
+    }
+    NSUInteger expectedSize = self.expectedSize;
+    NSData *fileData;
+    SDWebImageDownloaderDataBuffer *buffer;
+    if (self.temporaryPath) {
+        // Map before the temporary file been removed, the mapping is still valid after that
+        fileData = [NSData dataWithContentsOfFile:self.temporaryPath options:NSDataReadingMappedIfSafe error:nil];
+    } else {
+        // The operation does not touch the buffer after this, so it's safe to flatten in another queue
+        buffer = self.imageData;
+        self.imageData = nil;
+    }
+    if (!fileData && !buffer) {
+        return;
+    }
+    [resumeDataStore setResumeDataForURL:url withBlock:^SDWebImageDownloaderResumeData * _Nullable{
+        NSData *data = fileData ?: [buffer data];
+        if (data.length == 0 || (expectedSize > 0 && data.length >= expectedSize)) {
+            return nil;
+        }
+        return [SDWebImageDownloaderResumeData resumeDataWithData:data response:response totalLength:expectedSize];
+    }];
+}
+
+#pragma mark Streaming
+
+// Write into the temporary file, or the memory buffer
+- (void)appendReceivedData:(nonnull NSData *)data {
+    // Lock to avoid the file descriptor been closed, or the buffer been read by `cancel` during writing
+    @synchronized (self) {
+        if (self.temporaryPath && [self writeTemporaryFileWithData:data]) {
+            return;
+        }
+        if (!self.imageData) {
+            self.imageData = [[SDWebImageDownloaderDataBuffer alloc] initWithCapacity:self.expectedSize];
+        }
+        [self.imageData appendData:data];
+    }
+}
+
+// Call with lock held
+- (void)openTemporaryFile {
+    if (self.temporaryPath) {
+        return;
+    }
+    NSString *directory = [self.destinationPath stringByDeletingLastPathComponent];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+    // Use hidden file name in the same directory, so the rename into disk cache is atomic and the disk cache enumeration skip the file in progress
+    NSString *temporaryPath = [directory stringByAppendingPathComponent:[NSString stringWithFormat:@".%@.download", [NSUUID UUID].UUIDString]];
+    int fd = open(temporaryPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        // Fallback to memory buffer
+        return;
+    }
+    self.temporaryPath = temporaryPath;
+    self.temporaryFileDescriptor = fd;
+}
+
+// Call with lock held
+- (BOOL)writeTemporaryFileWithData:(nonnull NSData *)data {
+    int fd = self.temporaryFileDescriptor;
+    if (fd < 0) {
+        return NO;
+    }
+    __block BOOL success = YES;
+    [data enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+        const uint8_t *buffer = bytes;
+        size_t remaining = byteRange.length;
+        while (remaining > 0) {
+            ssize_t length = write(fd, buffer, remaining);
+            if (length < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                success = NO;
+                *stop = YES;
+                return;
+            }
+            buffer += length;
+            remaining -= length;
+        }
+    }];
+    if (!success) {
+        // Disk full or other error, fallback to memory buffer with the data already written (exclude the partial written chunk)
+        NSData *writtenData = [NSData dataWithContentsOfFile:self.temporaryPath options:NSDataReadingMappedIfSafe error:nil];
+        [self closeTemporaryFileAndRemove:YES];
+        self.imageData = [[SDWebImageDownloaderDataBuffer alloc] initWithCapacity:self.expectedSize];
+        if (writtenData.length >= self.receivedSize && self.receivedSize > 0) {
+            [self.imageData appendData:[writtenData subdataWithRange:NSMakeRange(0, self.receivedSize)]];
+        }
+    }
+    return success;
+}
+
+// Call with lock held. Close the temporary file, return the memory-mapped data which owns the file. The file is moved into disk cache when the data is stored, or removed when the data is released.
+- (nullable NSData *)finishTemporaryFile {
+    NSString *temporaryPath = self.temporaryPath;
+    if (!temporaryPath) {
+        return nil;
+    }
+    [self closeTemporaryFileAndRemove:NO];
+    if (self.receivedSize == 0) {
+        [[NSFileManager defaultManager] removeItemAtPath:temporaryPath error:nil];
+        return nil;
+    }
+    return SDDownloadedFileDataWithPath(temporaryPath);
+}
+
+// Call with lock held
+- (void)closeTemporaryFileAndRemove:(BOOL)remove {
+    if (self.temporaryFileDescriptor >= 0) {
+        close(self.temporaryFileDescriptor);
+        self.temporaryFileDescriptor = -1;
+    }
+    if (self.temporaryPath && remove) {
+        [[NSFileManager defaultManager] removeItemAtPath:self.temporaryPath error:nil];
+    }
+    self.temporaryPath = nil;
+}
+
 #pragma mark Helper methods
 + (SDWebImageOptions)imageOptionsFromDownloaderOptions:(SDWebImageDownloaderOptions)downloadOptions {
     SDWebImageOptions options = 0;
@@ -17,6 +17,38 @@
 static id<SDImageCache> _defaultImageCache;
 static id<SDImageLoader> _defaultImageLoader;
 
+// The inputs of `cacheKeyForURL:context:`, used to memoize the generated cache key. Only the values are kept, not the objects which generate them
+@interface SDWebImageCacheKeySignature : NSObject
+
+@property (strong, nonatomic, nonnull) NSURL *url;
+@property (copy, nonatomic, nullable) NSString *transformerKey;
+@property (strong, nonatomic, nullable) NSValue *thumbnailSizeValue;
+@property (assign, nonatomic) BOOL preserveAspectRatio;
+
+@end
+
+@implementation SDWebImageCacheKeySignature
+
+- (NSUInteger)hash {
+    return self.url.hash ^ self.transformerKey.hash ^ self.thumbnailSizeValue.hash ^ self.preserveAspectRatio;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    if (![object isKindOfClass:[SDWebImageCacheKeySignature class]]) {
+        return NO;
+    }
+    SDWebImageCacheKeySignature *other = object;
+    return (other.transformerKey == self.transformerKey || [other.transformerKey isEqualToString:self.transformerKey])
+    && other.preserveAspectRatio == self.preserveAspectRatio
+    && (other.thumbnailSizeValue == self.thumbnailSizeValue || [other.thumbnailSizeValue isEqualToValue:self.thumbnailSizeValue])
+    && [other.url isEqual:self.url];
+}
+
+@end
+
 @interface SDWebImageCombinedOperation ()
 
 @property (assign, nonatomic, getter = isCancelled) BOOL cancelled;
@@ -35,6 +67,7 @@ static id<SDImageLoader> _defaultImageLoader;
 @property (strong, nonatomic, readwrite, nonnull) id<SDImageLoader> imageLoader;
 @property (strong, nonatomic, nonnull) NSMutableSet<NSURL *> *failedURLs;
 @property (strong, nonatomic, nonnull) NSMutableSet<SDWebImageCombinedOperation *> *runningOperations;
+@property (strong, nonatomic, nonnull) NSCache<SDWebImageCacheKeySignature *, NSString *> *cacheKeys;
 
 @end
 
@@ -91,6 +124,8 @@ static id<SDImageLoader> _defaultImageLoader;
         SD_LOCK_INIT(_failedURLsLock);
         _runningOperations = [NSMutableSet new];
         SD_LOCK_INIT(_runningOperationsLock);
+        _cacheKeys = [NSCache new];
+        _cacheKeys.countLimit = 1000;
     }
     return self;
 }
@@ -137,12 +172,41 @@ static id<SDImageLoader> _defaultImageLoader;
         return @"";
     }
     
-    NSString *key;
-    // Cache Key Filter
     id<SDWebImageCacheKeyFilter> cacheKeyFilter = self.cacheKeyFilter;
     if (context[SDWebImageContextCacheKeyFilter]) {
         cacheKeyFilter = context[SDWebImageContextCacheKeyFilter];
     }
+    NSValue *thumbnailSizeValue = context[SDWebImageContextImageThumbnailPixelSize];
+    BOOL preserveAspectRatio = YES;
+    NSNumber *preserveAspectRatioValue = context[SDWebImageContextImagePreserveAspectRatio];
+    if (preserveAspectRatioValue != nil) {
+        preserveAspectRatio = preserveAspectRatioValue.boolValue;
+    }
+    id<SDImageTransformer> transformer = self.transformer;
+    if (context[SDWebImageContextImageTransformer]) {
+        transformer = context[SDWebImageContextImageTransformer];
+        if (![transformer conformsToProtocol:@protocol(SDImageTransformer)]) {
+            transformer = nil;
+        }
+    }
+    NSString *transformerKey = transformer.transformerKey;
+    
+    // The cache key filter is arbitrary code without a stable key, do not memoize for it
+    SDWebImageCacheKeySignature *signature;
+    if (!cacheKeyFilter) {
+        signature = [SDWebImageCacheKeySignature new];
+        signature.url = url;
+        signature.transformerKey = transformerKey;
+        signature.thumbnailSizeValue = thumbnailSizeValue;
+        signature.preserveAspectRatio = thumbnailSizeValue != nil && preserveAspectRatio;
+        NSString *key = [self.cacheKeys objectForKey:signature];
+        if (key) {
+            return key;
+        }
+    }
+    
+    NSString *key;
+    // Cache Key Filter
     if (cacheKeyFilter) {
         key = [cacheKeyFilter cacheKeyForURL:url];
     } else {
@@ -150,7 +214,6 @@ static id<SDImageLoader> _defaultImageLoader;
     }
     
     // Thumbnail Key Appending
-    NSValue *thumbnailSizeValue = context[SDWebImageContextImageThumbnailPixelSize];
     if (thumbnailSizeValue != nil) {
         CGSize thumbnailSize = CGSizeZero;
 #if SD_MAC
@@ -158,26 +221,17 @@ static id<SDImageLoader> _defaultImageLoader;
 #else
         thumbnailSize = thumbnailSizeValue.CGSizeValue;
 #endif
-        BOOL preserveAspectRatio = YES;
-        NSNumber *preserveAspectRatioValue = context[SDWebImageContextImagePreserveAspectRatio];
-        if (preserveAspectRatioValue != nil) {
-            preserveAspectRatio = preserveAspectRatioValue.boolValue;
-        }
         key = SDThumbnailedKeyForKey(key, thumbnailSize, preserveAspectRatio);
     }
     
     // Transformer Key Appending
-    id<SDImageTransformer> transformer = self.transformer;
-    if (context[SDWebImageContextImageTransformer]) {
-        transformer = context[SDWebImageContextImageTransformer];
-        if (![transformer conformsToProtocol:@protocol(SDImageTransformer)]) {
-            transformer = nil;
-        }
-    }
     if (transformer) {
-        key = SDTransformedKeyForKey(key, transformer.transformerKey);
+        key = SDTransformedKeyForKey(key, transformerKey);
     }
     
+    if (key && signature) {
+        [self.cacheKeys setObject:key forKey:signature];
+    }
     return key;
 }
 
@@ -306,6 +360,26 @@ static id<SDImageLoader> _defaultImageLoader;
                     [self callOriginalCacheProcessForOperation:operation url:url options:options context:context progress:progressBlock completed:completedBlock];
                     return;
                 }
+            } else if (options & SDWebImageRefreshCached && !SD_OPTIONS_CONTAINS(options, SDWebImageFromCacheOnly) && [imageCache respondsToSelector:@selector(queryHTTPCacheValidatorForKey:completion:)]) {
+                // Revalidate the cached image with the stored HTTP cache validator, instead of `NSURLCache`
+                [imageCache queryHTTPCacheValidatorForKey:key completion:^(SDHTTPCacheValidator * _Nullable validator) {
+                    @strongify(operation);
+                    if (!operation || operation.isCancelled) {
+                        // Image combined operation cancelled by user
+                        [self callCompletionBlockForOperation:operation completion:completedBlock error:[NSError errorWithDomain:SDWebImageErrorDomain code:SDWebImageErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during querying the cache"}] url:url];
+                        [self safelyRemoveOperationFromRunning:operation];
+                        return;
+                    }
+                    SDWebImageContext *validatorContext = context;
+                    if (validator) {
+                        SDWebImageMutableContext *mutableContext = context ? [context mutableCopy] : [NSMutableDictionary dictionary];
+                        mutableContext[SDWebImageContextHTTPCacheValidator] = validator;
+                        validatorContext = [mutableContext copy];
+                    }
+                    // Continue download process
+                    [self callDownloadProcessForOperation:operation url:url options:options context:validatorContext cachedImage:cachedImage cachedData:cachedData cacheType:cacheType progress:progressBlock completed:completedBlock];
+                }];
+                return;
             }
             
             // Continue download process
@@ -395,9 +469,15 @@ static id<SDImageLoader> _defaultImageLoader;
         imageLoader = self.imageLoader;
     }
     
+    // The cached image which is still fresh does not need revalidation
+    SDHTTPCacheValidator *cachedValidator = context[SDWebImageContextHTTPCacheValidator];
+    if (![cachedValidator isKindOfClass:[SDHTTPCacheValidator class]]) {
+        cachedValidator = nil;
+    }
+    
     // Check whether we should download image from network
     BOOL shouldDownload = !SD_OPTIONS_CONTAINS(options, SDWebImageFromCacheOnly);
-    shouldDownload &= (!cachedImage || options & SDWebImageRefreshCached);
+    shouldDownload &= (!cachedImage || (options & SDWebImageRefreshCached && !cachedValidator.isFresh));
     shouldDownload &= (![self.delegate respondsToSelector:@selector(imageManager:shouldDownloadImageForURL:)] || [self.delegate imageManager:self shouldDownloadImageForURL:url]);
     if ([imageLoader respondsToSelector:@selector(canRequestImageForURL:options:context:)]) {
         shouldDownload &= [imageLoader canRequestImageForURL:url options:options context:context];
@@ -419,6 +499,15 @@ static id<SDImageLoader> _defaultImageLoader;
             mutableContext[SDWebImageContextLoaderCachedImage] = cachedImage;
             context = [mutableContext copy];
         }
+        // Let the loader stream the original data into disk cache directory, the cache store moves the file into place
+        if (options & SDWebImageStreamToDiskCache && !context[SDWebImageContextDownloadDestinationPath]) {
+            NSString *destinationPath = [self streamDestinationPathForURL:url context:context];
+            if (destinationPath) {
+                SDWebImageMutableContext *mutableContext = context ? [context mutableCopy] : [NSMutableDictionary dictionary];
+                mutableContext[SDWebImageContextDownloadDestinationPath] = destinationPath;
+                context = [mutableContext copy];
+            }
+        }
         
         @weakify(operation);
         operation.loaderOperation = [imageLoader requestImageWithURL:url options:options context:context progress:progressBlock completed:^(UIImage *downloadedImage, NSData *downloadedData, NSError *error, BOOL finished) {
@@ -427,7 +516,13 @@ static id<SDImageLoader> _defaultImageLoader;
                 // Image combined operation cancelled by user
                 [self callCompletionBlockForOperation:operation completion:completedBlock error:[NSError errorWithDomain:SDWebImageErrorDomain code:SDWebImageErrorCancelled userInfo:@{NSLocalizedDescriptionKey : @"Operation cancelled by user during sending the request"}] url:url];
             } else if (cachedImage && options & SDWebImageRefreshCached && [error.domain isEqualToString:SDWebImageErrorDomain] && error.code == SDWebImageErrorCacheNotModified) {
-                // Image refresh hit the NSURLCache cache, do not call the completion block
+                // Image refresh hit the NSURLCache cache, or the server revalidated the cached image, do not call the completion block
+                if (cachedValidator) {
+                    // Update the freshness from the 304 response
+                    SDHTTPCacheValidator *validator = [cachedValidator validatorByUpdatingWithResponse:error.userInfo[SDWebImageErrorDownloadResponseKey]];
+                    id<SDImageCache> imageCache = [context[SDWebImageContextImageCache] conformsToProtocol:@protocol(SDImageCache)] ? context[SDWebImageContextImageCache] : self.imageCache;
+                    [self storeHTTPCacheValidator:validator forKey:[self cacheKeyForURL:url context:context] imageCache:imageCache];
+                }
             } else if ([error.domain isEqualToString:SDWebImageErrorDomain] && error.code == SDWebImageErrorCancelled) {
                 // Download operation cancelled by user before sending the request, don't block failed URL
                 [self callCompletionBlockForOperation:operation completion:completedBlock error:error url:url];
@@ -446,8 +541,18 @@ static id<SDImageLoader> _defaultImageLoader;
                     [self.failedURLs removeObject:url];
                     SD_UNLOCK(self->_failedURLsLock);
                 }
+                SDWebImageContext *storeContext = context;
+                if (finished) {
+                    // The image cache stores the validator of response with the image data, or remove the stale one
+                    id<SDWebImageOperation> loaderOperation = operation.loaderOperation;
+                    NSURLResponse *response = [loaderOperation respondsToSelector:@selector(response)] ? [(id)loaderOperation response] : nil;
+                    SDHTTPCacheValidator *validator = [SDHTTPCacheValidator validatorWithResponse:response];
+                    SDWebImageMutableContext *mutableContext = context ? [context mutableCopy] : [NSMutableDictionary dictionary];
+                    mutableContext[SDWebImageContextHTTPCacheValidator] = validator;
+                    storeContext = [mutableContext copy];
+                }
                 // Continue store cache process
-                [self callStoreCacheProcessForOperation:operation url:url options:options context:context downloadedImage:downloadedImage downloadedData:downloadedData cacheType:SDImageCacheTypeNone finished:finished completed:completedBlock];
+                [self callStoreCacheProcessForOperation:operation url:url options:options context:storeContext downloadedImage:downloadedImage downloadedData:downloadedData cacheType:SDImageCacheTypeNone finished:finished completed:completedBlock];
             }
             
             if (finished) {
@@ -529,14 +634,14 @@ static id<SDImageLoader> _defaultImageLoader;
             dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
                 @autoreleasepool {
                     NSData *cacheData = [cacheSerializer cacheDataWithImage:fullSizeImage originalData:downloadedData imageURL:url];
-                    [self storeImage:fullSizeImage imageData:cacheData forKey:key imageCache:imageCache cacheType:targetStoreCacheType waitStoreCache:waitStoreCache completion:^{
+                    [self storeImage:fullSizeImage imageData:cacheData forKey:key options:options context:context imageCache:imageCache cacheType:targetStoreCacheType waitStoreCache:waitStoreCache completion:^{
                         // Continue transform process
                         [self callTransformProcessForOperation:operation url:url options:options context:context originalImage:downloadedImage originalData:downloadedData cacheType:cacheType finished:finished completed:completedBlock];
                     }];
                 }
             });
         } else {
-            [self storeImage:fullSizeImage imageData:downloadedData forKey:key imageCache:imageCache cacheType:targetStoreCacheType waitStoreCache:waitStoreCache completion:^{
+            [self storeImage:fullSizeImage imageData:downloadedData forKey:key options:options context:context imageCache:imageCache cacheType:targetStoreCacheType waitStoreCache:waitStoreCache completion:^{
                 // Continue transform process
                 [self callTransformProcessForOperation:operation url:url options:options context:context originalImage:downloadedImage originalData:downloadedData cacheType:cacheType finished:finished completed:completedBlock];
             }];
@@ -671,7 +776,7 @@ static id<SDImageLoader> _defaultImageLoader;
         }
         // transformed/thumbnailed cache key
         NSString *key = [self cacheKeyForURL:url context:context];
-        [self storeImage:image imageData:cacheData forKey:key imageCache:imageCache cacheType:storeCacheType waitStoreCache:waitStoreCache completion:^{
+        [self storeImage:image imageData:cacheData forKey:key options:options context:context imageCache:imageCache cacheType:storeCacheType waitStoreCache:waitStoreCache completion:^{
             [self callCompletionBlockForOperation:operation completion:completedBlock image:image data:data error:nil cacheType:cacheType finished:finished url:url];
         }];
     } else {
@@ -690,21 +795,72 @@ static id<SDImageLoader> _defaultImageLoader;
     SD_UNLOCK(_runningOperationsLock);
 }
 
+- (nullable NSString *)streamDestinationPathForURL:(nonnull NSURL *)url context:(nullable SDWebImageContext *)context {
+    // The cache serializer need to process the decoded image before writing
+    if (context[SDWebImageContextCacheSerializer]) {
+        return nil;
+    }
+    // Both of the original and target image may be stored with original data, check the disk cache is used for both
+    SDImageCacheType storeCacheType = SDImageCacheTypeAll;
+    if (context[SDWebImageContextStoreCacheType]) {
+        storeCacheType = [context[SDWebImageContextStoreCacheType] integerValue];
+    }
+    SDImageCacheType originalStoreCacheType = SDImageCacheTypeDisk;
+    if (context[SDWebImageContextOriginalStoreCacheType]) {
+        originalStoreCacheType = [context[SDWebImageContextOriginalStoreCacheType] integerValue];
+    }
+    if ((storeCacheType != SDImageCacheTypeDisk && storeCacheType != SDImageCacheTypeAll) ||
+        (originalStoreCacheType != SDImageCacheTypeDisk && originalStoreCacheType != SDImageCacheTypeAll)) {
+        return nil;
+    }
+    // Same as store cache process, choose standalone original cache firstly
+    id<SDImageCache> imageCache;
+    if ([context[SDWebImageContextOriginalImageCache] conformsToProtocol:@protocol(SDImageCache)]) {
+        imageCache = context[SDWebImageContextOriginalImageCache];
+    } else if ([context[SDWebImageContextImageCache] conformsToProtocol:@protocol(SDImageCache)]) {
+        imageCache = context[SDWebImageContextImageCache];
+    } else {
+        imageCache = self.imageCache;
+    }
+    // Only the built-in image cache provide the file path of disk cache
+    if (![imageCache isKindOfClass:[SDImageCache class]]) {
+        return nil;
+    }
+    NSString *key = [self originalCacheKeyForURL:url context:context];
+    return [((SDImageCache *)imageCache) cachePathForKey:key];
+}
+
+- (void)storeHTTPCacheValidator:(nonnull SDHTTPCacheValidator *)validator
+                         forKey:(nullable NSString *)key
+                     imageCache:(nonnull id<SDImageCache>)imageCache {
+    if (![imageCache respondsToSelector:@selector(storeHTTPCacheValidator:forKey:completion:)]) {
+        return;
+    }
+    [imageCache storeHTTPCacheValidator:validator forKey:key completion:nil];
+}
+
 - (void)storeImage:(nullable UIImage *)image
          imageData:(nullable NSData *)data
             forKey:(nullable NSString *)key
+           options:(SDWebImageOptions)options
+           context:(nullable SDWebImageContext *)context
         imageCache:(nonnull id<SDImageCache>)imageCache
          cacheType:(SDImageCacheType)cacheType
     waitStoreCache:(BOOL)waitStoreCache
         completion:(nullable SDWebImageNoParamsBlock)completion {
     // Check whether we should wait the store cache finished. If not, callback immediately
-    [imageCache storeImage:image imageData:data forKey:key cacheType:cacheType completion:^{
+    SDWebImageNoParamsBlock storeCompletion = ^{
         if (waitStoreCache) {
             if (completion) {
                 completion();
             }
         }
-    }];
+    };
+    if ([imageCache respondsToSelector:@selector(storeImage:imageData:forKey:options:context:cacheType:completion:)]) {
+        [imageCache storeImage:image imageData:data forKey:key options:options context:context cacheType:cacheType completion:storeCompletion];
+    } else {
+        [imageCache storeImage:image imageData:data forKey:key cacheType:cacheType completion:storeCompletion];
+    }
     if (!waitStoreCache) {
         if (completion) {
             completion();
@@ -81,6 +81,7 @@ typedef void(^SDWebImagePrefetcherCompletionBlock)(NSUInteger noOfFinishedUrls,
 
 /**
  * The context for prefetcher. Defaults to nil.
+ * @note Set `SDWebImageContextMemoryCacheLowPriority` to YES to store the prefetched images with low admission priority, so they do not evict the images on screen from memory cache.
  */
 @property (nonatomic, copy, nullable) SDWebImageContext *context;
 
@@ -0,0 +1,36 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+
+@class SDImageCacheConfig;
+
+/// A disk cache of decoded bitmaps, used by `SDImageCache` to skip the decoding of small static images on disk cache hit.
+/// The bitmaps are appended into fixed-size chunk files with their format and orientation, a hit maps the chunk file and wraps the pixels into image without decoding or copying. The index is rebuilt by scanning the chunk headers on first access.
+/// The eviction is per chunk file, the oldest chunk is removed when the total size exceeds `maxDecodedDiskCacheSize`, so a replaced or removed bitmap in older chunk never outlives the newer record. All the methods are thread-safe.
+@interface SDBitmapDiskCache : NSObject
+
+- (nonnull instancetype)initWithCachePath:(nonnull NSString *)cachePath config:(nonnull SDImageCacheConfig *)config;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly, nonnull) NSString *cachePath;
+@property (nonatomic, copy, readonly, nonnull) SDImageCacheConfig *config;
+
+/// Create the bitmap record of image, without key. Return nil if the image is animated, larger than `maxDecodedDiskCachePixelCount`, or can not be decoded. This does not touch the disk, so it can be called outside of IO queue.
+- (nullable NSData *)bitmapDataWithImage:(nonnull UIImage *)image;
+/// Append the bitmap record for key, which replaces the previous one.
+- (void)setBitmapData:(nonnull NSData *)bitmapData forKey:(nonnull NSString *)key;
+/// Return the image mapped from the bitmap, or nil if missing.
+- (nullable UIImage *)imageForKey:(nonnull NSString *)key;
+- (void)removeImageForKey:(nonnull NSString *)key;
+- (void)removeAllImages;
+
+@property (nonatomic, assign, readonly) NSUInteger totalSize;
+@property (nonatomic, assign, readonly) NSUInteger totalCount;
+
+@end
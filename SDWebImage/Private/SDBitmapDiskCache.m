@@ -0,0 +1,491 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDBitmapDiskCache.h"
+#import "SDImageCacheConfig.h"
+#import "SDImageCoderHelper.h"
+#import "SDAnimatedImage.h"
+#import "UIImage+Metadata.h"
+#import "UIImage+ForceDecode.h"
+#import "NSImage+Compatibility.h"
+#import "SDInternalMacros.h"
+#import <sys/stat.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+static const uint32_t SDBitmapDiskCacheMagic = 0x4D425344; // "SDBM"
+static const uint64_t SDBitmapDiskCacheChunkSize = 4 * 1024 * 1024;
+static const uint64_t SDBitmapDiskCacheAlignment = 64; // Keep the pixels aligned for rendering
+static const uint32_t SDBitmapDiskCacheMaxKeyLength = 4096;
+static NSString * const SDBitmapDiskCacheChunkExtension = @"chunk";
+
+/// The record header in chunk file, followed by the key, and the pixels at aligned offset.
+typedef struct SDBitmapDiskCacheHeader {
+    uint32_t magic;
+    uint32_t keyLength;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bitsPerComponent;
+    uint32_t bitsPerPixel;
+    uint32_t bytesPerRow;
+    uint32_t bitmapInfo;
+    uint32_t orientation; // EXIF orientation
+    int32_t format; // The original image format
+    double scale;
+    uint64_t dataLength; // 0 for the removal record
+} SDBitmapDiskCacheHeader;
+
+static inline uint64_t SDBitmapDiskCacheAlign(uint64_t offset) {
+    return (offset + SDBitmapDiskCacheAlignment - 1) & ~(SDBitmapDiskCacheAlignment - 1);
+}
+
+static void SDBitmapDiskCacheReleaseData(void *info, const void *data, size_t size) {
+    // Release the mapped chunk retained by data provider
+    CFRelease(info);
+}
+
+@interface SDBitmapDiskCacheEntry : NSObject {
+    @package
+    SDBitmapDiskCacheHeader _header;
+    uint64_t _chunkID;
+    uint64_t _dataOffset;
+}
+@end
+
+@implementation SDBitmapDiskCacheEntry
+@end
+
+@interface SDBitmapDiskCacheChunk : NSObject
+
+@property (nonatomic, assign) uint64_t chunkID;
+@property (nonatomic, assign) uint64_t length; // The offset of next record, always aligned
+@property (nonatomic, strong, nullable) NSData *mappedData;
+@property (nonatomic, strong, nonnull) NSMutableSet<NSString *> *keys; // The keys whose current entry is in this chunk
+
+@end
+
+@implementation SDBitmapDiskCacheChunk
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _keys = [NSMutableSet set];
+    }
+    return self;
+}
+
+@end
+
+@interface SDBitmapDiskCache () {
+    SD_LOCK_DECLARE(_lock);
+}
+
+@property (nonatomic, strong, nonnull) NSFileManager *fileManager;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDBitmapDiskCacheEntry *> *entries;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSNumber *, SDBitmapDiskCacheChunk *> *chunks;
+@property (nonatomic, strong, nullable) SDBitmapDiskCacheChunk *currentChunk;
+@property (nonatomic, assign, readwrite) NSUInteger totalSize;
+@property (nonatomic, assign) BOOL loaded;
+
+@end
+
+@implementation SDBitmapDiskCache
+
+- (instancetype)init {
+    NSAssert(NO, @"Use `initWithCachePath:config:` with the cache path");
+    return nil;
+}
+
+- (instancetype)initWithCachePath:(NSString *)cachePath config:(SDImageCacheConfig *)config {
+    self = [super init];
+    if (self) {
+        _cachePath = [cachePath copy];
+        _config = [config copy];
+        _fileManager = config.fileManager ? config.fileManager : [NSFileManager new];
+        _entries = [NSMutableDictionary dictionary];
+        _chunks = [NSMutableDictionary dictionary];
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+#pragma mark - Bitmap
+
++ (BOOL)isBitmapCompatibleImage:(CGImageRef)cgImage {
+    return CGImageGetBitsPerComponent(cgImage) == 8 && CGImageGetBitsPerPixel(cgImage) == 32 && CFEqual(CGImageGetColorSpace(cgImage), [SDImageCoderHelper colorSpaceGetDeviceRGB]);
+}
+
+- (NSData *)bitmapDataWithImage:(UIImage *)image {
+    if (image.sd_isAnimated || image.sd_isVector || [image.class conformsToProtocol:@protocol(SDAnimatedImage)]) {
+        return nil;
+    }
+    CGImageRef cgImage = image.CGImage;
+    if (!cgImage) {
+        return nil;
+    }
+    size_t width = CGImageGetWidth(cgImage);
+    size_t height = CGImageGetHeight(cgImage);
+    if (width == 0 || height == 0 || width * height > self.config.maxDecodedDiskCachePixelCount) {
+        return nil;
+    }
+    if (CGImageGetBitsPerComponent(cgImage) > 8) {
+        // Keep the high bit depth image decoded from the original data
+        return nil;
+    }
+    CGImageRef bitmapImage;
+    if ([self.class isBitmapCompatibleImage:cgImage]) {
+        bitmapImage = CGImageRetain(cgImage);
+    } else {
+        bitmapImage = [SDImageCoderHelper CGImageCreateDecoded:cgImage];
+    }
+    if (!bitmapImage) {
+        return nil;
+    }
+    if (![self.class isBitmapCompatibleImage:bitmapImage]) {
+        CGImageRelease(bitmapImage);
+        return nil;
+    }
+    CFDataRef pixels = CGDataProviderCopyData(CGImageGetDataProvider(bitmapImage));
+    SDBitmapDiskCacheHeader header = {0};
+    header.magic = SDBitmapDiskCacheMagic;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.bitsPerComponent = (uint32_t)CGImageGetBitsPerComponent(bitmapImage);
+    header.bitsPerPixel = (uint32_t)CGImageGetBitsPerPixel(bitmapImage);
+    header.bytesPerRow = (uint32_t)CGImageGetBytesPerRow(bitmapImage);
+    header.bitmapInfo = CGImageGetBitmapInfo(bitmapImage);
+#if SD_MAC
+    header.orientation = kCGImagePropertyOrientationUp;
+#else
+    header.orientation = [SDImageCoderHelper exifOrientationFromImageOrientation:image.imageOrientation];
+#endif
+    header.format = (int32_t)image.sd_imageFormat;
+    header.scale = image.scale;
+    header.dataLength = (uint64_t)header.bytesPerRow * header.height;
+    CGImageRelease(bitmapImage);
+    if (!pixels || (uint64_t)CFDataGetLength(pixels) < header.dataLength || header.dataLength > SDBitmapDiskCacheChunkSize) {
+        if (pixels) {
+            CFRelease(pixels);
+        }
+        return nil;
+    }
+    NSMutableData *bitmapData = [NSMutableData dataWithCapacity:sizeof(header) + (NSUInteger)header.dataLength];
+    [bitmapData appendBytes:&header length:sizeof(header)];
+    [bitmapData appendBytes:CFDataGetBytePtr(pixels) length:(NSUInteger)header.dataLength];
+    CFRelease(pixels);
+    return [bitmapData copy];
+}
+
+- (nullable UIImage *)imageWithMappedData:(nonnull NSData *)mappedData offset:(uint64_t)offset header:(SDBitmapDiskCacheHeader)header {
+    // The data provider retains the mapped chunk, the pixels are paged in from file by system, no decoding and copying
+    CFTypeRef info = CFBridgingRetain(mappedData);
+    CGDataProviderRef provider = CGDataProviderCreateWithData((void *)info, (const uint8_t *)mappedData.bytes + offset, (size_t)header.dataLength, SDBitmapDiskCacheReleaseData);
+    if (!provider) {
+        CFRelease(info);
+        return nil;
+    }
+    CGImageRef cgImage = CGImageCreate(header.width, header.height, header.bitsPerComponent, header.bitsPerPixel, header.bytesPerRow, [SDImageCoderHelper colorSpaceGetDeviceRGB], header.bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    if (!cgImage) {
+        return nil;
+    }
+#if SD_MAC
+    UIImage *image = [[NSImage alloc] initWithCGImage:cgImage scale:header.scale orientation:header.orientation];
+#else
+    UIImageOrientation imageOrientation = [SDImageCoderHelper imageOrientationFromEXIFOrientation:header.orientation];
+    UIImage *image = [[UIImage alloc] initWithCGImage:cgImage scale:header.scale orientation:imageOrientation];
+#endif
+    CGImageRelease(cgImage);
+    image.sd_imageFormat = header.format;
+    image.sd_isDecoded = YES;
+    return image;
+}
+
+#pragma mark - Chunk
+
+- (nonnull NSString *)pathForChunkID:(uint64_t)chunkID {
+    return [self.cachePath stringByAppendingPathComponent:[NSString stringWithFormat:@"%llu.%@", chunkID, SDBitmapDiskCacheChunkExtension]];
+}
+
+// Make sure to call with lock
+- (void)loadIfNeeded {
+    if (self.loaded) {
+        return;
+    }
+    self.loaded = YES;
+    NSArray<NSString *> *fileNames = [self.fileManager contentsOfDirectoryAtPath:self.cachePath error:nil];
+    NSMutableArray<NSNumber *> *chunkIDs = [NSMutableArray arrayWithCapacity:fileNames.count];
+    for (NSString *fileName in fileNames) {
+        if ([fileName.pathExtension isEqualToString:SDBitmapDiskCacheChunkExtension]) {
+            [chunkIDs addObject:@(strtoull(fileName.stringByDeletingPathExtension.UTF8String, NULL, 10))];
+        }
+    }
+    // The later record wins, so load from the oldest chunk
+    [chunkIDs sortUsingSelector:@selector(compare:)];
+    for (NSNumber *chunkID in chunkIDs) {
+        [self loadChunkWithID:chunkID.unsignedLongLongValue];
+    }
+}
+
+// Make sure to call with lock
+- (void)loadChunkWithID:(uint64_t)chunkID {
+    NSString *path = [self pathForChunkID:chunkID];
+    int fd = open(path.fileSystemRepresentation, O_RDWR);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return;
+    }
+    uint64_t fileLength = (uint64_t)st.st_size;
+    SDBitmapDiskCacheChunk *chunk = [SDBitmapDiskCacheChunk new];
+    chunk.chunkID = chunkID;
+    self.chunks[@(chunkID)] = chunk;
+
+    uint64_t offset = 0;
+    SDBitmapDiskCacheHeader header;
+    while (offset + sizeof(header) <= fileLength) {
+        if (pread(fd, &header, sizeof(header), (off_t)offset) != sizeof(header)) {
+            break;
+        }
+        if (header.magic != SDBitmapDiskCacheMagic || header.keyLength == 0 || header.keyLength > SDBitmapDiskCacheMaxKeyLength) {
+            break;
+        }
+        uint64_t dataOffset = SDBitmapDiskCacheAlign(offset + sizeof(header) + header.keyLength);
+        if (dataOffset + header.dataLength > fileLength) {
+            break;
+        }
+        if (header.dataLength > 0 && header.dataLength != (uint64_t)header.bytesPerRow * header.height) {
+            break;
+        }
+        NSMutableData *keyData = [NSMutableData dataWithLength:header.keyLength];
+        if (pread(fd, keyData.mutableBytes, header.keyLength, (off_t)(offset + sizeof(header))) != header.keyLength) {
+            break;
+        }
+        NSString *key = [[NSString alloc] initWithData:keyData encoding:NSUTF8StringEncoding];
+        if (!key) {
+            break;
+        }
+        if (header.dataLength > 0) {
+            SDBitmapDiskCacheEntry *entry = [SDBitmapDiskCacheEntry new];
+            entry->_header = header;
+            entry->_chunkID = chunkID;
+            entry->_dataOffset = dataOffset;
+            [self setEntry:entry forKey:key];
+        } else {
+            [self removeEntryForKey:key];
+        }
+        offset = SDBitmapDiskCacheAlign(dataOffset + header.dataLength);
+    }
+    if (offset < fileLength) {
+        // Drop the partially written record, such as the app was killed during writing
+        ftruncate(fd, (off_t)offset);
+    }
+    close(fd);
+    chunk.length = offset;
+    _totalSize += (NSUInteger)offset;
+    if (!self.currentChunk || self.currentChunk.chunkID < chunkID) {
+        self.currentChunk = chunk;
+    }
+}
+
+// Make sure to call with lock
+- (nullable SDBitmapDiskCacheEntry *)appendRecordWithHeader:(SDBitmapDiskCacheHeader)header keyData:(nonnull NSData *)keyData pixels:(nullable const void *)pixels {
+    header.keyLength = (uint32_t)keyData.length;
+    uint64_t headerLength = SDBitmapDiskCacheAlign(sizeof(header) + header.keyLength);
+    uint64_t recordLength = SDBitmapDiskCacheAlign(headerLength + header.dataLength);
+    SDBitmapDiskCacheChunk *chunk = self.currentChunk;
+    if (!chunk || (chunk.length > 0 && chunk.length + recordLength > SDBitmapDiskCacheChunkSize)) {
+        // The chunk size is fixed, start a new chunk
+        [self.fileManager createDirectoryAtPath:self.cachePath withIntermediateDirectories:YES attributes:nil error:nil];
+        SDBitmapDiskCacheChunk *newChunk = [SDBitmapDiskCacheChunk new];
+        newChunk.chunkID = chunk ? chunk.chunkID + 1 : 0;
+        self.chunks[@(newChunk.chunkID)] = newChunk;
+        self.currentChunk = newChunk;
+        chunk = newChunk;
+    }
+    int fd = open([self pathForChunkID:chunk.chunkID].fileSystemRepresentation, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        return nil;
+    }
+    NSMutableData *headerData = [NSMutableData dataWithLength:(NSUInteger)headerLength];
+    memcpy(headerData.mutableBytes, &header, sizeof(header));
+    memcpy((uint8_t *)headerData.mutableBytes + sizeof(header), keyData.bytes, keyData.length);
+    BOOL success = pwrite(fd, headerData.bytes, (size_t)headerLength, (off_t)chunk.length) == (ssize_t)headerLength;
+    if (success && header.dataLength > 0) {
+        success = pwrite(fd, pixels, (size_t)header.dataLength, (off_t)(chunk.length + headerLength)) == (ssize_t)header.dataLength;
+    }
+    close(fd);
+    if (!success) {
+        // The next record overwrites the failed one
+        return nil;
+    }
+    SDBitmapDiskCacheEntry *entry = [SDBitmapDiskCacheEntry new];
+    entry->_header = header;
+    entry->_chunkID = chunk.chunkID;
+    entry->_dataOffset = chunk.length + headerLength;
+    chunk.length += recordLength;
+    _totalSize += (NSUInteger)recordLength;
+    return entry;
+}
+
+// Make sure to call with lock
+- (void)setEntry:(nonnull SDBitmapDiskCacheEntry *)entry forKey:(nonnull NSString *)key {
+    [self removeEntryForKey:key];
+    self.entries[key] = entry;
+    [self.chunks[@(entry->_chunkID)].keys addObject:key];
+}
+
+// Make sure to call with lock
+- (void)removeEntryForKey:(nonnull NSString *)key {
+    SDBitmapDiskCacheEntry *entry = self.entries[key];
+    if (!entry) {
+        return;
+    }
+    [self.chunks[@(entry->_chunkID)].keys removeObject:key];
+    [self.entries removeObjectForKey:key];
+}
+
+// Make sure to call with lock
+- (void)removeChunk:(nonnull SDBitmapDiskCacheChunk *)chunk {
+    for (NSString *key in chunk.keys) {
+        [self.entries removeObjectForKey:key];
+    }
+    [self.fileManager removeItemAtPath:[self pathForChunkID:chunk.chunkID] error:nil];
+    [self.chunks removeObjectForKey:@(chunk.chunkID)];
+    _totalSize -= (NSUInteger)MIN(chunk.length, (uint64_t)_totalSize);
+    if (self.currentChunk == chunk) {
+        self.currentChunk = nil;
+    }
+}
+
+// Make sure to call with lock
+- (void)trimToSizeLimit {
+    NSUInteger maxSize = self.config.maxDecodedDiskCacheSize;
+    if (maxSize == 0) {
+        return;
+    }
+    while (_totalSize > maxSize && self.chunks.count > 1) {
+        // Always evict the oldest chunk. A newer chunk may hold the replacing or removal record of a key in older chunk, evicting it first would load the stale bitmap again on next launch
+        // The chunk being written is the newest, never evict it
+        SDBitmapDiskCacheChunk *oldestChunk;
+        for (SDBitmapDiskCacheChunk *chunk in self.chunks.allValues) {
+            if (chunk == self.currentChunk) {
+                continue;
+            }
+            if (!oldestChunk || chunk.chunkID < oldestChunk.chunkID) {
+                oldestChunk = chunk;
+            }
+        }
+        if (!oldestChunk) {
+            break;
+        }
+        [self removeChunk:oldestChunk];
+    }
+}
+
+#pragma mark - Cache
+
+- (void)setBitmapData:(NSData *)bitmapData forKey:(NSString *)key {
+    if (bitmapData.length < sizeof(SDBitmapDiskCacheHeader)) {
+        return;
+    }
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    if (keyData.length == 0 || keyData.length > SDBitmapDiskCacheMaxKeyLength) {
+        return;
+    }
+    SDBitmapDiskCacheHeader header;
+    memcpy(&header, bitmapData.bytes, sizeof(header));
+    if (header.magic != SDBitmapDiskCacheMagic || bitmapData.length - sizeof(header) < header.dataLength) {
+        return;
+    }
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    SDBitmapDiskCacheEntry *entry = [self appendRecordWithHeader:header keyData:keyData pixels:(const uint8_t *)bitmapData.bytes + sizeof(header)];
+    if (entry) {
+        [self setEntry:entry forKey:key];
+    } else {
+        [self removeEntryForKey:key];
+    }
+    [self trimToSizeLimit];
+    SD_UNLOCK(_lock);
+}
+
+- (UIImage *)imageForKey:(NSString *)key {
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    SDBitmapDiskCacheEntry *entry = self.entries[key];
+    SDBitmapDiskCacheChunk *chunk = entry ? self.chunks[@(entry->_chunkID)] : nil;
+    if (!chunk) {
+        SD_UNLOCK(_lock);
+        return nil;
+    }
+    uint64_t end = entry->_dataOffset + entry->_header.dataLength;
+    NSData *mappedData = chunk.mappedData;
+    if (mappedData.length < end) {
+        // The chunk grows after last mapping, map again. The images created from the old mapping keep it alive
+        mappedData = [NSData dataWithContentsOfFile:[self pathForChunkID:chunk.chunkID] options:NSDataReadingMappedAlways error:nil];
+        chunk.mappedData = mappedData;
+    }
+    if (mappedData.length < end) {
+        // The chunk file is removed or truncated outside
+        [self removeEntryForKey:key];
+        SD_UNLOCK(_lock);
+        return nil;
+    }
+    uint64_t offset = entry->_dataOffset;
+    SDBitmapDiskCacheHeader header = entry->_header;
+    SD_UNLOCK(_lock);
+
+    return [self imageWithMappedData:mappedData offset:offset header:header];
+}
+
+- (void)removeImageForKey:(NSString *)key {
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    if (self.entries[key] && keyData.length > 0) {
+        // Append a removal record, so the key is not loaded again from the older chunk
+        SDBitmapDiskCacheHeader header = {0};
+        header.magic = SDBitmapDiskCacheMagic;
+        [self appendRecordWithHeader:header keyData:keyData pixels:NULL];
+        [self removeEntryForKey:key];
+    }
+    SD_UNLOCK(_lock);
+}
+
+- (void)removeAllImages {
+    SD_LOCK(_lock);
+    [self.fileManager removeItemAtPath:self.cachePath error:nil];
+    [self.entries removeAllObjects];
+    [self.chunks removeAllObjects];
+    self.currentChunk = nil;
+    _totalSize = 0;
+    self.loaded = YES;
+    SD_UNLOCK(_lock);
+}
+
+- (NSUInteger)totalSize {
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    NSUInteger totalSize = _totalSize;
+    SD_UNLOCK(_lock);
+    return totalSize;
+}
+
+- (NSUInteger)totalCount {
+    SD_LOCK(_lock);
+    [self loadIfNeeded];
+    NSUInteger totalCount = self.entries.count;
+    SD_UNLOCK(_lock);
+    return totalCount;
+}
+
+@end
@@ -0,0 +1,54 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+#import "NSData+ImageContentType.h"
+
+/// A record in the disk cache index, describe one file in disk cache directory.
+@interface SDDiskCacheIndexEntry : NSObject
+
+@property (nonatomic, copy, readonly, nonnull) NSString *fileName;
+@property (nonatomic, assign, readonly) NSUInteger size;
+@property (nonatomic, assign, readonly) NSTimeInterval date; // The date used for expiration, match `SDImageCacheConfigExpireType`
+@property (nonatomic, assign, readonly) SDImageFormat format;
+
+@end
+
+/// An in-memory index of the disk cache files, ordered from the oldest to the newest, with an on-disk manifest file.
+/// Size, count and the oldest entry are O(1), insert, touch and remove are O(1) as well, no file system walk is needed.
+/// The manifest is removed on the first mutation after it's written, so an existing manifest always matches the directory. When it's missing (crash, first launch), the owner should rebuild the index from the directory.
+@interface SDDiskCacheIndex : NSObject
+
+- (nonnull instancetype)initWithManifestPath:(nonnull NSString *)manifestPath;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly, nonnull) NSString *manifestPath;
+@property (nonatomic, assign, readonly, getter=isLoaded) BOOL loaded;
+@property (nonatomic, assign, readonly) NSUInteger totalSize;
+@property (nonatomic, assign, readonly) NSUInteger totalCount;
+
+/// Load the index from manifest file. Return NO if the manifest is missing or corrupted.
+- (BOOL)load;
+/// Mark the index as loaded without entries, used before rebuilding from directory.
+- (void)reset;
+/// Mark the index as unloaded, the owner should load or rebuild again.
+- (void)invalidate;
+/// Write the manifest file if the index changed since last synchronize.
+- (BOOL)synchronize;
+
+- (nullable SDDiskCacheIndexEntry *)entryForFileName:(nonnull NSString *)fileName;
+/// Insert or update the entry, and move it to the newest position if the date changed.
+- (void)setEntryForFileName:(nonnull NSString *)fileName size:(NSUInteger)size date:(NSTimeInterval)date format:(SDImageFormat)format;
+/// Update the date of entry and move it to the newest position.
+- (void)touchEntryForFileName:(nonnull NSString *)fileName date:(NSTimeInterval)date;
+- (void)removeEntryForFileName:(nonnull NSString *)fileName;
+- (void)removeAllEntries;
+/// The oldest entry, which should be evicted first.
+- (nullable SDDiskCacheIndexEntry *)oldestEntry;
+
+@end
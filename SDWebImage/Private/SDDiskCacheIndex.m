@@ -0,0 +1,284 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDDiskCacheIndex.h"
+#import "SDInternalMacros.h"
+
+static NSString * const SDDiskCacheIndexVersionKey = @"version";
+static NSString * const SDDiskCacheIndexEntriesKey = @"entries";
+static const NSInteger SDDiskCacheIndexVersion = 1;
+
+@interface SDDiskCacheIndexEntry () {
+    @package
+    __unsafe_unretained SDDiskCacheIndexEntry *_prev; // retained by the map table
+    __unsafe_unretained SDDiskCacheIndexEntry *_next; // retained by the map table
+}
+
+@property (nonatomic, copy, readwrite, nonnull) NSString *fileName;
+@property (nonatomic, assign, readwrite) NSUInteger size;
+@property (nonatomic, assign, readwrite) NSTimeInterval date;
+@property (nonatomic, assign, readwrite) SDImageFormat format;
+
+@end
+
+@implementation SDDiskCacheIndexEntry
+@end
+
+@interface SDDiskCacheIndex () {
+    SD_LOCK_DECLARE(_lock);
+    __unsafe_unretained SDDiskCacheIndexEntry *_head; // oldest
+    __unsafe_unretained SDDiskCacheIndexEntry *_tail; // newest
+}
+
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDDiskCacheIndexEntry *> *entries;
+@property (nonatomic, assign, readwrite, getter=isLoaded) BOOL loaded;
+@property (nonatomic, assign, readwrite) NSUInteger totalSize;
+@property (nonatomic, assign) BOOL dirty;
+
+@end
+
+@implementation SDDiskCacheIndex
+
+- (instancetype)init {
+    NSAssert(NO, @"Use `initWithManifestPath:` with the manifest path");
+    return nil;
+}
+
+- (instancetype)initWithManifestPath:(NSString *)manifestPath {
+    self = [super init];
+    if (self) {
+        _manifestPath = [manifestPath copy];
+        _entries = [NSMutableDictionary dictionary];
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+- (NSUInteger)totalCount {
+    SD_LOCK(_lock);
+    NSUInteger count = self.entries.count;
+    SD_UNLOCK(_lock);
+    return count;
+}
+
+#pragma mark - Manifest
+
+- (BOOL)load {
+    NSData *data = [NSData dataWithContentsOfFile:self.manifestPath options:NSDataReadingMappedIfSafe error:nil];
+    if (!data) {
+        return NO;
+    }
+    NSDictionary *manifest = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:nil error:nil];
+    if (![manifest isKindOfClass:[NSDictionary class]] || [manifest[SDDiskCacheIndexVersionKey] integerValue] != SDDiskCacheIndexVersion) {
+        return NO;
+    }
+    NSArray<NSArray *> *records = manifest[SDDiskCacheIndexEntriesKey];
+    if (![records isKindOfClass:[NSArray class]]) {
+        return NO;
+    }
+    SD_LOCK(_lock);
+    [self _removeAllEntries];
+    // Records are written from the oldest to the newest
+    for (NSArray *record in records) {
+        if (![record isKindOfClass:[NSArray class]] || record.count < 4) {
+            continue;
+        }
+        [self _setEntryForFileName:record[0] size:[record[1] unsignedIntegerValue] date:[record[2] doubleValue] format:[record[3] integerValue]];
+    }
+    self.loaded = YES;
+    self.dirty = NO;
+    SD_UNLOCK(_lock);
+    return YES;
+}
+
+- (void)reset {
+    SD_LOCK(_lock);
+    [self _removeAllEntries];
+    self.loaded = YES;
+    SD_UNLOCK(_lock);
+    [self markDirty];
+}
+
+- (void)invalidate {
+    SD_LOCK(_lock);
+    [self _removeAllEntries];
+    self.loaded = NO;
+    SD_UNLOCK(_lock);
+    [self markDirty];
+}
+
+- (BOOL)synchronize {
+    SD_LOCK(_lock);
+    if (!self.loaded || !self.dirty) {
+        SD_UNLOCK(_lock);
+        return NO;
+    }
+    NSMutableArray<NSArray *> *records = [NSMutableArray arrayWithCapacity:self.entries.count];
+    for (SDDiskCacheIndexEntry *entry = _head; entry; entry = entry->_next) {
+        [records addObject:@[entry.fileName, @(entry.size), @(entry.date), @(entry.format)]];
+    }
+    self.dirty = NO;
+    SD_UNLOCK(_lock);
+    
+    NSDictionary *manifest = @{SDDiskCacheIndexVersionKey : @(SDDiskCacheIndexVersion), SDDiskCacheIndexEntriesKey : records};
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:manifest format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    if (![data writeToFile:self.manifestPath options:NSDataWritingAtomic error:nil]) {
+        SD_LOCK(_lock);
+        self.dirty = YES;
+        SD_UNLOCK(_lock);
+        return NO;
+    }
+    return YES;
+}
+
+// The manifest on disk is outdated after any mutation, remove it so that an unexpected termination will trigger rebuild
+- (void)markDirty {
+    SD_LOCK(_lock);
+    BOOL wasDirty = self.dirty;
+    self.dirty = YES;
+    SD_UNLOCK(_lock);
+    if (!wasDirty) {
+        [[NSFileManager defaultManager] removeItemAtPath:self.manifestPath error:nil];
+    }
+}
+
+#pragma mark - Entries
+
+- (SDDiskCacheIndexEntry *)entryForFileName:(NSString *)fileName {
+    if (!fileName) {
+        return nil;
+    }
+    SD_LOCK(_lock);
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    SD_UNLOCK(_lock);
+    return entry;
+}
+
+- (void)setEntryForFileName:(NSString *)fileName size:(NSUInteger)size date:(NSTimeInterval)date format:(SDImageFormat)format {
+    if (!fileName) {
+        return;
+    }
+    SD_LOCK(_lock);
+    [self _setEntryForFileName:fileName size:size date:date format:format];
+    SD_UNLOCK(_lock);
+    [self markDirty];
+}
+
+- (void)touchEntryForFileName:(NSString *)fileName date:(NSTimeInterval)date {
+    if (!fileName) {
+        return;
+    }
+    SD_LOCK(_lock);
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    if (!entry || entry.date == date) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+    entry.date = date;
+    [self _moveEntryToTail:entry];
+    SD_UNLOCK(_lock);
+    [self markDirty];
+}
+
+- (void)removeEntryForFileName:(NSString *)fileName {
+    if (!fileName) {
+        return;
+    }
+    SD_LOCK(_lock);
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    if (!entry) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+    [self _unlinkEntry:entry];
+    self.totalSize -= entry.size;
+    [self.entries removeObjectForKey:fileName];
+    SD_UNLOCK(_lock);
+    [self markDirty];
+}
+
+- (void)removeAllEntries {
+    SD_LOCK(_lock);
+    [self _removeAllEntries];
+    SD_UNLOCK(_lock);
+    [self markDirty];
+}
+
+- (SDDiskCacheIndexEntry *)oldestEntry {
+    SD_LOCK(_lock);
+    SDDiskCacheIndexEntry *entry = _head;
+    SD_UNLOCK(_lock);
+    return entry;
+}
+
+#pragma mark - Linked list, call with lock held
+
+- (void)_setEntryForFileName:(NSString *)fileName size:(NSUInteger)size date:(NSTimeInterval)date format:(SDImageFormat)format {
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    if (entry) {
+        self.totalSize = self.totalSize - entry.size + size;
+        entry.size = size;
+        entry.format = format;
+        if (entry.date != date) {
+            entry.date = date;
+            [self _moveEntryToTail:entry];
+        }
+        return;
+    }
+    entry = [SDDiskCacheIndexEntry new];
+    entry.fileName = fileName;
+    entry.size = size;
+    entry.date = date;
+    entry.format = format;
+    self.entries[fileName] = entry;
+    self.totalSize += size;
+    [self _appendEntry:entry];
+}
+
+- (void)_appendEntry:(SDDiskCacheIndexEntry *)entry {
+    entry->_prev = _tail;
+    entry->_next = nil;
+    if (_tail) {
+        _tail->_next = entry;
+    } else {
+        _head = entry;
+    }
+    _tail = entry;
+}
+
+- (void)_unlinkEntry:(SDDiskCacheIndexEntry *)entry {
+    if (entry->_prev) {
+        entry->_prev->_next = entry->_next;
+    } else {
+        _head = entry->_next;
+    }
+    if (entry->_next) {
+        entry->_next->_prev = entry->_prev;
+    } else {
+        _tail = entry->_prev;
+    }
+    entry->_prev = nil;
+    entry->_next = nil;
+}
+
+- (void)_moveEntryToTail:(SDDiskCacheIndexEntry *)entry {
+    if (_tail == entry) {
+        return;
+    }
+    [self _unlinkEntry:entry];
+    [self _appendEntry:entry];
+}
+
+- (void)_removeAllEntries {
+    _head = nil;
+    _tail = nil;
+    [self.entries removeAllObjects];
+    self.totalSize = 0;
+}
+
+@end
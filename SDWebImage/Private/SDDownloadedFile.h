@@ -0,0 +1,20 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+
+/// Return the memory-mapped data of the file streamed by the download operation. The data owns the file: it's kept as long as the data is alive, and removed once the data is released, unless it has been moved into the disk cache.
+/// Return nil if the file can not be read, and the file is removed.
+FOUNDATION_EXPORT NSData * _Nullable SDDownloadedFileDataWithPath(NSString * _Nonnull path);
+
+/// Move the file owned by the data into the destination path, which replace the existing file. The mapped bytes keep valid after moving.
+/// Return NO if the data does not own a file, the file has been moved or removed, or the moving failed.
+FOUNDATION_EXPORT BOOL SDDownloadedFileDataMoveToPath(NSData * _Nullable data, NSString * _Nonnull path);
+
+/// Remove the file owned by the data immediately, such as when the data is known to be invalid, instead of waiting for the data to be released.
+FOUNDATION_EXPORT void SDDownloadedFileDataRemove(NSData * _Nullable data);
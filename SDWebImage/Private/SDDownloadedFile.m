@@ -0,0 +1,78 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDDownloadedFile.h"
+#import <objc/runtime.h>
+
+/// The file owned by the data, removed when the data is released if not moved.
+@interface SDDownloadedFile : NSObject
+
+@property (nonatomic, copy, nullable) NSString *path;
+
+@end
+
+@implementation SDDownloadedFile
+
+- (void)dealloc {
+    if (_path) {
+        unlink(_path.fileSystemRepresentation);
+    }
+}
+
+@end
+
+static void * SDDownloadedFileKey = &SDDownloadedFileKey;
+
+NSData * _Nullable SDDownloadedFileDataWithPath(NSString * _Nonnull path) {
+    NSCParameterAssert(path);
+    // The mapping is still valid after the file been moved or removed
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    if (!data) {
+        unlink(path.fileSystemRepresentation);
+        return nil;
+    }
+    SDDownloadedFile *file = [SDDownloadedFile new];
+    file.path = path;
+    objc_setAssociatedObject(data, SDDownloadedFileKey, file, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    return data;
+}
+
+BOOL SDDownloadedFileDataMoveToPath(NSData * _Nullable data, NSString * _Nonnull path) {
+    NSCParameterAssert(path);
+    if (!data) {
+        return NO;
+    }
+    SDDownloadedFile *file = objc_getAssociatedObject(data, SDDownloadedFileKey);
+    if (!file) {
+        return NO;
+    }
+    // The same data may be stored into multiple caches concurrently, only the first one move the file
+    @synchronized (file) {
+        if (!file.path || rename(file.path.fileSystemRepresentation, path.fileSystemRepresentation) != 0) {
+            return NO;
+        }
+        file.path = nil;
+    }
+    return YES;
+}
+
+void SDDownloadedFileDataRemove(NSData * _Nullable data) {
+    if (!data) {
+        return;
+    }
+    SDDownloadedFile *file = objc_getAssociatedObject(data, SDDownloadedFileKey);
+    if (!file) {
+        return;
+    }
+    @synchronized (file) {
+        if (file.path) {
+            unlink(file.path.fileSystemRepresentation);
+            file.path = nil;
+        }
+    }
+}
@@ -8,6 +8,7 @@
 
 #import "SDImageAssetManager.h"
 #import "SDInternalMacros.h"
+#import "SDMemoryPressureCoordinator.h"
 
 static NSArray *SDBundlePreferredScales() {
     static NSArray *scales;
@@ -37,6 +38,10 @@ static NSArray *SDBundlePreferredScales() {
     return scales;
 }
 
+@interface SDImageAssetManager () <SDMemoryPressureResponder>
+
+@end
+
 @implementation SDImageAssetManager {
     SD_LOCK_DECLARE(_lock);
 }
@@ -64,19 +69,16 @@ static NSArray *SDBundlePreferredScales() {
         _imageTable = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsCopyIn valueOptions:valueOptions];
         SD_LOCK_INIT(_lock);
 #if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+        [SDMemoryPressureCoordinator.sharedCoordinator registerResponder:self priority:SDMemoryPressurePriorityMemoryCache];
 #endif
     }
     return self;
 }
 
-- (void)dealloc {
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
-}
-
-- (void)didReceiveMemoryWarning:(NSNotification *)notification {
+- (void)memoryPressureCoordinator:(SDMemoryPressureCoordinator *)coordinator didReceiveMemoryPressure:(SDMemoryPressureLevel)level {
+    if (level == SDMemoryPressureLevelNormal) {
+        return;
+    }
     SD_LOCK(_lock);
     [self.imageTable removeAllObjects];
     SD_UNLOCK(_lock);
@@ -0,0 +1,27 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+
+/// A segmented receive buffer for download operation. The appended chunks are retained without copying, and only flattened into contiguous bytes when `data` is called.
+/// The flattened storage is allocated with the capacity hint (such as `Content-Length`) and reused for later flatten, so each received byte is copied at most once, and the copied chunks are released immediately to keep the peak memory low.
+/// The returned data is an immutable snapshot and keep valid after more chunks appended. Not thread-safe.
+@interface SDWebImageDownloaderDataBuffer : NSObject
+
+- (nonnull instancetype)initWithCapacity:(NSUInteger)capacity NS_DESIGNATED_INITIALIZER;
+
+/// The total length of appended data.
+@property (nonatomic, assign, readonly) NSUInteger length;
+/// The expected total length, 0 means unknown.
+@property (nonatomic, assign, readonly) NSUInteger capacity;
+
+- (void)appendData:(nonnull NSData *)data;
+/// Return the contiguous bytes of all appended data, without copying when possible.
+- (nonnull NSData *)data;
+
+@end
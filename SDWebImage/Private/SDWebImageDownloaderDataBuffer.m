@@ -0,0 +1,113 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageDownloaderDataBuffer.h"
+
+// The contiguous storage shared by the buffer and the returned snapshots. Bytes before `length` never change.
+@interface SDWebImageDownloaderDataStorage : NSObject {
+    @package
+    uint8_t *_bytes;
+    NSUInteger _capacity;
+    NSUInteger _length;
+}
+@end
+
+@implementation SDWebImageDownloaderDataStorage
+
+- (void)dealloc {
+    free(_bytes);
+}
+
+- (nullable instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _bytes = malloc(capacity);
+        if (!_bytes) {
+            return nil;
+        }
+        _capacity = capacity;
+    }
+    return self;
+}
+
+@end
+
+@implementation SDWebImageDownloaderDataBuffer {
+    SDWebImageDownloaderDataStorage *_storage;
+    NSMutableArray<NSData *> *_chunks;
+}
+
+- (instancetype)init {
+    return [self initWithCapacity:0];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _capacity = capacity;
+        _chunks = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)appendData:(NSData *)data {
+    if (data.length == 0) {
+        return;
+    }
+    // URLSession provide immutable data, `copy` does not copy the bytes
+    [_chunks addObject:[data copy]];
+    _length += data.length;
+}
+
+- (NSData *)data {
+    if (_chunks.count == 0) {
+        return [self snapshotOfStorage:_storage];
+    }
+    if (!_storage && _chunks.count == 1) {
+        // Single chunk, no need to copy
+        return _chunks.firstObject;
+    }
+    SDWebImageDownloaderDataStorage *storage = _storage;
+    if (!storage || storage->_capacity < _length) {
+        // Capacity hint is unknown or wrong, allocate a new storage. The old snapshots still retain the old storage.
+        SDWebImageDownloaderDataStorage *newStorage = [[SDWebImageDownloaderDataStorage alloc] initWithCapacity:MAX(_length, _capacity)];
+        if (!newStorage) {
+            return [NSData data];
+        }
+        if (storage) {
+            memcpy(newStorage->_bytes, storage->_bytes, storage->_length);
+            newStorage->_length = storage->_length;
+        }
+        storage = newStorage;
+        _storage = newStorage;
+    }
+    // Release each chunk once copied, so the peak memory is about the total length plus one chunk
+    while (_chunks.count > 0) {
+        NSData *chunk = _chunks.firstObject;
+        // The data from URLSession may be backed by discontiguous dispatch data, `bytes` would flatten it into another copy
+        uint8_t *destination = storage->_bytes + storage->_length;
+        [chunk enumerateByteRangesUsingBlock:^(const void * _Nonnull bytes, NSRange byteRange, BOOL * _Nonnull stop) {
+            memcpy(destination + byteRange.location, bytes, byteRange.length);
+        }];
+        storage->_length += chunk.length;
+        [_chunks removeObjectAtIndex:0];
+    }
+    return [self snapshotOfStorage:storage];
+}
+
+- (NSData *)snapshotOfStorage:(SDWebImageDownloaderDataStorage *)storage {
+    if (!storage || storage->_length == 0) {
+        return [NSData data];
+    }
+    return [[NSData alloc] initWithBytesNoCopy:storage->_bytes length:storage->_length deallocator:^(void * _Nonnull bytes, NSUInteger length) {
+        // Keep the storage alive until the snapshot released
+        [storage self];
+    }];
+}
+
+@end
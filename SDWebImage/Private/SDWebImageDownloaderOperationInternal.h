@@ -0,0 +1,18 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageDownloaderOperation.h"
+#import "SDWebImageDownloaderResumeDataStore.h"
+
+@interface SDWebImageDownloaderOperation ()
+
+// Injected by downloader, the partial body is stored when cancelled or failed, and resumed on next start
+@property (strong, nonatomic, nullable) SDWebImageDownloaderResumeDataStore *resumeDataStore;
+
+@end
@@ -0,0 +1,53 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+#import "SDHTTPCacheValidator.h"
+
+/// The partial body of a cancelled or failed download, with the validator to resume it by `Range` and `If-Range`.
+@interface SDWebImageDownloaderResumeData : NSObject
+
+- (nonnull instancetype)initWithData:(nonnull NSData *)data validator:(nonnull SDHTTPCacheValidator *)validator totalLength:(int64_t)totalLength;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+/// The received bytes from the start of the body.
+@property (nonatomic, copy, readonly, nonnull) NSData *data;
+@property (nonatomic, copy, readonly, nonnull) SDHTTPCacheValidator *validator;
+/// The length of the full body, or 0 if unknown.
+@property (nonatomic, assign, readonly) int64_t totalLength;
+/// The `If-Range` header value, the strong entity tag or the last modified date. Nil means it can not be resumed.
+@property (nonatomic, copy, readonly, nullable) NSString *ifRangeValue;
+
+/// Apply the `Range` and `If-Range` header to the request.
+- (void)applyToRequest:(nonnull NSMutableURLRequest *)request;
+
+/// Create the resume data from the received body and its response. Return nil if the response does not allow resuming.
++ (nullable instancetype)resumeDataWithData:(nonnull NSData *)data response:(nonnull NSURLResponse *)response totalLength:(int64_t)totalLength;
+/// Return the first byte position of the `206 Partial Content` response, or -1 if the response is not partial.
++ (int64_t)rangeStartWithResponse:(nonnull NSURLResponse *)response;
+
+@end
+
+/// The store of partial bodies for resumable downloads, used by `SDWebImageDownloader`.
+/// The partial bodies are kept in memory under the memory limit, and in the partial-file directory under the disk limit, the least recently written ones are removed first. The store and disk write are asynchronous, the lookup waits for the pending stores. All the methods are thread-safe.
+@interface SDWebImageDownloaderResumeDataStore : NSObject
+
+- (nonnull instancetype)initWithMemoryLimit:(NSUInteger)memoryLimit diskLimit:(NSUInteger)diskLimit diskPath:(nullable NSString *)diskPath;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+/// The partial body smaller than this is not kept, it's cheaper to download again.
+@property (nonatomic, assign) NSUInteger minimumDataSize;
+
+- (nullable SDWebImageDownloaderResumeData *)resumeDataForURL:(nonnull NSURL *)url;
+- (void)setResumeData:(nonnull SDWebImageDownloaderResumeData *)resumeData forURL:(nonnull NSURL *)url;
+/// Create the resume data by block in background, such as flattening the received body, then store it. The lookup of the same URL waits for it.
+- (void)setResumeDataForURL:(nonnull NSURL *)url withBlock:(nonnull SDWebImageDownloaderResumeData * _Nullable (^)(void))block;
+- (void)removeResumeDataForURL:(nonnull NSURL *)url;
+- (void)removeAllResumeData;
+
+@end
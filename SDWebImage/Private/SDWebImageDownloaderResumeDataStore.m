@@ -0,0 +1,298 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageDownloaderResumeDataStore.h"
+#import "SDFileAttributeHelper.h"
+#import "SDInternalMacros.h"
+#import <CommonCrypto/CommonDigest.h>
+
+static NSString * const SDResumeDataExtendedAttributeName = @"com.hackemist.SDWebImageDownloader.resume";
+static NSString * const SDResumeDataValidatorKey = @"validator";
+static NSString * const SDResumeDataTotalLengthKey = @"totalLength";
+
+// The header fields are case insensitive
+static NSString * SDResumeDataHeaderValue(NSURLResponse *response, NSString *field) {
+    if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return nil;
+    }
+    NSDictionary *headers = ((NSHTTPURLResponse *)response).allHeaderFields;
+    for (NSString *key in headers) {
+        if ([key isKindOfClass:[NSString class]] && [key caseInsensitiveCompare:field] == NSOrderedSame) {
+            id value = headers[key];
+            return [value isKindOfClass:[NSString class]] ? value : nil;
+        }
+    }
+    return nil;
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+static NSString * SDResumeDataFileNameForURL(NSURL *url) {
+    const char *str = url.absoluteString.UTF8String;
+    if (str == NULL) {
+        str = "";
+    }
+    unsigned char r[CC_MD5_DIGEST_LENGTH];
+    CC_MD5(str, (CC_LONG)strlen(str), r);
+    return [NSString stringWithFormat:@"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x.partial",
+            r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7], r[8], r[9], r[10], r[11], r[12], r[13], r[14], r[15]];
+}
+#pragma clang diagnostic pop
+
+@implementation SDWebImageDownloaderResumeData
+
+- (instancetype)initWithData:(NSData *)data validator:(SDHTTPCacheValidator *)validator totalLength:(int64_t)totalLength {
+    self = [super init];
+    if (self) {
+        _data = [data copy];
+        _validator = [validator copy];
+        _totalLength = MAX(totalLength, 0);
+    }
+    return self;
+}
+
+- (NSString *)ifRangeValue {
+    // The weak entity tag can not be used for range request, see RFC 7233 section 3.2
+    NSString *entityTag = self.validator.entityTag;
+    if (entityTag.length > 0 && ![entityTag hasPrefix:@"W/"]) {
+        return entityTag;
+    }
+    NSString *lastModified = self.validator.lastModified;
+    if (lastModified.length > 0) {
+        return lastModified;
+    }
+    return nil;
+}
+
+- (void)applyToRequest:(NSMutableURLRequest *)request {
+    NSString *ifRangeValue = self.ifRangeValue;
+    if (!ifRangeValue || self.data.length == 0) {
+        return;
+    }
+    [request setValue:[NSString stringWithFormat:@"bytes=%lu-", (unsigned long)self.data.length] forHTTPHeaderField:@"Range"];
+    [request setValue:ifRangeValue forHTTPHeaderField:@"If-Range"];
+}
+
++ (instancetype)resumeDataWithData:(NSData *)data response:(NSURLResponse *)response totalLength:(int64_t)totalLength {
+    if (data.length == 0 || ![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return nil;
+    }
+    NSInteger statusCode = ((NSHTTPURLResponse *)response).statusCode;
+    if (statusCode != 200 && statusCode != 206) {
+        return nil;
+    }
+    NSString *acceptRanges = SDResumeDataHeaderValue(response, @"Accept-Ranges");
+    if ([acceptRanges caseInsensitiveCompare:@"none"] == NSOrderedSame) {
+        return nil;
+    }
+    // The compressed body is decoded by URLSession, the received bytes can not map to the range of content
+    NSString *contentEncoding = SDResumeDataHeaderValue(response, @"Content-Encoding");
+    if (contentEncoding.length > 0 && [contentEncoding caseInsensitiveCompare:@"identity"] != NSOrderedSame) {
+        return nil;
+    }
+    SDWebImageDownloaderResumeData *resumeData = [[self alloc] initWithData:data validator:[SDHTTPCacheValidator validatorWithResponse:response] totalLength:totalLength];
+    if (!resumeData.ifRangeValue) {
+        return nil;
+    }
+    return resumeData;
+}
+
++ (int64_t)rangeStartWithResponse:(NSURLResponse *)response {
+    if (![response isKindOfClass:[NSHTTPURLResponse class]] || ((NSHTTPURLResponse *)response).statusCode != 206) {
+        return -1;
+    }
+    // Such as `bytes 1000-1999/2000`
+    NSString *contentRange = SDResumeDataHeaderValue(response, @"Content-Range");
+    NSScanner *scanner = [NSScanner scannerWithString:contentRange ?: @""];
+    long long start = 0;
+    if (![scanner scanString:@"bytes" intoString:nil] || ![scanner scanLongLong:&start] || start < 0) {
+        return -1;
+    }
+    return start;
+}
+
+@end
+
+@interface SDWebImageDownloaderResumeDataStore ()
+
+@property (nonatomic, strong, nonnull) NSCache<NSString *, SDWebImageDownloaderResumeData *> *memoryCache;
+@property (nonatomic, assign) NSUInteger memoryLimit; // NSCache treats 0 as no limit, we treat it as disabled
+@property (nonatomic, assign) NSUInteger diskLimit;
+@property (nonatomic, copy, nullable) NSString *diskPath;
+@property (nonatomic, strong, nonnull) dispatch_queue_t ioQueue;
+@property (nonatomic, strong, nonnull) NSFileManager *fileManager;
+
+@end
+
+@implementation SDWebImageDownloaderResumeDataStore
+
+- (instancetype)initWithMemoryLimit:(NSUInteger)memoryLimit diskLimit:(NSUInteger)diskLimit diskPath:(NSString *)diskPath {
+    self = [super init];
+    if (self) {
+        _memoryCache = [[NSCache alloc] init];
+        _memoryCache.name = @"com.hackemist.SDWebImageDownloaderResumeDataStore";
+        _memoryCache.totalCostLimit = memoryLimit;
+        _memoryLimit = memoryLimit;
+        _diskLimit = diskPath ? diskLimit : 0;
+        _diskPath = [diskPath copy];
+        _ioQueue = dispatch_queue_create("com.hackemist.SDWebImageDownloaderResumeDataStore", DISPATCH_QUEUE_SERIAL);
+        _fileManager = [NSFileManager new];
+    }
+    return self;
+}
+
+- (SDWebImageDownloaderResumeData *)resumeDataForURL:(NSURL *)url {
+    NSString *key = url.absoluteString;
+    if (!key) {
+        return nil;
+    }
+    __block SDWebImageDownloaderResumeData *resumeData = [self.memoryCache objectForKey:key];
+    if (resumeData) {
+        return resumeData;
+    }
+    // Wait for the pending stores of the same URL
+    NSString *path = self.diskPath ? [self.diskPath stringByAppendingPathComponent:SDResumeDataFileNameForURL(url)] : nil;
+    __block NSData *data;
+    __block NSData *attribute;
+    dispatch_sync(self.ioQueue, ^{
+        resumeData = [self.memoryCache objectForKey:key];
+        if (resumeData || self.diskLimit == 0) {
+            return;
+        }
+        data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+        if (data) {
+            attribute = [SDFileAttributeHelper extendedAttribute:SDResumeDataExtendedAttributeName atPath:path traverseLink:NO error:nil];
+        }
+    });
+    if (resumeData) {
+        return resumeData;
+    }
+    if (data.length == 0 || !attribute) {
+        return nil;
+    }
+    NSDictionary *metadata = [NSPropertyListSerialization propertyListWithData:attribute options:NSPropertyListImmutable format:nil error:nil];
+    if (![metadata isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+    NSData *validatorData = metadata[SDResumeDataValidatorKey];
+    SDHTTPCacheValidator *validator = [validatorData isKindOfClass:[NSData class]] ? [SDHTTPCacheValidator validatorWithArchivedData:validatorData] : nil;
+    if (!validator) {
+        return nil;
+    }
+    NSNumber *totalLength = metadata[SDResumeDataTotalLengthKey];
+    return [[SDWebImageDownloaderResumeData alloc] initWithData:data validator:validator totalLength:[totalLength isKindOfClass:[NSNumber class]] ? totalLength.longLongValue : 0];
+}
+
+- (void)setResumeData:(SDWebImageDownloaderResumeData *)resumeData forURL:(NSURL *)url {
+    [self setResumeDataForURL:url withBlock:^SDWebImageDownloaderResumeData * _Nullable{
+        return resumeData;
+    }];
+}
+
+- (void)setResumeDataForURL:(NSURL *)url withBlock:(SDWebImageDownloaderResumeData * _Nullable (^)(void))block {
+    if (!url.absoluteString || !block) {
+        return;
+    }
+    // The cancel usually happens on main queue, create and write in background
+    dispatch_async(self.ioQueue, ^{
+        @autoreleasepool {
+            SDWebImageDownloaderResumeData *resumeData = block();
+            if (resumeData) {
+                [self storeResumeData:resumeData forURL:url];
+            }
+        }
+    });
+}
+
+- (void)removeResumeDataForURL:(NSURL *)url {
+    NSString *key = url.absoluteString;
+    if (!key) {
+        return;
+    }
+    [self.memoryCache removeObjectForKey:key];
+    NSString *path = self.diskPath ? [self.diskPath stringByAppendingPathComponent:SDResumeDataFileNameForURL(url)] : nil;
+    dispatch_async(self.ioQueue, ^{
+        // Remove again after the pending stores of the same URL
+        [self.memoryCache removeObjectForKey:key];
+        if (self.diskLimit > 0) {
+            [self.fileManager removeItemAtPath:path error:nil];
+        }
+    });
+}
+
+- (void)removeAllResumeData {
+    [self.memoryCache removeAllObjects];
+    if (self.diskLimit == 0) {
+        return;
+    }
+    dispatch_async(self.ioQueue, ^{
+        [self.fileManager removeItemAtPath:self.diskPath error:nil];
+    });
+}
+
+#pragma mark - Helper
+
+// Call on IO queue
+- (void)storeResumeData:(nonnull SDWebImageDownloaderResumeData *)resumeData forURL:(nonnull NSURL *)url {
+    NSString *key = url.absoluteString;
+    NSUInteger length = resumeData.data.length;
+    if (length == 0 || length < self.minimumDataSize) {
+        return;
+    }
+    if (length <= self.memoryLimit) {
+        [self.memoryCache setObject:resumeData forKey:key cost:length];
+    } else {
+        [self.memoryCache removeObjectForKey:key];
+    }
+    if (self.diskLimit == 0 || length > self.diskLimit) {
+        return;
+    }
+    NSString *path = [self.diskPath stringByAppendingPathComponent:SDResumeDataFileNameForURL(url)];
+    NSDictionary *metadata = @{SDResumeDataValidatorKey : resumeData.validator.archivedData, SDResumeDataTotalLengthKey : @(resumeData.totalLength)};
+    NSData *attribute = [NSPropertyListSerialization dataWithPropertyList:metadata format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    [self.fileManager createDirectoryAtPath:self.diskPath withIntermediateDirectories:YES attributes:nil error:nil];
+    if (![resumeData.data writeToFile:path options:NSDataWritingAtomic error:nil]) {
+        return;
+    }
+    if (!attribute || ![SDFileAttributeHelper setExtendedAttribute:SDResumeDataExtendedAttributeName value:attribute atPath:path traverseLink:NO overwrite:YES error:nil]) {
+        [self.fileManager removeItemAtPath:path error:nil];
+        return;
+    }
+    [self trimDiskToLimit];
+}
+
+
+// Call on IO queue. Remove the least recently written files until the total size is under limit
+- (void)trimDiskToLimit {
+    NSURL *diskURL = [NSURL fileURLWithPath:self.diskPath isDirectory:YES];
+    NSArray<NSURLResourceKey> *resourceKeys = @[NSURLContentModificationDateKey, NSURLTotalFileAllocatedSizeKey];
+    NSArray<NSURL *> *fileURLs = [self.fileManager contentsOfDirectoryAtURL:diskURL includingPropertiesForKeys:resourceKeys options:NSDirectoryEnumerationSkipsHiddenFiles error:nil];
+    NSUInteger totalSize = 0;
+    NSMutableDictionary<NSURL *, NSDictionary<NSURLResourceKey, id> *> *files = [NSMutableDictionary dictionaryWithCapacity:fileURLs.count];
+    for (NSURL *fileURL in fileURLs) {
+        NSDictionary<NSURLResourceKey, id> *resourceValues = [fileURL resourceValuesForKeys:resourceKeys error:nil];
+        totalSize += [resourceValues[NSURLTotalFileAllocatedSizeKey] unsignedIntegerValue];
+        files[fileURL] = resourceValues;
+    }
+    if (totalSize <= self.diskLimit) {
+        return;
+    }
+    NSArray<NSURL *> *sortedFileURLs = [files keysSortedByValueUsingComparator:^NSComparisonResult(NSDictionary<NSURLResourceKey, id> *obj1, NSDictionary<NSURLResourceKey, id> *obj2) {
+        return [obj1[NSURLContentModificationDateKey] compare:obj2[NSURLContentModificationDateKey]];
+    }];
+    for (NSURL *fileURL in sortedFileURLs) {
+        if (totalSize <= self.diskLimit) {
+            break;
+        }
+        if ([self.fileManager removeItemAtURL:fileURL error:nil]) {
+            totalSize -= [files[fileURL][NSURLTotalFileAllocatedSizeKey] unsignedIntegerValue];
+        }
+    }
+}
+
+@end
@@ -0,0 +1,52 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+#import "SDWebImageDownloaderConfig.h"
+#import "SDWebImageDownloaderOperation.h"
+
+/// The scheduler of download operations, used by `SDWebImageDownloader` instead of `NSOperationQueue`.
+/// The pending operations are grouped by URL host, each host keeps a binary heap ordered by priority, and by the execution order for the same priority, so the enqueue, dequeue and reprioritization are O(log n) without any operation dependency. The hosts with the same top priority are served in round-robin, under the per-host limits. The operation is started directly when a slot is available, and the priority of running operation is forwarded to its `NSURLSessionTask`. All the methods are thread-safe.
+@interface SDWebImageDownloaderScheduler : NSObject
+
+- (nonnull instancetype)initWithExecutionOrder:(SDWebImageDownloaderExecutionOrder)executionOrder;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+/// The order of the operations with the same priority in one host, the pending operations are reordered when changed.
+@property (nonatomic, assign) SDWebImageDownloaderExecutionOrder executionOrder;
+/// The maximum number of running operations, 0 or negative value means no limit.
+@property (nonatomic, assign) NSInteger maxConcurrentOperationCount;
+/// The maximum number of running operations for each host, 0 or negative value means no limit.
+@property (nonatomic, assign) NSInteger maxConcurrentOperationCountPerHost;
+/// The maximum number of running operations for the specify host or `*.` host suffix pattern, which overrides `maxConcurrentOperationCountPerHost`.
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSNumber *> *maxConcurrentOperationCountForHosts;
+/// The maximum number of pending operations for each host, the one which would start last is cancelled when exceeded. 0 or negative value means no limit.
+@property (nonatomic, assign) NSInteger maxPendingOperationCountPerHost;
+/// The suspended scheduler does not start the pending operations.
+@property (nonatomic, assign, getter=isSuspended) BOOL suspended;
+/// The number of pending and running operations.
+@property (nonatomic, assign, readonly) NSUInteger operationCount;
+/// The started operations which are not finished.
+@property (nonatomic, copy, readonly, nonnull) NSArray<NSOperation<SDWebImageDownloaderOperation> *> *runningOperations;
+
+/// Enqueue the operation with priority (the same range as `NSURLSessionTask.priority`, 0.0 to 1.0). The caller should call `operationDidFinish:` from the operation's completion block.
+- (void)addOperation:(nonnull NSOperation<SDWebImageDownloaderOperation> *)operation priority:(float)priority;
+/// Set the priority requested by one requester of pending or running operation, such as the download token. The operation takes the highest priority of its live requesters, or the priority when added if there is none. The requester is held weakly.
+- (void)setPriority:(float)priority forOperation:(nonnull NSOperation<SDWebImageDownloaderOperation> *)operation requester:(nonnull id)requester;
+/// Remove the priority requested by the requester, such as the requester is cancelled.
+- (void)removeRequester:(nonnull id)requester forOperation:(nonnull NSOperation<SDWebImageDownloaderOperation> *)operation;
+/// Return the priority of the operation, or `NSURLSessionTaskPriorityDefault` if the operation is not scheduled.
+- (float)priorityForOperation:(nonnull NSOperation<SDWebImageDownloaderOperation> *)operation;
+/// Start the cancelled pending operation immediately, so it finishes without waiting for its turn.
+- (void)operationDidCancel:(nonnull NSOperation<SDWebImageDownloaderOperation> *)operation;
+/// Remove the finished operation, and start the next pending ones.
+- (void)operationDidFinish:(nonnull NSOperation<SDWebImageDownloaderOperation> *)operation;
+/// Cancel all the pending and running operations.
+- (void)cancelAllOperations;
+
+@end
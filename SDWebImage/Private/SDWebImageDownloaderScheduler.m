@@ -0,0 +1,567 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageDownloaderScheduler.h"
+#import "SDInternalMacros.h"
+
+@class SDWebImageDownloaderSchedulerHost;
+
+// A scheduled operation, the heap index is NSNotFound after it's started
+@interface SDWebImageDownloaderSchedulerEntry : NSObject
+
+@property (nonatomic, strong, nonnull) NSOperation<SDWebImageDownloaderOperation> *operation;
+@property (nonatomic, strong, nonnull) SDWebImageDownloaderSchedulerHost *host;
+@property (nonatomic, assign) float priority;
+@property (nonatomic, assign) float basePriority; // The priority when added, used when there is no live requester
+@property (nonatomic, strong, nullable) NSMapTable<id, NSNumber *> *requestedPriorities; // weak requester -> priority
+@property (nonatomic, assign) uint64_t sequence;
+@property (nonatomic, assign) NSUInteger heapIndex;
+
+@end
+
+@implementation SDWebImageDownloaderSchedulerEntry
+@end
+
+// The pending and running operations of one host
+@interface SDWebImageDownloaderSchedulerHost : NSObject
+
+@property (nonatomic, copy, nonnull) NSString *name;
+@property (nonatomic, strong, nonnull) NSMutableArray<SDWebImageDownloaderSchedulerEntry *> *heap;
+@property (nonatomic, assign) NSUInteger runningCount;
+@property (nonatomic, assign) NSInteger maxConcurrentCount; // 0 means no limit
+@property (nonatomic, assign) uint64_t lastServed; // For the round-robin between hosts
+
+@end
+
+@implementation SDWebImageDownloaderSchedulerHost
+@end
+
+static void SDSetOperationTaskPriority(NSOperation<SDWebImageDownloaderOperation> *operation, float priority) {
+    if (![operation respondsToSelector:@selector(dataTask)]) {
+        return;
+    }
+    NSURLSessionTask *task;
+    @synchronized (operation) {
+        task = operation.dataTask;
+    }
+    task.priority = priority;
+}
+
+@interface SDWebImageDownloaderScheduler () {
+    SD_LOCK_DECLARE(_lock); // A lock to keep the access to hosts and entries thread-safe
+}
+
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDWebImageDownloaderSchedulerHost *> *hosts; // hosts with pending or running ones
+@property (nonatomic, strong, nonnull) NSMapTable<NSOperation *, SDWebImageDownloaderSchedulerEntry *> *entries; // pending and running ones
+@property (nonatomic, assign) NSUInteger runningCount;
+@property (nonatomic, assign) uint64_t sequence;
+@property (nonatomic, assign) uint64_t servedCount;
+@property (nonatomic, strong, nonnull) dispatch_queue_t startQueue; // concurrent, a slow `start` does not delay others
+
+@end
+
+@implementation SDWebImageDownloaderScheduler
+
+@synthesize executionOrder = _executionOrder;
+@synthesize maxConcurrentOperationCount = _maxConcurrentOperationCount;
+@synthesize maxConcurrentOperationCountPerHost = _maxConcurrentOperationCountPerHost;
+@synthesize maxConcurrentOperationCountForHosts = _maxConcurrentOperationCountForHosts;
+@synthesize maxPendingOperationCountPerHost = _maxPendingOperationCountPerHost;
+@synthesize suspended = _suspended;
+
+- (instancetype)initWithExecutionOrder:(SDWebImageDownloaderExecutionOrder)executionOrder {
+    self = [super init];
+    if (self) {
+        _executionOrder = executionOrder;
+        _hosts = [NSMutableDictionary dictionary];
+        _entries = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+        _startQueue = dispatch_queue_create("com.hackemist.SDWebImageDownloaderScheduler", DISPATCH_QUEUE_CONCURRENT);
+        SD_LOCK_INIT(_lock);
+    }
+    return self;
+}
+
+#pragma mark - Properties
+
+- (SDWebImageDownloaderExecutionOrder)executionOrder {
+    SD_LOCK(_lock);
+    SDWebImageDownloaderExecutionOrder executionOrder = _executionOrder;
+    SD_UNLOCK(_lock);
+    return executionOrder;
+}
+
+- (void)setExecutionOrder:(SDWebImageDownloaderExecutionOrder)executionOrder {
+    SD_LOCK(_lock);
+    if (_executionOrder != executionOrder) {
+        _executionOrder = executionOrder;
+        // Rebuild the heaps with new order
+        for (SDWebImageDownloaderSchedulerHost *host in self.hosts.allValues) {
+            for (NSInteger index = (NSInteger)host.heap.count / 2 - 1; index >= 0; index--) {
+                [self siftDownAtIndex:index inHost:host];
+            }
+        }
+    }
+    SD_UNLOCK(_lock);
+}
+
+- (NSInteger)maxConcurrentOperationCount {
+    SD_LOCK(_lock);
+    NSInteger maxConcurrentOperationCount = _maxConcurrentOperationCount;
+    SD_UNLOCK(_lock);
+    return maxConcurrentOperationCount;
+}
+
+- (void)setMaxConcurrentOperationCount:(NSInteger)maxConcurrentOperationCount {
+    SD_LOCK(_lock);
+    _maxConcurrentOperationCount = maxConcurrentOperationCount;
+    SD_UNLOCK(_lock);
+    [self startPendingOperations];
+}
+
+- (NSInteger)maxConcurrentOperationCountPerHost {
+    SD_LOCK(_lock);
+    NSInteger maxConcurrentOperationCountPerHost = _maxConcurrentOperationCountPerHost;
+    SD_UNLOCK(_lock);
+    return maxConcurrentOperationCountPerHost;
+}
+
+- (void)setMaxConcurrentOperationCountPerHost:(NSInteger)maxConcurrentOperationCountPerHost {
+    SD_LOCK(_lock);
+    _maxConcurrentOperationCountPerHost = maxConcurrentOperationCountPerHost;
+    [self updateHostLimits];
+    SD_UNLOCK(_lock);
+    [self startPendingOperations];
+}
+
+- (NSDictionary<NSString *,NSNumber *> *)maxConcurrentOperationCountForHosts {
+    SD_LOCK(_lock);
+    NSDictionary<NSString *,NSNumber *> *maxConcurrentOperationCountForHosts = _maxConcurrentOperationCountForHosts;
+    SD_UNLOCK(_lock);
+    return maxConcurrentOperationCountForHosts;
+}
+
+- (void)setMaxConcurrentOperationCountForHosts:(NSDictionary<NSString *,NSNumber *> *)maxConcurrentOperationCountForHosts {
+    NSMutableDictionary<NSString *,NSNumber *> *limits = [NSMutableDictionary dictionaryWithCapacity:maxConcurrentOperationCountForHosts.count];
+    [maxConcurrentOperationCountForHosts enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull pattern, NSNumber * _Nonnull limit, BOOL * _Nonnull stop) {
+        limits[pattern.lowercaseString] = limit;
+    }];
+    SD_LOCK(_lock);
+    _maxConcurrentOperationCountForHosts = [limits copy];
+    [self updateHostLimits];
+    SD_UNLOCK(_lock);
+    [self startPendingOperations];
+}
+
+- (NSInteger)maxPendingOperationCountPerHost {
+    SD_LOCK(_lock);
+    NSInteger maxPendingOperationCountPerHost = _maxPendingOperationCountPerHost;
+    SD_UNLOCK(_lock);
+    return maxPendingOperationCountPerHost;
+}
+
+- (void)setMaxPendingOperationCountPerHost:(NSInteger)maxPendingOperationCountPerHost {
+    SD_LOCK(_lock);
+    _maxPendingOperationCountPerHost = maxPendingOperationCountPerHost;
+    SD_UNLOCK(_lock);
+    // The exceeded pending operations are dropped on next enqueue, like the NSURLSession does not cancel the running tasks when limit changes
+}
+
+- (BOOL)isSuspended {
+    SD_LOCK(_lock);
+    BOOL suspended = _suspended;
+    SD_UNLOCK(_lock);
+    return suspended;
+}
+
+- (void)setSuspended:(BOOL)suspended {
+    SD_LOCK(_lock);
+    _suspended = suspended;
+    SD_UNLOCK(_lock);
+    [self startPendingOperations];
+}
+
+- (NSUInteger)operationCount {
+    SD_LOCK(_lock);
+    NSUInteger operationCount = self.entries.count;
+    SD_UNLOCK(_lock);
+    return operationCount;
+}
+
+- (NSArray<NSOperation<SDWebImageDownloaderOperation> *> *)runningOperations {
+    NSMutableArray<NSOperation<SDWebImageDownloaderOperation> *> *runningOperations = [NSMutableArray array];
+    SD_LOCK(_lock);
+    for (SDWebImageDownloaderSchedulerEntry *entry in self.entries.objectEnumerator) {
+        if (entry.heapIndex == NSNotFound) {
+            [runningOperations addObject:entry.operation];
+        }
+    }
+    SD_UNLOCK(_lock);
+    return [runningOperations copy];
+}
+
+#pragma mark - Schedule
+
+- (void)addOperation:(NSOperation<SDWebImageDownloaderOperation> *)operation priority:(float)priority {
+    NSParameterAssert(operation);
+    NSString *hostName = operation.request.URL.host.lowercaseString ?: @"";
+    SDWebImageDownloaderSchedulerEntry *droppedEntry;
+    SD_LOCK(_lock);
+    if ([self.entries objectForKey:operation]) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+    SDWebImageDownloaderSchedulerHost *host = self.hosts[hostName];
+    if (!host) {
+        host = [SDWebImageDownloaderSchedulerHost new];
+        host.name = hostName;
+        host.heap = [NSMutableArray array];
+        host.maxConcurrentCount = [self maxConcurrentCountForHostName:hostName];
+        self.hosts[hostName] = host;
+    }
+    SDWebImageDownloaderSchedulerEntry *entry = [SDWebImageDownloaderSchedulerEntry new];
+    entry.operation = operation;
+    entry.host = host;
+    entry.priority = priority;
+    entry.basePriority = priority;
+    entry.sequence = self.sequence++;
+    entry.heapIndex = host.heap.count;
+    [host.heap addObject:entry];
+    [self siftUpAtIndex:entry.heapIndex inHost:host];
+    [self.entries setObject:entry forKey:operation];
+    NSInteger maxPendingCount = _maxPendingOperationCountPerHost;
+    if (maxPendingCount > 0 && host.heap.count > (NSUInteger)maxPendingCount) {
+        // Drop the one which would start last, which may be the new one. It takes a slot like the cancelled one, so it's not started before cancelled
+        droppedEntry = [self lastEntryInHost:host];
+        [self removeEntryAtIndex:droppedEntry.heapIndex inHost:host];
+        host.runningCount++;
+        self.runningCount++;
+    }
+    SD_UNLOCK(_lock);
+    if (droppedEntry) {
+        // Cancel asynchronously, the caller may hold its own lock, and the completion blocks of new operation should not be called before this method returns
+        dispatch_async(self.startQueue, ^{
+            [droppedEntry.operation cancel];
+            [self startEntries:@[droppedEntry]];
+        });
+    }
+    [self startPendingOperations];
+}
+
+- (void)setPriority:(float)priority forOperation:(NSOperation<SDWebImageDownloaderOperation> *)operation requester:(id)requester {
+    NSParameterAssert(operation);
+    NSParameterAssert(requester);
+    SD_LOCK(_lock);
+    SDWebImageDownloaderSchedulerEntry *entry = [self.entries objectForKey:operation];
+    if (!entry) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+    if (!entry.requestedPriorities) {
+        entry.requestedPriorities = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+    }
+    [entry.requestedPriorities setObject:@(priority) forKey:requester];
+    BOOL running = [self updatePriorityOfEntry:entry];
+    float runningPriority = entry.priority;
+    SD_UNLOCK(_lock);
+    if (running) {
+        // The session schedules the requests of same host by task priority, such as HTTP/2 streams
+        SDSetOperationTaskPriority(operation, runningPriority);
+    }
+}
+
+- (void)removeRequester:(id)requester forOperation:(NSOperation<SDWebImageDownloaderOperation> *)operation {
+    NSParameterAssert(operation);
+    NSParameterAssert(requester);
+    SD_LOCK(_lock);
+    SDWebImageDownloaderSchedulerEntry *entry = [self.entries objectForKey:operation];
+    if (!entry) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+    [entry.requestedPriorities removeObjectForKey:requester];
+    BOOL running = [self updatePriorityOfEntry:entry];
+    float runningPriority = entry.priority;
+    SD_UNLOCK(_lock);
+    if (running) {
+        SDSetOperationTaskPriority(operation, runningPriority);
+    }
+}
+
+// Call with lock held. Take the highest priority of the live requesters, so one requester can not lower the priority for others. Return YES if the priority of running operation is changed
+- (BOOL)updatePriorityOfEntry:(SDWebImageDownloaderSchedulerEntry *)entry {
+    BOOL hasRequester = NO;
+    float priority = entry.basePriority;
+    for (id requester in entry.requestedPriorities.keyEnumerator) {
+        NSNumber *requestedPriority = [entry.requestedPriorities objectForKey:requester];
+        if (requestedPriority) {
+            priority = hasRequester ? MAX(priority, requestedPriority.floatValue) : requestedPriority.floatValue;
+            hasRequester = YES;
+        }
+    }
+    if (entry.priority == priority) {
+        return NO;
+    }
+    float oldPriority = entry.priority;
+    entry.priority = priority;
+    if (entry.heapIndex == NSNotFound) {
+        return YES;
+    }
+    if (priority > oldPriority) {
+        [self siftUpAtIndex:entry.heapIndex inHost:entry.host];
+    } else {
+        [self siftDownAtIndex:entry.heapIndex inHost:entry.host];
+    }
+    return NO;
+}
+
+- (float)priorityForOperation:(NSOperation<SDWebImageDownloaderOperation> *)operation {
+    NSParameterAssert(operation);
+    SD_LOCK(_lock);
+    SDWebImageDownloaderSchedulerEntry *entry = [self.entries objectForKey:operation];
+    float priority = entry ? entry.priority : NSURLSessionTaskPriorityDefault;
+    SD_UNLOCK(_lock);
+    return priority;
+}
+
+- (void)operationDidCancel:(NSOperation<SDWebImageDownloaderOperation> *)operation {
+    NSParameterAssert(operation);
+    SD_LOCK(_lock);
+    SDWebImageDownloaderSchedulerEntry *entry = [self.entries objectForKey:operation];
+    BOOL pending = entry && entry.heapIndex != NSNotFound;
+    if (pending) {
+        // The operation contract requires start to finish the cancelled operation, it does not take the slot for long
+        [self removeEntryAtIndex:entry.heapIndex inHost:entry.host];
+        entry.host.runningCount++;
+        self.runningCount++;
+    }
+    SD_UNLOCK(_lock);
+    if (pending) {
+        [self startEntries:@[entry]];
+    }
+}
+
+- (void)operationDidFinish:(NSOperation<SDWebImageDownloaderOperation> *)operation {
+    NSParameterAssert(operation);
+    SD_LOCK(_lock);
+    SDWebImageDownloaderSchedulerEntry *entry = [self.entries objectForKey:operation];
+    if (!entry) {
+        SD_UNLOCK(_lock);
+        return;
+    }
+    [self.entries removeObjectForKey:operation];
+    SDWebImageDownloaderSchedulerHost *host = entry.host;
+    if (entry.heapIndex != NSNotFound) {
+        // Finished without start, the custom operation may do this
+        [self removeEntryAtIndex:entry.heapIndex inHost:host];
+    } else {
+        if (host.runningCount > 0) {
+            host.runningCount--;
+        }
+        if (self.runningCount > 0) {
+            self.runningCount--;
+        }
+    }
+    if (host.heap.count == 0 && host.runningCount == 0) {
+        [self.hosts removeObjectForKey:host.name];
+    }
+    SD_UNLOCK(_lock);
+    [self startPendingOperations];
+}
+
+- (void)cancelAllOperations {
+    SD_LOCK(_lock);
+    NSArray<NSOperation<SDWebImageDownloaderOperation> *> *operations = self.entries.keyEnumerator.allObjects;
+    SD_UNLOCK(_lock);
+    for (NSOperation<SDWebImageDownloaderOperation> *operation in operations) {
+        [operation cancel];
+        [self operationDidCancel:operation];
+    }
+}
+
+- (void)startPendingOperations {
+    NSMutableArray<SDWebImageDownloaderSchedulerEntry *> *entries;
+    SD_LOCK(_lock);
+    NSInteger maxCount = _maxConcurrentOperationCount;
+    while (!_suspended && (maxCount <= 0 || self.runningCount < (NSUInteger)maxCount)) {
+        SDWebImageDownloaderSchedulerHost *host = [self nextHost];
+        if (!host) {
+            break;
+        }
+        SDWebImageDownloaderSchedulerEntry *entry = host.heap.firstObject;
+        [self removeEntryAtIndex:0 inHost:host];
+        host.runningCount++;
+        host.lastServed = ++self.servedCount;
+        self.runningCount++;
+        if (!entries) {
+            entries = [NSMutableArray array];
+        }
+        [entries addObject:entry];
+    }
+    SD_UNLOCK(_lock);
+    if (entries) {
+        [self startEntries:entries];
+    }
+}
+
+// Start outside of the lock and the caller thread, the operation may finish synchronously. Each one is started in parallel, the `start` of custom operation may block
+- (void)startEntries:(NSArray<SDWebImageDownloaderSchedulerEntry *> *)entries {
+    for (SDWebImageDownloaderSchedulerEntry *entry in entries) {
+        dispatch_async(self.startQueue, ^{
+            NSOperation<SDWebImageDownloaderOperation> *operation = entry.operation;
+            [operation start];
+            // The priority may be changed before start
+            SD_LOCK(self->_lock);
+            float priority = entry.priority;
+            SD_UNLOCK(self->_lock);
+            SDSetOperationTaskPriority(operation, priority);
+        });
+    }
+}
+
+#pragma mark - Hosts
+
+// Call with lock held. The host with higher priority goes first, and the hosts with same priority are served in round-robin, so a stalled host can not take all the slots
+- (nullable SDWebImageDownloaderSchedulerHost *)nextHost {
+    SDWebImageDownloaderSchedulerHost *nextHost;
+    for (SDWebImageDownloaderSchedulerHost *host in self.hosts.objectEnumerator) {
+        if (host.heap.count == 0) {
+            continue;
+        }
+        if (host.maxConcurrentCount > 0 && host.runningCount >= (NSUInteger)host.maxConcurrentCount) {
+            continue;
+        }
+        if (!nextHost) {
+            nextHost = host;
+            continue;
+        }
+        float priority = host.heap.firstObject.priority;
+        float nextPriority = nextHost.heap.firstObject.priority;
+        if (priority > nextPriority || (priority == nextPriority && host.lastServed < nextHost.lastServed)) {
+            nextHost = host;
+        }
+    }
+    return nextHost;
+}
+
+// Call with lock held. The exact host name wins, then the longest matched `*.` suffix pattern, then the default limit
+- (NSInteger)maxConcurrentCountForHostName:(NSString *)hostName {
+    NSDictionary<NSString *, NSNumber *> *limits = _maxConcurrentOperationCountForHosts;
+    NSNumber *limit = limits[hostName];
+    if (limit) {
+        return limit.integerValue;
+    }
+    NSUInteger matchedLength = 0;
+    for (NSString *pattern in limits) {
+        if (![pattern hasPrefix:@"*."] || pattern.length <= matchedLength) {
+            continue;
+        }
+        NSString *suffix = [pattern substringFromIndex:1];
+        if ([hostName hasSuffix:suffix] || [hostName isEqualToString:[pattern substringFromIndex:2]]) {
+            limit = limits[pattern];
+            matchedLength = pattern.length;
+        }
+    }
+    if (limit) {
+        return limit.integerValue;
+    }
+    return _maxConcurrentOperationCountPerHost;
+}
+
+// Call with lock held
+- (void)updateHostLimits {
+    for (SDWebImageDownloaderSchedulerHost *host in self.hosts.objectEnumerator) {
+        host.maxConcurrentCount = [self maxConcurrentCountForHostName:host.name];
+    }
+}
+
+#pragma mark - Heap
+
+// Call with lock held
+- (BOOL)entry:(SDWebImageDownloaderSchedulerEntry *)entry precedesEntry:(SDWebImageDownloaderSchedulerEntry *)otherEntry {
+    if (entry.priority != otherEntry.priority) {
+        return entry.priority > otherEntry.priority;
+    }
+    if (_executionOrder == SDWebImageDownloaderLIFOExecutionOrder) {
+        return entry.sequence > otherEntry.sequence;
+    }
+    return entry.sequence < otherEntry.sequence;
+}
+
+// The last one is a leaf of the heap
+- (nullable SDWebImageDownloaderSchedulerEntry *)lastEntryInHost:(SDWebImageDownloaderSchedulerHost *)host {
+    NSMutableArray<SDWebImageDownloaderSchedulerEntry *> *heap = host.heap;
+    SDWebImageDownloaderSchedulerEntry *lastEntry;
+    for (NSUInteger index = heap.count / 2; index < heap.count; index++) {
+        SDWebImageDownloaderSchedulerEntry *entry = heap[index];
+        if (!lastEntry || [self entry:lastEntry precedesEntry:entry]) {
+            lastEntry = entry;
+        }
+    }
+    return lastEntry;
+}
+
+- (void)swapEntryAtIndex:(NSUInteger)index withIndex:(NSUInteger)otherIndex inHost:(SDWebImageDownloaderSchedulerHost *)host {
+    NSMutableArray<SDWebImageDownloaderSchedulerEntry *> *heap = host.heap;
+    [heap exchangeObjectAtIndex:index withObjectAtIndex:otherIndex];
+    heap[index].heapIndex = index;
+    heap[otherIndex].heapIndex = otherIndex;
+}
+
+- (void)siftUpAtIndex:(NSUInteger)index inHost:(SDWebImageDownloaderSchedulerHost *)host {
+    NSMutableArray<SDWebImageDownloaderSchedulerEntry *> *heap = host.heap;
+    while (index > 0) {
+        NSUInteger parent = (index - 1) / 2;
+        if (![self entry:heap[index] precedesEntry:heap[parent]]) {
+            break;
+        }
+        [self swapEntryAtIndex:index withIndex:parent inHost:host];
+        index = parent;
+    }
+}
+
+- (void)siftDownAtIndex:(NSUInteger)index inHost:(SDWebImageDownloaderSchedulerHost *)host {
+    NSMutableArray<SDWebImageDownloaderSchedulerEntry *> *heap = host.heap;
+    NSUInteger count = heap.count;
+    while (YES) {
+        NSUInteger left = index * 2 + 1;
+        NSUInteger right = left + 1;
+        NSUInteger first = index;
+        if (left < count && [self entry:heap[left] precedesEntry:heap[first]]) {
+            first = left;
+        }
+        if (right < count && [self entry:heap[right] precedesEntry:heap[first]]) {
+            first = right;
+        }
+        if (first == index) {
+            break;
+        }
+        [self swapEntryAtIndex:index withIndex:first inHost:host];
+        index = first;
+    }
+}
+
+- (void)removeEntryAtIndex:(NSUInteger)index inHost:(SDWebImageDownloaderSchedulerHost *)host {
+    NSMutableArray<SDWebImageDownloaderSchedulerEntry *> *heap = host.heap;
+    NSUInteger lastIndex = heap.count - 1;
+    SDWebImageDownloaderSchedulerEntry *entry = heap[index];
+    if (index != lastIndex) {
+        [self swapEntryAtIndex:index withIndex:lastIndex inHost:host];
+    }
+    [heap removeLastObject];
+    entry.heapIndex = NSNotFound;
+    if (index < heap.count) {
+        // The moved last entry may go either way
+        SDWebImageDownloaderSchedulerEntry *movedEntry = heap[index];
+        [self siftUpAtIndex:index inHost:host];
+        if (movedEntry.heapIndex == index) {
+            [self siftDownAtIndex:index inHost:host];
+        }
+    }
+}
+
+@end
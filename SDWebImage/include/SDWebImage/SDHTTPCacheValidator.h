@@ -0,0 +1 @@
+../../Core/SDHTTPCacheValidator.h
\ No newline at end of file
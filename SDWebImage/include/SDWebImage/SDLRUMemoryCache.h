@@ -0,0 +1 @@
+../../Core/SDLRUMemoryCache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../Core/SDMemoryPressureCoordinator.h
\ No newline at end of file
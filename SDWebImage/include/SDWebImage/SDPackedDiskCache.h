@@ -0,0 +1 @@
+../../Core/SDPackedDiskCache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../Core/SDWebImageDownloaderConcurrencyController.h
\ No newline at end of file
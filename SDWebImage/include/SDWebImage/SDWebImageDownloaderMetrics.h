@@ -0,0 +1 @@
+../../Core/SDWebImageDownloaderMetrics.h
\ No newline at end of file
@@ -10,11 +10,17 @@
 #import "SDWebImageTestCoder.h"
 #import "SDMockFileManager.h"
 #import "SDWebImageTestCache.h"
+#import "SDBitmapDiskCache.h"
+#import <mach/mach.h>
+#import <sys/stat.h>
 
 static NSString *kTestImageKeyJPEG = @"TestImageKey.jpg";
 static NSString *kTestImageKeyPNG = @"TestImageKey.png";
 
-@interface SDImageCacheTests : SDTestCase <NSFileManagerDelegate>
+@interface SDImageCacheTests : SDTestCase <NSFileManagerDelegate, SDMemoryPressureResponder>
+
+@property (nonatomic, strong) SDLRUMemoryCache *memoryPressureCache;
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *memoryPressureCacheCounts;
 
 @end
 
@@ -883,8 +889,910 @@ static NSString *kTestImageKeyPNG = @"TestImageKey.png";
     expect(cacheFiles.count).equal(0);
 }
 
+- (void)test59QueryDiskCacheDecodeConcurrentlyWithExtendedData {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Query disk cache decode concurrently"];
+    expectation.expectedFulfillmentCount = 2;
+    SDImageCache *cache = [[SDImageCache alloc] initWithNamespace:@"test59"];
+    UIImage *JPEGImage = [[UIImage alloc] initWithContentsOfFile:[self testJPEGPath]];
+    JPEGImage.sd_extendedObject = @"JPEG";
+    UIImage *PNGImage = [self testPNGImage];
+    [cache storeImage:JPEGImage imageData:nil forKey:kTestImageKeyJPEG cacheType:SDImageCacheTypeDisk completion:nil];
+    [cache storeImage:PNGImage imageData:nil forKey:kTestImageKeyPNG cacheType:SDImageCacheTypeDisk completion:^{
+        [cache queryCacheOperationForKey:kTestImageKeyJPEG done:^(UIImage * _Nullable image, NSData * _Nullable data, SDImageCacheType cacheType) {
+            expect([NSThread isMainThread]).beTruthy();
+            expect(cacheType).equal(SDImageCacheTypeDisk);
+            expect(image.size).equal(JPEGImage.size);
+            expect(image.sd_extendedObject).equal(@"JPEG");
+            [expectation fulfill];
+        }];
+        [cache queryCacheOperationForKey:kTestImageKeyPNG done:^(UIImage * _Nullable image, NSData * _Nullable data, SDImageCacheType cacheType) {
+            expect([NSThread isMainThread]).beTruthy();
+            expect(cacheType).equal(SDImageCacheTypeDisk);
+            expect(image.size).equal(PNGImage.size);
+            [expectation fulfill];
+        }];
+    }];
+    
+    [self waitForExpectationsWithCommonTimeoutUsingHandler:^(NSError * _Nullable error) {
+        [cache clearDiskOnCompletion:nil];
+    }];
+}
+
+- (void)test60DiskCacheIndex {
+    NSString *cachePath = [[self userCacheDirectory] stringByAppendingPathComponent:@"diskIndex"];
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.shouldUseDiskCacheIndex = YES;
+    config.maxDiskAge = -1;
+    SDDiskCache *diskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+    [diskCache removeAllData];
+    expect(diskCache.totalSize).equal(0);
+    expect(diskCache.totalCount).equal(0);
+    
+    NSData *data = [NSData dataWithContentsOfFile:[self testPNGPath]];
+    [diskCache setData:data forKey:@"a.png"];
+    [diskCache setData:data forKey:@"b.png"];
+    [diskCache setData:data forKey:@"c.png"];
+    expect(diskCache.totalSize).equal(data.length * 3);
+    expect(diskCache.totalCount).equal(3);
+    [diskCache removeDataForKey:@"b.png"];
+    expect(diskCache.totalSize).equal(data.length * 2);
+    expect(diskCache.totalCount).equal(2);
+    
+    // Manifest is written after expiration check, new instance load from it
+    [diskCache removeExpiredData];
+    SDDiskCache *loadedDiskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+    expect(loadedDiskCache.totalCount).equal(2);
+    expect(loadedDiskCache.totalSize).equal(data.length * 2);
+    
+    // Manifest is removed after mutation, new instance rebuild from directory
+    [diskCache setData:data forKey:@"d.png"];
+    SDDiskCache *rebuiltDiskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+    expect(rebuiltDiskCache.totalCount).equal(3);
+    expect(rebuiltDiskCache.totalSize).equal(data.length * 3);
+    
+    // Size limit evict the oldest first
+    config.maxDiskSize = data.length * 2;
+    SDDiskCache *limitedDiskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+    [limitedDiskCache setData:data forKey:@"e.png"];
+    [limitedDiskCache removeExpiredData];
+    expect(limitedDiskCache.totalCount).equal(0);
+    expect([limitedDiskCache containsDataForKey:@"e.png"]).beFalsy();
+    [limitedDiskCache setData:data forKey:@"a.png"];
+    config.maxDiskSize = data.length * 3;
+    [limitedDiskCache setData:data forKey:@"b.png"];
+    [limitedDiskCache setData:data forKey:@"c.png"];
+    [limitedDiskCache setData:data forKey:@"d.png"];
+    [limitedDiskCache removeExpiredData];
+    expect([limitedDiskCache containsDataForKey:@"a.png"]).beFalsy();
+    expect([limitedDiskCache containsDataForKey:@"d.png"]).beTruthy();
+    [limitedDiskCache removeAllData];
+}
+
+- (void)test61DiskCacheIndexTrimPerformance {
+    NSString *cachePath = [[self userCacheDirectory] stringByAppendingPathComponent:@"diskIndexPerformance"];
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.shouldUseDiskCacheIndex = YES;
+    SDDiskCache *diskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+    [diskCache removeAllData];
+    // Increase the count to 100k or 500k to compare with the directory enumeration
+    NSUInteger count = 10000;
+    NSData *data = [@"SDDiskCacheIndex" dataUsingEncoding:NSUTF8StringEncoding];
+    for (NSUInteger i = 0; i < count; i++) {
+        [diskCache setData:data forKey:@(i).stringValue];
+    }
+    [self measureBlock:^{
+        [diskCache removeExpiredData];
+        expect(diskCache.totalCount).equal(count);
+        expect(diskCache.totalSize).equal(count * data.length);
+    }];
+    [diskCache removeAllData];
+}
+
+- (void)test62PackedDiskCache {
+    NSString *cachePath = [[self userCacheDirectory] stringByAppendingPathComponent:@"packedDiskCache"];
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    SDPackedDiskCache *diskCache = [[SDPackedDiskCache alloc] initWithCachePath:cachePath config:config];
+    [diskCache removeAllData];
+    expect(diskCache.totalCount).equal(0);
+    
+    NSData *smallData = [@"SDPackedDiskCache" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *extendedData = [@"extended" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *largeData = [NSData dataWithContentsOfFile:[self testJPEGPath]];
+    diskCache.maxPackedDataSize = largeData.length - 1;
+    [diskCache setData:smallData forKey:@"a"];
+    [diskCache setExtendedData:extendedData forKey:@"a"];
+    [diskCache setData:smallData forKey:@"b"];
+    [diskCache setData:largeData forKey:@"c"];
+    expect([diskCache dataForKey:@"a"]).equal(smallData);
+    expect([diskCache extendedDataForKey:@"a"]).equal(extendedData);
+    expect([diskCache dataForKey:@"c"]).equal(largeData);
+    // Packed data does not have standalone file, large data does
+    expect([diskCache cachePathForKey:@"a"]).beNil();
+    expect([[NSFileManager defaultManager] fileExistsAtPath:[diskCache cachePathForKey:@"c"]]).beTruthy();
+    expect(diskCache.totalCount).equal(3);
+    
+    // Overwrite reset the extended data, remove append a tombstone
+    [diskCache setData:smallData forKey:@"b"];
+    [diskCache removeDataForKey:@"a"];
+    expect([diskCache containsDataForKey:@"a"]).beFalsy();
+    expect(diskCache.totalCount).equal(2);
+    
+    // New instance replay the segment files
+    SDPackedDiskCache *loadedDiskCache = [[SDPackedDiskCache alloc] initWithCachePath:cachePath config:config];
+    expect([loadedDiskCache containsDataForKey:@"a"]).beFalsy();
+    expect([loadedDiskCache dataForKey:@"b"]).equal(smallData);
+    expect([loadedDiskCache dataForKey:@"c"]).equal(largeData);
+    expect(loadedDiskCache.totalCount).equal(2);
+    [loadedDiskCache removeAllData];
+    
+    // Compaction drop the overwritten records and keep the live ones
+    SDPackedDiskCache *compactedDiskCache = [[SDPackedDiskCache alloc] initWithCachePath:cachePath config:config];
+    compactedDiskCache.maxSegmentSize = 256;
+    for (NSUInteger i = 0; i < 100; i++) {
+        [compactedDiskCache setData:smallData forKey:@(i % 10).stringValue];
+    }
+    [compactedDiskCache setExtendedData:extendedData forKey:@"0"];
+    // Background compaction may already happen, compare with the size of all the appended records
+    NSUInteger totalSize = 100 * (24 + 1 + smallData.length);
+    [compactedDiskCache compact];
+    expect(compactedDiskCache.totalSize).beLessThan(totalSize / 2);
+    expect(compactedDiskCache.totalCount).equal(10);
+    SDPackedDiskCache *reloadedDiskCache = [[SDPackedDiskCache alloc] initWithCachePath:cachePath config:config];
+    expect(reloadedDiskCache.totalCount).equal(10);
+    expect([reloadedDiskCache dataForKey:@"9"]).equal(smallData);
+    expect([reloadedDiskCache extendedDataForKey:@"0"]).equal(extendedData);
+    [reloadedDiskCache removeAllData];
+}
+
+- (void)test63LRUMemoryCache {
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.shouldUseWeakMemoryCache = NO;
+    config.maxMemoryCount = 3;
+    // One shard to make the LRU order predictable
+    SDLRUMemoryCache *memoryCache = [[SDLRUMemoryCache alloc] initWithConfig:config shardCount:1];
+    expect(memoryCache.shardCount).equal(1);
+    NSObject *object = [NSObject new];
+    [memoryCache setObject:object forKey:@"1"];
+    [memoryCache setObject:object forKey:@"2"];
+    [memoryCache setObject:object forKey:@"3"];
+    // Access 1, then 2 is the least recently used
+    expect([memoryCache objectForKey:@"1"]).equal(object);
+    [memoryCache setObject:object forKey:@"4"];
+    expect([memoryCache objectForKey:@"2"]).beNil();
+    expect([memoryCache objectForKey:@"1"]).equal(object);
+    expect(memoryCache.totalCount).equal(3);
+    expect(memoryCache.hitCount).equal(2);
+    expect(memoryCache.missCount).equal(1);
+    expect(memoryCache.evictionCount).equal(1);
+    
+    // Cost limit
+    config.maxMemoryCount = 0;
+    config.maxMemoryCost = 10;
+    [memoryCache removeAllObjects];
+    [memoryCache resetStatistics];
+    [memoryCache setObject:object forKey:@"1" cost:4];
+    [memoryCache setObject:object forKey:@"2" cost:4];
+    [memoryCache setObject:object forKey:@"3" cost:4];
+    expect(memoryCache.totalCost).equal(8);
+    expect([memoryCache objectForKey:@"1"]).beNil();
+    expect(memoryCache.evictionCount).equal(1);
+    
+    // SLRU keep the accessed object when scanning new objects
+    SDLRUMemoryCache *slruMemoryCache = [[SDLRUMemoryCache alloc] initWithConfig:config shardCount:1];
+    slruMemoryCache.evictionPolicy = SDLRUMemoryCacheEvictionPolicySegmentedLRU;
+    [slruMemoryCache setObject:object forKey:@"hot" cost:2];
+    expect([slruMemoryCache objectForKey:@"hot"]).equal(object);
+    for (NSUInteger i = 0; i < 20; i++) {
+        [slruMemoryCache setObject:object forKey:@(i).stringValue cost:2];
+    }
+    expect([slruMemoryCache objectForKey:@"hot"]).equal(object);
+    expect(slruMemoryCache.totalCost).beLessThanOrEqualTo(10);
+    
+#if SD_UIKIT
+    // Weak cache
+    config.shouldUseWeakMemoryCache = YES;
+    object = [NSObject new];
+    [memoryCache setObject:object forKey:@"weak"];
+    [[NSNotificationCenter defaultCenter] postNotificationName:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    expect(memoryCache.totalCount).equal(0);
+    expect([memoryCache objectForKey:@"weak"]).equal(object);
+#endif
+}
+
+- (void)test64MemoryCacheContentionPerformance {
+    // Compare with `SDMemoryCache` by changing the class, the `NSCache` based one use a global lock
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.maxMemoryCount = 1000;
+    id<SDMemoryCache> memoryCache = [[SDLRUMemoryCache alloc] initWithConfig:config];
+    NSObject *object = [NSObject new];
+    NSUInteger threadCount = 8;
+    NSUInteger iterations = 20000;
+    [self measureBlock:^{
+        dispatch_apply(threadCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t thread) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                NSString *key = @((i * 7 + thread) % 2000).stringValue;
+                if (i % 4 == 0) {
+                    [memoryCache setObject:object forKey:key cost:1];
+                } else {
+                    [memoryCache objectForKey:key];
+                }
+            }
+        });
+    }];
+}
+
+- (void)test65BatchQueryImagesForKeys {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Batch query should query memory and disk cache with one operation"];
+    SDImageCache *cache = [[SDImageCache alloc] initWithNamespace:@"BatchQuery"];
+    NSData *imageData = [NSData dataWithContentsOfFile:[self testJPEGPath]];
+    UIImage *image = [self testJPEGImage];
+    [cache storeImageToMemory:image forKey:@"memory"];
+    [cache storeImageDataToDisk:imageData forKey:@"disk1"];
+    [cache storeImageDataToDisk:imageData forKey:@"disk2"];
+    NSArray<NSString *> *keys = @[@"memory", @"disk1", @"disk2", @"missing", @"disk1"];
+    
+    NSMutableArray<NSString *> *progressKeys = [NSMutableArray array];
+    id<SDWebImageOperation> operation = [cache queryImagesForKeys:keys options:0 context:nil progress:^(NSString * _Nonnull key, UIImage * _Nullable image, NSData * _Nullable data, SDImageCacheType cacheType) {
+        [progressKeys addObject:key];
+    } completion:^(NSDictionary<NSString *,UIImage *> * _Nonnull images, NSDictionary<NSString *,NSNumber *> * _Nonnull cacheTypes) {
+        expect([NSThread isMainThread]).beTruthy();
+        // Duplicated keys are queried once
+        expect(progressKeys.count).equal(4);
+        expect(progressKeys.firstObject).equal(@"memory");
+        expect(images.count).equal(3);
+        expect(images[@"memory"]).equal(image);
+        expect(images[@"disk1"]).notTo.beNil();
+        expect(images[@"disk2"]).notTo.beNil();
+        expect(cacheTypes[@"memory"].integerValue).equal(SDImageCacheTypeMemory);
+        expect(cacheTypes[@"disk1"].integerValue).equal(SDImageCacheTypeDisk);
+        expect(cacheTypes[@"missing"].integerValue).equal(SDImageCacheTypeNone);
+        // Disk images are written back to memory cache
+        expect([cache imageFromMemoryCacheForKey:@"disk2"]).equal(images[@"disk2"]);
+        [cache clearDiskOnCompletion:^{
+            [expectation fulfill];
+        }];
+    }];
+    expect(operation).notTo.beNil();
+    // The memory cache result is called synchronously
+    expect(progressKeys).equal(@[@"memory"]);
+    
+    // All in memory, completion is called synchronously
+    __block BOOL called = NO;
+    operation = [cache queryImagesForKeys:@[@"memory"] options:0 context:nil completion:^(NSDictionary<NSString *,UIImage *> * _Nonnull images, NSDictionary<NSString *,NSNumber *> * _Nonnull cacheTypes) {
+        called = YES;
+    }];
+    expect(operation).beNil();
+    expect(called).beTruthy();
+    
+    // Cancelled batch should callback once with the results so far
+    XCTestExpectation *cancelExpectation = [self expectationWithDescription:@"Cancelled batch query should callback with partial results"];
+    [cache storeImageToMemory:image forKey:@"hit"];
+    [cache removeImageFromMemoryForKey:@"memory"];
+    [cache storeImageDataToDisk:imageData forKey:@"memory"];
+    operation = [cache queryImagesForKeys:@[@"hit", @"memory"] options:0 context:nil completion:^(NSDictionary<NSString *,UIImage *> * _Nonnull images, NSDictionary<NSString *,NSNumber *> * _Nonnull cacheTypes) {
+        expect([NSThread isMainThread]).beTruthy();
+        expect(images[@"hit"]).equal(image);
+        expect(cacheTypes[@"hit"].integerValue).equal(SDImageCacheTypeMemory);
+        [cancelExpectation fulfill];
+    }];
+    [operation cancel];
+    
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)test66CoalesceDuplicatedQueries {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Duplicated queries for the same key should share one disk read and decode"];
+    expectation.expectedFulfillmentCount = 2;
+    SDImageCache *cache = [[SDImageCache alloc] initWithNamespace:@"CoalesceQuery"];
+    NSData *imageData = [NSData dataWithContentsOfFile:[self testJPEGPath]];
+    [cache storeImageDataToDisk:imageData forKey:kTestImageKeyJPEG];
+    // Does not write back to memory cache, so each decode produce a different image instance
+    SDWebImageContext *context = @{SDWebImageContextStoreCacheType : @(SDImageCacheTypeNone)};
+    
+    __block UIImage *firstImage;
+    SDImageCacheQueryCompletionBlock completion = ^(UIImage * _Nullable image, NSData * _Nullable data, SDImageCacheType cacheType) {
+        expect(image).notTo.beNil();
+        expect(cacheType).equal(SDImageCacheTypeDisk);
+        if (!firstImage) {
+            firstImage = image;
+        } else {
+            expect(image).beIdenticalTo(firstImage);
+        }
+        [expectation fulfill];
+    };
+    SDImageCacheToken *token1 = [cache queryCacheOperationForKey:kTestImageKeyJPEG options:0 context:context done:completion];
+    // Cancel one waiter does not affect others
+    __block BOOL cancelCalled = NO;
+    SDImageCacheToken *token2 = [cache queryCacheOperationForKey:kTestImageKeyJPEG options:0 context:context done:^(UIImage * _Nullable image, NSData * _Nullable data, SDImageCacheType cacheType) {
+        expect(image).beNil();
+        cancelCalled = YES;
+    }];
+    SDImageCacheToken *token3 = [cache queryCacheOperationForKey:kTestImageKeyJPEG options:0 context:context done:completion];
+    expect(token1).notTo.beNil();
+    expect(token2).notTo.beNil();
+    expect(token3).notTo.beNil();
+    [token2 cancel];
+    
+    [self waitForExpectationsWithCommonTimeout];
+    expect(cancelCalled).beTruthy();
+    [cache clearDiskOnCompletion:nil];
+}
+
+- (void)test67DiskCacheReadingPolicy {
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    expect([config diskCacheReadingOptionsForFileSize:1024]).equal(0);
+    expect([config diskCacheReadingOptionsForFileSize:1024 * 1024]).equal(NSDataReadingMappedIfSafe);
+    config.diskCacheUncachedReadingThreshold = 512 * 1024;
+    expect([config diskCacheReadingOptionsForFileSize:1024 * 1024]).equal(NSDataReadingUncached);
+    config.diskCacheWritingOptions = 0;
+    expect([config diskCacheReadingOptionsForFileSize:128 * 1024]).equal(0);
+    
+    // Benchmark, report the syscalls, page faults and resident size of each policy on a mixed size corpus
+    NSString *cachePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SDDiskCacheReadingPolicy"];
+    SDDiskCache *diskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:[[SDImageCacheConfig alloc] init]];
+    NSArray<NSNumber *> *sizes = @[@(2 * 1024), @(16 * 1024), @(64 * 1024), @(256 * 1024), @(2 * 1024 * 1024)];
+    NSMutableArray<NSString *> *keys = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 100; i++) {
+        NSUInteger size = sizes[i % sizes.count].unsignedIntegerValue;
+        NSMutableData *data = [NSMutableData dataWithLength:size];
+        memset(data.mutableBytes, (int)i, size);
+        NSString *key = [NSString stringWithFormat:@"%lu", (unsigned long)i];
+        [diskCache setData:data forKey:key];
+        [keys addObject:key];
+    }
+    NSDictionary<NSString *, SDImageCacheConfig *> *policies = ({
+        SDImageCacheConfig *plain = [[SDImageCacheConfig alloc] init];
+        plain.diskCacheMappedReadingThreshold = 0;
+        SDImageCacheConfig *mapped = [[SDImageCacheConfig alloc] init];
+        mapped.diskCacheMappedReadingThreshold = 0;
+        mapped.diskCacheReadingOptions = NSDataReadingMappedIfSafe;
+        SDImageCacheConfig *adaptive = [[SDImageCacheConfig alloc] init];
+        SDImageCacheConfig *uncached = [[SDImageCacheConfig alloc] init];
+        uncached.diskCacheUncachedReadingThreshold = 1024 * 1024;
+        @{@"plain" : plain, @"mapped" : mapped, @"adaptive" : adaptive, @"uncached" : uncached};
+    });
+    for (NSString *name in policies) {
+        SDDiskCache *policyCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:policies[name]];
+        task_events_info_data_t eventsBefore, eventsAfter;
+        mach_task_basic_info_data_t basicBefore, basicAfter;
+        mach_msg_type_number_t count = TASK_EVENTS_INFO_COUNT;
+        task_info(mach_task_self(), TASK_EVENTS_INFO, (task_info_t)&eventsBefore, &count);
+        count = MACH_TASK_BASIC_INFO_COUNT;
+        task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&basicBefore, &count);
+        NSMutableArray<NSData *> *datas = [NSMutableArray arrayWithCapacity:keys.count];
+        NSUInteger checksum = 0;
+        for (NSString *key in keys) {
+            NSData *data = [policyCache dataForKey:key];
+            expect(data).notTo.beNil();
+            // Touch every page like a decoder
+            const uint8_t *bytes = data.bytes;
+            for (NSUInteger offset = 0; offset < data.length; offset += 4096) {
+                checksum += bytes[offset];
+            }
+            [datas addObject:data];
+        }
+        count = TASK_EVENTS_INFO_COUNT;
+        task_info(mach_task_self(), TASK_EVENTS_INFO, (task_info_t)&eventsAfter, &count);
+        count = MACH_TASK_BASIC_INFO_COUNT;
+        task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&basicAfter, &count);
+        NSLog(@"Disk cache reading policy %@: syscalls %d, page faults %d, resident size %lld KB, checksum %lu", name,
+              (eventsAfter.syscalls_unix + eventsAfter.syscalls_mach) - (eventsBefore.syscalls_unix + eventsBefore.syscalls_mach),
+              eventsAfter.faults - eventsBefore.faults,
+              ((long long)basicAfter.resident_size - (long long)basicBefore.resident_size) / 1024,
+              (unsigned long)checksum);
+    }
+    [diskCache removeAllData];
+}
+
+- (void)test68StoreInWriteLaneWithReadAfterWrite {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Store in write lane should coalesce and keep read-after-write consistency"];
+    expectation.expectedFulfillmentCount = 3;
+    SDImageCache *cache = [[SDImageCache alloc] initWithNamespace:@"WriteLane"];
+    NSData *imageData = [NSData dataWithContentsOfFile:[self testJPEGPath]];
+    UIImage *image = [self testJPEGImage];
+    
+    // Repeated stores for the same key are coalesced, all completion blocks are called
+    [cache storeImage:image imageData:nil forKey:kTestImageKeyJPEG toDisk:YES completion:^{
+        [expectation fulfill];
+    }];
+    [cache storeImage:nil imageData:imageData forKey:kTestImageKeyJPEG toDisk:YES completion:^{
+        // Written to disk
+        expect([cache.diskCache dataForKey:kTestImageKeyJPEG]).notTo.beNil();
+        [expectation fulfill];
+    }];
+    // Pending store is visible to the read
+    expect([cache diskImageDataExistsWithKey:kTestImageKeyJPEG]).beTruthy();
+    expect([cache diskImageDataForKey:kTestImageKeyJPEG]).notTo.beNil();
+    
+    // Remove cancel the pending store
+    [cache storeImage:nil imageData:imageData forKey:kTestImageKeyPNG toDisk:YES completion:^{
+        expect([cache.diskCache dataForKey:kTestImageKeyPNG]).beNil();
+        [expectation fulfill];
+    }];
+    [cache removeImageFromDiskForKey:kTestImageKeyPNG];
+    expect([cache diskImageDataExistsWithKey:kTestImageKeyPNG]).beFalsy();
+    
+    [self waitForExpectationsWithCommonTimeout];
+    [cache clearDiskOnCompletion:nil];
+}
+
+- (void)test69WriteBehindDiskCacheStore {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Write-behind should write the pending stores in batch"];
+    expectation.expectedFulfillmentCount = 10;
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.diskCacheWriteBehindInterval = 0.2;
+    SDImageCache *cache = [[SDImageCache alloc] initWithNamespace:@"WriteBehind" diskCacheDirectory:nil config:config];
+    NSData *imageData = [NSData dataWithContentsOfFile:[self testJPEGPath]];
+    for (NSUInteger i = 0; i < 10; i++) {
+        NSString *key = @(i).stringValue;
+        [cache storeImage:nil imageData:imageData forKey:key toDisk:YES completion:^{
+            expect([cache.diskCache dataForKey:key]).equal(imageData);
+            [expectation fulfill];
+        }];
+    }
+    // Not written yet, but visible to the read
+    expect([cache.diskCache containsDataForKey:@"0"]).beFalsy();
+    expect([cache diskImageDataForKey:@"0"]).equal(imageData);
+    
+    [self waitForExpectationsWithCommonTimeout];
+    
+    // The cancelled pending store still calls its completion
+    XCTestExpectation *cancelExpectation = [self expectationWithDescription:@"Cancelled pending store should call completion"];
+    [cache storeImage:nil imageData:imageData forKey:@"cancelled" toDisk:YES completion:^{
+        expect([cache.diskCache containsDataForKey:@"cancelled"]).beFalsy();
+        [cancelExpectation fulfill];
+    }];
+    [cache removeImageFromDiskForKey:@"cancelled"];
+    [self waitForExpectationsWithCommonTimeout];
+    
+    // Built-in disk cache batch write
+    NSString *cachePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SDDiskCacheBatch"];
+    SDDiskCache *diskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:[[SDImageCacheConfig alloc] init]];
+    [diskCache setDataBatch:@{@"a" : imageData, @"b" : imageData}];
+    expect([diskCache dataForKey:@"a"]).equal(imageData);
+    expect([diskCache dataForKey:@"b"]).equal(imageData);
+    NSNumber *excluded;
+    [[NSURL fileURLWithPath:cachePath isDirectory:YES] getResourceValue:&excluded forKey:NSURLIsExcludedFromBackupKey error:nil];
+    expect(excluded.boolValue).beTruthy();
+    [diskCache removeAllData];
+    [cache clearDiskOnCompletion:nil];
+}
+
+- (void)test70DiskCacheIncrementalTrimWithWatermarks {
+    NSString *cachePath = [[self userCacheDirectory] stringByAppendingPathComponent:@"diskIncrementalTrim"];
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.shouldUseDiskCacheIndex = YES;
+    NSData *data = [@"SDDiskCacheTrim" dataUsingEncoding:NSUTF8StringEncoding];
+    config.maxDiskSize = data.length * 10;
+    config.diskCacheLowWatermarkRatio = 0.5;
+    SDDiskCache *diskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+    [diskCache removeAllData];
+    for (NSUInteger i = 0; i < 10; i++) {
+        [diskCache setData:data forKey:@(i).stringValue];
+    }
+    // Below high watermark, nothing to do
+    expect([diskCache shouldRemoveExpiredData]).beFalsy();
+    expect([diskCache removeExpiredDataWithTimeLimit:0]).beTruthy();
+    expect(diskCache.totalCount).equal(10);
+    
+    // Above high watermark, each zero time limit slice remove one file
+    [diskCache setData:data forKey:@"10"];
+    expect([diskCache shouldRemoveExpiredData]).beTruthy();
+    expect([diskCache removeExpiredDataWithTimeLimit:0]).beFalsy();
+    expect(diskCache.totalCount).equal(10);
+    
+    // Resume after relaunch, until the low watermark, no more
+    SDDiskCache *relaunchedDiskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+    expect([relaunchedDiskCache shouldRemoveExpiredData]).beTruthy();
+    NSUInteger slices = 0;
+    while (![relaunchedDiskCache removeExpiredDataWithTimeLimit:0]) {
+        slices++;
+    }
+    expect(slices).equal(5);
+    expect(relaunchedDiskCache.totalCount).equal(5);
+    expect([relaunchedDiskCache containsDataForKey:@"10"]).beTruthy();
+    expect([relaunchedDiskCache containsDataForKey:@"0"]).beFalsy();
+    
+    // Trimming finished, should not continue below the high watermark
+    [relaunchedDiskCache setData:data forKey:@"11"];
+    expect([relaunchedDiskCache shouldRemoveExpiredData]).beFalsy();
+    expect([relaunchedDiskCache removeExpiredDataWithTimeLimit:0]).beTruthy();
+    expect(relaunchedDiskCache.totalCount).equal(6);
+    [relaunchedDiskCache removeAllData];
+}
+
+- (void)test71DiskCacheFanOutLayoutWithMigration {
+    NSString *cachePath = [[self userCacheDirectory] stringByAppendingPathComponent:@"diskCacheFanOut"];
+    SDImageCacheConfig *flatConfig = [[SDImageCacheConfig alloc] init];
+    SDDiskCache *flatDiskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:flatConfig];
+    [flatDiskCache removeAllData];
+    NSData *data = [@"SDDiskCacheFanOut" dataUsingEncoding:NSUTF8StringEncoding];
+    [flatDiskCache setData:data forKey:@"a"];
+    [flatDiskCache setData:data forKey:@"b"];
+    
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.diskCacheFanOutLevel = 2;
+    SDDiskCache *diskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+    NSString *fileName = [flatDiskCache cachePathForKey:@"c"].lastPathComponent;
+    NSString *expectedPath = [NSString pathWithComponents:@[cachePath, [fileName substringWithRange:NSMakeRange(0, 2)], [fileName substringWithRange:NSMakeRange(2, 2)], fileName]];
+    expect([diskCache cachePathForKey:@"c"]).equal(expectedPath);
+    [diskCache setData:data forKey:@"c"];
+    expect([[NSFileManager defaultManager] fileExistsAtPath:expectedPath]).beTruthy();
+    expect([diskCache dataForKey:@"c"]).equal(data);
+    
+    // Legacy flat file is moved into the fan-out layout on access
+    expect([diskCache dataForKey:@"a"]).equal(data);
+    expect([[NSFileManager defaultManager] fileExistsAtPath:[diskCache cachePathForKey:@"a"]]).beTruthy();
+    expect([[NSFileManager defaultManager] fileExistsAtPath:[flatDiskCache cachePathForKey:@"a"]]).beFalsy();
+    expect(diskCache.totalCount).equal(3);
+    expect(diskCache.totalSize).equal(3 * data.length);
+    
+    // Moving the directory merge the flat files into the fan-out layout
+    NSString *oldCachePath = [[self userCacheDirectory] stringByAppendingPathComponent:@"diskCacheFanOutOld"];
+    SDDiskCache *oldDiskCache = [[SDDiskCache alloc] initWithCachePath:oldCachePath config:flatConfig];
+    [oldDiskCache removeAllData];
+    [oldDiskCache setData:data forKey:@"d"];
+    [diskCache moveCacheDirectoryFromPath:oldCachePath toPath:cachePath];
+    expect([[NSFileManager defaultManager] fileExistsAtPath:[diskCache cachePathForKey:@"d"]]).beTruthy();
+    expect([diskCache dataForKey:@"d"]).equal(data);
+    
+    [diskCache removeDataForKey:@"b"];
+    expect([diskCache containsDataForKey:@"b"]).beFalsy();
+    [diskCache removeAllData];
+}
+
+- (void)test72DiskCacheFanOutLayoutPerformance {
+    // Increase the count to 100k or 500k to compare the large directory
+    NSUInteger count = 10000;
+    NSData *data = [@"SDDiskCacheFanOut" dataUsingEncoding:NSUTF8StringEncoding];
+    for (NSUInteger fanOutLevel = 0; fanOutLevel <= 2; fanOutLevel += 2) {
+        NSString *cachePath = [[self userCacheDirectory] stringByAppendingPathComponent:[NSString stringWithFormat:@"diskCacheFanOut%lu", (unsigned long)fanOutLevel]];
+        SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+        config.diskCacheFanOutLevel = fanOutLevel;
+        SDDiskCache *diskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+        [diskCache removeAllData];
+        NSMutableArray<NSString *> *paths = [NSMutableArray arrayWithCapacity:count];
+        for (NSUInteger i = 0; i < count; i++) {
+            NSString *key = @(i).stringValue;
+            [diskCache setData:data forKey:key];
+            [paths addObject:[diskCache cachePathForKey:key]];
+        }
+        CFAbsoluteTime openDuration = 0, statDuration = 0, unlinkDuration = 0;
+        CFAbsoluteTime begin = CFAbsoluteTimeGetCurrent();
+        for (NSString *path in paths) {
+            int fd = open(path.fileSystemRepresentation, O_RDONLY);
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        openDuration = CFAbsoluteTimeGetCurrent() - begin;
+        begin = CFAbsoluteTimeGetCurrent();
+        for (NSString *path in paths) {
+            struct stat st;
+            stat(path.fileSystemRepresentation, &st);
+        }
+        statDuration = CFAbsoluteTimeGetCurrent() - begin;
+        begin = CFAbsoluteTimeGetCurrent();
+        for (NSString *path in paths) {
+            expect(unlink(path.fileSystemRepresentation)).equal(0);
+        }
+        unlinkDuration = CFAbsoluteTimeGetCurrent() - begin;
+        NSLog(@"Fan-out level %lu with %lu entries, open: %.2fus, stat: %.2fus, unlink: %.2fus", (unsigned long)fanOutLevel, (unsigned long)count, openDuration * 1e6 / count, statDuration * 1e6 / count, unlinkDuration * 1e6 / count);
+        [diskCache removeAllData];
+    }
+}
+
+- (void)test73DiskCacheMurmur3FileNameWithMigration {
+    NSString *cachePath = [[self userCacheDirectory] stringByAppendingPathComponent:@"diskCacheMurmur3"];
+    SDImageCacheConfig *md5Config = [[SDImageCacheConfig alloc] init];
+    SDDiskCache *md5DiskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:md5Config];
+    [md5DiskCache removeAllData];
+    NSData *data = [@"SDDiskCacheMurmur3" dataUsingEncoding:NSUTF8StringEncoding];
+    NSString *key = @"http://example.com/image.png?size=100#fragment";
+    [md5DiskCache setData:data forKey:key];
+    
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.diskCacheFileNameHash = SDImageCacheConfigFileNameHashMurmur3;
+    SDDiskCache *diskCache = [[SDDiskCache alloc] initWithCachePath:cachePath config:config];
+    NSString *fileName = [diskCache cachePathForKey:key].lastPathComponent;
+    expect(fileName.length).equal(32 + 4);
+    expect(fileName.pathExtension).equal(@"png");
+    expect(fileName).notTo.equal([md5DiskCache cachePathForKey:key].lastPathComponent);
+    // Host name is not an extension, only alphanumeric extension is used
+    expect([diskCache cachePathForKey:@"http://example.com"].pathExtension).equal(@"");
+    expect([diskCache cachePathForKey:@"http://example.com/a.p%20g"].pathExtension).equal(@"");
+    expect([diskCache cachePathForKey:@"image.jpg"].pathExtension).equal(@"jpg");
+    
+    // MD5 named file is renamed on access
+    expect([diskCache containsDataForKey:key]).beTruthy();
+    expect([[NSFileManager defaultManager] fileExistsAtPath:[diskCache cachePathForKey:key]]).beTruthy();
+    expect([[NSFileManager defaultManager] fileExistsAtPath:[md5DiskCache cachePathForKey:key]]).beFalsy();
+    expect([diskCache dataForKey:key]).equal(data);
+    [diskCache removeDataForKey:key];
+    expect([diskCache containsDataForKey:key]).beFalsy();
+    [diskCache removeAllData];
+}
+
+- (void)test74DiskCacheFileNamePerformance {
+    NSString *key = @"http://example.com/path/to/image.png?size=100";
+    // Key derivation benchmark, the result is reported per million lookups
+    NSUInteger count = 100000;
+    for (SDImageCacheConfigFileNameHash fileNameHash = SDImageCacheConfigFileNameHashMD5; fileNameHash <= SDImageCacheConfigFileNameHashMurmur3; fileNameHash++) {
+        SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+        config.diskCacheFileNameHash = fileNameHash;
+        SDDiskCache *diskCache = [[SDDiskCache alloc] initWithCachePath:[[self userCacheDirectory] stringByAppendingPathComponent:@"diskCacheFileName"] config:config];
+        CFAbsoluteTime begin = CFAbsoluteTimeGetCurrent();
+        for (NSUInteger i = 0; i < count; i++) {
+            @autoreleasepool {
+                [diskCache cachePathForKey:key];
+            }
+        }
+        CFAbsoluteTime duration = CFAbsoluteTimeGetCurrent() - begin;
+        NSLog(@"File name hash %lu: %.3fs per million lookups", (unsigned long)fileNameHash, duration * 1000000 / count);
+    }
+}
+
+- (void)test75TinyLFUMemoryCacheWithLowPriorityStore {
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.shouldUseWeakMemoryCache = NO;
+    config.maxMemoryCount = 10;
+    // One shard to make the eviction predictable
+    SDLRUMemoryCache *memoryCache = [[SDLRUMemoryCache alloc] initWithConfig:config shardCount:1];
+    memoryCache.evictionPolicy = SDLRUMemoryCacheEvictionPolicyTinyLFU;
+    NSObject *object = [NSObject new];
+    for (NSUInteger i = 0; i < 5; i++) {
+        NSString *key = [NSString stringWithFormat:@"hot%lu", (unsigned long)i];
+        [memoryCache setObject:object forKey:key];
+        for (NSUInteger j = 0; j < 5; j++) {
+            [memoryCache objectForKey:key];
+        }
+    }
+    // Scan with objects accessed twice, which is enough to flush the SLRU protected segment
+    for (NSUInteger i = 0; i < 100; i++) {
+        NSString *key = @(i).stringValue;
+        [memoryCache setObject:object forKey:key];
+        [memoryCache objectForKey:key];
+    }
+    for (NSUInteger i = 0; i < 5; i++) {
+        expect([memoryCache objectForKey:[NSString stringWithFormat:@"hot%lu", (unsigned long)i]]).equal(object);
+    }
+    // The newest object is always available
+    expect([memoryCache objectForKey:@"99"]).equal(object);
+    expect(memoryCache.totalCount).beLessThanOrEqualTo(10);
+    
+    // Low priority object use the free space only
+    config.maxMemoryCount = 3;
+    SDLRUMemoryCache *lruMemoryCache = [[SDLRUMemoryCache alloc] initWithConfig:config shardCount:1];
+    [lruMemoryCache setObject:object forKey:@"1"];
+    [lruMemoryCache setObject:object forKey:@"2"];
+    [lruMemoryCache setObject:object forKey:@"prefetch" cost:0 lowPriority:YES];
+    expect([lruMemoryCache objectForKey:@"prefetch"]).equal(object);
+    [lruMemoryCache setObject:object forKey:@"3"];
+    [lruMemoryCache setObject:object forKey:@"prefetch2" cost:0 lowPriority:YES];
+    expect([lruMemoryCache objectForKey:@"prefetch2"]).beNil();
+    expect([lruMemoryCache objectForKey:@"2"]).equal(object);
+    
+    // Store with context through image cache
+    SDImageCacheConfig *cacheConfig = [[SDImageCacheConfig alloc] init];
+    cacheConfig.memoryCacheClass = [SDWebImageTestMemoryCache class];
+    SDImageCache *imageCache = [[SDImageCache alloc] initWithNamespace:@"LowPriorityStore" diskCacheDirectory:nil config:cacheConfig];
+    SDWebImageTestMemoryCache *testMemoryCache = imageCache.memoryCache;
+    UIImage *image = [self testJPEGImage];
+    [imageCache storeImage:image imageData:nil forKey:kTestImageKeyJPEG cacheType:SDImageCacheTypeMemory completion:nil];
+    [imageCache storeImage:image imageData:nil forKey:kTestImageKeyPNG options:0 context:@{SDWebImageContextMemoryCacheLowPriority : @(YES)} cacheType:SDImageCacheTypeMemory completion:nil];
+    expect([imageCache imageFromMemoryCacheForKey:kTestImageKeyPNG]).equal(image);
+    expect([testMemoryCache.lowPriorityKeys containsObject:kTestImageKeyPNG]).beTruthy();
+    expect([testMemoryCache.lowPriorityKeys containsObject:kTestImageKeyJPEG]).beFalsy();
+}
+
+- (void)test76MemoryPressureCoordinator {
+    SDMemoryPressureCoordinator *coordinator = [[SDMemoryPressureCoordinator alloc] init];
+    expect(coordinator.moderateTargetRatio).equal(0.5);
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.shouldUseWeakMemoryCache = NO;
+    SDLRUMemoryCache *memoryCache = [[SDLRUMemoryCache alloc] initWithConfig:config shardCount:1];
+    NSObject *object = [NSObject new];
+    for (NSUInteger i = 0; i < 10; i++) {
+        [memoryCache setObject:object forKey:@(i).stringValue cost:1];
+    }
+    // Access 0, so it's kept after trimming
+    expect([memoryCache objectForKey:@"0"]).equal(object);
+    self.memoryPressureCache = memoryCache;
+    self.memoryPressureCacheCounts = [NSMutableArray array];
+    // Register the memory cache first, the priority still decides the order
+    [coordinator registerResponder:(id<SDMemoryPressureResponder>)memoryCache priority:SDMemoryPressurePriorityMemoryCache];
+    [coordinator registerResponder:self priority:SDMemoryPressurePriorityAnimatedFrame];
+    
+    // Moderate trim the memory cache to the ratio, by recency
+    [coordinator dispatchMemoryPressure:SDMemoryPressureLevelModerate];
+    expect(coordinator.currentLevel).equal(SDMemoryPressureLevelModerate);
+    expect(self.memoryPressureCacheCounts).equal(@[@(10)]);
+    expect(memoryCache.totalCount).equal(5);
+    expect(memoryCache.totalCost).equal(5);
+    expect([memoryCache objectForKey:@"0"]).equal(object);
+    expect([memoryCache objectForKey:@"1"]).beNil();
+    
+    // Normal does not release anything
+    [coordinator dispatchMemoryPressure:SDMemoryPressureLevelNormal];
+    expect(memoryCache.totalCount).equal(5);
+    
+    // Critical clear the memory cache
+    [coordinator dispatchMemoryPressure:SDMemoryPressureLevelCritical];
+    expect(memoryCache.totalCount).equal(0);
+    
+    [coordinator unregisterResponder:self];
+    [coordinator dispatchMemoryPressure:SDMemoryPressureLevelModerate];
+    expect(self.memoryPressureCacheCounts.count).equal(3);
+    self.memoryPressureCache = nil;
+}
+
+- (void)memoryPressureCoordinator:(SDMemoryPressureCoordinator *)coordinator didReceiveMemoryPressure:(SDMemoryPressureLevel)level {
+    // Record the memory cache count before it responds
+    [self.memoryPressureCacheCounts addObject:@(self.memoryPressureCache.totalCount)];
+}
+
+- (void)test77DecodedBitmapDiskCache {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Decoded bitmap disk cache hit without decoding"];
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.shouldCacheDecodedImagesOnDisk = YES;
+    SDImageCache *cache = [[SDImageCache alloc] initWithNamespace:@"DecodedBitmap" diskCacheDirectory:nil config:config];
+    NSString *bitmapCachePath = [cache.diskCachePath stringByAppendingPathExtension:@"bitmap"];
+    UIImage *image = [SDImageCoderHelper decodedImageWithImage:[self testPNGImage]];
+    UIColor *color = [image sd_colorAtPoint:CGPointMake(150, 150)];
+    [cache clearDiskOnCompletion:^{
+        [cache storeImage:image imageData:nil forKey:kTestImageKeyPNG toDisk:YES completion:^{
+            expect([[NSFileManager defaultManager] contentsOfDirectoryAtPath:bitmapCachePath error:nil].count).equal(1);
+            [cache clearMemory];
+            // The bitmap hit still provides the image data
+            [cache queryCacheOperationForKey:kTestImageKeyPNG done:^(UIImage * _Nullable bitmapImage, NSData * _Nullable data, SDImageCacheType cacheType) {
+                expect(bitmapImage).notTo.beNil();
+                expect(data).notTo.beNil();
+                expect(cacheType).equal(SDImageCacheTypeDisk);
+                expect(bitmapImage.sd_isDecoded).beTruthy();
+                expect(bitmapImage.size).equal(image.size);
+                expect([bitmapImage sd_colorAtPoint:CGPointMake(150, 150)]).equal(color);
+                // The index is rebuilt from the chunk files
+                SDImageCache *reloadedCache = [[SDImageCache alloc] initWithNamespace:@"DecodedBitmap" diskCacheDirectory:nil config:config];
+                [reloadedCache queryCacheOperationForKey:kTestImageKeyPNG done:^(UIImage * _Nullable reloadedImage, NSData * _Nullable reloadedData, SDImageCacheType reloadedCacheType) {
+                    expect(reloadedImage).notTo.beNil();
+                    expect(reloadedImage.sd_isDecoded).beTruthy();
+                    expect(reloadedData).notTo.beNil();
+                    // The options which produce a different image skip the bitmap
+                    [reloadedCache clearMemory];
+                    [reloadedCache queryCacheOperationForKey:kTestImageKeyPNG options:SDImageCacheAvoidDecodeImage done:^(UIImage * _Nullable avoidDecodeImage, NSData * _Nullable avoidDecodeData, SDImageCacheType avoidDecodeCacheType) {
+                        expect(avoidDecodeImage.sd_isDecoded).beFalsy();
+                    }];
+                    // Query the disk only still reads the image data
+                    [cache queryCacheOperationForKey:kTestImageKeyPNG options:0 context:nil cacheType:SDImageCacheTypeDisk done:^(UIImage * _Nullable diskImage, NSData * _Nullable diskData, SDImageCacheType diskCacheType) {
+                        expect(diskData).notTo.beNil();
+                        // Storing new image data makes the bitmap stale
+                        [cache storeImageDataToDisk:diskData forKey:kTestImageKeyPNG];
+                        [cache clearMemory];
+                        [cache queryCacheOperationForKey:kTestImageKeyPNG done:^(UIImage * _Nullable dataImage, NSData * _Nullable imageData, SDImageCacheType dataCacheType) {
+                            expect(dataImage).notTo.beNil();
+                            expect(imageData).notTo.beNil();
+                            [cache clearDiskOnCompletion:^{
+                                expect([[NSFileManager defaultManager] fileExistsAtPath:bitmapCachePath]).beFalsy();
+                                [expectation fulfill];
+                            }];
+                        }];
+                    }];
+                }];
+            }];
+        }];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)test78EncodedDataMemoryTier {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Encoded data memory tier query without disk IO"];
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.shouldCacheImageDataInMemory = YES;
+    SDImageCache *cache = [[SDImageCache alloc] initWithNamespace:@"MemoryData" diskCacheDirectory:nil config:config];
+    NSData *imageData = [NSData dataWithContentsOfFile:[self testJPEGPath]];
+    UIImage *image = [UIImage sd_imageWithData:imageData];
+    [cache storeImage:image imageData:imageData forKey:kTestImageKeyJPEG toDisk:YES completion:^{
+        // Evict the decoded image and remove the file, the query is served from the data in memory
+        [cache removeImageFromMemoryForKey:kTestImageKeyJPEG];
+        [[NSFileManager defaultManager] removeItemAtPath:[cache cachePathForKey:kTestImageKeyJPEG] error:nil];
+        [cache queryCacheOperationForKey:kTestImageKeyJPEG done:^(UIImage * _Nullable dataImage, NSData * _Nullable data, SDImageCacheType cacheType) {
+            expect(dataImage).notTo.beNil();
+            expect(data).equal(imageData);
+            expect(cacheType).equal(SDImageCacheTypeDisk);
+            // Query the data along with the memory image, synchronously
+            __block NSData *memoryData;
+            [cache queryCacheOperationForKey:kTestImageKeyJPEG options:SDImageCacheQueryMemoryData | SDImageCacheQueryMemoryDataSync done:^(UIImage * _Nullable memoryImage, NSData * _Nullable queriedData, SDImageCacheType memoryCacheType) {
+                memoryData = queriedData;
+            }];
+            expect(memoryData).equal(imageData);
+            // Clear memory also clear the data tier
+            [cache clearMemory];
+            [cache queryCacheOperationForKey:kTestImageKeyJPEG done:^(UIImage * _Nullable missImage, NSData * _Nullable missData, SDImageCacheType missCacheType) {
+                expect(missImage).beNil();
+                expect(missData).beNil();
+                [cache clearDiskOnCompletion:^{
+                    [expectation fulfill];
+                }];
+            }];
+        }];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)test79HTTPCacheValidatorStore {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"HTTP cache validator is stored with image data"];
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    config.shouldStoreHTTPCacheValidators = YES;
+    SDImageCache *cache = [[SDImageCache alloc] initWithNamespace:@"HTTPCacheValidator" diskCacheDirectory:nil config:config];
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[NSURL URLWithString:kTestJPEGURL] statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{@"etag" : @"\"abc\"", @"Last-Modified" : @"Wed, 21 Oct 2015 07:28:00 GMT", @"Cache-Control" : @"public, max-age=3600"}];
+    SDHTTPCacheValidator *validator = [SDHTTPCacheValidator validatorWithResponse:response];
+    expect(validator.entityTag).equal(@"\"abc\"");
+    expect(validator.isFresh).beTruthy();
+    expect(validator.canRevalidate).beTruthy();
+    NSData *imageData = [NSData dataWithContentsOfFile:[self testJPEGPath]];
+    [cache storeImage:nil imageData:imageData forKey:kTestImageKeyJPEG options:0 context:@{SDWebImageContextHTTPCacheValidator : validator} cacheType:SDImageCacheTypeDisk completion:^{
+        [cache queryHTTPCacheValidatorForKey:kTestImageKeyJPEG completion:^(SDHTTPCacheValidator * _Nullable storedValidator) {
+            expect(storedValidator).equal(validator);
+            // The new data without validator removes the stale one
+            [cache storeImageData:imageData forKey:kTestImageKeyJPEG completion:^{
+                [cache queryHTTPCacheValidatorForKey:kTestImageKeyJPEG completion:^(SDHTTPCacheValidator * _Nullable emptyValidator) {
+                    // Nothing stored, let manager fallback to `NSURLCache`
+                    expect(emptyValidator).beNil();
+                    [cache clearDiskOnCompletion:^{
+                        [expectation fulfill];
+                    }];
+                }];
+            }];
+        }];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)test80DecodedBitmapDiskCacheEvictsOldestChunk {
+    NSString *cachePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"BitmapEviction"];
+    [[NSFileManager defaultManager] removeItemAtPath:cachePath error:nil];
+    SDImageCacheConfig *config = [[SDImageCacheConfig alloc] init];
+    // Each 512x512 bitmap is 1MB, so 3 records fill a 4MB chunk
+    config.maxDecodedDiskCacheSize = 6.5 * 1024 * 1024;
+    SDBitmapDiskCache *bitmapCache = [[SDBitmapDiskCache alloc] initWithCachePath:cachePath config:config];
+    UIImage *redImage = [self bitmapTestImageWithColor:UIColor.redColor];
+    UIImage *blueImage = [self bitmapTestImageWithColor:UIColor.blueColor];
+    NSData *redData = [bitmapCache bitmapDataWithImage:redImage];
+    NSData *blueData = [bitmapCache bitmapDataWithImage:blueImage];
+    expect(redData).notTo.beNil();
+    // Chunk 0 holds the stale bitmap, chunk 1 holds the replacing one
+    [bitmapCache setBitmapData:redData forKey:@"a"];
+    [bitmapCache setBitmapData:redData forKey:@"b"];
+    [bitmapCache setBitmapData:redData forKey:@"c"];
+    [bitmapCache setBitmapData:blueData forKey:@"a"];
+    [bitmapCache setBitmapData:blueData forKey:@"d"];
+    [bitmapCache setBitmapData:blueData forKey:@"e"];
+    // Access the older chunk, which still must be evicted first
+    expect([bitmapCache imageForKey:@"b"]).notTo.beNil();
+    [bitmapCache setBitmapData:blueData forKey:@"f"];
+    expect([bitmapCache imageForKey:@"b"]).beNil();
+    expect([bitmapCache imageForKey:@"d"]).notTo.beNil();
+    
+    // The stale bitmap is not loaded again
+    SDBitmapDiskCache *reloadedCache = [[SDBitmapDiskCache alloc] initWithCachePath:cachePath config:config];
+    UIImage *image = [reloadedCache imageForKey:@"a"];
+    expect([image sd_colorAtPoint:CGPointMake(10, 10)]).equal([blueImage sd_colorAtPoint:CGPointMake(10, 10)]);
+    expect(reloadedCache.totalCount).equal(4);
+    [reloadedCache removeAllImages];
+}
+
 #pragma mark Helper methods
 
+- (UIImage *)bitmapTestImageWithColor:(UIColor *)color {
+    SDGraphicsImageRendererFormat *format = [SDGraphicsImageRendererFormat preferredFormat];
+    format.scale = 1;
+    SDGraphicsImageRenderer *renderer = [[SDGraphicsImageRenderer alloc] initWithSize:CGSizeMake(512, 512) format:format];
+    return [renderer imageWithActions:^(CGContextRef  _Nonnull context) {
+        CGContextSetFillColorWithColor(context, color.CGColor);
+        CGContextFillRect(context, CGRectMake(0, 0, 512, 512));
+    }];
+}
+
 - (UIImage *)testJPEGImage {
     static UIImage *reusableImage = nil;
     if (!reusableImage) {
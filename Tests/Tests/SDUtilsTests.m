@@ -13,6 +13,8 @@
 #import "SDInternalMacros.h"
 #import "SDFileAttributeHelper.h"
 #import "UIColor+SDHexString.h"
+#import "SDWebImageDownloaderDataBuffer.h"
+#import "SDDownloadedFile.h"
 
 @interface SDUtilsTests : SDTestCase
 
@@ -162,6 +164,71 @@
     };
 }
 
+- (void)testSDWebImageDownloaderDataBuffer {
+    NSData *chunk1 = [@"SDWeb" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *chunk2 = [@"Image" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *chunk3 = [@"Buffer" dataUsingEncoding:NSUTF8StringEncoding];
+    // Unknown capacity
+    SDWebImageDownloaderDataBuffer *buffer = [[SDWebImageDownloaderDataBuffer alloc] initWithCapacity:0];
+    expect(buffer.data.length).equal(0);
+    [buffer appendData:chunk1];
+    // Single chunk does not copy
+    expect(buffer.data).beIdenticalTo(chunk1);
+    [buffer appendData:chunk2];
+    NSData *snapshot = buffer.data;
+    expect(snapshot).equal([@"SDWebImage" dataUsingEncoding:NSUTF8StringEncoding]);
+    // Snapshot does not change after appending, even when the storage grows
+    [buffer appendData:chunk3];
+    expect(buffer.length).equal(16);
+    expect(buffer.data).equal([@"SDWebImageBuffer" dataUsingEncoding:NSUTF8StringEncoding]);
+    expect(snapshot).equal([@"SDWebImage" dataUsingEncoding:NSUTF8StringEncoding]);
+    
+    // Capacity hint, the flatten storage is reused
+    buffer = [[SDWebImageDownloaderDataBuffer alloc] initWithCapacity:16];
+    [buffer appendData:chunk1];
+    [buffer appendData:chunk2];
+    snapshot = buffer.data;
+    [buffer appendData:chunk3];
+    NSData *data = buffer.data;
+    expect(data).equal([@"SDWebImageBuffer" dataUsingEncoding:NSUTF8StringEncoding]);
+    expect(data.bytes == snapshot.bytes).beTruthy();
+    expect(snapshot).equal([@"SDWebImage" dataUsingEncoding:NSUTF8StringEncoding]);
+}
+
+- (void)testSDDownloadedFile {
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SDDownloadedFile"];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+    NSString *path = [directory stringByAppendingPathComponent:@".a.download"];
+    NSString *destinationPath = [directory stringByAppendingPathComponent:@"a"];
+    NSData *content = [@"SDDownloadedFile" dataUsingEncoding:NSUTF8StringEncoding];
+    // The file is removed when the data is released
+    @autoreleasepool {
+        [content writeToFile:path atomically:YES];
+        NSData *data = SDDownloadedFileDataWithPath(path);
+        expect(data).equal(content);
+        data = nil;
+    }
+    expect([[NSFileManager defaultManager] fileExistsAtPath:path]).beFalsy();
+    // The moved file is kept after the data is released, and only moved once
+    @autoreleasepool {
+        [content writeToFile:path atomically:YES];
+        NSData *data = SDDownloadedFileDataWithPath(path);
+        expect(SDDownloadedFileDataMoveToPath(data, destinationPath)).beTruthy();
+        expect(SDDownloadedFileDataMoveToPath(data, path)).beFalsy();
+        expect(data).equal(content);
+        data = nil;
+    }
+    expect([NSData dataWithContentsOfFile:destinationPath]).equal(content);
+    expect(SDDownloadedFileDataMoveToPath(content, path)).beFalsy();
+    // The invalid data removes the file immediately
+    [content writeToFile:path atomically:YES];
+    NSData *data = SDDownloadedFileDataWithPath(path);
+    SDDownloadedFileDataRemove(data);
+    expect([[NSFileManager defaultManager] fileExistsAtPath:path]).beFalsy();
+    expect(SDDownloadedFileDataMoveToPath(data, destinationPath)).beFalsy();
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:nil];
+}
+
 #pragma mark - Helper
 
 - (NSString *)testJPEGPath {
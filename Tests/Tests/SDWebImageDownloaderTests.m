@@ -22,11 +22,119 @@
 @property (nonatomic, weak, nullable) NSOperation<SDWebImageDownloaderOperation> *downloadOperation;
 @end
 
-@interface SDWebImageDownloader ()
-@property (strong, nonatomic, nonnull) NSOperationQueue *downloadQueue;
+@interface SDWebImageDownloader () <NSURLSessionDataDelegate>
+@property (strong, nonatomic) NSURLSession *session;
 @end
 
 
+static NSData *SDWebImageTestHostProtocolImageData;
+static NSString *SDWebImageTestHostProtocolLastRange;
+
+/**
+ *  A stand-in server for multiple hosts, the `stalled.test` host never responds, the `latency.test` host responds after 50ms, the `resume.test` host stalls after the first half and supports range request, the other `.test` hosts respond the image data immediately
+ */
+@interface SDWebImageTestHostProtocol : NSURLProtocol
+@end
+
+@implementation SDWebImageTestHostProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    return [request.URL.host hasSuffix:@".test"];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    if ([self.request.URL.host isEqualToString:@"stalled.test"]) {
+        return;
+    }
+    if ([self.request.URL.host isEqualToString:@"resume.test"]) {
+        [self respondRange];
+        return;
+    }
+    if ([self.request.URL.host isEqualToString:@"latency.test"]) {
+        // The client callbacks should be on the loading thread
+        [self performSelector:@selector(respond) withObject:nil afterDelay:0.05];
+        return;
+    }
+    [self respond];
+}
+
+- (void)respond {
+    NSData *data = SDWebImageTestHostProtocolImageData;
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{@"Content-Type" : @"image/png", @"Content-Length" : @(data.length).stringValue}];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self.client URLProtocol:self didLoadData:data];
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)respondRange {
+    NSData *data = SDWebImageTestHostProtocolImageData;
+    NSString *entityTag = @"\"resume-v1\"";
+    NSString *range = [self.request valueForHTTPHeaderField:@"Range"];
+    SDWebImageTestHostProtocolLastRange = range;
+    NSUInteger start = 0;
+    if (range && [[self.request valueForHTTPHeaderField:@"If-Range"] isEqualToString:entityTag]) {
+        NSScanner *scanner = [NSScanner scannerWithString:range];
+        NSInteger value = 0;
+        if ([scanner scanString:@"bytes=" intoString:nil] && [scanner scanInteger:&value] && value > 0 && value < (NSInteger)data.length) {
+            start = value;
+        }
+    }
+    NSMutableDictionary<NSString *, NSString *> *headers = [@{@"Content-Type" : @"image/png", @"ETag" : entityTag, @"Accept-Ranges" : @"bytes", @"Content-Length" : @(data.length - start).stringValue} mutableCopy];
+    if (start > 0) {
+        headers[@"Content-Range"] = [NSString stringWithFormat:@"bytes %lu-%lu/%lu", (unsigned long)start, (unsigned long)data.length - 1, (unsigned long)data.length];
+    }
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:start > 0 ? 206 : 200 HTTPVersion:@"HTTP/1.1" headerFields:headers];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    if (start > 0) {
+        [self.client URLProtocol:self didLoadData:[data subdataWithRange:NSMakeRange(start, data.length - start)]];
+        [self.client URLProtocolDidFinishLoading:self];
+    } else {
+        // Stall after the first half, like a cell scrolled off
+        [self.client URLProtocol:self didLoadData:[data subdataWithRange:NSMakeRange(0, data.length / 2)]];
+    }
+}
+
+- (void)stopLoading {
+    [NSObject cancelPreviousPerformRequestsWithTarget:self];
+}
+
+@end
+
+@interface SDWebImageTestMetricsDelegate : NSObject <SDWebImageDownloaderMetricsDelegate>
+
+@property (nonatomic, copy, nullable) void (^reportBlock)(SDWebImageDownloaderMetricsSnapshot * _Nonnull snapshot);
+
+@end
+
+@implementation SDWebImageTestMetricsDelegate
+
+- (void)imageDownloader:(SDWebImageDownloader *)downloader didReportMetrics:(SDWebImageDownloaderMetricsSnapshot *)snapshot {
+    if (self.reportBlock) {
+        self.reportBlock(snapshot);
+    }
+}
+
+@end
+
+@interface SDWebImageTestConcurrencyController : NSObject <SDWebImageDownloaderConcurrencyController>
+
+@property (atomic, assign) NSUInteger sampleCount;
+
+@end
+
+@implementation SDWebImageTestConcurrencyController
+
+- (NSInteger)concurrentDownloadCountWithSample:(SDWebImageDownloaderConcurrencySample *)sample currentCount:(NSInteger)currentCount {
+    self.sampleCount++;
+    return currentCount;
+}
+
+@end
+
 @interface SDWebImageDownloaderTests : SDTestCase
 
 @property (nonatomic, strong) NSMutableArray<NSURL *> *executionOrderURLs;
@@ -813,6 +921,335 @@
     [self waitForExpectationsWithCommonTimeout];
 }
 
+- (void)test32OperationWithTaskPerformance {
+    // Change the count to 10 to compare, the cost for each delegate callback should be flat
+    NSUInteger operationCount = 1000;
+    SDWebImageDownloaderConfig *config = [[SDWebImageDownloaderConfig alloc] init];
+    config.operationClass = [SDWebImageTestDownloadOperation class];
+    config.maxConcurrentDownloads = operationCount;
+    SDWebImageDownloader *downloader = [[SDWebImageDownloader alloc] initWithConfig:config];
+    NSMutableArray<SDWebImageDownloadToken *> *tokens = [NSMutableArray arrayWithCapacity:operationCount];
+    for (NSUInteger i = 0; i < operationCount; i++) {
+        NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:kPlaceholderTestURLTemplate, (int)i]];
+        [tokens addObject:[downloader downloadImageWithURL:url completed:nil]];
+    }
+    // Test operation keep running, assign a task which is never resumed
+    SDWebImageTestDownloadOperation *operation = (SDWebImageTestDownloadOperation *)tokens.lastObject.downloadOperation;
+    NSURLSessionDataTask *task = [downloader.session dataTaskWithURL:operation.request.URL];
+    operation.dataTask = task;
+    NSData *data = [NSData data];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 10000; i++) {
+            [downloader URLSession:downloader.session dataTask:task didReceiveData:data];
+        }
+    }];
+    [task cancel];
+    [downloader cancelAllDownloads];
+    [downloader invalidateSessionAndCancel:YES];
+}
+
+- (void)test33ThatHTTPCacheValidatorSendsConditionalRequest {
+    SDWebImageDownloader *downloader = [[SDWebImageDownloader alloc] init];
+    NSURL *imageURL = [NSURL URLWithString:kTestJPEGURL];
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:imageURL statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{@"ETag" : @"\"abc\"", @"Last-Modified" : @"Wed, 21 Oct 2015 07:28:00 GMT", @"Cache-Control" : @"no-cache"}];
+    SDHTTPCacheValidator *validator = [SDHTTPCacheValidator validatorWithResponse:response];
+    expect(validator.isFresh).beFalsy();
+    UIImage *cachedImage = [[UIImage alloc] initWithContentsOfFile:[self testPNGPath]];
+    SDWebImageDownloadToken *token = (SDWebImageDownloadToken *)[downloader requestImageWithURL:imageURL options:SDWebImageRefreshCached context:@{SDWebImageContextHTTPCacheValidator : validator, SDWebImageContextLoaderCachedImage : cachedImage} progress:nil completed:nil];
+    // The validator replaces NSURLCache
+    expect([token.request valueForHTTPHeaderField:@"If-None-Match"]).equal(@"\"abc\"");
+    expect([token.request valueForHTTPHeaderField:@"If-Modified-Since"]).equal(@"Wed, 21 Oct 2015 07:28:00 GMT");
+    expect(token.request.cachePolicy).equal(NSURLRequestReloadIgnoringLocalCacheData);
+    [token cancel];
+    [downloader invalidateSessionAndCancel:YES];
+}
+
+- (void)test34DownloaderPrioritySchedulerPerformance {
+    NSUInteger operationCount = 2000;
+    SDWebImageDownloaderConfig *config = [[SDWebImageDownloaderConfig alloc] init];
+    config.operationClass = [SDWebImageTestDownloadOperation class];
+    config.maxConcurrentDownloads = 1;
+    // Enqueue cost, should be flat for each operation
+    [self measureBlock:^{
+        SDWebImageDownloader *downloader = [[SDWebImageDownloader alloc] initWithConfig:config];
+        downloader.suspended = YES;
+        for (NSUInteger i = 0; i < operationCount; i++) {
+            NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:kPlaceholderTestURLTemplate, (int)i]];
+            [downloader downloadImageWithURL:url options:SDWebImageDownloaderLowPriority progress:nil completed:nil];
+        }
+        [downloader cancelAllDownloads];
+        [downloader invalidateSessionAndCancel:YES];
+    }];
+    
+    // Time to start the highest priority one, which is raised after enqueue
+    SDWebImageDownloader *downloader = [[SDWebImageDownloader alloc] initWithConfig:config];
+    downloader.suspended = YES;
+    NSMutableArray<SDWebImageDownloadToken *> *tokens = [NSMutableArray arrayWithCapacity:operationCount];
+    for (NSUInteger i = 0; i < operationCount; i++) {
+        NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:kPlaceholderTestURLTemplate, (int)i]];
+        [tokens addObject:[downloader downloadImageWithURL:url options:SDWebImageDownloaderLowPriority progress:nil completed:nil]];
+    }
+    expect(downloader.currentDownloadCount).equal(operationCount);
+    SDWebImageDownloadToken *visibleToken = tokens[operationCount / 2];
+    visibleToken.priority = NSURLSessionTaskPriorityHigh;
+    expect(visibleToken.priority).equal(NSURLSessionTaskPriorityHigh);
+    NSOperation *visibleOperation = visibleToken.downloadOperation;
+    [self keyValueObservingExpectationForObject:visibleOperation keyPath:NSStringFromSelector(@selector(isExecuting)) expectedValue:@YES];
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    downloader.suspended = NO;
+    [self waitForExpectationsWithCommonTimeout];
+    NSLog(@"Time to start the highest priority download: %.3fms", (CFAbsoluteTimeGetCurrent() - startTime) * 1000);
+    // The FIFO order keeps the first enqueued one waiting
+    expect(tokens.firstObject.downloadOperation.isExecuting).beFalsy();
+    [downloader cancelAllDownloads];
+    [downloader invalidateSessionAndCancel:YES];
+    
+    // The shared operation takes the highest priority of the live tokens
+    SDWebImageDownloader *sharedDownloader = [[SDWebImageDownloader alloc] initWithConfig:config];
+    sharedDownloader.suspended = YES;
+    NSURL *sharedURL = [NSURL URLWithString:[NSString stringWithFormat:kPlaceholderTestURLTemplate, 0]];
+    SDWebImageDownloadToken *urgentToken = [sharedDownloader downloadImageWithURL:sharedURL options:SDWebImageDownloaderHighPriority progress:nil completed:nil];
+    SDWebImageDownloadToken *idleToken = [sharedDownloader downloadImageWithURL:sharedURL options:0 progress:nil completed:nil];
+    expect(idleToken.downloadOperation).equal(urgentToken.downloadOperation);
+    idleToken.priority = NSURLSessionTaskPriorityLow;
+    expect(urgentToken.priority).equal(NSURLSessionTaskPriorityHigh);
+    [urgentToken cancel];
+    expect(idleToken.priority).equal(NSURLSessionTaskPriorityLow);
+    [sharedDownloader cancelAllDownloads];
+    [sharedDownloader invalidateSessionAndCancel:YES];
+}
+
+- (void)test35ThatPerHostLimitKeepsFastHostUnaffectedByStalledHost {
+    SDWebImageTestHostProtocolImageData = [NSData dataWithContentsOfFile:[self testPNGPath]];
+    SDWebImageDownloaderConfig *config = [[SDWebImageDownloaderConfig alloc] init];
+    NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    sessionConfiguration.protocolClasses = @[[SDWebImageTestHostProtocol class]];
+    config.sessionConfiguration = sessionConfiguration;
+    config.maxConcurrentDownloads = 4;
+    config.maxConcurrentDownloadsPerHost = 2;
+    config.maxPendingDownloadsPerHost = 4;
+    SDWebImageDownloader *downloader = [[SDWebImageDownloader alloc] initWithConfig:config];
+    
+    // 2 running, 4 pending, the last 4 enqueued are dropped
+    NSUInteger stalledCount = 10;
+    __block NSUInteger droppedCount = 0;
+    XCTestExpectation *droppedExpectation = [self expectationWithDescription:@"Exceeded pending downloads are dropped"];
+    droppedExpectation.expectedFulfillmentCount = 4;
+    droppedExpectation.assertForOverFulfill = NO; // The stalled ones are cancelled at last
+    for (NSUInteger i = 0; i < stalledCount; i++) {
+        NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"https://stalled.test/%d.png", (int)i]];
+        [downloader downloadImageWithURL:url options:0 progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+            expect(error.code).equal(SDWebImageErrorCancelled);
+            droppedCount++;
+            [droppedExpectation fulfill];
+        }];
+    }
+    // Dropped asynchronously, not inside `downloadImageWithURL:` which holds the downloader lock
+    expect(droppedCount).equal(0);
+    // The FIFO order without per-host limit would keep these waiting behind the stalled ones
+    NSUInteger fastCount = 6;
+    XCTestExpectation *fastExpectation = [self expectationWithDescription:@"Fast host downloads are not blocked"];
+    fastExpectation.expectedFulfillmentCount = fastCount;
+    for (NSUInteger i = 0; i < fastCount; i++) {
+        NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"https://fast.test/%d.png", (int)i]];
+        [downloader downloadImageWithURL:url options:0 progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+            expect(error).beNil();
+            expect(image).notTo.beNil();
+            [fastExpectation fulfill];
+        }];
+    }
+    
+    [self waitForExpectationsWithCommonTimeout];
+    expect(droppedCount).equal(4);
+    // The stalled host still takes only its 2 slots with 4 pending
+    expect(downloader.currentDownloadCount).equal(6);
+    [downloader invalidateSessionAndCancel:YES];
+}
+
+- (void)test36ThatAIMDConcurrencyControllerConvergesOnSimulatedNetwork {
+    SDWebImageDownloaderAIMDConcurrencyController *controller = [[SDWebImageDownloaderAIMDConcurrencyController alloc] init];
+    controller.maximumConcurrentDownloads = 32;
+    controller.sampleCount = 4;
+    // The bandwidth is shared by the concurrent downloads, and the server queues the requests beyond 6 connections
+    NSTimeInterval latency = 0.2, transferTime = 0.05, queueingTime = 0.1;
+    NSInteger count = 2;
+    NSMutableArray<NSNumber *> *counts = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 400; i++) {
+        NSTimeInterval queueing = MAX(count - 6, 0) * queueingTime;
+        NSTimeInterval timeToFirstByte = latency + queueing;
+        NSTimeInterval duration = timeToFirstByte + count * transferTime + MAX(count - 6, 0) * queueingTime;
+        SDWebImageDownloaderConcurrencySample *sample = [[SDWebImageDownloaderConcurrencySample alloc] initWithDuration:duration timeToFirstByte:timeToFirstByte receivedBytes:10240 retryCount:0 failed:NO];
+        count = [controller concurrentDownloadCountWithSample:sample currentCount:count];
+        [counts addObject:@(count)];
+    }
+    expect(controller.concurrentDownloadCount).equal(count);
+    // Probes around the best concurrency instead of the maximum
+    NSArray<NSNumber *> *lastCounts = [counts subarrayWithRange:NSMakeRange(counts.count - 100, 100)];
+    NSNumber *maxCount = [lastCounts valueForKeyPath:@"@max.self"];
+    NSNumber *minCount = [lastCounts valueForKeyPath:@"@min.self"];
+    expect(maxCount.integerValue).beLessThanOrEqualTo(10);
+    expect(minCount.integerValue).beGreaterThanOrEqualTo(3);
+    
+    // Back off immediately on failure
+    SDWebImageDownloaderConcurrencySample *failedSample = [[SDWebImageDownloaderConcurrencySample alloc] initWithDuration:15 timeToFirstByte:15 receivedBytes:0 retryCount:0 failed:YES];
+    expect([controller concurrentDownloadCountWithSample:failedSample currentCount:8]).equal(4);
+}
+
+- (void)test37ThatConcurrencyControllerAdjustsDownloaderWithLocalServer {
+    SDWebImageTestHostProtocolImageData = [NSData dataWithContentsOfFile:[self testPNGPath]];
+    SDWebImageDownloaderConfig *config = [[SDWebImageDownloaderConfig alloc] init];
+    NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    sessionConfiguration.protocolClasses = @[[SDWebImageTestHostProtocol class]];
+    config.sessionConfiguration = sessionConfiguration;
+    config.maxConcurrentDownloads = 2;
+    SDWebImageDownloaderAIMDConcurrencyController *controller = [[SDWebImageDownloaderAIMDConcurrencyController alloc] init];
+    controller.maximumConcurrentDownloads = 8;
+    controller.sampleCount = 4;
+    config.concurrencyController = controller;
+    SDWebImageDownloader *downloader = [[SDWebImageDownloader alloc] initWithConfig:config];
+    
+    // The constant latency makes more concurrency always better
+    NSUInteger downloadCount = 32;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Downloads with concurrency controller"];
+    expectation.expectedFulfillmentCount = downloadCount;
+    for (NSUInteger i = 0; i < downloadCount; i++) {
+        NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"https://latency.test/%d.png", (int)i]];
+        [downloader downloadImageWithURL:url options:0 progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+            expect(error).beNil();
+            [expectation fulfill];
+        }];
+    }
+    
+    [self waitForExpectationsWithCommonTimeout];
+    expect(controller.concurrentDownloadCount).beGreaterThan(2);
+    expect(config.maxConcurrentDownloads).equal(2);
+    [downloader invalidateSessionAndCancel:YES];
+}
+
+- (void)test38ThatDownloaderAggregatesMetricsByHostAndContentType {
+    SDWebImageTestHostProtocolImageData = [NSData dataWithContentsOfFile:[self testPNGPath]];
+    SDWebImageDownloaderConfig *config = [[SDWebImageDownloaderConfig alloc] init];
+    NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    sessionConfiguration.protocolClasses = @[[SDWebImageTestHostProtocol class]];
+    config.sessionConfiguration = sessionConfiguration;
+    config.shouldCollectMetrics = YES;
+    config.metricsReportInterval = 0.5;
+    SDWebImageDownloader *downloader = [[SDWebImageDownloader alloc] initWithConfig:config];
+    
+    NSUInteger downloadCount = 3;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Downloads with metrics"];
+    expectation.expectedFulfillmentCount = downloadCount;
+    for (NSUInteger i = 0; i < downloadCount; i++) {
+        NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"https://fast.test/%d.png", (int)i]];
+        [downloader downloadImageWithURL:url options:0 progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+            [expectation fulfill];
+        }];
+    }
+    [self waitForExpectationsWithCommonTimeout];
+    
+    // The operation completion block runs after the completed block
+    XCTestExpectation *snapshotExpectation = [self expectationWithDescription:@"Metrics snapshot"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kMinDelayNanosecond), dispatch_get_main_queue(), ^{
+        SDWebImageDownloaderMetricsSnapshot *snapshot = downloader.metricsCollector.snapshot;
+        expect(snapshot.totalMetrics.requestCount).equal(downloadCount);
+        expect(snapshot.totalMetrics.errorRate).equal(0);
+        expect(snapshot.totalMetrics.receivedBytes).beGreaterThan(0);
+        expect(snapshot.hostMetrics[@"fast.test"].requestCount).equal(downloadCount);
+        expect(snapshot.contentTypeMetrics[@"image/png"].requestCount).equal(downloadCount);
+        expect(snapshot.totalMetrics.timeToFirstByteHistogram.bucketCounts.count).equal(SDWebImageLatencyHistogram.bucketUpperBounds.count);
+        [snapshotExpectation fulfill];
+    });
+    [self waitForExpectationsWithCommonTimeout];
+    
+    // The periodic report resets the window
+    XCTestExpectation *reportExpectation = [self expectationWithDescription:@"Metrics report"];
+    SDWebImageTestMetricsDelegate *delegate = [SDWebImageTestMetricsDelegate new];
+    delegate.reportBlock = ^(SDWebImageDownloaderMetricsSnapshot * _Nonnull reportSnapshot) {
+        expect(reportSnapshot.totalMetrics.requestCount).equal(downloadCount);
+        expect(downloader.metricsCollector.snapshot.totalMetrics.requestCount).equal(0);
+        [reportExpectation fulfill];
+    };
+    downloader.metricsDelegate = delegate;
+    [self waitForExpectationsWithCommonTimeout];
+    downloader.metricsDelegate = nil;
+    [downloader invalidateSessionAndCancel:YES];
+}
+
+- (void)test39ThatCancelledDownloadResumesWithRangeRequest {
+    SDWebImageTestHostProtocolImageData = [NSData dataWithContentsOfFile:[self testPNGPath]];
+    SDWebImageTestHostProtocolLastRange = nil;
+    SDWebImageDownloaderConfig *config = [[SDWebImageDownloaderConfig alloc] init];
+    NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    sessionConfiguration.protocolClasses = @[[SDWebImageTestHostProtocol class]];
+    config.sessionConfiguration = sessionConfiguration;
+    config.maxResumableDataMemorySize = 10 * 1024 * 1024;
+    config.minimumResumableDataSize = 1;
+    SDWebImageDownloader *downloader = [[SDWebImageDownloader alloc] initWithConfig:config];
+    NSURL *url = [NSURL URLWithString:@"https://resume.test/large.png"];
+    NSUInteger halfLength = SDWebImageTestHostProtocolImageData.length / 2;
+    
+    // Cancel after the first half received
+    XCTestExpectation *cancelExpectation = [self expectationWithDescription:@"Download cancelled with partial data"];
+    __block SDWebImageDownloadToken *token;
+    __block BOOL cancelled = NO;
+    token = [downloader downloadImageWithURL:url options:0 progress:^(NSInteger receivedSize, NSInteger expectedSize, NSURL * _Nullable targetURL) {
+        if (receivedSize < (NSInteger)halfLength) {
+            return;
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (!cancelled) {
+                cancelled = YES;
+                [token cancel];
+            }
+        });
+    } completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+        expect(error.code).equal(SDWebImageErrorCancelled);
+        [cancelExpectation fulfill];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+    expect(SDWebImageTestHostProtocolLastRange).beNil();
+    
+    // Request the remaining bytes only
+    XCTestExpectation *resumeExpectation = [self expectationWithDescription:@"Download resumed"];
+    [downloader downloadImageWithURL:url options:0 progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+        expect(error).beNil();
+        expect(image).notTo.beNil();
+        expect(data).equal(SDWebImageTestHostProtocolImageData);
+        [resumeExpectation fulfill];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+    expect(SDWebImageTestHostProtocolLastRange).equal([NSString stringWithFormat:@"bytes=%lu-", (unsigned long)halfLength]);
+    [downloader invalidateSessionAndCancel:YES];
+}
+
+- (void)test40ThatFinishedDownloadsReachMetricsCollectorAndConcurrencyController {
+    SDWebImageTestHostProtocolImageData = [NSData dataWithContentsOfFile:[self testPNGPath]];
+    SDWebImageDownloaderConfig *config = [[SDWebImageDownloaderConfig alloc] init];
+    NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    sessionConfiguration.protocolClasses = @[[SDWebImageTestHostProtocol class]];
+    config.sessionConfiguration = sessionConfiguration;
+    config.shouldCollectMetrics = YES;
+    SDWebImageTestConcurrencyController *controller = [SDWebImageTestConcurrencyController new];
+    config.concurrencyController = controller;
+    SDWebImageDownloader *downloader = [[SDWebImageDownloader alloc] initWithConfig:config];
+    
+    // The operation has finished and dropped its task when the completed block called, the metrics should be processed before that
+    NSUInteger downloadCount = 2;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Each finished download is measured"];
+    expectation.expectedFulfillmentCount = downloadCount;
+    for (NSUInteger i = 0; i < downloadCount; i++) {
+        NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"https://fast.test/metrics-%d.png", (int)i]];
+        [downloader downloadImageWithURL:url options:0 progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, BOOL finished) {
+            expect(error).beNil();
+            [expectation fulfill];
+        }];
+    }
+    [self waitForExpectationsWithCommonTimeout];
+    expect(controller.sampleCount).equal(downloadCount);
+    expect(downloader.metricsCollector.snapshot.totalMetrics.requestCount).equal(downloadCount);
+    [downloader invalidateSessionAndCancel:YES];
+}
+
 #pragma mark - Helper
 
 - (NSString *)testPNGPath {
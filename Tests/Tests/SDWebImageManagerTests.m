@@ -538,6 +538,72 @@
     [self waitForExpectationsWithTimeout:kAsyncTestTimeout * 5 handler:nil];
 }
 
+- (void)test20ThatStreamToDiskCacheWorks {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Stream to disk cache should write the downloaded data into disk cache directly"];
+    NSURL *url = [NSURL URLWithString:@"http://via.placeholder.com/503x503.png"];
+    NSString *key = [SDWebImageManager.sharedManager cacheKeyForURL:url];
+    [SDImageCache.sharedImageCache removeImageFromMemoryForKey:key];
+    [SDImageCache.sharedImageCache removeImageFromDiskForKey:key];
+    NSString *cachePath = [SDImageCache.sharedImageCache cachePathForKey:key];
+    
+    [SDWebImageManager.sharedManager loadImageWithURL:url options:SDWebImageStreamToDiskCache | SDWebImageWaitStoreCache progress:nil completed:^(UIImage * _Nullable image, NSData * _Nullable data, NSError * _Nullable error, SDImageCacheType cacheType, BOOL finished, NSURL * _Nullable imageURL) {
+        expect(error).beNil();
+        expect(image.size).equal(CGSizeMake(503, 503));
+        // The file is moved into place, and no temporary file left
+        NSData *diskData = [NSData dataWithContentsOfFile:cachePath];
+        expect(diskData).equal(data);
+        NSArray<NSString *> *fileNames = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:cachePath.stringByDeletingLastPathComponent error:nil];
+        for (NSString *fileName in fileNames) {
+            expect([fileName hasSuffix:@".download"]).beFalsy();
+        }
+        expect([SDImageCache.sharedImageCache imageFromMemoryCacheForKey:key]).equal(image);
+        [SDImageCache.sharedImageCache removeImageFromMemoryForKey:key];
+        [SDImageCache.sharedImageCache removeImageFromDiskForKey:key];
+        [expectation fulfill];
+    }];
+    
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)test21ThatCacheKeyIsMemoizedForSameInputs {
+    SDWebImageManager *manager = [[SDWebImageManager alloc] initWithCache:[[SDImageCache alloc] initWithNamespace:@"CacheKeyMemoize"] loader:SDWebImageDownloader.sharedDownloader];
+    NSURL *url = [NSURL URLWithString:@"http://example.com/image.png"];
+    SDImageFlippingTransformer *transformer = [SDImageFlippingTransformer transformerWithHorizontal:YES vertical:NO];
+    SDWebImageContext *context = @{SDWebImageContextImageTransformer : transformer, SDWebImageContextImageThumbnailPixelSize : @(CGSizeMake(100, 100))};
+    NSString *key = [manager cacheKeyForURL:url context:context];
+    NSString *expectedKey = SDTransformedKeyForKey(SDThumbnailedKeyForKey(url.absoluteString, CGSizeMake(100, 100), YES), transformer.transformerKey);
+    expect(key).equal(expectedKey);
+    // Same inputs return the same key object
+    expect([manager cacheKeyForURL:url context:[context copy]] == key).beTruthy();
+    // Different inputs does not share the memoized key
+    SDWebImageContext *otherContext = @{SDWebImageContextImageTransformer : transformer, SDWebImageContextImageThumbnailPixelSize : @(CGSizeMake(100, 100)), SDWebImageContextImagePreserveAspectRatio : @(NO)};
+    expect([manager cacheKeyForURL:url context:otherContext]).equal(SDTransformedKeyForKey(SDThumbnailedKeyForKey(url.absoluteString, CGSizeMake(100, 100), NO), transformer.transformerKey));
+    // The transformer is matched by its key, not the instance
+    SDImageFlippingTransformer *sameTransformer = [SDImageFlippingTransformer transformerWithHorizontal:YES vertical:NO];
+    SDWebImageContext *sameContext = @{SDWebImageContextImageTransformer : sameTransformer, SDWebImageContextImageThumbnailPixelSize : @(CGSizeMake(100, 100))};
+    expect([manager cacheKeyForURL:url context:sameContext] == key).beTruthy();
+    // The cache key filter is not memoized
+    __block NSString *filteredKey = @"filtered";
+    manager.cacheKeyFilter = [SDWebImageCacheKeyFilter cacheKeyFilterWithBlock:^NSString * _Nullable(NSURL * _Nonnull imageURL) {
+        return filteredKey;
+    }];
+    expect([manager cacheKeyForURL:url context:nil]).equal(@"filtered");
+    filteredKey = @"refiltered";
+    expect([manager cacheKeyForURL:url context:nil]).equal(@"refiltered");
+    manager.cacheKeyFilter = nil;
+    
+    // Key derivation benchmark, the result is reported per million lookups
+    NSUInteger count = 100000;
+    CFAbsoluteTime begin = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < count; i++) {
+        @autoreleasepool {
+            [manager cacheKeyForURL:url context:context];
+        }
+    }
+    CFAbsoluteTime duration = CFAbsoluteTimeGetCurrent() - begin;
+    NSLog(@"Memoized cache key derivation: %.3fs per million lookups", duration * 1000000 / count);
+}
+
 - (NSString *)testJPEGPath {
     NSBundle *testBundle = [NSBundle bundleForClass:[self class]];
     return [testBundle pathForResource:@"TestImage" ofType:@"jpg"];
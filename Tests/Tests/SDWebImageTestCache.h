@@ -16,6 +16,7 @@
 
 @property (nonatomic, strong, nonnull) SDImageCacheConfig *config;
 @property (nonatomic, strong, nonnull) NSCache *cache;
+@property (nonatomic, strong, nonnull) NSMutableSet *lowPriorityKeys;
 
 @end
 
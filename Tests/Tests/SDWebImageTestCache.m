@@ -20,6 +20,7 @@ static NSString * const SDWebImageTestDiskCacheExtendedAttributeName = @"com.hac
     if (self) {
         self.config = config;
         self.cache = [[NSCache alloc] init];
+        self.lowPriorityKeys = [NSMutableSet set];
     }
     return self;
 }
@@ -44,6 +45,13 @@ static NSString * const SDWebImageTestDiskCacheExtendedAttributeName = @"com.hac
     [self.cache setObject:object forKey:key cost:cost];
 }
 
+- (void)setObject:(nullable id)object forKey:(nonnull id)key cost:(NSUInteger)cost lowPriority:(BOOL)lowPriority {
+    [self.cache setObject:object forKey:key cost:cost];
+    if (lowPriority) {
+        [self.lowPriorityKeys addObject:key];
+    }
+}
+
 @end
 
 @implementation SDWebImageTestDiskCache
@@ -17,5 +17,6 @@
 
 @property (nonatomic, strong, nullable) NSURLRequest *request;
 @property (nonatomic, strong, nullable) NSURLResponse *response;
+@property (nonatomic, strong, nullable) NSURLSessionTask *dataTask;
 
 @end
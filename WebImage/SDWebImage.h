@@ -23,7 +23,10 @@ FOUNDATION_EXPORT const unsigned char SDWebImageVersionString[];
 #import <SDWebImage/SDImageCacheConfig.h>
 #import <SDWebImage/SDImageCache.h>
 #import <SDWebImage/SDMemoryCache.h>
+#import <SDWebImage/SDLRUMemoryCache.h>
+#import <SDWebImage/SDMemoryPressureCoordinator.h>
 #import <SDWebImage/SDDiskCache.h>
+#import <SDWebImage/SDPackedDiskCache.h>
 #import <SDWebImage/SDImageCacheDefine.h>
 #import <SDWebImage/SDImageCachesManager.h>
 #import <SDWebImage/UIView+WebCache.h>
@@ -33,6 +36,9 @@ FOUNDATION_EXPORT const unsigned char SDWebImageVersionString[];
 #import <SDWebImage/SDWebImageDownloaderOperation.h>
 #import <SDWebImage/SDWebImageDownloaderRequestModifier.h>
 #import <SDWebImage/SDWebImageDownloaderResponseModifier.h>
+#import <SDWebImage/SDWebImageDownloaderConcurrencyController.h>
+#import <SDWebImage/SDWebImageDownloaderMetrics.h>
+#import <SDWebImage/SDHTTPCacheValidator.h>
 #import <SDWebImage/SDWebImageDownloaderDecryptor.h>
 #import <SDWebImage/SDImageLoader.h>
 #import <SDWebImage/SDImageLoadersManager.h>